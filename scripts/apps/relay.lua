@@ -170,6 +170,26 @@ function on_request_stat(server, client, request)
     })
 end
 
+function on_request_graph(server, client, request)
+    if not request then return nil end
+
+    if relay_stat_pass then
+        if request.headers['authorization'] ~= relay_stat_pass then
+            server:send(client, {
+                code = 401,
+                headers = {
+                    "WWW-Authenticate: Basic realm=\"Astra Relay\"",
+                    "Content-Length: 0",
+                    "Connection: close",
+                }
+            })
+            return nil
+        end
+    end
+
+    http_graph_on_request(server, client, request)
+end
+
 -- oooooooooo ooooo            o   ooooo  oooo ooooo       ooooo  oooooooo8 ooooooooooo
 --  888    888 888            888    888  88    888         888  888        88  888  88
 --  888oooo88  888           8  88     888      888         888   888oooooo     888
@@ -437,6 +457,7 @@ function main()
     log.info("Astra Relay started on " .. relay_addr .. ":" .. relay_port)
 
     local route = {
+        { "/stat/graph", on_request_graph },
         { "/stat/", on_request_stat },
         { "/stat", http_redirect({ location = "/stat/" }) },
     }
@@ -18,14 +18,37 @@
 -- along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 options_usage = [[
+    --graph ADDR:PORT   serve stream module graph as JSON at /graph
+    --graph-timing      measure time spent in each stream module
     FILE                Astra script
 ]]
 
+config_filename = nil
+graph_addr = nil
+graph_port = nil
+
 options = {
+    ["--graph"] = function(idx)
+        local value = argv[idx + 1] or ""
+        local addr, port = value:match("^(.*):(%d+)$")
+        if not addr then
+            print("invalid --graph value, expected ADDR:PORT")
+            astra.exit(1)
+        end
+        if addr == "" then addr = "0.0.0.0" end
+        graph_addr = addr
+        graph_port = tonumber(port)
+        return 1
+    end,
+    ["--graph-timing"] = function(idx)
+        astra.graph_timing(true)
+        return 0
+    end,
     ["*"] = function(idx)
         local filename = argv[idx]
         local stat, stat_err = utils.stat(filename)
         if stat and stat.type == "file" then
+            config_filename = filename
             dofile(filename)
             return 0
         else
@@ -37,4 +60,26 @@ options = {
 
 function main()
     log.info("Starting " .. astra.fullname)
+
+    if graph_port then
+        http_server({
+            addr = graph_addr,
+            port = graph_port,
+            route = {
+                { "/graph", http_graph_on_request },
+            },
+        })
+        log.info("Stream graph available at http://" .. graph_addr .. ":"
+                 .. graph_port .. "/graph")
+    end
+end
+
+-- SIGHUP: re-read configuration, restarting changed channels only
+function on_sighup()
+    if not config_filename then return end
+
+    log.info("Reloading " .. config_filename)
+    reload_channels(function()
+        dofile(config_filename)
+    end)
 end
@@ -503,6 +503,16 @@ init_input_module.udp = function(conf)
             socket_size = conf.socket_size,
             renew = conf.renew,
             rtp = conf.rtp,
+            reorder = conf.reorder,
+            reorder_ms = conf.reorder_ms,
+            fec = conf.fec,
+            batch = conf.batch,
+            rx_thread = conf.rx_thread,
+            rx_ring = conf.rx_ring,
+            busy_poll = conf.busy_poll,
+            cpu = conf.cpu,
+            timestamps = conf.timestamps,
+            shared = conf.shared,
         })
     end
 
@@ -1077,6 +1087,7 @@ Common Options:
     -h, --help          command line arguments
     -v, --version       version number
     --pid FILE          create PID-file
+    --workers COUNT     run channels on COUNT worker threads
     --syslog NAME       send log messages to syslog
     --log FILE          write log to file
     --no-stdout         do not print log messages into console
@@ -1122,6 +1133,15 @@ astra_options = {
         pidfile(argv[idx + 1])
         return 1
     end,
+    ["--workers"] = function(idx)
+        local count = tonumber(argv[idx + 1])
+        if count == nil then
+            print("--workers: this option requires a number")
+            astra.exit(1)
+        end
+        worker.start(count)
+        return 1
+    end,
     ["--syslog"] = function(idx)
         if argv[idx + 1] == nil then
             print("--syslog: this option requires an argument")
@@ -38,6 +38,19 @@ function on_analyze_spts(channel_data, input_id, data)
 
     elseif data.analyze then
 
+        -- receive statistics of network inputs, see channel_init_input()
+        local net = data.input
+        if net and net.kernel_drops then
+            local last = input_data.kernel_drops
+            if last and net.kernel_drops > last then
+                log.warning("[" .. input_data.config.name .. "] Kernel dropped "
+                            .. (net.kernel_drops - last) .. " datagrams."
+                            .. " Queue:" .. net.queue_max .. "/" .. net.rcvbuf
+                            .. " bytes, increase socket_size")
+            end
+            input_data.kernel_drops = net.kernel_drops
+        end
+
         if data.on_air ~= input_data.on_air then
             local analyze_message = "[" .. input_data.config.name .. "] Bitrate:" .. data.total.bitrate .. "Kbit/s"
 
@@ -154,12 +167,21 @@ function channel_init_input(channel_data, input_id)
     input_data.input = init_input(input_data.config)
 
     if input_data.config.no_analyze ~= true then
+        local input_module = input_data.input.input
+        local input_stats = nil
+        if type(input_module) == "table" and input_module.stats then
+            input_stats = function() return input_module:stats() end
+        end
+
         input_data.analyze = analyze({
             upstream = input_data.input.tail:stream(),
             name = input_data.config.name,
             cc_limit = input_data.config.cc_limit,
             bitrate_limit = input_data.config.bitrate_limit,
             callback = function(data)
+                if data.analyze and input_stats then
+                    data.input = input_stats()
+                end
                 on_analyze_spts(channel_data, input_id, data)
             end,
         })
@@ -297,6 +319,17 @@ init_output_module.udp = function(channel_data, output_id)
         rtp = (output_data.config.format == "rtp"),
         sync = output_data.config.sync,
         sync_opts = output_data.config.sync_opts,
+        sync_thread = output_data.config.sync_thread,
+        sync_cpu = output_data.config.sync_cpu,
+        txtime = output_data.config.txtime,
+        txtime_lead = output_data.config.txtime_lead,
+        txtime_tai = output_data.config.txtime_tai,
+        pacing = output_data.config.pacing,
+        batch = output_data.config.batch,
+        batch_ms = output_data.config.batch_ms,
+        gso = output_data.config.gso,
+        fec = output_data.config.fec,
+        fec_row = output_data.config.fec_row,
     })
 end
 
@@ -370,6 +403,7 @@ function http_output_client(server, client, request)
         server = server,
         client = client,
         request = request,
+        output_data = client_data.output_data,
         st   = os.time(),
     }
 end
@@ -416,12 +450,29 @@ function http_output_on_request(server, client, request)
             upstream = channel_data.tail:stream(),
             buffer_size = client_data.output_data.config.buffer_size,
             buffer_fill = client_data.output_data.config.buffer_fill,
+            overflow = client_data.output_data.config.overflow,
+            stat = http_output_client_list[client_data.client_id],
         })
     end
 
     allow_channel()
 end
 
+-- Route callback: dump astra.graph() as JSON
+function http_graph_on_request(server, client, request)
+    if not request then return nil end
+
+    server:send(client, {
+        code = 200,
+        headers = {
+            "Content-Type: application/json",
+            "Cache-Control: no-cache",
+            "Connection: close",
+        },
+        content = json.encode(astra.graph()),
+    })
+end
+
 init_output_module.http = function(channel_data, output_id)
     local output_data = channel_data.output[output_id]
 
@@ -454,8 +505,9 @@ kill_output_module.http = function(channel_data, output_id)
     local instance = output_data.instance
     local instance_id = output_data.instance_id
 
+    -- the server may be shared with other channels; only drop our clients
     for _, client in pairs(http_output_client_list) do
-        if client.server == instance then
+        if client.server == instance and client.output_data == output_data then
             instance:close(client.client)
         end
     end
@@ -760,12 +812,89 @@ end
 
 channel_list = {}
 
-function make_channel(channel_config)
+-- serialize config value into a string suitable for comparison
+local function config_dump(value, out, seen)
+    local t = type(value)
+    if t == "table" then
+        if seen[value] then
+            table.insert(out, "<cycle>")
+            return
+        end
+        seen[value] = true
+
+        local keys = {}
+        for k in pairs(value) do table.insert(keys, k) end
+        table.sort(keys, function(a, b)
+            local ta, tb = type(a), type(b)
+            if ta ~= tb then return ta < tb end
+            if ta == "number" or ta == "string" then return a < b end
+            return tostring(a) < tostring(b)
+        end)
+
+        table.insert(out, "{")
+        for _, k in ipairs(keys) do
+            config_dump(k, out, seen)
+            table.insert(out, "=")
+            config_dump(value[k], out, seen)
+            table.insert(out, ",")
+        end
+        table.insert(out, "}")
+
+        seen[value] = nil
+    elseif t == "function" then
+        -- same code compares equal even if the closure was re-created
+        local ok, code = pcall(string.dump, value)
+        table.insert(out, ok and code or tostring(value))
+    elseif t == "string" then
+        table.insert(out, string.format("%q", value))
+    else
+        table.insert(out, t .. ":" .. tostring(value))
+    end
+end
+
+local function config_signature(value)
+    local out = {}
+    config_dump(value, out, {})
+    return table.concat(out)
+end
+
+-- signatures of channel config: everything but outputs, and each output
+local function channel_signature(channel_config)
+    local base = {}
+    for k, v in pairs(channel_config) do
+        if k ~= "output" then base[k] = v end
+    end
+
+    local output = {}
+    for n, o in ipairs(channel_config.output or {}) do
+        output[n] = config_signature(o)
+    end
+
+    return { base = config_signature(base), output = output }
+end
+
+-- number of outputs keeping channel input running without HTTP clients
+local function channel_static_clients(output_list)
+    if #output_list == 0 then return 1 end
+
+    local clients = 0
+    for _, o in pairs(output_list) do
+        if o.config.format ~= "http" or o.config.keep_active == true then
+            clients = clients + 1
+        end
+    end
+    return clients
+end
+
+-- validate config and prepare channel data without creating modules
+local function channel_prepare(channel_config)
     if not channel_config.name then
         log.error("[make_channel] option 'name' is required")
         return nil
     end
 
+    local signature = channel_signature(channel_config)
+
     if not channel_config.input or #channel_config.input == 0 then
         log.error("[" .. channel_config.name .. "] option 'input' is required")
         return nil
@@ -783,6 +912,7 @@ function make_channel(channel_config)
 
     local channel_data = {
         config = channel_config,
+        signature = signature,
         input = {},
         transform = {},
         output = {},
@@ -825,34 +955,239 @@ function make_channel(channel_config)
     if not check_url_format("transform") then return nil end
     if not check_url_format("output") then return nil end
 
-    if #channel_data.output == 0 then
-        channel_data.clients = 1
-    else
+    if channel_config.worker == nil then channel_config.worker = 0 end
+    if channel_config.worker ~= 0 then
+        if channel_config.worker < 0 or channel_config.worker > worker.count() then
+            log.error("[" .. channel_config.name .. "] worker #" .. channel_config.worker .. " is not running")
+            return nil
+        end
+        for _, o in pairs(channel_data.input) do
+            if o.config.format == "http" or o.config.format == "dvb" then
+                log.error("[" .. channel_config.name .. "] " .. o.config.format .. " input is not supported on workers")
+                return nil
+            end
+        end
         for _, o in pairs(channel_data.output) do
-            if o.config.format ~= "http" or o.config.keep_active == true then
-                channel_data.clients = channel_data.clients + 1
+            if o.config.format == "http" or o.config.format == "np" then
+                log.error("[" .. channel_config.name .. "] " .. o.config.format .. " output is not supported on workers")
+                return nil
             end
         end
     end
 
+    channel_data.clients = channel_static_clients(channel_data.output)
     channel_data.active_input_id = 0
-    channel_data.transmit = transmit()
-    channel_data.tail = channel_data.transmit
 
-    for xfrm_id in ipairs(channel_data.transform) do
-        stream_init_transform(channel_data, xfrm_id)
+    return channel_data
+end
+
+-- create module instances for a prepared channel
+local function channel_start(channel_data)
+    local channel_config = channel_data.config
+
+    -- module instances are serviced by the thread that created them
+    worker.run(channel_config.worker, function()
+        channel_data.transmit = transmit()
+        channel_data.tail = channel_data.transmit
+
+        for xfrm_id in ipairs(channel_data.transform) do
+            stream_init_transform(channel_data, xfrm_id)
+        end
+
+        if channel_data.clients > 0 then
+            channel_init_input(channel_data, 1)
+        end
+
+        for output_id in ipairs(channel_data.output) do
+            channel_init_output(channel_data, output_id)
+        end
+    end)
+
+    table.insert(channel_list, channel_data)
+    return channel_data
+end
+
+-- outputs can be swapped in place unless they alter the shared tail
+local function channel_output_is_simple(output_list)
+    for _, o in pairs(output_list) do
+        for key in pairs(o.config) do
+            if init_output_option[key] then return false end
+        end
+    end
+    return true
+end
+
+-- apply new output list to a running channel
+local function channel_update_output(channel_data, fresh)
+    local old_sig = channel_data.signature.output
+    local new_sig = fresh.signature.output
+
+    -- match unchanged outputs, in order
+    local used = {}
+    local output_list = {}
+    local created = {}
+    for n, sig in ipairs(new_sig) do
+        local match = nil
+        for i, o in ipairs(old_sig) do
+            if not used[i] and o == sig then
+                match = i
+                break
+            end
+        end
+        if match then
+            used[match] = true
+            output_list[n] = channel_data.output[match]
+        else
+            output_list[n] = fresh.output[n]
+            table.insert(created, n)
+        end
+    end
+
+    local old_clients = channel_static_clients(channel_data.output)
+    local new_clients = channel_static_clients(output_list)
+    local name = channel_data.config.name
+
+    worker.run(channel_data.config.worker, function()
+        for i in ipairs(channel_data.output) do
+            if not used[i] then
+                channel_kill_output(channel_data, i)
+                log.info("[" .. name .. "] removed output #" .. i)
+            end
+        end
+
+        channel_data.output = output_list
+        for n, o in ipairs(output_list) do
+            o.config.name = name .. " #" .. n
+        end
+
+        for _, n in ipairs(created) do
+            channel_init_output(channel_data, n)
+            log.info("[" .. name .. "] added output #" .. n)
+        end
+
+        -- start or stop input if the number of static clients changed
+        channel_data.clients = channel_data.clients + new_clients - old_clients
+        if channel_data.clients > 0 and not channel_data.input[1].input then
+            channel_init_input(channel_data, 1)
+        elseif channel_data.clients == 0 and channel_data.input[1].input then
+            for input_id, input_data in ipairs(channel_data.input) do
+                if input_data.input then
+                    channel_kill_input(channel_data, input_id)
+                end
+            end
+            channel_data.active_input_id = 0
+        end
+    end)
+
+    channel_data.signature = fresh.signature
+    channel_data.config.output = fresh.config.output
+end
+
+-- compare new config with a running channel and apply the difference
+local function channel_reload(channel_data, channel_config)
+    local name = channel_config.name
+
+    if channel_config.enable == false then
+        kill_channel(channel_data)
+        log.info("[" .. name .. "] channel is disabled")
+        return nil
     end
 
-    if channel_data.clients > 0 then
-        channel_init_input(channel_data, 1)
+    local fresh = channel_prepare(channel_config)
+    if not fresh then
+        log.error("[" .. name .. "] invalid configuration, keeping running channel")
+        return channel_data
     end
 
-    for output_id in ipairs(channel_data.output) do
-        channel_init_output(channel_data, output_id)
+    local old_sig = channel_data.signature
+    local new_sig = fresh.signature
+
+    if old_sig.base == new_sig.base then
+        if table.concat(old_sig.output, "\0") == table.concat(new_sig.output, "\0") then
+            return channel_data -- unchanged
+        end
+
+        if channel_output_is_simple(channel_data.output)
+           and channel_output_is_simple(fresh.output)
+        then
+            channel_update_output(channel_data, fresh)
+            return channel_data
+        end
     end
 
-    table.insert(channel_list, channel_data)
-    return channel_data
+    kill_channel(channel_data)
+    log.info("[" .. name .. "] configuration changed, restarting channel")
+
+    return channel_start(fresh)
+end
+
+-- in-place reload state; set while re-evaluating configuration.
+-- running channels are queued by name, since names needn't be unique,
+-- and tracked by object until the new configuration claims them
+local reload_state = nil
+
+function make_channel(channel_config)
+    if reload_state and channel_config.name then
+        local queue = reload_state.by_name[channel_config.name]
+        if queue and #queue > 0 then
+            local channel_data = table.remove(queue, 1)
+            reload_state.unclaimed[channel_data] = nil
+            return channel_reload(channel_data, channel_config)
+        end
+    end
+
+    local channel_data = channel_prepare(channel_config)
+    if not channel_data then return nil end
+
+    return channel_start(channel_data)
+end
+
+-- re-evaluate configuration by calling func(), then kill channels
+-- it didn't define. channels with unchanged config keep running.
+function reload_channels(func)
+    if reload_state then
+        log.error("[reload] reload is already in progress")
+        return false
+    end
+
+    reload_state = { by_name = {}, unclaimed = {} }
+    for _, channel_data in ipairs(channel_list) do
+        local name = channel_data.config.name
+        local queue = reload_state.by_name[name]
+        if not queue then
+            queue = {}
+            reload_state.by_name[name] = queue
+        end
+        table.insert(queue, channel_data)
+        reload_state.unclaimed[channel_data] = true
+    end
+
+    local ok, err = pcall(func)
+    local unclaimed = reload_state.unclaimed
+    reload_state = nil
+
+    if not ok then
+        log.error("[reload] " .. tostring(err))
+        log.error("[reload] configuration error, remaining channels are left as is")
+        return false
+    end
+
+    -- kill_channel() edits channel_list; collect first
+    local orphans = {}
+    for _, channel_data in ipairs(channel_list) do
+        if unclaimed[channel_data] then
+            table.insert(orphans, channel_data)
+        end
+    end
+
+    for _, channel_data in ipairs(orphans) do
+        local name = channel_data.config.name
+        kill_channel(channel_data)
+        log.info("[" .. name .. "] channel removed")
+    end
+
+    collectgarbage()
+    return true
 end
 
 function kill_channel(channel_data)
@@ -871,22 +1206,25 @@ function kill_channel(channel_data)
         return nil
     end
 
-    while #channel_data.input > 0 do
-        channel_kill_input(channel_data, 1)
-        table.remove(channel_data.input, 1)
-    end
-    channel_data.input = nil
+    -- modules are destroyed by the thread servicing them
+    worker.run(channel_data.config.worker, function()
+        while #channel_data.input > 0 do
+            channel_kill_input(channel_data, 1)
+            table.remove(channel_data.input, 1)
+        end
 
-    while #channel_data.transform > 0 do
-        stream_kill_transform(channel_data, 1)
-        table.remove(channel_data.transform, 1)
-    end
-    channel_data.transform = nil
+        while #channel_data.transform > 0 do
+            stream_kill_transform(channel_data, 1)
+            table.remove(channel_data.transform, 1)
+        end
 
-    while #channel_data.output > 0 do
-        channel_kill_output(channel_data, 1)
-        table.remove(channel_data.output, 1)
-    end
+        while #channel_data.output > 0 do
+            channel_kill_output(channel_data, 1)
+            table.remove(channel_data.output, 1)
+        end
+    end)
+    channel_data.input = nil
+    channel_data.transform = nil
     channel_data.output = nil
 
     channel_data.tail = nil
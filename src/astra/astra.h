@@ -113,6 +113,13 @@
 #define __asc_result
 #endif /* !__GNUC__ */
 
+/* storage class for per-thread variables */
+#ifdef HAVE_THREAD_LOCAL
+#   define __asc_thread __thread
+#else /* HAVE_THREAD_LOCAL */
+#   define __asc_thread
+#endif /* !HAVE_THREAD_LOCAL */
+
 static inline
 uint32_t asc_get_be32(const void *ptr)
 {
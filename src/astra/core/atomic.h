@@ -0,0 +1,67 @@
+/*
+ * Astra Core (Atomic operations)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ASC_ATOMIC_H_
+#define _ASC_ATOMIC_H_ 1
+
+#ifndef _ASTRA_H_
+#   error "Please include <astra/astra.h> first"
+#endif /* !_ASTRA_H_ */
+
+/*
+ * Thin wrappers around compiler atomic builtins. Only use these on
+ * naturally aligned variables no wider than a pointer.
+ */
+
+/* sequentially consistent */
+#define asc_atomic_load(_ptr) \
+    __atomic_load_n((_ptr), __ATOMIC_SEQ_CST)
+
+#define asc_atomic_store(_ptr, _val) \
+    __atomic_store_n((_ptr), (_val), __ATOMIC_SEQ_CST)
+
+#define asc_atomic_exchange(_ptr, _val) \
+    __atomic_exchange_n((_ptr), (_val), __ATOMIC_SEQ_CST)
+
+#define asc_atomic_fetch_add(_ptr, _val) \
+    __atomic_fetch_add((_ptr), (_val), __ATOMIC_SEQ_CST)
+
+#define asc_atomic_fetch_sub(_ptr, _val) \
+    __atomic_fetch_sub((_ptr), (_val), __ATOMIC_SEQ_CST)
+
+#define asc_atomic_cas(_ptr, _expected, _desired) \
+    __atomic_compare_exchange_n((_ptr), (_expected), (_desired), false \
+                                , __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+/* acquire/release pairs for publishing data to another thread */
+#define asc_atomic_load_acquire(_ptr) \
+    __atomic_load_n((_ptr), __ATOMIC_ACQUIRE)
+
+#define asc_atomic_store_release(_ptr, _val) \
+    __atomic_store_n((_ptr), (_val), __ATOMIC_RELEASE)
+
+/* no ordering; counters and statistics */
+#define asc_atomic_load_relaxed(_ptr) \
+    __atomic_load_n((_ptr), __ATOMIC_RELAXED)
+
+#define asc_atomic_store_relaxed(_ptr, _val) \
+    __atomic_store_n((_ptr), (_val), __ATOMIC_RELAXED)
+
+#endif /* _ASC_ATOMIC_H_ */
@@ -79,6 +79,32 @@ void asc_usleep(uint64_t usec)
 #endif
 }
 
+/* block calling thread until asc_utime() reaches `utime' */
+void asc_usleep_until(uint64_t utime)
+{
+#if defined(HAVE_CLOCK_NANOSLEEP) && !defined(_WIN32)
+    /* absolute deadline; doesn't accumulate wake up latency */
+    const struct timespec ts =
+    {
+        .tv_sec = utime / 1000000ULL,
+        .tv_nsec = (utime % 1000000ULL) * 1000L,
+    };
+
+    int ret;
+    do
+    {
+        ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    } while (ret == EINTR);
+
+    if (ret == 0)
+        return;
+#endif /* HAVE_CLOCK_NANOSLEEP && !_WIN32 */
+
+    const uint64_t now = asc_utime();
+    if (utime > now)
+        asc_usleep(utime - now);
+}
+
 #ifndef _WIN32
 /* get RTC timestamp `offset_ms' milliseconds into the future */
 void asc_rtctime(struct timespec *ts, unsigned long offset_ms)
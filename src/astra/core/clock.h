@@ -28,6 +28,7 @@
 
 uint64_t asc_utime(void) __asc_result;
 void asc_usleep(uint64_t usec);
+void asc_usleep_until(uint64_t utime);
 #ifndef _WIN32
 void asc_rtctime(struct timespec *ts, unsigned long offset_ms);
 #endif
@@ -22,7 +22,7 @@
 #include <astra/core/error.h>
 
 /* FIXME: use platform-specific TLS routines */
-static /*__thread*/ char msg_buf[1024];
+static __asc_thread char msg_buf[1024];
 
 char *asc_strerror(int errnum, char *buf, size_t buflen)
 {
@@ -29,6 +29,16 @@
 
 #define MSG(_msg) "[event-epoll] " _msg
 
+#ifdef WITH_EVENT_URING
+/* built as a fallback for the io_uring backend, see event-priv.h */
+#   define asc_event_core_init epoll_core_init
+#   define asc_event_core_destroy epoll_core_destroy
+#   define asc_event_core_loop epoll_core_loop
+#   define asc_event_subscribe epoll_subscribe
+#   define asc_event_init epoll_event_init
+#   define asc_event_close epoll_event_close
+#endif /* WITH_EVENT_URING */
+
 typedef struct
 {
     asc_list_t *list;
@@ -39,7 +49,7 @@ typedef struct
     size_t out_size;
 } asc_event_mgr_t;
 
-static asc_event_mgr_t *event_mgr = NULL;
+static __asc_thread asc_event_mgr_t *event_mgr = NULL;
 
 void asc_event_core_init(void)
 {
@@ -81,12 +91,17 @@ bool asc_event_core_loop(unsigned int timeout)
 {
     if (asc_list_count(event_mgr->list) == 0)
     {
+        const unsigned int depth = lua_api_suspend();
         asc_usleep(timeout * 1000ULL); /* dry run */
+        lua_api_resume(depth);
+
         return true;
     }
 
+    const unsigned int depth = lua_api_suspend();
     const int ret = epoll_wait(event_mgr->fd, event_mgr->out
                                , event_mgr->out_size, timeout);
+    lua_api_resume(depth);
 
     if (ret == -1 && errno != EINTR)
     {
@@ -37,7 +37,7 @@ typedef struct
     size_t out_size;
 } asc_event_mgr_t;
 
-static asc_event_mgr_t *event_mgr = NULL;
+static __asc_thread asc_event_mgr_t *event_mgr = NULL;
 
 void asc_event_core_init(void)
 {
@@ -79,7 +79,10 @@ bool asc_event_core_loop(unsigned int timeout)
 {
     if (asc_list_count(event_mgr->list) == 0)
     {
+        const unsigned int depth = lua_api_suspend();
         asc_usleep(timeout * 1000ULL); /* dry run */
+        lua_api_resume(depth);
+
         return true;
     }
 
@@ -88,8 +91,10 @@ bool asc_event_core_loop(unsigned int timeout)
         (timeout % 1000) * 1000000UL, /* tv_nsec */
     };
 
+    const unsigned int depth = lua_api_suspend();
     const int ret = kevent(event_mgr->fd, NULL, 0, event_mgr->out
                            , event_mgr->out_size, &ts);
+    lua_api_resume(depth);
 
     if (ret == -1 && errno != EINTR)
     {
@@ -50,7 +50,7 @@ typedef struct
     bool is_changed;
 } asc_event_mgr_t;
 
-static asc_event_mgr_t *event_mgr = NULL;
+static __asc_thread asc_event_mgr_t *event_mgr = NULL;
 
 #ifdef _WIN32
 /*
@@ -95,12 +95,14 @@ void wait_thread_proc(void *arg, BOOLEAN timedout)
         if (ret == 0 && (ne.lNetworkEvents & FD_CONNECT)
             && ne.iErrorCode[FD_CONNECT_BIT] != 0)
         {
-            asc_job_queue(event, (loop_callback_t)wait_connect_fail, event);
+            asc_job_send(event->loop, event
+                         , (loop_callback_t)wait_connect_fail, event);
         }
     }
     else
     {
-        asc_job_queue(event, (loop_callback_t)wait_unregister, event);
+        asc_job_send(event->loop, event
+                     , (loop_callback_t)wait_unregister, event);
     }
 }
 
@@ -109,6 +111,9 @@ void wait_register(asc_event_t *event)
 {
     HANDLE wait = NULL;
 
+    /* wait callback runs on a pool thread; remember where to send jobs */
+    event->loop = asc_main_loop_current();
+
     const HANDLE conn_evt = CreateEventW(NULL, TRUE, FALSE, NULL);
     if (conn_evt == NULL)
     {
@@ -176,11 +181,16 @@ bool asc_event_core_loop(unsigned int timeout)
 {
     if (event_mgr->ev_cnt == 0)
     {
+        const unsigned int depth = lua_api_suspend();
         asc_usleep(timeout * 1000ULL); /* dry run */
+        lua_api_resume(depth);
+
         return true;
     }
 
+    const unsigned int depth = lua_api_suspend();
     int ret = poll(event_mgr->fd, event_mgr->ev_cnt, timeout);
+    lua_api_resume(depth);
 #ifndef _WIN32
     if (ret == -1 && errno != EINTR)
 #else
@@ -201,7 +211,8 @@ bool asc_event_core_loop(unsigned int timeout)
         ret--;
         asc_event_t *const event = event_mgr->ev[i];
 
-        const bool is_rd = revents & (POLLRDNORM | POLLRDHUP | POLLHUP);
+        const bool is_rd = revents & (POLLIN | POLLRDNORM
+                                      | POLLRDHUP | POLLHUP);
         const bool is_wr = revents & POLLOUT;
         const bool is_er = revents & (POLLERR | POLLNVAL | POLLHUP | POLLBAND);
 
@@ -278,7 +289,7 @@ void asc_event_subscribe(asc_event_t *event)
 
     event_mgr->fd[i].events = 0;
     if (event->on_read)
-        event_mgr->fd[i].events |= (POLLRDNORM | POLLRDHUP);
+        event_mgr->fd[i].events |= (POLLIN | POLLRDNORM | POLLRDHUP);
     if (event->on_write)
         event_mgr->fd[i].events |= POLLOUT;
     if (event->on_error)
@@ -25,6 +25,17 @@
 #include <astra/astra.h>
 #include <astra/core/list.h>
 #include <astra/core/event.h>
+#include <astra/luaapi/state.h>
+
+/*
+ * Backends release the Lua lock only while blocked in the kernel, so
+ * worker loops can run Lua code meanwhile and callbacks always run
+ * with the lock held.
+ */
+
+#if defined(_WIN32) && defined(WITH_EVENT_POLL)
+#   include <astra/core/mainloop.h>
+#endif
 
 struct asc_event_t
 {
@@ -38,11 +49,30 @@ struct asc_event_t
     /* these are for WSAPoll non-blocking connect() workaround */
     HANDLE conn_evt;
     HANDLE wait;
+    asc_main_loop_t *loop;
+#endif
+
+#ifdef WITH_EVENT_URING
+    event_recv_callback_t on_recv;
+    uint32_t slot;
+    uint32_t poll_seq;
+    uint32_t recv_seq;
+    unsigned int poll_mask;
 #endif
 };
 
 void asc_event_subscribe(asc_event_t *event);
 
+#ifdef WITH_EVENT_URING
+/* epoll backend, used when io_uring is unavailable at run time */
+void epoll_core_init(void);
+void epoll_core_destroy(void);
+bool epoll_core_loop(unsigned int timeout);
+void epoll_subscribe(asc_event_t *event);
+asc_event_t *epoll_event_init(int fd, void *arg);
+void epoll_event_close(asc_event_t *event);
+#endif /* WITH_EVENT_URING */
+
 /* minimum size for output arrays */
 #define EVENT_LIST_MIN_SIZE 1024
 
@@ -50,7 +50,7 @@ typedef struct
     fd_set emaster;
 } asc_event_mgr_t;
 
-static asc_event_mgr_t *event_mgr = NULL;
+static __asc_thread asc_event_mgr_t *event_mgr = NULL;
 
 void asc_event_core_init(void)
 {
@@ -109,7 +109,10 @@ bool asc_event_core_loop(unsigned int timeout)
 {
     if (event_mgr->max_fd < 0)
     {
+        const unsigned int depth = lua_api_suspend();
         asc_usleep(timeout * 1000ULL); /* dry run */
+        lua_api_resume(depth);
+
         return true;
     }
 
@@ -125,7 +128,9 @@ bool asc_event_core_loop(unsigned int timeout)
         .tv_usec = (timeout % 1000) * 1000UL,
     };
 
+    const unsigned int depth = lua_api_suspend();
     int ret = select(event_mgr->max_fd + 1, &rset, &wset, &eset, &tv);
+    lua_api_resume(depth);
 #ifndef _WIN32
     if (ret == -1 && errno != EINTR)
 #else
@@ -0,0 +1,847 @@
+/*
+ * Astra Core (Event notification)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * io_uring backend (Linux 5.19+).
+ *
+ * Readiness is delivered through one-shot IORING_OP_POLL_ADD requests
+ * that are re-armed after each completion, which keeps the level
+ * triggered semantics of the other backends. All pending requests are
+ * submitted by the same io_uring_enter() call that waits for
+ * completions, so there is one system call per loop iteration.
+ *
+ * Events with a receive callback use multishot IORING_OP_RECV with
+ * kernel-selected buffers from a shared buffer ring; datagrams are
+ * handed to the callback without any further system calls.
+ */
+
+#include "event-priv.h"
+#include <astra/core/atomic.h>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+
+#ifndef POLLRDHUP
+#   define POLLRDHUP 0
+#endif
+
+#define MSG(_msg) "[event-uring] " _msg
+
+/* submission queue size; completion queue is twice as large */
+#define URING_ENTRIES 1024
+
+/* provided buffers for receive requests */
+#define URING_BUF_COUNT 1024 /* must be a power of two */
+#define URING_BUF_SIZE 2048
+#define URING_BUF_GROUP 0
+
+/* user_data for requests whose completions are ignored */
+#define URING_UD_IGNORE UINT64_MAX
+
+/* initial size of the slot table */
+#define URING_SLOTS_MIN 64
+
+/*
+ * user_data is made of event slot index (low 32 bits) and request
+ * sequence number (high 32 bits). completions with sequence numbers
+ * not matching any active request on that slot are stale and dropped.
+ */
+#define UD_MAKE(_slot, _seq) (((uint64_t)(_seq) << 32) | (_slot))
+#define UD_SLOT(_ud) ((uint32_t)((_ud) & 0xFFFFFFFF))
+#define UD_SEQ(_ud) ((uint32_t)((_ud) >> 32))
+
+typedef struct
+{
+    asc_event_t *event;
+    uint32_t next_free;
+} uring_slot_t;
+
+typedef struct
+{
+    asc_list_t *list;
+
+    int fd;
+    unsigned int to_submit;
+    uint32_t seq;
+
+    /* submission queue */
+    void *sq_ptr;
+    size_t sq_size;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    /* completion queue */
+    void *cq_ptr;
+    size_t cq_size;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* event slots */
+    uring_slot_t *slots;
+    uint32_t slot_count;
+    uint32_t slot_free;
+
+    /* provided buffers; set up on first receive request */
+    struct io_uring_buf_ring *br;
+    size_t br_size;
+    uint8_t *buf;
+    bool br_failed;
+
+    bool is_changed;
+} asc_event_mgr_t;
+
+static __asc_thread asc_event_mgr_t *event_mgr = NULL;
+
+/* io_uring setup failed, event-epoll.c does the work */
+static __asc_thread bool use_epoll = false;
+static bool fallback_warned = false;
+
+/*
+ * ring setup
+ */
+
+static inline
+int uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline
+int uring_enter(int fd, unsigned int to_submit, unsigned int min_complete
+                , unsigned int flags, void *arg, size_t argsz)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete
+                   , flags, arg, argsz);
+}
+
+static inline
+int uring_register(int fd, unsigned int opcode, void *arg
+                   , unsigned int nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static
+bool uring_open(void)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    /* old kernel, seccomp or io_uring_disabled sysctl */
+    event_mgr->fd = uring_setup(URING_ENTRIES, &p);
+    if (event_mgr->fd == -1)
+    {
+        asc_log_debug(MSG("io_uring_setup(): %s"), strerror(errno));
+        return false;
+    }
+
+    if (!(p.features & IORING_FEAT_EXT_ARG))
+    {
+        asc_log_debug(MSG("kernel lacks IORING_FEAT_EXT_ARG (Linux 5.11+)"));
+        close(event_mgr->fd);
+        return false;
+    }
+
+    event_mgr->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    event_mgr->cq_size = p.cq_off.cqes
+                         + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (event_mgr->cq_size > event_mgr->sq_size)
+            event_mgr->sq_size = event_mgr->cq_size;
+
+        event_mgr->cq_size = event_mgr->sq_size;
+    }
+
+    event_mgr->sq_ptr = mmap(NULL, event_mgr->sq_size
+                             , PROT_READ | PROT_WRITE
+                             , MAP_SHARED | MAP_POPULATE
+                             , event_mgr->fd, IORING_OFF_SQ_RING);
+    ASC_ASSERT(event_mgr->sq_ptr != MAP_FAILED
+               , MSG("mmap(): sq ring: %s"), strerror(errno));
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        event_mgr->cq_ptr = event_mgr->sq_ptr;
+    }
+    else
+    {
+        event_mgr->cq_ptr = mmap(NULL, event_mgr->cq_size
+                                 , PROT_READ | PROT_WRITE
+                                 , MAP_SHARED | MAP_POPULATE
+                                 , event_mgr->fd, IORING_OFF_CQ_RING);
+        ASC_ASSERT(event_mgr->cq_ptr != MAP_FAILED
+                   , MSG("mmap(): cq ring: %s"), strerror(errno));
+    }
+
+    event_mgr->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    event_mgr->sqes = (struct io_uring_sqe *)mmap(NULL, event_mgr->sqes_size
+                                                  , PROT_READ | PROT_WRITE
+                                                  , MAP_SHARED | MAP_POPULATE
+                                                  , event_mgr->fd
+                                                  , IORING_OFF_SQES);
+    ASC_ASSERT(event_mgr->sqes != MAP_FAILED
+               , MSG("mmap(): sqes: %s"), strerror(errno));
+
+    uint8_t *const sq = (uint8_t *)event_mgr->sq_ptr;
+    event_mgr->sq_head = (unsigned int *)&sq[p.sq_off.head];
+    event_mgr->sq_tail = (unsigned int *)&sq[p.sq_off.tail];
+    event_mgr->sq_array = (unsigned int *)&sq[p.sq_off.array];
+    event_mgr->sq_mask = *(unsigned int *)&sq[p.sq_off.ring_mask];
+    event_mgr->sq_entries = p.sq_entries;
+
+    uint8_t *const cq = (uint8_t *)event_mgr->cq_ptr;
+    event_mgr->cq_head = (unsigned int *)&cq[p.cq_off.head];
+    event_mgr->cq_tail = (unsigned int *)&cq[p.cq_off.tail];
+    event_mgr->cq_mask = *(unsigned int *)&cq[p.cq_off.ring_mask];
+    event_mgr->cqes = (struct io_uring_cqe *)&cq[p.cq_off.cqes];
+
+    return true;
+}
+
+static
+void uring_close(void)
+{
+    if (event_mgr->br != NULL)
+    {
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = URING_BUF_GROUP;
+
+        uring_register(event_mgr->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        munmap(event_mgr->br, event_mgr->br_size);
+        event_mgr->br = NULL;
+    }
+
+    ASC_FREE(event_mgr->buf, free);
+
+    munmap(event_mgr->sqes, event_mgr->sqes_size);
+    if (event_mgr->cq_ptr != event_mgr->sq_ptr)
+        munmap(event_mgr->cq_ptr, event_mgr->cq_size);
+
+    munmap(event_mgr->sq_ptr, event_mgr->sq_size);
+    close(event_mgr->fd);
+}
+
+/*
+ * submission
+ */
+
+static
+bool uring_submit(unsigned int wait, unsigned int timeout)
+{
+    unsigned int flags = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+
+    void *argp = NULL;
+    size_t argsz = 0;
+
+    if (wait > 0)
+    {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+
+    const unsigned int to_submit = event_mgr->to_submit;
+    const unsigned int depth = (wait > 0) ? lua_api_suspend() : 0;
+    const int ret = uring_enter(event_mgr->fd, to_submit, wait
+                                , flags, argp, argsz);
+    lua_api_resume(depth);
+    if (ret >= 0)
+    {
+        event_mgr->to_submit -= ((unsigned int)ret < to_submit)
+                                ? (unsigned int)ret : to_submit;
+    }
+    else if (errno != EINTR && errno != ETIME && errno != EBUSY)
+    {
+        asc_log_error(MSG("io_uring_enter(): %s"), strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+static
+struct io_uring_sqe *uring_get_sqe(void)
+{
+    unsigned int tail = *event_mgr->sq_tail;
+    unsigned int head = __atomic_load_n(event_mgr->sq_head, __ATOMIC_ACQUIRE);
+
+    if (tail - head >= event_mgr->sq_entries)
+    {
+        /* queue full; hand accumulated requests to the kernel */
+        uring_submit(0, 0);
+
+        head = __atomic_load_n(event_mgr->sq_head, __ATOMIC_ACQUIRE);
+        ASC_ASSERT(tail - head < event_mgr->sq_entries
+                   , MSG("submission queue overflow"));
+    }
+
+    const unsigned int idx = tail & event_mgr->sq_mask;
+    struct io_uring_sqe *const sqe = &event_mgr->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+
+    event_mgr->sq_array[idx] = idx;
+    __atomic_store_n(event_mgr->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    event_mgr->to_submit++;
+
+    return sqe;
+}
+
+static inline
+uint32_t next_seq(void)
+{
+    if (++event_mgr->seq == 0)
+        ++event_mgr->seq; /* zero means no request */
+
+    return event_mgr->seq;
+}
+
+static
+void cancel_request(uint8_t opcode, uint32_t slot, uint32_t seq)
+{
+    struct io_uring_sqe *const sqe = uring_get_sqe();
+
+    sqe->opcode = opcode;
+    sqe->addr = UD_MAKE(slot, seq);
+    sqe->user_data = URING_UD_IGNORE;
+}
+
+/*
+ * provided buffers
+ */
+
+static inline
+void buf_recycle(uint16_t bid)
+{
+    struct io_uring_buf_ring *const br = event_mgr->br;
+    const uint16_t tail = br->tail;
+
+    struct io_uring_buf *const buf = &br->bufs[tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)&event_mgr->buf[bid * URING_BUF_SIZE];
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+
+    __atomic_store_n(&br->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static
+bool buf_ring_init(void)
+{
+    if (event_mgr->br != NULL)
+        return true;
+    else if (event_mgr->br_failed)
+        return false;
+
+    const size_t size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    void *const ring = mmap(NULL, size, PROT_READ | PROT_WRITE
+                            , MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED)
+    {
+        asc_log_error(MSG("mmap(): buffer ring: %s"), strerror(errno));
+        event_mgr->br_failed = true;
+        return false;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+
+    if (uring_register(event_mgr->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+    {
+        asc_log_warning(MSG("buffer rings unavailable: %s"), strerror(errno));
+        munmap(ring, size);
+        event_mgr->br_failed = true;
+        return false;
+    }
+
+    event_mgr->br = (struct io_uring_buf_ring *)ring;
+    event_mgr->br_size = size;
+    event_mgr->buf = ASC_ALLOC(URING_BUF_COUNT * URING_BUF_SIZE, uint8_t);
+
+    for (unsigned int i = 0; i < URING_BUF_COUNT; i++)
+        buf_recycle(i);
+
+    return true;
+}
+
+/*
+ * event slots
+ */
+
+static
+void slot_alloc(asc_event_t *event)
+{
+    if (event_mgr->slot_free == UINT32_MAX)
+    {
+        const uint32_t old_count = event_mgr->slot_count;
+        const uint32_t new_count = (old_count > 0)
+                                   ? old_count * 2 : URING_SLOTS_MIN;
+
+        event_mgr->slots = (uring_slot_t *)realloc(event_mgr->slots
+                                                   , new_count * sizeof(*event_mgr->slots));
+        ASC_ASSERT(event_mgr->slots != NULL, MSG("realloc() failed"));
+
+        /* chain new slots into the free list */
+        for (uint32_t i = old_count; i < new_count; i++)
+        {
+            event_mgr->slots[i].event = NULL;
+            event_mgr->slots[i].next_free = (i + 1 < new_count)
+                                            ? i + 1 : UINT32_MAX;
+        }
+
+        event_mgr->slot_free = old_count;
+        event_mgr->slot_count = new_count;
+    }
+
+    const uint32_t slot = event_mgr->slot_free;
+    event_mgr->slot_free = event_mgr->slots[slot].next_free;
+    event_mgr->slots[slot].event = event;
+
+    event->slot = slot;
+}
+
+static
+void slot_release(asc_event_t *event)
+{
+    uring_slot_t *const slot = &event_mgr->slots[event->slot];
+
+    slot->event = NULL;
+    slot->next_free = event_mgr->slot_free;
+    event_mgr->slot_free = event->slot;
+}
+
+/*
+ * requests
+ */
+
+static
+unsigned int poll_mask(const asc_event_t *event)
+{
+    unsigned int mask = POLLERR | POLLHUP;
+
+    if (event->on_read)
+        mask |= POLLIN | POLLRDHUP;
+    if (event->on_write)
+        mask |= POLLOUT;
+    if (event->on_error)
+        mask |= POLLPRI;
+
+    return mask;
+}
+
+static
+void poll_arm(asc_event_t *event)
+{
+    event->poll_seq = next_seq();
+    event->poll_mask = poll_mask(event);
+
+    struct io_uring_sqe *const sqe = uring_get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = event->fd;
+    sqe->poll32_events = event->poll_mask;
+    sqe->user_data = UD_MAKE(event->slot, event->poll_seq);
+}
+
+static
+void poll_disarm(asc_event_t *event)
+{
+    if (event->poll_seq == 0)
+        return;
+
+    cancel_request(IORING_OP_POLL_REMOVE, event->slot, event->poll_seq);
+    event->poll_seq = 0;
+}
+
+static
+void recv_arm(asc_event_t *event)
+{
+    event->recv_seq = next_seq();
+
+    struct io_uring_sqe *const sqe = uring_get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = event->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = UD_MAKE(event->slot, event->recv_seq);
+}
+
+static
+void recv_disarm(asc_event_t *event)
+{
+    if (event->recv_seq == 0)
+        return;
+
+    cancel_request(IORING_OP_ASYNC_CANCEL, event->slot, event->recv_seq);
+    event->recv_seq = 0;
+}
+
+/* look up event by user_data; NULL if it's gone or request is stale */
+static inline
+asc_event_t *event_lookup(uint64_t ud, bool *is_recv)
+{
+    const uint32_t slot = UD_SLOT(ud);
+    if (slot >= event_mgr->slot_count)
+        return NULL;
+
+    asc_event_t *const event = event_mgr->slots[slot].event;
+    if (event == NULL)
+        return NULL;
+
+    const uint32_t seq = UD_SEQ(ud);
+    if (seq == event->poll_seq)
+    {
+        *is_recv = false;
+        return event;
+    }
+    else if (seq == event->recv_seq)
+    {
+        *is_recv = true;
+        return event;
+    }
+
+    return NULL;
+}
+
+/*
+ * one-shot poll completes with the mask passed to the wait queue
+ * callback rather than the result of re-polling the file. socket data
+ * wakeups always carry POLLPRI, so make sure there's actually urgent
+ * data before reporting it as an error event.
+ */
+static
+unsigned int pri_verify(const asc_event_t *event, unsigned int mask)
+{
+    struct pollfd pfd = {
+        .fd = event->fd,
+        .events = POLLPRI,
+        .revents = 0,
+    };
+
+    if (poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLPRI))
+        mask &= ~POLLPRI;
+
+    return mask;
+}
+
+static
+void on_poll_cqe(asc_event_t *event, const struct io_uring_cqe *cqe)
+{
+    const uint32_t slot = event->slot;
+
+    /* one shot request is complete */
+    event->poll_seq = 0;
+
+    if (cqe->res < 0)
+    {
+        if (cqe->res != -ECANCELED)
+        {
+            asc_log_error(MSG("poll failed on fd %d: %s")
+                          , event->fd, strerror(-cqe->res));
+        }
+
+        poll_arm(event);
+        return;
+    }
+
+    unsigned int mask = cqe->res;
+    if ((mask & (POLLIN | POLLPRI)) == (POLLIN | POLLPRI))
+        mask = pri_verify(event, mask);
+    const bool is_rd = mask & (POLLIN | POLLRDHUP | POLLHUP);
+    const bool is_wr = mask & POLLOUT;
+    const bool is_er = mask & (POLLERR | POLLHUP | POLLPRI);
+
+    /*
+     * stop dispatching if a callback changed any event; the event
+     * might have been closed, or even closed and reallocated.
+     */
+    event_mgr->is_changed = false;
+
+    if (event->on_read && is_rd)
+    {
+        event->on_read(event->arg);
+        if (event_mgr->is_changed)
+            goto rearm;
+    }
+    if (event->on_error && is_er)
+    {
+        event->on_error(event->arg);
+        if (event_mgr->is_changed)
+            goto rearm;
+    }
+    if (event->on_write && is_wr)
+        event->on_write(event->arg);
+
+rearm:
+    if (event_mgr->slots[slot].event != event)
+        return;
+
+    /* callbacks might have re-armed it via asc_event_subscribe() */
+    if (event->poll_seq == 0)
+        poll_arm(event);
+}
+
+static
+void on_recv_cqe(asc_event_t *event, const struct io_uring_cqe *cqe)
+{
+    const bool has_buf = (cqe->flags & IORING_CQE_F_BUFFER);
+    const uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    const uint32_t slot = event->slot;
+
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        event->recv_seq = 0; /* multishot request terminated */
+
+    if (cqe->res >= 0 && has_buf)
+    {
+        if (event->on_recv != NULL)
+        {
+            event->on_recv(event->arg, &event_mgr->buf[bid * URING_BUF_SIZE]
+                           , cqe->res);
+        }
+    }
+    else if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED)
+    {
+        asc_log_debug(MSG("recv failed on fd %d: %s")
+                      , event->fd, strerror(-cqe->res));
+    }
+
+    if (has_buf)
+        buf_recycle(bid);
+
+    /* callback might have closed the event */
+    if (event_mgr->slots[slot].event != event)
+        return;
+
+    if (event->recv_seq == 0 && event->on_recv != NULL)
+        recv_arm(event);
+}
+
+/*
+ * public API
+ */
+
+void asc_event_core_init(void)
+{
+    event_mgr = ASC_ALLOC(1, asc_event_mgr_t);
+    event_mgr->list = asc_list_init();
+    event_mgr->slot_free = UINT32_MAX;
+
+    if (!uring_open())
+    {
+        /* every loop thread ends up here; only say it once */
+        if (!asc_atomic_exchange(&fallback_warned, true))
+            asc_log_warning(MSG("io_uring is unavailable, falling back to epoll"));
+
+        ASC_FREE(event_mgr->list, asc_list_destroy);
+        ASC_FREE(event_mgr, free);
+
+        use_epoll = true;
+        epoll_core_init();
+    }
+}
+
+void asc_event_core_destroy(void)
+{
+    if (use_epoll)
+    {
+        epoll_core_destroy();
+        use_epoll = false;
+
+        return;
+    }
+
+    if (event_mgr == NULL)
+        return;
+
+    asc_event_t *event, *prev = NULL;
+    asc_list_till_empty(event_mgr->list)
+    {
+        event = (asc_event_t *)asc_list_data(event_mgr->list);
+        ASC_ASSERT(event != prev, MSG("on_error didn't close event"));
+
+        if (event->on_error != NULL)
+            event->on_error(event->arg);
+        else
+            asc_event_close(event);
+
+        prev = event;
+    }
+
+    uring_close();
+
+    ASC_FREE(event_mgr->list, asc_list_destroy);
+    ASC_FREE(event_mgr->slots, free);
+    ASC_FREE(event_mgr, free);
+}
+
+bool asc_event_core_loop(unsigned int timeout)
+{
+    if (use_epoll)
+        return epoll_core_loop(timeout);
+
+    if (asc_list_count(event_mgr->list) == 0)
+    {
+        if (event_mgr->to_submit > 0)
+            uring_submit(0, 0); /* flush cancellations */
+
+        const unsigned int depth = lua_api_suspend();
+        asc_usleep(timeout * 1000ULL); /* dry run */
+        lua_api_resume(depth);
+
+        return true;
+    }
+
+    if (!uring_submit(1, timeout))
+        return false;
+
+    unsigned int head = *event_mgr->cq_head;
+    const unsigned int tail = __atomic_load_n(event_mgr->cq_tail
+                                              , __ATOMIC_ACQUIRE);
+
+    while (head != tail)
+    {
+        /* copy entry and release it to the kernel before dispatching */
+        const struct io_uring_cqe cqe =
+            event_mgr->cqes[head & event_mgr->cq_mask];
+
+        __atomic_store_n(event_mgr->cq_head, ++head, __ATOMIC_RELEASE);
+
+        if (cqe.user_data == URING_UD_IGNORE)
+            continue;
+
+        bool is_recv = false;
+        asc_event_t *const event = event_lookup(cqe.user_data, &is_recv);
+
+        if (event == NULL)
+        {
+            /* stale completion; return buffer if it carries one */
+            if ((cqe.flags & IORING_CQE_F_BUFFER) && event_mgr->br != NULL)
+                buf_recycle(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+            continue;
+        }
+
+        if (is_recv)
+            on_recv_cqe(event, &cqe);
+        else
+            on_poll_cqe(event, &cqe);
+    }
+
+    return true;
+}
+
+void asc_event_subscribe(asc_event_t *event)
+{
+    if (use_epoll)
+    {
+        epoll_subscribe(event);
+        return;
+    }
+
+    event_mgr->is_changed = true;
+
+    if (event->poll_seq != 0)
+    {
+        if (event->poll_mask == poll_mask(event))
+            return;
+
+        poll_disarm(event);
+    }
+
+    poll_arm(event);
+}
+
+bool asc_event_set_on_recv(asc_event_t *event, event_recv_callback_t on_recv)
+{
+    if (use_epoll)
+        return false;
+
+    if (on_recv != NULL && !buf_ring_init())
+        return false;
+
+    event->on_recv = on_recv;
+
+    if (on_recv != NULL && event->recv_seq == 0)
+        recv_arm(event);
+    else if (on_recv == NULL)
+        recv_disarm(event);
+
+    return true;
+}
+
+asc_event_t *asc_event_init(int fd, void *arg)
+{
+    if (use_epoll)
+        return epoll_event_init(fd, arg);
+
+    asc_event_t *const event = ASC_ALLOC(1, asc_event_t);
+
+    event->fd = fd;
+    event->arg = arg;
+
+    slot_alloc(event);
+    poll_arm(event);
+
+    event_mgr->is_changed = true;
+
+    asc_list_insert_tail(event_mgr->list, event);
+
+    return event;
+}
+
+void asc_event_close(asc_event_t *event)
+{
+    if (use_epoll)
+    {
+        epoll_event_close(event);
+        return;
+    }
+
+    poll_disarm(event);
+    recv_disarm(event);
+    slot_release(event);
+
+    event_mgr->is_changed = true;
+
+    asc_list_remove_item(event_mgr->list, event);
+
+    free(event);
+}
@@ -47,3 +47,13 @@ void asc_event_set_on_error(asc_event_t *event, event_callback_t on_error)
     event->on_error = on_error;
     asc_event_subscribe(event);
 }
+
+#ifndef WITH_EVENT_URING
+bool asc_event_set_on_recv(asc_event_t *event, event_recv_callback_t on_recv)
+{
+    ASC_UNUSED(event);
+    ASC_UNUSED(on_recv);
+
+    return false;
+}
+#endif /* !WITH_EVENT_URING */
@@ -28,6 +28,7 @@
 
 typedef struct asc_event_t asc_event_t;
 typedef void (*event_callback_t)(void *);
+typedef void (*event_recv_callback_t)(void *, const void *, size_t);
 
 void asc_event_core_init(void);
 bool asc_event_core_loop(unsigned int timeout) __asc_result;
@@ -40,4 +41,11 @@ void asc_event_set_on_read(asc_event_t *event, event_callback_t on_read);
 void asc_event_set_on_write(asc_event_t *event, event_callback_t on_write);
 void asc_event_set_on_error(asc_event_t *event, event_callback_t on_error);
 
+/*
+ * completion based receive; returns false if the event backend doesn't
+ * support it, in which case caller should fall back to on_read.
+ */
+bool asc_event_set_on_recv(asc_event_t *event
+                           , event_recv_callback_t on_recv) __asc_result;
+
 #endif /* _ASC_EVENT_H_ */
@@ -25,7 +25,10 @@
 #include <astra/core/thread.h>
 #include <astra/core/timer.h>
 #include <astra/core/socket.h>
+#include <astra/core/worker.h>
 #include <astra/luaapi/state.h>
+#include <astra/luaapi/stream.h>
+#include <astra/mpegts/block.h>
 
 #define MSG(_msg) "[init] " _msg
 
@@ -63,6 +66,8 @@ void asc_lib_init(void)
     asc_timer_core_init();
     asc_event_core_init();
     asc_main_loop_init();
+    asc_worker_core_init();
+    module_stream_core_init();
 
     /* Lua modules may need features init'd above */
     lua = lua_api_init();
@@ -78,6 +83,11 @@ void asc_lib_destroy(void)
      * timers, etc.
      */
     ASC_FREE(lua, lua_api_destroy);
+    module_stream_core_destroy();
+
+    /* stop worker loops; Lua state is ours alone after this */
+    asc_worker_core_destroy();
+    lua_api_lock_disable();
 
     /* join any stray threads */
     asc_thread_core_destroy();
@@ -88,8 +98,9 @@ void asc_lib_destroy(void)
     /* cleaning up rogue events might invoke their on_error callbacks */
     asc_event_core_destroy();
 
-    /* no side effects for this one */
+    /* no side effects for these */
     asc_timer_core_destroy();
+    ts_block_cache_flush();
 
     /* nothing left to use sockets or logs */
     asc_socket_core_destroy();
@@ -107,6 +118,9 @@ void asc_lib_exit(int status)
 
 void asc_lib_abort(void)
 {
+    /* make sure the reason for aborting makes it to the log */
+    asc_log_flush();
+
     asc_exit_status = ASC_EXIT_ABORT;
     exit(ASC_EXIT_ABORT);
 }
@@ -22,6 +22,9 @@
 #include <astra/astra.h>
 #include <astra/core/log.h>
 #include <astra/core/mutex.h>
+#include <astra/core/cond.h>
+#include <astra/core/atomic.h>
+#include <astra/core/clock.h>
 
 #ifndef _WIN32
 #   include <syslog.h>
@@ -29,6 +32,42 @@
 
 #define MSG(_msg) "[log] " _msg
 
+/* maximum length of a log line */
+#define LOG_BUFFER_SIZE 2048
+
+/* asynchronous mode: queued records and maximum message length */
+#define LOG_RING_SIZE 1024 /* must be a power of two */
+#define LOG_RECORD_SIZE 512
+
+/* rate limiter slots; call sites are hashed into these */
+#define LOG_SITE_COUNT 256 /* must be a power of two */
+#define LOG_SITE_PROBES 4
+
+/* writer thread wakes up this often to report repeats, msecs */
+#define LOG_FLUSH_INTERVAL 1000
+
+typedef struct
+{
+    size_t seq;
+    asc_log_type_t type;
+    time_t ts;
+    size_t len;
+    char text[LOG_RECORD_SIZE];
+} log_record_t;
+
+typedef struct
+{
+    uintptr_t key; /* call site, 0 if unused */
+    unsigned long window; /* current one second window */
+    unsigned int count; /* messages seen in current window */
+    unsigned int suppressed; /* messages dropped in current window */
+
+    /* last dropped message; published through seq, odd while written */
+    unsigned int seq;
+    const char *fmt; /* format string, NULL for pass-through messages */
+    asc_log_type_t type;
+} log_site_t;
+
 typedef struct
 {
     bool color;
@@ -44,7 +83,48 @@ typedef struct
     WORD attr;
 #endif
 
+    /* output stage; protected by lock */
     asc_mutex_t lock;
+
+    time_t ts_sec;
+    char ts_str[32];
+    size_t ts_len;
+
+    /* duplicate collapsing; off by default */
+    bool dedup;
+    asc_log_type_t last_type;
+    size_t last_len;
+    char last_text[LOG_BUFFER_SIZE];
+    unsigned int repeat;
+
+    /* per call site rate limiting */
+    unsigned int rate_limit;
+    log_site_t sites[LOG_SITE_COUNT];
+    time_t flush_ts; /* last time idle call sites were reported */
+
+    /*
+     * Asynchronous mode: bounded MPSC ring (D. Vyukov). Producers claim
+     * slots by advancing ring_head; writer thread consumes at ring_tail.
+     */
+    bool async;
+    size_t producers; /* threads that may be claiming a slot */
+    log_record_t *ring;
+    size_t ring_head;
+    size_t ring_tail;
+    size_t ring_done; /* records written out so far */
+
+    bool stop;
+    int sleeping;
+    asc_mutex_t wlock;
+    asc_cond_t wcond; /* wakes up writer thread */
+    asc_cond_t fcond; /* wakes up asc_log_flush() callers */
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+
+    asc_log_stats_t stats;
 } asc_logger_t;
 
 static
@@ -169,6 +249,332 @@ struct tm *localtime_r(const time_t *timep, struct tm *result)
 
 #endif /* _WIN32 */
 
+/*
+ * output stage; called with logger lock held
+ */
+
+/* write out a single line with timestamp and severity prefix */
+static
+void line_write(asc_log_type_t type, time_t ts, const char *text)
+{
+    char buf[LOG_BUFFER_SIZE];
+
+    /* timestamp is formatted once per second */
+    if (ts != logger->ts_sec)
+    {
+        struct tm sct;
+
+        logger->ts_sec = ts;
+        logger->ts_len = 0;
+
+        if (localtime_r(&ts, &sct) != NULL)
+        {
+            logger->ts_len = strftime(logger->ts_str, sizeof(logger->ts_str)
+                                      , "%b %d %X: ", &sct);
+        }
+    }
+
+    int len = snprintf(buf, sizeof(buf), "%.*s%s: %s"
+                       , (int)logger->ts_len, logger->ts_str
+                       , type_strings[type], text);
+    if (len < 0)
+        return;
+    else if (len >= (int)sizeof(buf))
+        len = sizeof(buf) - 1; /* string truncated */
+
+#ifndef _WIN32
+    if (logger->syslog != NULL)
+        syslog(type_syslog[type], "%s", text);
+#endif /* !_WIN32 */
+
+    if (logger->sout)
+        sout_write(type, buf);
+
+    if (logger->fd != -1)
+    {
+        /* replace null with newline before writing to file */
+        buf[len++] = '\n';
+
+        if (write(logger->fd, buf, len) == -1)
+        {
+            fprintf(stderr, MSG("failed to write to log file: %s\n")
+                    , strerror(errno));
+        }
+    }
+}
+
+/* report identical lines that were held back */
+static
+void repeat_flush(time_t ts)
+{
+    if (logger->repeat == 0)
+        return;
+
+    char text[64];
+    snprintf(text, sizeof(text), "last message repeated %u times"
+             , logger->repeat);
+
+    logger->repeat = 0;
+    line_write(logger->last_type, ts, text);
+}
+
+/* write a message, collapsing consecutive duplicates if enabled */
+static
+void line_emit(asc_log_type_t type, time_t ts, const char *text, size_t len)
+{
+    if (!logger->dedup)
+    {
+        line_write(type, ts, text);
+        return;
+    }
+
+    if (type == logger->last_type && len == logger->last_len
+        && !memcmp(text, logger->last_text, len))
+    {
+        logger->repeat++;
+        asc_atomic_fetch_add(&logger->stats.repeated, 1);
+        return;
+    }
+
+    repeat_flush(ts);
+
+    if (len >= sizeof(logger->last_text))
+        len = sizeof(logger->last_text) - 1;
+
+    memcpy(logger->last_text, text, len);
+    logger->last_text[len] = '\0';
+    logger->last_len = len;
+    logger->last_type = type;
+
+    line_write(type, ts, text);
+}
+
+/* record what a call site dropped; skipped if another thread is at it */
+static
+void site_set(log_site_t *site, const char *fmt, asc_log_type_t type)
+{
+    unsigned int seq = asc_atomic_load_relaxed(&site->seq);
+    if ((seq & 1) || !asc_atomic_cas(&site->seq, &seq, seq + 1))
+        return;
+
+    asc_atomic_store_relaxed(&site->fmt, fmt);
+    asc_atomic_store_relaxed(&site->type, type);
+    asc_atomic_store_release(&site->seq, seq + 2);
+}
+
+static
+void site_get(log_site_t *site, const char **fmt, asc_log_type_t *type)
+{
+    while (true)
+    {
+        const unsigned int seq = asc_atomic_load_acquire(&site->seq);
+        if (seq & 1)
+            continue; /* writer is a few stores away from done */
+
+        *fmt = asc_atomic_load_acquire(&site->fmt);
+        *type = asc_atomic_load_acquire(&site->type);
+
+        if (asc_atomic_load_relaxed(&site->seq) == seq)
+            return;
+    }
+}
+
+/* format a summary of lines dropped by the rate limiter */
+static
+void site_summary(char *text, size_t size, const char *fmt, unsigned int cnt)
+{
+    if (fmt != NULL)
+        snprintf(text, size, MSG("suppressed %u messages: %s"), cnt, fmt);
+    else
+        snprintf(text, size, MSG("suppressed %u messages"), cnt);
+}
+
+/* report call sites that went over the limit in a past window */
+static
+void sites_flush(time_t ts)
+{
+    logger->flush_ts = ts;
+
+    for (size_t i = 0; i < LOG_SITE_COUNT; i++)
+    {
+        log_site_t *const site = &logger->sites[i];
+
+        if (asc_atomic_load_relaxed(&site->suppressed) == 0)
+            continue;
+
+        unsigned long window = asc_atomic_load_relaxed(&site->window);
+        if (window == (unsigned long)ts)
+            continue; /* still going on */
+
+        /* start a fresh window so producers don't report it again */
+        if (!asc_atomic_cas(&site->window, &window, (unsigned long)ts))
+            continue;
+
+        asc_atomic_store_relaxed(&site->count, 0);
+        const unsigned int cnt = asc_atomic_exchange(&site->suppressed, 0);
+        if (cnt == 0)
+            continue;
+
+        const char *fmt;
+        asc_log_type_t type;
+        site_get(site, &fmt, &type);
+
+        char text[LOG_RECORD_SIZE];
+        site_summary(text, sizeof(text), fmt, cnt);
+
+        line_emit(type, ts, text, strlen(text));
+    }
+}
+
+/*
+ * asynchronous writer
+ */
+
+static inline
+log_record_t *ring_peek(void)
+{
+    log_record_t *const rec =
+        &logger->ring[logger->ring_tail & (LOG_RING_SIZE - 1)];
+
+    if (asc_atomic_load(&rec->seq) != logger->ring_tail + 1)
+        return NULL;
+
+    return rec;
+}
+
+static
+bool ring_push(asc_log_type_t type, time_t ts, const char *msg, va_list ap)
+{
+    size_t pos = asc_atomic_load_relaxed(&logger->ring_head);
+    log_record_t *rec;
+
+    while (true)
+    {
+        rec = &logger->ring[pos & (LOG_RING_SIZE - 1)];
+
+        const size_t seq = asc_atomic_load_acquire(&rec->seq);
+        const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+        if (dif == 0)
+        {
+            /* slot is free; try to claim it */
+            if (asc_atomic_cas(&logger->ring_head, &pos, pos + 1))
+                break;
+        }
+        else if (dif < 0)
+        {
+            return false; /* ring is full */
+        }
+        else
+        {
+            pos = asc_atomic_load_relaxed(&logger->ring_head);
+        }
+    }
+
+    rec->type = type;
+    rec->ts = ts;
+    rec->len = 0;
+
+    const int ret = vsnprintf(rec->text, sizeof(rec->text), msg, ap);
+    if (ret > 0)
+    {
+        rec->len = ret;
+        if (rec->len >= sizeof(rec->text))
+            rec->len = sizeof(rec->text) - 1; /* string truncated */
+    }
+
+    /* publish record, then wake up writer if it's idle */
+    asc_atomic_store(&rec->seq, pos + 1);
+
+    if (asc_atomic_load(&logger->sleeping))
+    {
+        asc_mutex_lock(&logger->wlock);
+        asc_cond_signal(&logger->wcond);
+        asc_mutex_unlock(&logger->wlock);
+    }
+
+    return true;
+}
+
+/* write out queued records; only called by the thread owning the ring */
+static
+void ring_drain(void)
+{
+    log_record_t *rec = ring_peek();
+    if (rec == NULL)
+        return;
+
+    asc_mutex_lock(&logger->lock);
+
+    do
+    {
+        if (rec->len > 0)
+            line_emit(rec->type, rec->ts, rec->text, rec->len);
+
+        asc_atomic_store_release(&rec->seq
+                                 , logger->ring_tail + LOG_RING_SIZE);
+        logger->ring_tail++;
+    } while ((rec = ring_peek()) != NULL);
+
+    asc_mutex_unlock(&logger->lock);
+
+    asc_atomic_store(&logger->ring_done, logger->ring_tail);
+}
+
+#ifdef _WIN32
+static __stdcall
+unsigned int writer_proc(void *arg)
+#else
+static
+void *writer_proc(void *arg)
+#endif
+{
+    ASC_UNUSED(arg);
+
+    while (true)
+    {
+        ring_drain();
+
+        asc_mutex_lock(&logger->wlock);
+        asc_cond_broadcast(&logger->fcond);
+
+        if (logger->stop && ring_peek() == NULL)
+        {
+            asc_mutex_unlock(&logger->wlock);
+            break;
+        }
+
+        /* re-check after announcing sleep; see ring_push() */
+        bool timeout = false;
+        asc_atomic_store(&logger->sleeping, 1);
+
+        if (ring_peek() == NULL && !logger->stop)
+        {
+            timeout = !asc_cond_timedwait(&logger->wcond, &logger->wlock
+                                          , LOG_FLUSH_INTERVAL);
+        }
+
+        asc_atomic_store(&logger->sleeping, 0);
+        asc_mutex_unlock(&logger->wlock);
+
+        /* report call sites that went quiet, busy or not */
+        const time_t ts = time(NULL);
+        if (timeout || ts != logger->flush_ts)
+        {
+            asc_mutex_lock(&logger->lock);
+            if (timeout)
+                repeat_flush(ts);
+
+            if (ts != logger->flush_ts)
+                sites_flush(ts);
+
+            asc_mutex_unlock(&logger->lock);
+        }
+    }
+
+    return 0;
+}
+
 /*
  * init and deinit
  */
@@ -179,8 +585,15 @@ void asc_log_core_init(void)
 
     logger->sout = true;
     logger->fd = -1;
+    logger->ts_sec = -1;
 
     asc_mutex_init(&logger->lock);
+    asc_mutex_init(&logger->wlock);
+    asc_cond_init(&logger->wcond);
+    asc_cond_init(&logger->fcond);
+
+    /* timezone is only re-read on init and on log reopen */
+    tzset();
 
 #ifdef _WIN32
     /* get default text color */
@@ -200,6 +613,12 @@ void asc_log_core_destroy(void)
     if (logger == NULL)
         return;
 
+    asc_log_set_async(false);
+
+    asc_mutex_lock(&logger->lock);
+    repeat_flush(time(NULL));
+    asc_mutex_unlock(&logger->lock);
+
     if (logger->fd != -1)
         close(logger->fd);
 
@@ -211,6 +630,9 @@ void asc_log_core_destroy(void)
     }
 #endif /* !_WIN32 */
 
+    asc_cond_destroy(&logger->fcond);
+    asc_cond_destroy(&logger->wcond);
+    asc_mutex_destroy(&logger->wlock);
     asc_mutex_destroy(&logger->lock);
 
     ASC_FREE(logger->filename, free);
@@ -276,6 +698,9 @@ void asc_log_reopen(void)
 {
     asc_mutex_lock(&logger->lock);
 
+    tzset();
+    logger->ts_sec = -1;
+
     if (logger->fd != -1)
     {
         close(logger->fd);
@@ -303,81 +728,298 @@ bool asc_log_is_debug(void)
     return logger->debug;
 }
 
+void asc_log_set_rate_limit(unsigned int val)
+{
+    logger->rate_limit = val;
+}
+
+/* collapse consecutive identical lines into a repeat count */
+void asc_log_set_dedup(bool val)
+{
+    asc_mutex_lock(&logger->lock);
+
+    repeat_flush(time(NULL));
+    logger->dedup = val;
+    logger->last_len = 0;
+
+    asc_mutex_unlock(&logger->lock);
+}
+
+/* move formatting and output of log lines to a background thread */
+void asc_log_set_async(bool val)
+{
+    if (logger->async == val)
+        return;
+
+    if (val)
+    {
+        logger->ring = ASC_ALLOC(LOG_RING_SIZE, log_record_t);
+        for (size_t i = 0; i < LOG_RING_SIZE; i++)
+            logger->ring[i].seq = i;
+
+        logger->ring_head = logger->ring_tail = logger->ring_done = 0;
+        logger->stop = false;
+
+#ifdef _WIN32
+        const intptr_t ret = _beginthreadex(NULL, 0, writer_proc
+                                            , NULL, 0, NULL);
+        ASC_ASSERT(ret > 0, MSG("failed to create thread: %s")
+                   , strerror(errno));
+
+        logger->thread = (HANDLE)ret;
+#else /* _WIN32 */
+        const int ret = pthread_create(&logger->thread, NULL
+                                       , writer_proc, NULL);
+        ASC_ASSERT(ret == 0, MSG("failed to create thread: %s")
+                   , strerror(ret));
+#endif /* !_WIN32 */
+
+        asc_atomic_store(&logger->async, true);
+    }
+    else
+    {
+        /*
+         * No new claims after this; wait for producers that got in
+         * before it to publish their records, or they'd write into
+         * freed memory.
+         */
+        asc_atomic_store(&logger->async, false);
+        while (asc_atomic_load(&logger->producers) > 0)
+            asc_usleep(100);
+
+        asc_mutex_lock(&logger->wlock);
+        logger->stop = true;
+        asc_cond_signal(&logger->wcond);
+        asc_mutex_unlock(&logger->wlock);
+
+#ifdef _WIN32
+        WaitForSingleObject(logger->thread, INFINITE);
+        CloseHandle(logger->thread);
+#else /* _WIN32 */
+        pthread_join(logger->thread, NULL);
+#endif /* !_WIN32 */
+
+        /* pick up records the writer didn't get to */
+        ring_drain();
+        ASC_FREE(logger->ring, free);
+    }
+}
+
+/* wait until queued log lines are written out */
+void asc_log_flush(void)
+{
+    if (logger == NULL || !asc_atomic_load(&logger->async))
+        return;
+
+    const size_t target = asc_atomic_load(&logger->ring_head);
+
+    asc_mutex_lock(&logger->wlock);
+    asc_cond_signal(&logger->wcond);
+
+    while (asc_atomic_load(&logger->ring_done) - target > SIZE_MAX / 2)
+        asc_cond_wait(&logger->fcond, &logger->wlock);
+
+    asc_mutex_unlock(&logger->wlock);
+}
+
+void asc_log_stats(asc_log_stats_t *stats)
+{
+    stats->queued = asc_atomic_load_relaxed(&logger->stats.queued);
+    stats->dropped = asc_atomic_load_relaxed(&logger->stats.dropped);
+    stats->suppressed = asc_atomic_load_relaxed(&logger->stats.suppressed);
+    stats->repeated = asc_atomic_load_relaxed(&logger->stats.repeated);
+}
+
 /*
  * public interface
  */
 
-void asc_log_va(asc_log_type_t type, const char *msg, va_list ap)
+/*
+ * Register as a ring producer if async mode is on. Both sides go
+ * through sequentially consistent atomics, so either the disabling
+ * thread sees the count or this one sees async switched off.
+ */
+static inline
+bool ring_enter(void)
 {
-    if (type == ASC_LOG_DEBUG)
+    if (!asc_atomic_load(&logger->async))
+        return false;
+
+    asc_atomic_fetch_add(&logger->producers, 1);
+    if (asc_atomic_load(&logger->async))
+        return true;
+
+    asc_atomic_fetch_sub(&logger->producers, 1);
+    return false;
+}
+
+/* hand a formatted line to the writer thread or write it out directly */
+static
+void line_submit(asc_log_type_t type, time_t ts, const char *msg, va_list ap)
+{
+    if (ring_enter())
     {
-        if (logger != NULL && !logger->debug)
-            return;
+        /* never block the caller; drop the line if writer can't keep up */
+        if (ring_push(type, ts, msg, ap))
+            asc_atomic_fetch_add(&logger->stats.queued, 1);
+        else
+            asc_atomic_fetch_add(&logger->stats.dropped, 1);
+
+        asc_atomic_fetch_sub(&logger->producers, 1);
+        return;
     }
 
-    char buf[2048];
-    ssize_t space = sizeof(buf);
-    size_t len_prefix = 0;
-    int ret;
+    char buf[LOG_BUFFER_SIZE];
+    const int ret = vsnprintf(buf, sizeof(buf), msg, ap);
+    if (ret <= 0)
+        return; /* error or empty string */
 
-    /* add timestamp and severity */
-    tzset();
-    const time_t ct = time(NULL);
-    struct tm sct;
+    size_t len = ret;
+    if (len >= sizeof(buf))
+        len = sizeof(buf) - 1; /* string truncated */
+
+    asc_mutex_lock(&logger->lock);
+
+    /* no writer thread to report idle call sites in this mode */
+    if (ts != logger->flush_ts)
+        sites_flush(ts);
+
+    line_emit(type, ts, buf, len);
+    asc_mutex_unlock(&logger->lock);
+
+    asc_atomic_fetch_add(&logger->stats.queued, 1);
+}
 
-    if (localtime_r(&ct, &sct) != NULL)
+static
+void line_submit_text(asc_log_type_t type, time_t ts, const char *msg, ...)
+{
+    va_list ap;
+    va_start(ap, msg);
+    line_submit(type, ts, msg, ap);
+    va_end(ap);
+}
+
+/* cheap string hash for rate limiter keys */
+static inline
+uintptr_t site_hash(const char *str)
+{
+    uintptr_t hash = 5381;
+    for (; *str != '\0'; str++)
+        hash = (hash * 33) ^ (uint8_t)*str;
+
+    return hash;
+}
+
+/*
+ * Check per call site message rate. Call sites are told apart by their
+ * format string; pass-through messages (i.e. from Lua) by their text.
+ */
+static
+bool site_check(asc_log_type_t type, time_t ts, const char *msg, va_list ap)
+{
+    const unsigned int limit = logger->rate_limit;
+    if (limit == 0)
+        return true;
+
+    uintptr_t key = (uintptr_t)msg;
+    const char *fmt = msg;
+
+    if (!strcmp(msg, "%s"))
     {
-        len_prefix += strftime(buf, space, "%b %d %X: ", &sct);
-        space -= len_prefix;
+        va_list aq;
+        va_copy(aq, ap);
+        key = site_hash(va_arg(aq, const char *)) | 1; /* never 0 */
+        va_end(aq);
+
+        fmt = NULL;
     }
 
-    ret = snprintf(&buf[len_prefix], space, "%s: ", type_strings[type]);
-    if (ret > 0 && ret < space)
+    const size_t hash = (key ^ (key >> 16)) * 0x9E3779B1U;
+    log_site_t *site = NULL;
+
+    /* find or claim a slot; sites idle for a while can be taken over */
+    for (size_t i = 0; i < LOG_SITE_PROBES && site == NULL; i++)
     {
-        len_prefix += ret;
-        space -= ret;
+        log_site_t *const probe = &logger->sites[(hash + i)
+                                                 & (LOG_SITE_COUNT - 1)];
+
+        uintptr_t cur = asc_atomic_load(&probe->key);
+        if (cur == key)
+        {
+            site = probe;
+        }
+        else if (cur == 0
+                 || (asc_atomic_load_relaxed(&probe->window) + 1
+                         < (unsigned long)ts
+                     && asc_atomic_load_relaxed(&probe->suppressed) == 0))
+        {
+            if (asc_atomic_cas(&probe->key, &cur, key))
+            {
+                asc_atomic_store_relaxed(&probe->window, (unsigned long)ts);
+                asc_atomic_store_relaxed(&probe->count, 0);
+                site = probe;
+            }
+        }
     }
 
-    /* add message */
-    size_t len = 0;
-    ret = vsnprintf(&buf[len_prefix], space, msg, ap);
-    if (ret > 0 && ret < space)
-        len = len_prefix + ret; /* success */
-    else if (ret >= space)
-        len = sizeof(buf) - 1; /* string truncated */
-    else
-        return; /* error or empty string */
+    /* table is crowded; share a slot with another call site */
+    if (site == NULL)
+        site = &logger->sites[hash & (LOG_SITE_COUNT - 1)];
 
-    /* send it out through configured channels */
-    if (logger == NULL)
+    unsigned long window = asc_atomic_load_relaxed(&site->window);
+    if (window != (unsigned long)ts)
     {
-        fprintf(stderr, "%s\n", &buf[len_prefix]);
-        return;
+        if (asc_atomic_cas(&site->window, &window, (unsigned long)ts))
+        {
+            asc_atomic_store_relaxed(&site->count, 0);
+
+            /* report the window that just ended before starting over */
+            const unsigned int cnt = asc_atomic_exchange(&site->suppressed, 0);
+            if (cnt > 0)
+            {
+                const char *last_fmt;
+                asc_log_type_t last_type;
+                site_get(site, &last_fmt, &last_type);
+
+                char text[LOG_RECORD_SIZE];
+                site_summary(text, sizeof(text), last_fmt, cnt);
+                line_submit_text(last_type, ts, "%s", text);
+            }
+        }
     }
 
-    asc_mutex_lock(&logger->lock);
+    if (asc_atomic_fetch_add(&site->count, 1) < limit)
+        return true;
 
-#ifndef _WIN32
-    if (logger->syslog != NULL)
-        syslog(type_syslog[type], "%s", &buf[len_prefix]);
-#endif /* !_WIN32 */
+    site_set(site, fmt, type);
+    asc_atomic_fetch_add(&site->suppressed, 1);
+    asc_atomic_fetch_add(&logger->stats.suppressed, 1);
 
-    if (logger->sout)
-        sout_write(type, buf);
+    return false;
+}
 
-    if (logger->fd != -1)
+void asc_log_va(asc_log_type_t type, const char *msg, va_list ap)
+{
+    if (type == ASC_LOG_DEBUG)
     {
-        /* replace null with newline before writing to file */
-        buf[len++] = '\n';
+        if (logger != NULL && !logger->debug)
+            return;
+    }
 
-        if (write(logger->fd, buf, len) == -1)
-        {
-            fprintf(stderr, MSG("failed to write to log file: %s\n")
-                    , strerror(errno));
-        }
+    if (logger == NULL)
+    {
+        char buf[LOG_BUFFER_SIZE];
+        if (vsnprintf(buf, sizeof(buf), msg, ap) > 0)
+            fprintf(stderr, "%s\n", buf);
+
+        return;
     }
 
-    asc_mutex_unlock(&logger->lock);
+    const time_t ts = time(NULL);
+    if (!site_check(type, ts, msg, ap))
+        return;
+
+    line_submit(type, ts, msg, ap);
 }
 
 void asc_log(asc_log_type_t type, const char *msg, ...)
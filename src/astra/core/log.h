@@ -34,6 +34,17 @@ typedef enum
     ASC_LOG_DEBUG,
 } asc_log_type_t;
 
+typedef struct
+{
+    size_t queued; /* lines accepted for output */
+    size_t dropped; /* lines lost to a full queue (async mode) */
+    size_t suppressed; /* lines over the per call site rate limit */
+    size_t repeated; /* lines collapsed as duplicates of the last one */
+} asc_log_stats_t;
+
+/* default per call site limit for the main program, lines per second */
+#define ASC_LOG_RATE_DEFAULT 20
+
 void asc_log_core_init(void);
 void asc_log_core_destroy(void);
 
@@ -44,8 +55,13 @@ void asc_log_set_file(const char *val);
 #ifndef _WIN32
 void asc_log_set_syslog(const char *val);
 #endif
+void asc_log_set_rate_limit(unsigned int val);
+void asc_log_set_dedup(bool val);
+void asc_log_set_async(bool val);
 void asc_log_reopen(void);
+void asc_log_flush(void);
 bool asc_log_is_debug(void);
+void asc_log_stats(asc_log_stats_t *stats);
 
 void asc_log_va(asc_log_type_t type, const char *msg
                 , va_list ap) __asc_printf(2, 0);
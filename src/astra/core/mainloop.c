@@ -21,21 +21,21 @@
 
 #include <astra/astra.h>
 #include <astra/core/mainloop.h>
+#include <astra/core/atomic.h>
 #include <astra/core/event.h>
 #include <astra/core/mutex.h>
+#include <astra/core/cond.h>
 #include <astra/core/timer.h>
 #include <astra/core/socket.h>
 #include <astra/core/spawn.h>
 #include <astra/luaapi/luaapi.h>
 #include <astra/luaapi/state.h>
 
-#define MSG(_msg) "[mainloop] " _msg
-
-/* garbage collector interval, usecs */
-#define LUA_GC_TIMEOUT (1 * 1000 * 1000)
+#ifdef HAVE_EVENTFD
+#   include <sys/eventfd.h>
+#endif
 
-/* maximum number of jobs queued */
-#define JOB_QUEUE_SIZE 256
+#define MSG(_msg) "[mainloop] " _msg
 
 enum
 {
@@ -44,30 +44,71 @@ enum
     MAIN_LOOP_SHUTDOWN = 0x00000004,
 };
 
-typedef struct
+typedef struct loop_job_t loop_job_t;
+
+struct loop_job_t
 {
-    loop_callback_t proc;
+    loop_callback_t proc; /* NULL if pruned */
     void *arg;
     void *owner;
-} loop_job_t;
 
-typedef struct
+    uint64_t queued; /* time of enqueue, usecs */
+    loop_job_t *next;
+};
+
+struct asc_main_loop_t
 {
     uint32_t flags;
     unsigned int stop_cnt;
+    bool is_primary;
 
-    int wake_fd[2];
+    int wake_fd[2]; /* both set to the same descriptor for eventfd */
     asc_event_t *wake_ev;
     unsigned int wake_cnt;
+    int wake_pending; /* set while a wake up is in flight */
+
+    /*
+     * Intrusive MPSC queue (D. Vyukov). Any thread pushes to the head;
+     * only the owner thread pops from the tail.
+     */
+    loop_job_t *job_head;
+    loop_job_t *job_tail;
+    loop_job_t job_stub;
+    size_t job_depth;
 
-    unsigned int job_cnt;
-    loop_job_t jobs[JOB_QUEUE_SIZE];
     asc_mutex_t job_mutex;
-} asc_main_loop_t;
+    asc_cond_t job_cond;
+    unsigned int job_waiters;
+
+    /* updated by owner thread only */
+    size_t job_depth_max;
+    uint64_t job_total;
+    uint64_t job_latency_sum;
+    uint64_t job_latency_max;
+};
 
+/* loop created by the main thread; receives signals and runs Lua GC */
 static
+asc_main_loop_t *primary_loop = NULL;
+
+/* loop owned by the calling thread, if any */
+static __asc_thread
 asc_main_loop_t *main_loop = NULL;
 
+/* loop receiving jobs and wake ups from the calling thread */
+static __asc_thread
+asc_main_loop_t *bound_loop = NULL;
+
+/* get target loop for jobs and wake ups sent by the calling thread */
+static inline
+asc_main_loop_t *loop_self(void)
+{
+    if (bound_loop != NULL)
+        return bound_loop;
+
+    return primary_loop;
+}
+
 /*
  * main thread wake up mechanism
  */
@@ -83,11 +124,19 @@ bool wake_open(void)
 {
     int fds[2] = { -1, -1 };
 
+#ifdef HAVE_EVENTFD
+    /* counter semantics: any number of writes is drained by one read */
+    fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fds[0] == -1)
+        return false;
+#else
     if (asc_pipe_open(fds, NULL, PIPE_BOTH) != 0)
         return false;
+#endif /* HAVE_EVENTFD */
 
     main_loop->wake_fd[0] = fds[0];
     main_loop->wake_fd[1] = fds[1];
+    asc_atomic_store(&main_loop->wake_pending, 0);
 
     main_loop->wake_ev = asc_event_init(fds[PIPE_RD], NULL);
     asc_event_set_on_read(main_loop->wake_ev, on_wake_read);
@@ -116,7 +165,8 @@ void wake_close(void)
     if (fds[1] != -1)
     {
         main_loop->wake_fd[1] = -1;
-        asc_pipe_close(fds[1]);
+        if (fds[1] != fds[0])
+            asc_pipe_close(fds[1]);
     }
 }
 
@@ -126,8 +176,21 @@ void on_wake_read(void *arg)
 {
     ASC_UNUSED(arg);
 
+#ifdef HAVE_EVENTFD
+    uint64_t buf;
+    const ssize_t ret = read(main_loop->wake_fd[PIPE_RD], &buf, sizeof(buf));
+#else
     char buf[32];
     const ssize_t ret = recv(main_loop->wake_fd[PIPE_RD], buf, sizeof(buf), 0);
+#endif /* HAVE_EVENTFD */
+
+    /*
+     * Jobs are run after this, so later producers must wake us again.
+     * Clear the flag only after draining the pipe: a wake up written
+     * before the read would otherwise be consumed with the flag still
+     * set, and no producer would ever write to the pipe again.
+     */
+    asc_atomic_store(&main_loop->wake_pending, 0);
     switch (ret)
     {
         case -1:
@@ -193,89 +256,275 @@ void asc_wake_close(void)
     }
 }
 
-/* signal event polling function to return */
-void asc_wake(void)
+static
+void loop_wake(asc_main_loop_t *loop)
 {
-    const int fd = main_loop->wake_fd[PIPE_WR];
-    static const char byte = '\0';
+    const int fd = loop->wake_fd[PIPE_WR];
+    if (fd == -1)
+        return;
 
-    if (fd != -1 && send(fd, &byte, 1, 0) == -1)
+    /* skip the syscall if the loop hasn't consumed last wake up yet */
+    if (asc_atomic_exchange(&loop->wake_pending, 1) != 0)
+        return;
+
+#ifdef HAVE_EVENTFD
+    static const uint64_t value = 1;
+    if (write(fd, &value, sizeof(value)) == -1)
+        asc_log_error(MSG("wake up write(): %s"), asc_error_msg());
+#else
+    static const char byte = '\0';
+    if (send(fd, &byte, 1, 0) == -1)
         asc_log_error(MSG("wake up send(): %s"), asc_error_msg());
+#endif /* HAVE_EVENTFD */
+}
+
+/* signal event polling function to return */
+void asc_wake(void)
+{
+    loop_wake(loop_self());
 }
 
 /*
  * callback queue
  */
 
-/* add a procedure to main loop's job list */
-void asc_job_queue(void *owner, loop_callback_t proc, void *arg)
+static
+void job_link(asc_main_loop_t *loop, loop_job_t *job)
 {
-    bool overflow = false;
+    job->next = NULL;
 
-    asc_mutex_lock(&main_loop->job_mutex);
-    if (main_loop->job_cnt < JOB_QUEUE_SIZE)
+    loop_job_t *const prev = asc_atomic_exchange(&loop->job_head, job);
+    asc_atomic_store_release(&prev->next, job);
+}
+
+/* pop next job; NULL if empty or a producer hasn't finished linking yet */
+static
+loop_job_t *job_pop(asc_main_loop_t *loop)
+{
+    loop_job_t *tail = loop->job_tail;
+    loop_job_t *next = asc_atomic_load_acquire(&tail->next);
+
+    if (tail == &loop->job_stub)
     {
-        loop_job_t *const job = &main_loop->jobs[main_loop->job_cnt++];
+        if (next == NULL)
+            return NULL;
+
+        loop->job_tail = next;
+        tail = next;
+        next = asc_atomic_load_acquire(&next->next);
+    }
 
-        job->proc = proc;
-        job->arg = arg;
-        job->owner = owner;
+    if (next != NULL)
+    {
+        loop->job_tail = next;
+        return tail;
+    }
+
+    if (tail != asc_atomic_load(&loop->job_head))
+        return NULL;
+
+    /* last item in queue; put stub back so tail can be released */
+    job_link(loop, &loop->job_stub);
+
+    next = asc_atomic_load_acquire(&tail->next);
+    if (next != NULL)
+    {
+        loop->job_tail = next;
+        return tail;
     }
-    else
+
+    return NULL;
+}
+
+/* returns true if the queue was empty */
+static
+bool job_push(asc_main_loop_t *loop, void *owner, loop_callback_t proc
+              , void *arg)
+{
+    loop_job_t *const job = ASC_ALLOC(1, loop_job_t);
+
+    job->proc = proc;
+    job->arg = arg;
+    job->owner = owner;
+    job->queued = asc_utime();
+
+    const size_t depth = asc_atomic_fetch_add(&loop->job_depth, 1);
+    job_link(loop, job);
+
+    /* owner might be waiting in asc_job_call() */
+    if (asc_atomic_load(&loop->job_waiters) > 0)
     {
-        main_loop->job_cnt = 0;
-        overflow = true;
+        asc_mutex_lock(&loop->job_mutex);
+        asc_cond_signal(&loop->job_cond);
+        asc_mutex_unlock(&loop->job_mutex);
     }
-    asc_mutex_unlock(&main_loop->job_mutex);
 
-    if (overflow)
-        asc_log_error(MSG("job queue overflow, list flushed"));
+    return (depth == 0);
+}
+
+/*
+ * Add a procedure to main loop's job list. The loop is woken up if
+ * the list was empty and the caller is another thread.
+ */
+void asc_job_queue(void *owner, loop_callback_t proc, void *arg)
+{
+    asc_main_loop_t *const loop = loop_self();
+
+    if (job_push(loop, owner, proc, arg) && loop != main_loop)
+        loop_wake(loop);
+}
+
+/* add a procedure to another loop's job list and wake it up */
+void asc_job_send(asc_main_loop_t *loop, void *owner, loop_callback_t proc
+                  , void *arg)
+{
+    if (job_push(loop, owner, proc, arg) && loop != main_loop)
+        loop_wake(loop);
 }
 
-/* remove jobs belonging to a specific module or object */
+/*
+ * Remove jobs belonging to a specific module or object. Must be called
+ * by the thread running the loop; jobs are marked and freed by run_jobs().
+ */
 void asc_job_prune(void *owner)
 {
-    unsigned int i = 0;
+    asc_main_loop_t *const loop = loop_self();
+    ASC_ASSERT(loop == main_loop, MSG("prune from a foreign thread"));
 
-    asc_mutex_lock(&main_loop->job_mutex);
-    while (i < main_loop->job_cnt)
+    loop_job_t *job = loop->job_tail;
+    while (job != NULL)
     {
-        loop_job_t *const job = &main_loop->jobs[i];
+        if (job != &loop->job_stub && job->owner == owner)
+            job->proc = NULL;
 
-        if (job->owner == owner)
-        {
-            main_loop->job_cnt--;
-            memmove(job, &job[1], (main_loop->job_cnt - i) * sizeof(*job));
-        }
-        else
+        job = asc_atomic_load_acquire(&job->next);
+    }
+}
+
+/* run all queued callbacks; returns true if more jobs are on the way */
+static
+bool run_jobs(void)
+{
+    asc_main_loop_t *const loop = main_loop;
+
+    const size_t depth = asc_atomic_load(&loop->job_depth);
+    if (depth > loop->job_depth_max)
+        loop->job_depth_max = depth;
+
+    loop_job_t *job;
+    while ((job = job_pop(loop)) != NULL)
+    {
+        asc_atomic_fetch_sub(&loop->job_depth, 1);
+
+        if (job->proc != NULL)
         {
-            i++;
+            const uint64_t now = asc_utime();
+            const uint64_t latency = (now > job->queued)
+                                     ? now - job->queued : 0;
+
+            loop->job_total++;
+            loop->job_latency_sum += latency;
+            if (latency > loop->job_latency_max)
+                loop->job_latency_max = latency;
+
+            job->proc(job->arg);
         }
+
+        free(job);
     }
-    asc_mutex_unlock(&main_loop->job_mutex);
+
+    return (asc_atomic_load(&loop->job_depth) > 0);
 }
 
-/* run all queued callbacks */
+/* get job queue counters; values are approximate if the loop is running */
+void asc_job_stats(asc_main_loop_t *loop, asc_job_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    stats->depth = asc_atomic_load(&loop->job_depth);
+    stats->depth_max = loop->job_depth_max;
+    stats->total = loop->job_total;
+    stats->latency_max = loop->job_latency_max;
+
+    if (stats->total > 0)
+        stats->latency_avg = loop->job_latency_sum / stats->total;
+}
+
+/*
+ * synchronous calls between loops
+ */
+
+typedef struct
+{
+    loop_callback_t proc;
+    void *arg;
+
+    asc_main_loop_t *caller;
+    bool done;
+} loop_call_t;
+
+/* runs on target loop; reports completion to caller */
 static
-void run_jobs(void)
+void on_job_call(void *arg)
+{
+    loop_call_t *const call = (loop_call_t *)arg;
+    asc_main_loop_t *const caller = call->caller;
+
+    call->proc(call->arg);
+
+    asc_mutex_lock(&caller->job_mutex);
+    call->done = true;
+    asc_cond_signal(&caller->job_cond);
+    asc_mutex_unlock(&caller->job_mutex);
+}
+
+/*
+ * Run a procedure on another loop's thread and wait for it to return.
+ *
+ * The caller keeps servicing its own job queue while waiting, so two
+ * loops calling each other at the same time don't deadlock. The Lua
+ * lock is released for the duration of the call.
+ */
+void asc_job_call(asc_main_loop_t *loop, loop_callback_t proc, void *arg)
 {
-    loop_job_t *const first = &main_loop->jobs[0];
-    loop_job_t job;
+    asc_main_loop_t *const self = main_loop;
+
+    if (loop == self)
+    {
+        proc(arg);
+        return;
+    }
+
+    ASC_ASSERT(self != NULL, MSG("synchronous call from a non-loop thread"));
 
-    asc_mutex_lock(&main_loop->job_mutex);
-    while (main_loop->job_cnt > 0)
+    loop_call_t call = { proc, arg, self, false };
+    unsigned int depth = lua_api_suspend();
+
+    asc_job_send(loop, &call, on_job_call, &call);
+
+    asc_mutex_lock(&self->job_mutex);
+    asc_atomic_fetch_add(&self->job_waiters, 1);
+    while (!call.done)
     {
-        /* pull first job in queue */
-        main_loop->job_cnt--;
-        job = *first;
-        memmove(first, &first[1], main_loop->job_cnt * sizeof(*first));
-
-        /* run it with mutex unlocked */
-        asc_mutex_unlock(&main_loop->job_mutex);
-        job.proc(job.arg);
-        asc_mutex_lock(&main_loop->job_mutex);
+        if (asc_atomic_load(&self->job_depth) > 0)
+        {
+            asc_mutex_unlock(&self->job_mutex);
+
+            lua_api_resume(depth);
+            run_jobs();
+            depth = lua_api_suspend();
+
+            asc_mutex_lock(&self->job_mutex);
+        }
+        else
+        {
+            asc_cond_wait(&self->job_cond, &self->job_mutex);
+        }
     }
-    asc_mutex_unlock(&main_loop->job_mutex);
+    asc_atomic_fetch_sub(&self->job_waiters, 1);
+    asc_mutex_unlock(&self->job_mutex);
+
+    lua_api_resume(depth);
 }
 
 /*
@@ -285,9 +534,20 @@ void run_jobs(void)
 void asc_main_loop_init(void)
 {
     main_loop = ASC_ALLOC(1, asc_main_loop_t);
+    bound_loop = main_loop;
+
+    if (primary_loop == NULL)
+    {
+        primary_loop = main_loop;
+        main_loop->is_primary = true;
+    }
 
     main_loop->wake_fd[0] = main_loop->wake_fd[1] = -1;
+
+    main_loop->job_head = &main_loop->job_stub;
+    main_loop->job_tail = &main_loop->job_stub;
     asc_mutex_init(&main_loop->job_mutex);
+    asc_cond_init(&main_loop->job_cond);
 }
 
 void asc_main_loop_destroy(void)
@@ -296,16 +556,42 @@ void asc_main_loop_destroy(void)
         return;
 
     wake_close();
+
+    loop_job_t *job;
+    while ((job = job_pop(main_loop)) != NULL)
+        free(job);
+
+    asc_cond_destroy(&main_loop->job_cond);
     asc_mutex_destroy(&main_loop->job_mutex);
 
+    if (main_loop == primary_loop)
+        primary_loop = NULL;
+
+    bound_loop = NULL;
     ASC_FREE(main_loop, free);
 }
 
+/* get loop receiving jobs from the calling thread */
+asc_main_loop_t *asc_main_loop_current(void)
+{
+    return loop_self();
+}
+
+/* get loop created by the main thread */
+asc_main_loop_t *asc_main_loop_primary(void)
+{
+    return primary_loop;
+}
+
+/* direct jobs and wake ups from the calling thread to a given loop */
+void asc_main_loop_attach(asc_main_loop_t *loop)
+{
+    bound_loop = loop;
+}
+
 /* process events, return when a shutdown or reload is requested */
 bool asc_main_loop_run(void)
 {
-    uint64_t current_time = asc_utime();
-    uint64_t gc_check_timeout = current_time;
     unsigned int ev_sleep = 0;
 
     while (true)
@@ -344,15 +630,18 @@ bool asc_main_loop_run(void)
             }
         }
 
-        current_time = asc_utime();
-        if ((current_time - gc_check_timeout) >= LUA_GC_TIMEOUT)
+        const bool pending = run_jobs();
+        ev_sleep = asc_timer_core_loop();
+
+        /* producer is still linking a job; poll without sleeping */
+        if (pending)
+            ev_sleep = 0;
+        else if (main_loop->is_primary && ev_sleep > 0)
         {
-            gc_check_timeout = current_time;
-            lua_gc(lua, LUA_GCCOLLECT, 0);
+            /* idle: collect garbage in bounded slices between polls */
+            if (lua_api_gc_step())
+                ev_sleep = 0;
         }
-
-        run_jobs();
-        ev_sleep = asc_timer_core_loop();
     }
 }
 
@@ -363,9 +652,11 @@ bool asc_main_loop_run(void)
 /* request graceful shutdown, abort if called multiple times */
 void asc_main_loop_shutdown(void)
 {
-    if (main_loop->flags & MAIN_LOOP_SHUTDOWN)
+    asc_main_loop_t *const loop = primary_loop;
+
+    if (loop->flags & MAIN_LOOP_SHUTDOWN)
     {
-        if (++main_loop->stop_cnt >= 3)
+        if (++loop->stop_cnt >= 3)
         {
             /*
              * NOTE: can't use regular exit() here as this is usually
@@ -375,24 +666,30 @@ void asc_main_loop_shutdown(void)
              */
             _exit(ASC_EXIT_MAINLOOP);
         }
-        else if (main_loop->stop_cnt >= 2)
+        else if (loop->stop_cnt >= 2)
         {
             asc_log_error(MSG("main thread appears to be blocked; "
                               "will abort on next shutdown request"));
         }
     }
 
-    main_loop->flags |= MAIN_LOOP_SHUTDOWN;
+    loop->flags |= MAIN_LOOP_SHUTDOWN;
 }
 
 /* ask loader program (i.e. main.c) to restart the instance */
 void asc_main_loop_reload(void)
 {
-    main_loop->flags |= MAIN_LOOP_RELOAD;
+    primary_loop->flags |= MAIN_LOOP_RELOAD;
 }
 
 /* reopen logs and run `on_sighup` Lua function if defined */
 void asc_main_loop_sighup(void)
 {
-    main_loop->flags |= MAIN_LOOP_SIGHUP;
+    primary_loop->flags |= MAIN_LOOP_SIGHUP;
+}
+
+/* make the calling thread's loop return from asc_main_loop_run() */
+void asc_main_loop_stop(void)
+{
+    main_loop->flags |= MAIN_LOOP_SHUTDOWN;
 }
@@ -26,21 +26,40 @@
 #   error "Please include <astra/astra.h> first"
 #endif /* !_ASTRA_H_ */
 
+typedef struct asc_main_loop_t asc_main_loop_t;
 typedef void (*loop_callback_t)(void *);
 
+typedef struct
+{
+    size_t depth; /* jobs waiting to be run */
+    size_t depth_max; /* peak queue depth */
+    uint64_t total; /* jobs run so far */
+    uint64_t latency_avg; /* time spent in queue, usecs */
+    uint64_t latency_max;
+} asc_job_stats_t;
+
 void asc_wake_open(void);
 void asc_wake_close(void);
 void asc_wake(void);
 
 void asc_job_queue(void *owner, loop_callback_t proc, void *arg);
+void asc_job_send(asc_main_loop_t *loop, void *owner, loop_callback_t proc
+                  , void *arg);
+void asc_job_call(asc_main_loop_t *loop, loop_callback_t proc, void *arg);
 void asc_job_prune(void *owner);
+void asc_job_stats(asc_main_loop_t *loop, asc_job_stats_t *stats);
 
 void asc_main_loop_init(void);
 void asc_main_loop_destroy(void);
 bool asc_main_loop_run(void) __asc_result;
 
+asc_main_loop_t *asc_main_loop_current(void) __asc_result;
+asc_main_loop_t *asc_main_loop_primary(void) __asc_result;
+void asc_main_loop_attach(asc_main_loop_t *loop);
+
 void asc_main_loop_shutdown(void);
 void asc_main_loop_reload(void);
 void asc_main_loop_sighup(void);
+void asc_main_loop_stop(void);
 
 #endif /* _ASC_MAINLOOP_H_ */
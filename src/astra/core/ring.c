@@ -0,0 +1,112 @@
+/*
+ * Astra Core (Lock-free ring buffer)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <astra/astra.h>
+#include <astra/core/ring.h>
+#include <astra/core/atomic.h>
+
+#define MSG(_msg) "[core/ring] " _msg
+
+/* keep producer and consumer indices on separate cache lines */
+#define RING_CACHE_LINE 64
+
+struct asc_ring_t
+{
+    void **slots;
+    size_t mask;
+
+    char pad1[RING_CACHE_LINE];
+    size_t head; /* next item to pop */
+    char pad2[RING_CACHE_LINE];
+    size_t tail; /* next free slot */
+    char pad3[RING_CACHE_LINE];
+};
+
+asc_ring_t *asc_ring_init(size_t size)
+{
+    ASC_ASSERT(size > 0, MSG("ring size must be non-zero"));
+
+    /* round up to power of two for cheap index wrapping */
+    size_t cap = 1;
+    while (cap < size)
+        cap <<= 1;
+
+    asc_ring_t *const ring = ASC_ALLOC(1, asc_ring_t);
+    ring->slots = ASC_ALLOC(cap, void *);
+    ring->mask = cap - 1;
+
+    return ring;
+}
+
+void asc_ring_destroy(asc_ring_t *ring)
+{
+    free(ring->slots);
+    free(ring);
+}
+
+/* producer only; returns false if the ring is full */
+bool asc_ring_push(asc_ring_t *ring, void *item)
+{
+    const size_t tail = ring->tail;
+    const size_t head = asc_atomic_load_acquire(&ring->head);
+
+    if (tail - head > ring->mask)
+        return false;
+
+    asc_atomic_store_relaxed(&ring->slots[tail & ring->mask], item);
+    asc_atomic_store_release(&ring->tail, tail + 1);
+
+    return true;
+}
+
+/*
+ * Consumer, or producer dropping old items. Slot is read before the
+ * head is claimed; the producer can't overwrite it until head moves
+ * past, in which case the claim fails and we retry.
+ */
+void *asc_ring_pop(asc_ring_t *ring)
+{
+    size_t head = asc_atomic_load(&ring->head);
+
+    while (true)
+    {
+        const size_t tail = asc_atomic_load_acquire(&ring->tail);
+        if (head == tail)
+            return NULL;
+
+        void **const slot = &ring->slots[head & ring->mask];
+        void *const item = asc_atomic_load_relaxed(slot);
+        if (asc_atomic_cas(&ring->head, &head, head + 1))
+            return item;
+    }
+}
+
+size_t asc_ring_count(const asc_ring_t *ring)
+{
+    const size_t head = asc_atomic_load_relaxed(&ring->head);
+    const size_t tail = asc_atomic_load_relaxed(&ring->tail);
+
+    return (tail > head) ? tail - head : 0;
+}
+
+size_t asc_ring_size(const asc_ring_t *ring)
+{
+    return ring->mask + 1;
+}
@@ -0,0 +1,45 @@
+/*
+ * Astra Core (Lock-free ring buffer)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ASC_RING_H_
+#define _ASC_RING_H_ 1
+
+#ifndef _ASTRA_H_
+#   error "Please include <astra/astra.h> first"
+#endif /* !_ASTRA_H_ */
+
+/*
+ * Bounded ring of pointers with a single producer and a single
+ * consumer. The producer may also pop items itself, e.g. to make room
+ * by dropping the oldest entry when the ring is full.
+ */
+
+typedef struct asc_ring_t asc_ring_t;
+
+asc_ring_t *asc_ring_init(size_t size) __asc_result;
+void asc_ring_destroy(asc_ring_t *ring);
+
+bool asc_ring_push(asc_ring_t *ring, void *item) __asc_result;
+void *asc_ring_pop(asc_ring_t *ring) __asc_result;
+
+size_t asc_ring_count(const asc_ring_t *ring) __asc_result;
+size_t asc_ring_size(const asc_ring_t *ring) __asc_result;
+
+#endif /* _ASC_RING_H_ */
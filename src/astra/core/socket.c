@@ -30,10 +30,26 @@
 #   include <arpa/inet.h>
 #   include <netinet/in.h>
 #   include <netinet/tcp.h>
+#   include <netinet/udp.h>
 #   ifdef HAVE_NETINET_SCTP_H
 #       include <netinet/sctp.h>
 #   endif
 #   include <netdb.h>
+#   include <sys/ioctl.h>
+#   ifdef HAVE_LINUX_SOCK_DIAG_H
+#       include <linux/sock_diag.h>
+#   endif
+#   ifdef HAVE_LINUX_NET_TSTAMP_H
+#       include <linux/net_tstamp.h>
+#   endif
+#   ifdef HAVE_LINUX_ERRQUEUE_H
+#       include <linux/errqueue.h>
+#   endif
+#endif
+
+#if defined(SO_TXTIME) && defined(HAVE_LINUX_NET_TSTAMP_H) \
+    && defined(HAVE_SENDMMSG) && defined(HAVE_CLOCK_GETTIME)
+#   define USE_TXTIME 1
 #endif
 
 #ifdef IGMP_EMULATION
@@ -43,6 +59,10 @@
 
 #define MSG(_msg) "[socket %d] " _msg, sock->fd
 
+/* max. payload and segment count for a single UDP GSO send */
+#define GSO_MAX_BYTES 65000
+#define GSO_MAX_SEGMENTS 64
+
 struct asc_socket_t
 {
     int fd;
@@ -57,11 +77,18 @@ struct asc_socket_t
 
     struct ip_mreq mreq;
 
+    size_t gso_size; /* UDP_SEGMENT value, 0 if disabled */
+    bool nonblock;
+
+    bool txtime; /* SO_TXTIME enabled */
+    bool txtime_tai; /* launch times are in CLOCK_TAI, not CLOCK_MONOTONIC */
+
     /* Callbacks */
     void *arg;
     event_callback_t on_read;      /* data read */
     event_callback_t on_close;     /* error occured (connection closed) */
     event_callback_t on_ready;     /* data send is possible now */
+    event_recv_callback_t on_recv; /* datagram received by event backend */
 };
 
 /*
@@ -242,9 +269,17 @@ static void __asc_socket_on_ready(void *arg)
         sock->on_ready(sock->arg);
 }
 
+static void __asc_socket_on_recv(void *arg, const void *data, size_t len)
+{
+    asc_socket_t *sock = (asc_socket_t *)arg;
+    if(sock->on_recv)
+        sock->on_recv(sock->arg, data, len);
+}
+
 static bool __asc_socket_check_event(asc_socket_t *sock)
 {
     const bool is_callback = (   sock->on_read != NULL
+                              || sock->on_recv != NULL
                               || sock->on_ready != NULL
                               || sock->on_close != NULL);
 
@@ -280,6 +315,29 @@ void asc_socket_set_on_read(asc_socket_t *sock, event_callback_t on_read)
     }
 }
 
+bool asc_socket_set_on_recv(asc_socket_t *sock, event_recv_callback_t on_recv)
+{
+    if(sock->on_recv == on_recv)
+        return true;
+
+    sock->on_recv = on_recv;
+
+    if(__asc_socket_check_event(sock))
+    {
+        if(asc_event_set_on_recv(sock->event
+                                 , (on_recv != NULL) ? __asc_socket_on_recv : NULL))
+        {
+            return true;
+        }
+    }
+
+    /* not supported by event backend */
+    sock->on_recv = NULL;
+    __asc_socket_check_event(sock);
+
+    return (on_recv == NULL);
+}
+
 void asc_socket_set_on_ready(asc_socket_t *sock, event_callback_t on_ready)
 {
     if(sock->on_ready == on_ready)
@@ -518,6 +576,188 @@ ssize_t asc_socket_recvfrom(asc_socket_t *sock, void *buffer, size_t size)
                     , (struct sockaddr *)&sock->sockaddr, &slen);
 }
 
+#ifdef HAVE_RECVMMSG
+/* room for SO_RXQ_OVFL, SO_TIMESTAMPNS and IP_PKTINFO control messages */
+#ifdef IP_PKTINFO
+#   define RXINFO_CMSG_PKTINFO CMSG_SPACE(sizeof(struct in_pktinfo))
+#else
+#   define RXINFO_CMSG_PKTINFO 0
+#endif
+
+#define RXINFO_CMSG_SIZE \
+    (CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(struct timespec)) \
+     + RXINFO_CMSG_PKTINFO)
+
+typedef union
+{
+    char buf[RXINFO_CMSG_SIZE];
+    struct cmsghdr align;
+} rxinfo_cmsg_t;
+
+static void rxinfo_parse(struct msghdr *hdr, asc_socket_rxinfo_t *info)
+{
+    memset(info, 0, sizeof(*info));
+
+    for(struct cmsghdr *c = CMSG_FIRSTHDR(hdr); c != NULL
+        ; c = CMSG_NXTHDR(hdr, c))
+    {
+#ifdef IP_PKTINFO
+        if(c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_PKTINFO)
+        {
+            struct in_pktinfo pi;
+            memcpy(&pi, CMSG_DATA(c), sizeof(pi));
+            info->dst = pi.ipi_addr.s_addr;
+
+            continue;
+        }
+#endif
+
+        if(c->cmsg_level != SOL_SOCKET)
+            continue;
+
+#ifdef SO_RXQ_OVFL
+        if(c->cmsg_type == SO_RXQ_OVFL)
+            memcpy(&info->drops, CMSG_DATA(c), sizeof(info->drops));
+#endif
+
+#ifdef SCM_TIMESTAMPNS
+        if(c->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            info->tstamp = (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+        }
+#endif
+    }
+}
+#endif /* HAVE_RECVMMSG */
+
+/*
+ * receive up to `count' datagrams in one call. `buffer' is divided into
+ * `count' slots of `size' bytes each; datagram lengths are stored in
+ * `lengths', and metadata in `info' unless it's NULL. blocking sockets
+ * wait for the first datagram only. returns number of datagrams
+ * received or -1 on error.
+ */
+ssize_t asc_socket_recv_batch(asc_socket_t *sock, void *buffer, size_t size
+                              , size_t *lengths, asc_socket_rxinfo_t *info
+                              , size_t count)
+{
+    if(count > ASC_SOCKET_BATCH_MAX)
+        count = ASC_SOCKET_BATCH_MAX;
+
+    uint8_t *const ptr = (uint8_t *)buffer;
+
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msg[ASC_SOCKET_BATCH_MAX];
+    struct iovec iov[ASC_SOCKET_BATCH_MAX];
+    rxinfo_cmsg_t control[ASC_SOCKET_BATCH_MAX];
+
+    memset(msg, 0, count * sizeof(*msg));
+    for(size_t i = 0; i < count; i++)
+    {
+        iov[i].iov_base = &ptr[i * size];
+        iov[i].iov_len = size;
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+
+        if(info != NULL)
+        {
+            msg[i].msg_hdr.msg_control = control[i].buf;
+            msg[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+        }
+    }
+
+    const int flags = sock->nonblock ? MSG_DONTWAIT : MSG_WAITFORONE;
+    const int ret = recvmmsg(sock->fd, msg, count, flags, NULL);
+    if(ret <= 0)
+        return -1;
+
+    for(int i = 0; i < ret; i++)
+    {
+        lengths[i] = msg[i].msg_len;
+
+        if(info != NULL)
+            rxinfo_parse(&msg[i].msg_hdr, &info[i]);
+    }
+
+    return ret;
+#else
+    /* emulate using plain recv() until socket queue is empty */
+    if(info != NULL)
+        memset(info, 0, count * sizeof(*info));
+
+    size_t i = 0;
+    for(; i < count; i++)
+    {
+        int flags = 0;
+#ifdef MSG_DONTWAIT
+        if(i > 0)
+            flags = MSG_DONTWAIT;
+#else
+        if(i > 0 && !sock->nonblock)
+            break;
+#endif /* MSG_DONTWAIT */
+
+        const ssize_t ret = recv(sock->fd, (char *)&ptr[i * size], size
+                                 , flags);
+        if(ret < 0)
+            break;
+
+        lengths[i] = ret;
+    }
+
+    return (i > 0) ? (ssize_t)i : -1;
+#endif /* HAVE_RECVMMSG */
+}
+
+/*
+ * Bytes waiting in the receive queue. SO_MEMINFO counts the whole queue;
+ * the FIONREAD (SIOCINQ) fallback only sees the first UDP datagram.
+ */
+bool asc_socket_rxq(asc_socket_t *sock, asc_socket_rxq_t *rxq)
+{
+    memset(rxq, 0, sizeof(*rxq));
+
+#if defined(SO_MEMINFO) && defined(HAVE_LINUX_SOCK_DIAG_H)
+    uint32_t mem[SK_MEMINFO_VARS] = { 0 };
+    socklen_t len = sizeof(mem);
+
+    if(getsockopt(sock->fd, SOL_SOCKET, SO_MEMINFO, mem, &len) == 0)
+    {
+        rxq->queued = mem[SK_MEMINFO_RMEM_ALLOC];
+        rxq->rcvbuf = mem[SK_MEMINFO_RCVBUF];
+#ifdef SK_MEMINFO_DROPS
+        if(len > SK_MEMINFO_DROPS * sizeof(*mem))
+            rxq->drops = mem[SK_MEMINFO_DROPS];
+#endif
+
+        return true;
+    }
+#endif /* SO_MEMINFO && HAVE_LINUX_SOCK_DIAG_H */
+
+    int rcvbuf = 0;
+    socklen_t optlen = sizeof(rcvbuf);
+    if(getsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF
+                  , (char *)&rcvbuf, &optlen) == 0)
+    {
+        rxq->rcvbuf = rcvbuf;
+    }
+
+#ifdef _WIN32
+    u_long queued = 0;
+    if(ioctlsocket(sock->fd, FIONREAD, &queued) != 0)
+        return false;
+#else
+    int queued = 0;
+    if(ioctl(sock->fd, FIONREAD, &queued) != 0)
+        return false;
+#endif /* _WIN32 */
+
+    rxq->queued = queued;
+    return true;
+}
+
 /*
  *  oooooooo8 ooooooooooo oooo   oooo ooooooooo
  * 888         888    88   8888o  88   888    88o
@@ -538,6 +778,52 @@ ssize_t asc_socket_send(asc_socket_t *sock, const void *buffer, size_t size)
     return ret;
 }
 
+/*
+ * gather write of `count' buffers; like asc_socket_send(), returns
+ * number of bytes sent, 0 if the socket would block or -1 on error.
+ */
+ssize_t asc_socket_sendv(asc_socket_t *sock, const void *const *buffers
+                         , const size_t *sizes, size_t count)
+{
+    if(count > ASC_SOCKET_BATCH_MAX)
+        count = ASC_SOCKET_BATCH_MAX;
+
+#ifndef _WIN32
+    struct iovec iov[ASC_SOCKET_BATCH_MAX];
+    for(size_t i = 0; i < count; i++)
+    {
+        iov[i].iov_base = (void *)buffers[i];
+        iov[i].iov_len = sizes[i];
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    const ssize_t ret = sendmsg(sock->fd, &msg, 0);
+    if(ret == -1 && asc_socket_would_block())
+        return 0;
+
+    return ret;
+#else
+    /* no sendmsg() on winsock; send buffers until one goes short */
+    ssize_t total = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        const ssize_t ret = asc_socket_send(sock, buffers[i], sizes[i]);
+        if(ret == -1)
+            return (total > 0) ? total : -1;
+
+        total += ret;
+        if((size_t)ret < sizes[i])
+            break;
+    }
+
+    return total;
+#endif /* _WIN32 */
+}
+
 ssize_t asc_socket_sendto(asc_socket_t *sock, const void *buffer, size_t size)
 {
     const socklen_t slen = sizeof(struct sockaddr_in);
@@ -545,6 +831,206 @@ ssize_t asc_socket_sendto(asc_socket_t *sock, const void *buffer, size_t size)
                   , (struct sockaddr *)&sock->sockaddr, slen);
 }
 
+/*
+ * send `count' datagrams of `size' bytes each, stored back to back
+ * in `buffer'. returns number of datagrams sent or -1 on error.
+ */
+ssize_t asc_socket_sendto_batch(asc_socket_t *sock, const void *buffer
+                                , size_t size, size_t count)
+{
+    const uint8_t *const ptr = (const uint8_t *)buffer;
+    const socklen_t slen = sizeof(struct sockaddr_in);
+    size_t sent = 0;
+
+#ifdef UDP_SEGMENT
+    if(sock->gso_size == size && count > 1)
+    {
+        /* kernel splits each send into `size' byte datagrams */
+        size_t max = GSO_MAX_BYTES / size;
+        if(max > GSO_MAX_SEGMENTS)
+            max = GSO_MAX_SEGMENTS;
+
+        while(sent < count)
+        {
+            const size_t left = count - sent;
+            const size_t n = (left > max) ? max : left;
+
+            const ssize_t ret = sendto(sock->fd, &ptr[sent * size], n * size
+                                       , 0, (struct sockaddr *)&sock->sockaddr
+                                       , slen);
+            if(ret < 0)
+                break;
+
+            sent += n;
+        }
+
+        return (sent > 0) ? (ssize_t)sent : -1;
+    }
+#endif /* UDP_SEGMENT */
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msg[ASC_SOCKET_BATCH_MAX];
+    struct iovec iov[ASC_SOCKET_BATCH_MAX];
+
+    while(sent < count)
+    {
+        const size_t left = count - sent;
+        const size_t n = (left > ASC_SOCKET_BATCH_MAX)
+                         ? ASC_SOCKET_BATCH_MAX : left;
+
+        memset(msg, 0, n * sizeof(*msg));
+        for(size_t i = 0; i < n; i++)
+        {
+            iov[i].iov_base = (void *)&ptr[(sent + i) * size];
+            iov[i].iov_len = size;
+            msg[i].msg_hdr.msg_name = &sock->sockaddr;
+            msg[i].msg_hdr.msg_namelen = slen;
+            msg[i].msg_hdr.msg_iov = &iov[i];
+            msg[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int ret = sendmmsg(sock->fd, msg, n, 0);
+        if(ret <= 0)
+            break;
+
+        sent += ret;
+        if((size_t)ret < n)
+            break;
+    }
+#else
+    for(; sent < count; sent++)
+    {
+        const ssize_t ret = sendto(sock->fd, (const char *)&ptr[sent * size]
+                                   , size, 0
+                                   , (struct sockaddr *)&sock->sockaddr, slen);
+        if(ret < 0)
+            break;
+    }
+#endif /* HAVE_SENDMMSG */
+
+    return (sent > 0) ? (ssize_t)sent : -1;
+}
+
+/*
+ * like asc_socket_sendto_batch(), but each datagram carries a launch time
+ * for the etf/fq qdiscs. `txtime' holds one asc_utime() timestamp per
+ * datagram. Falls back to a plain batch send if SO_TXTIME is not enabled.
+ */
+ssize_t asc_socket_sendto_txtime(asc_socket_t *sock, const void *buffer
+                                 , size_t size, size_t count
+                                 , const uint64_t *txtime)
+{
+#ifdef USE_TXTIME
+    if(!sock->txtime)
+        return asc_socket_sendto_batch(sock, buffer, size, count);
+
+    /* translate from asc_utime() to the qdisc's clock */
+    struct timespec ts;
+    clock_gettime(sock->txtime_tai ? CLOCK_TAI : CLOCK_MONOTONIC, &ts);
+    const int64_t offset = (ts.tv_sec * 1000000000LL + ts.tv_nsec)
+                           - (int64_t)asc_utime() * 1000;
+
+    const uint8_t *const ptr = (const uint8_t *)buffer;
+    const socklen_t slen = sizeof(struct sockaddr_in);
+    size_t sent = 0;
+
+    struct mmsghdr msg[ASC_SOCKET_BATCH_MAX];
+    struct iovec iov[ASC_SOCKET_BATCH_MAX];
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(uint64_t))];
+        struct cmsghdr align;
+    } ctl[ASC_SOCKET_BATCH_MAX];
+
+    while(sent < count)
+    {
+        const size_t left = count - sent;
+        const size_t n = (left > ASC_SOCKET_BATCH_MAX)
+                         ? ASC_SOCKET_BATCH_MAX : left;
+
+        memset(msg, 0, n * sizeof(*msg));
+        for(size_t i = 0; i < n; i++)
+        {
+            iov[i].iov_base = (void *)&ptr[(sent + i) * size];
+            iov[i].iov_len = size;
+            msg[i].msg_hdr.msg_name = &sock->sockaddr;
+            msg[i].msg_hdr.msg_namelen = slen;
+            msg[i].msg_hdr.msg_iov = &iov[i];
+            msg[i].msg_hdr.msg_iovlen = 1;
+            msg[i].msg_hdr.msg_control = ctl[i].buf;
+            msg[i].msg_hdr.msg_controllen = sizeof(ctl[i].buf);
+
+            const uint64_t value = txtime[sent + i] * 1000 + offset;
+
+            struct cmsghdr *const cmsg = CMSG_FIRSTHDR(&msg[i].msg_hdr);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_TXTIME;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(value));
+            memcpy(CMSG_DATA(cmsg), &value, sizeof(value));
+        }
+
+        const int ret = sendmmsg(sock->fd, msg, n, 0);
+        if(ret <= 0)
+            break;
+
+        sent += ret;
+        if((size_t)ret < n)
+            break;
+    }
+
+    return (sent > 0) ? (ssize_t)sent : -1;
+#else
+    ASC_UNUSED(txtime);
+    return asc_socket_sendto_batch(sock, buffer, size, count);
+#endif /* USE_TXTIME */
+}
+
+/*
+ * drain the socket error queue, counting datagrams the qdisc dropped
+ * for missing their launch time or having an invalid one.
+ */
+void asc_socket_txtime_errors(asc_socket_t *sock, asc_socket_txerr_t *err)
+{
+#if defined(USE_TXTIME) && defined(HAVE_LINUX_ERRQUEUE_H)
+    if(!sock->txtime)
+        return;
+
+    while(true)
+    {
+        char ctl[CMSG_SPACE(sizeof(struct sock_extended_err))
+                 + CMSG_SPACE(sizeof(struct sockaddr_in))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = ctl;
+        msg.msg_controllen = sizeof(ctl);
+
+        if(recvmsg(sock->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL
+            ; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if(cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+
+            struct sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+
+            if(ee.ee_origin != SO_EE_ORIGIN_TXTIME)
+                continue;
+
+            if(ee.ee_code == SO_EE_CODE_TXTIME_MISSED)
+                err->late++;
+            else
+                err->rejected++;
+        }
+    }
+#else
+    ASC_UNUSED(sock);
+    ASC_UNUSED(err);
+#endif /* USE_TXTIME && HAVE_LINUX_ERRQUEUE_H */
+}
+
 /*
  * ooooo oooo   oooo ooooooooooo  ooooooo
  *  888   8888o  88   888    88 o888   888o
@@ -590,6 +1076,7 @@ void asc_socket_set_nonblock(asc_socket_t *sock, bool is_nonblock)
     if(is_nonblock == false && sock->event)
     {
         sock->on_read = NULL;
+        sock->on_recv = NULL;
         sock->on_ready = NULL;
         sock->on_close = NULL;
 
@@ -609,6 +1096,8 @@ void asc_socket_set_nonblock(asc_socket_t *sock, bool is_nonblock)
 
     ASC_ASSERT(ret == 0, MSG("failed to set non-blocking mode: %s")
                , asc_error_msg());
+
+    sock->nonblock = is_nonblock;
 }
 
 void asc_socket_set_sockaddr(asc_socket_t *sock, const char *addr, int port)
@@ -680,7 +1169,7 @@ void asc_socket_set_timeout(asc_socket_t *sock, int rcvmsec, int sndmsec)
     if(rcvmsec > 0)
     {
         tv.tv_sec = rcvmsec / 1000;
-        tv.tv_usec = rcvmsec % 1000;
+        tv.tv_usec = (rcvmsec % 1000) * 1000;
         setsockopt(sock->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
     }
 
@@ -689,7 +1178,7 @@ void asc_socket_set_timeout(asc_socket_t *sock, int rcvmsec, int sndmsec)
         if(rcvmsec != sndmsec)
         {
             tv.tv_sec = sndmsec / 1000;
-            tv.tv_usec = sndmsec % 1000;
+            tv.tv_usec = (sndmsec % 1000) * 1000;
         }
         setsockopt(sock->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
     }
@@ -751,6 +1240,170 @@ void asc_socket_set_buffer(asc_socket_t *sock, int rcvbuf, int sndbuf)
     }
 }
 
+/* enable UDP generic segmentation offload; Linux 4.18+ */
+bool asc_socket_set_gso(asc_socket_t *sock, size_t segment)
+{
+#ifdef UDP_SEGMENT
+    const int value = segment;
+    if(setsockopt(sock->fd, SOL_UDP, UDP_SEGMENT
+                  , (char *)&value, sizeof(value)) != 0)
+    {
+        asc_log_debug(MSG("failed to set UDP_SEGMENT = `%d': %s")
+                      , value, asc_error_msg());
+
+        return false;
+    }
+
+    sock->gso_size = segment;
+    return true;
+#else
+    ASC_UNUSED(sock);
+    ASC_UNUSED(segment);
+
+    return false;
+#endif /* UDP_SEGMENT */
+}
+
+/* spin in the driver for up to `usecs' on blocking receive */
+bool asc_socket_set_busy_poll(asc_socket_t *sock, int usecs)
+{
+#ifdef SO_BUSY_POLL
+    if(setsockopt(sock->fd, SOL_SOCKET, SO_BUSY_POLL
+                  , (char *)&usecs, sizeof(usecs)) != 0)
+    {
+        asc_log_debug(MSG("failed to set SO_BUSY_POLL = `%d': %s")
+                      , usecs, asc_error_msg());
+
+        return false;
+    }
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    ASC_UNUSED(usecs);
+
+    return false;
+#endif /* SO_BUSY_POLL */
+}
+
+/* report kernel drop counter with each datagram */
+bool asc_socket_set_rxq_ovfl(asc_socket_t *sock)
+{
+#ifdef SO_RXQ_OVFL
+    const int value = 1;
+    if(setsockopt(sock->fd, SOL_SOCKET, SO_RXQ_OVFL
+                  , (char *)&value, sizeof(value)) != 0)
+    {
+        asc_log_debug(MSG("failed to set SO_RXQ_OVFL: %s")
+                      , asc_error_msg());
+
+        return false;
+    }
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    return false;
+#endif /* SO_RXQ_OVFL */
+}
+
+/* report kernel arrival time with each datagram */
+bool asc_socket_set_timestamps(asc_socket_t *sock)
+{
+#ifdef SO_TIMESTAMPNS
+    const int value = 1;
+    if(setsockopt(sock->fd, SOL_SOCKET, SO_TIMESTAMPNS
+                  , (char *)&value, sizeof(value)) != 0)
+    {
+        asc_log_debug(MSG("failed to set SO_TIMESTAMPNS: %s")
+                      , asc_error_msg());
+
+        return false;
+    }
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    return false;
+#endif /* SO_TIMESTAMPNS */
+}
+
+/* report destination address with each datagram */
+bool asc_socket_set_pktinfo(asc_socket_t *sock)
+{
+#if defined(IP_PKTINFO) && defined(HAVE_RECVMMSG)
+    const int value = 1;
+    if(setsockopt(sock->fd, IPPROTO_IP, IP_PKTINFO
+                  , (char *)&value, sizeof(value)) != 0)
+    {
+        asc_log_debug(MSG("failed to set IP_PKTINFO: %s")
+                      , asc_error_msg());
+
+        return false;
+    }
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    return false;
+#endif /* IP_PKTINFO && HAVE_RECVMMSG */
+}
+
+/*
+ * attach launch times to outgoing datagrams; Linux 4.19+. fq expects
+ * CLOCK_MONOTONIC, etf is usually set up with CLOCK_TAI.
+ */
+bool asc_socket_set_txtime(asc_socket_t *sock, bool tai)
+{
+#ifdef USE_TXTIME
+    struct sock_txtime value;
+    memset(&value, 0, sizeof(value));
+    value.clockid = tai ? CLOCK_TAI : CLOCK_MONOTONIC;
+    value.flags = SOF_TXTIME_REPORT_ERRORS;
+
+    if(setsockopt(sock->fd, SOL_SOCKET, SO_TXTIME
+                  , (char *)&value, sizeof(value)) != 0)
+    {
+        asc_log_debug(MSG("failed to set SO_TXTIME: %s")
+                      , asc_error_msg());
+
+        return false;
+    }
+
+    sock->txtime = true;
+    sock->txtime_tai = tai;
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    ASC_UNUSED(tai);
+
+    return false;
+#endif /* USE_TXTIME */
+}
+
+/* cap transmit rate, bytes per second; enforced by the fq qdisc */
+bool asc_socket_set_pacing_rate(asc_socket_t *sock, uint64_t rate)
+{
+#ifdef SO_MAX_PACING_RATE
+    if(setsockopt(sock->fd, SOL_SOCKET, SO_MAX_PACING_RATE
+                  , (char *)&rate, sizeof(rate)) != 0)
+    {
+        asc_log_debug(MSG("failed to set SO_MAX_PACING_RATE = `%llu': %s")
+                      , (unsigned long long)rate, asc_error_msg());
+
+        return false;
+    }
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    ASC_UNUSED(rate);
+
+    return false;
+#endif /* SO_MAX_PACING_RATE */
+}
+
 /*
  * oooo     oooo       oooooooo8     o       oooooooo8 ooooooooooo
  *  8888o   888      o888     88    888     888        88  888  88
@@ -876,10 +1529,11 @@ void asc_socket_set_multicast_loop(asc_socket_t *sock, int is_on)
 
 /* multicast_* */
 
-static int __asc_socket_multicast_cmd(asc_socket_t *sock, int cmd)
+static int __asc_socket_multicast_mreq(asc_socket_t *sock
+                                       , const struct ip_mreq *mreq, int cmd)
 {
     int ret = setsockopt(sock->fd, IPPROTO_IP, cmd
-                         , (const char *)&sock->mreq, sizeof(sock->mreq));
+                         , (const char *)mreq, sizeof(*mreq));
     if(ret == -1)
         return -1;
 
@@ -889,7 +1543,7 @@ static int __asc_socket_multicast_cmd(asc_socket_t *sock, int cmd)
 
     struct sockaddr_in dst;
     memset(&dst, 0, sizeof(dst));
-    dst.sin_addr.s_addr = sock->mreq.imr_multiaddr.s_addr;
+    dst.sin_addr.s_addr = mreq->imr_multiaddr.s_addr;
     dst.sin_family = AF_INET;
 #ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
     dst.sin_len = sizeof(dst);
@@ -897,7 +1551,7 @@ static int __asc_socket_multicast_cmd(asc_socket_t *sock, int cmd)
 
     create_igmp_packet(buffer,
         (cmd == IP_ADD_MEMBERSHIP) ? 0x16 : 0x17,
-        sock->mreq.imr_multiaddr.s_addr);
+        mreq->imr_multiaddr.s_addr);
 
     const int raw_sock = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
     if(raw_sock == -1)
@@ -913,6 +1567,11 @@ static int __asc_socket_multicast_cmd(asc_socket_t *sock, int cmd)
     return 0;
 }
 
+static int __asc_socket_multicast_cmd(asc_socket_t *sock, int cmd)
+{
+    return __asc_socket_multicast_mreq(sock, &sock->mreq, cmd);
+}
+
 void asc_socket_multicast_join(asc_socket_t *sock, const char *addr
                                , const char *localaddr)
 {
@@ -982,3 +1641,76 @@ void asc_socket_multicast_renew(asc_socket_t *sock)
     asc_log_error(MSG("failed to renew multicast group `%s': %s")
                   , inet_ntoa(sock->mreq.imr_multiaddr), err);
 }
+
+static bool multicast_mreq(struct ip_mreq *mreq, const char *addr
+                           , const char *localaddr)
+{
+    memset(mreq, 0, sizeof(*mreq));
+
+    mreq->imr_multiaddr.s_addr = inet_addr(addr);
+    if(!IN_MULTICAST(ntohl(mreq->imr_multiaddr.s_addr)))
+        return false;
+
+    if(localaddr != NULL)
+    {
+        mreq->imr_interface.s_addr = inet_addr(localaddr);
+        if(mreq->imr_interface.s_addr == INADDR_NONE)
+            mreq->imr_interface.s_addr = INADDR_ANY;
+    }
+
+    return true;
+}
+
+/*
+ * Join another group on the same socket. Unlike multicast_join(), this
+ * doesn't log on failure: running out of memberships (ENOBUFS) is
+ * expected and callers may retry on a different socket.
+ */
+bool asc_socket_multicast_add(asc_socket_t *sock, const char *addr
+                              , const char *localaddr)
+{
+    struct ip_mreq mreq;
+    if(!multicast_mreq(&mreq, addr, localaddr))
+        return false;
+
+    return (__asc_socket_multicast_mreq(sock, &mreq, IP_ADD_MEMBERSHIP) == 0);
+}
+
+void asc_socket_multicast_drop(asc_socket_t *sock, const char *addr
+                               , const char *localaddr)
+{
+    struct ip_mreq mreq;
+    if(!multicast_mreq(&mreq, addr, localaddr))
+        return;
+
+    if(__asc_socket_multicast_mreq(sock, &mreq, IP_DROP_MEMBERSHIP) == -1)
+    {
+        asc_log_error(MSG("failed to leave multicast group `%s': %s")
+                      , addr, asc_error_msg());
+    }
+}
+
+/*
+ * With IP_MULTICAST_ALL on (Linux default), a socket bound to a wildcard
+ * address receives every group joined by any socket on the host.
+ */
+bool asc_socket_set_multicast_all(asc_socket_t *sock, bool is_on)
+{
+#ifdef IP_MULTICAST_ALL
+    const int value = is_on;
+    if(setsockopt(sock->fd, IPPROTO_IP, IP_MULTICAST_ALL
+                  , (const char *)&value, sizeof(value)) != 0)
+    {
+        asc_log_debug(MSG("failed to set IP_MULTICAST_ALL: %s")
+                      , asc_error_msg());
+
+        return false;
+    }
+
+    return true;
+#else
+    ASC_UNUSED(sock);
+    ASC_UNUSED(is_on);
+    return false;
+#endif /* IP_MULTICAST_ALL */
+}
@@ -44,6 +44,7 @@ asc_socket_t *asc_socket_open_sctp4(void *arg) __asc_result;
 void asc_socket_set_on_read(asc_socket_t *sock, event_callback_t on_read);
 void asc_socket_set_on_close(asc_socket_t *sock, event_callback_t on_close);
 void asc_socket_set_on_ready(asc_socket_t *sock, event_callback_t on_ready);
+bool asc_socket_set_on_recv(asc_socket_t *sock, event_recv_callback_t on_recv);
 
 void asc_socket_shutdown_recv(asc_socket_t *sock);
 void asc_socket_shutdown_send(asc_socket_t *sock);
@@ -60,8 +61,48 @@ void asc_socket_connect(asc_socket_t *sock, const char *addr, int port
 ssize_t asc_socket_recv(asc_socket_t *sock, void *buffer, size_t size) __asc_result;
 ssize_t asc_socket_recvfrom(asc_socket_t *sock, void *buffer, size_t size) __asc_result;
 
+#define ASC_SOCKET_BATCH_MAX 64
+
+/* per-datagram metadata; fields are 0 where unavailable */
+typedef struct
+{
+    uint32_t drops; /* SO_RXQ_OVFL: datagrams dropped by kernel so far */
+    uint64_t tstamp; /* SO_TIMESTAMPNS: arrival time, nanoseconds */
+    uint32_t dst; /* IP_PKTINFO: destination address, network order */
+} asc_socket_rxinfo_t;
+
+ssize_t asc_socket_recv_batch(asc_socket_t *sock, void *buffer, size_t size
+                              , size_t *lengths, asc_socket_rxinfo_t *info
+                              , size_t count) __asc_result;
+
+/* kernel receive queue snapshot */
+typedef struct
+{
+    size_t queued; /* bytes waiting in the receive queue */
+    size_t rcvbuf; /* receive buffer limit */
+    size_t drops; /* datagrams dropped on full queue, if known */
+} asc_socket_rxq_t;
+
+bool asc_socket_rxq(asc_socket_t *sock, asc_socket_rxq_t *rxq) __asc_result;
+
 ssize_t asc_socket_send(asc_socket_t *sock, const void *buffer, size_t size) __asc_result;
+ssize_t asc_socket_sendv(asc_socket_t *sock, const void *const *buffers
+                         , const size_t *sizes, size_t count) __asc_result;
 ssize_t asc_socket_sendto(asc_socket_t *sock, const void *buffer, size_t size) __asc_result;
+ssize_t asc_socket_sendto_batch(asc_socket_t *sock, const void *buffer
+                                , size_t size, size_t count) __asc_result;
+ssize_t asc_socket_sendto_txtime(asc_socket_t *sock, const void *buffer
+                                 , size_t size, size_t count
+                                 , const uint64_t *txtime) __asc_result;
+
+/* launch time errors reported by the qdisc, accumulated */
+typedef struct
+{
+    uint64_t late; /* missed their launch time */
+    uint64_t rejected; /* launch time refused by the qdisc */
+} asc_socket_txerr_t;
+
+void asc_socket_txtime_errors(asc_socket_t *sock, asc_socket_txerr_t *err);
 
 int asc_socket_fd(asc_socket_t *sock) __asc_result;
 const char *asc_socket_addr(asc_socket_t *sock) __asc_result;
@@ -75,6 +116,14 @@ void asc_socket_set_keep_alive(asc_socket_t *sock, int is_on);
 void asc_socket_set_broadcast(asc_socket_t *sock, int is_on);
 void asc_socket_set_timeout(asc_socket_t *sock, int rcvmsec, int sndmsec);
 void asc_socket_set_buffer(asc_socket_t *sock, int rcvbuf, int sndbuf);
+bool asc_socket_set_gso(asc_socket_t *sock, size_t segment) __asc_result;
+bool asc_socket_set_busy_poll(asc_socket_t *sock, int usecs) __asc_result;
+bool asc_socket_set_rxq_ovfl(asc_socket_t *sock) __asc_result;
+bool asc_socket_set_timestamps(asc_socket_t *sock) __asc_result;
+bool asc_socket_set_pktinfo(asc_socket_t *sock) __asc_result;
+bool asc_socket_set_txtime(asc_socket_t *sock, bool tai) __asc_result;
+bool asc_socket_set_pacing_rate(asc_socket_t *sock
+                                , uint64_t rate) __asc_result;
 
 void asc_socket_set_multicast_if(asc_socket_t *sock, const char *addr);
 void asc_socket_set_multicast_ttl(asc_socket_t *sock, int ttl);
@@ -83,6 +132,13 @@ void asc_socket_multicast_join(asc_socket_t *sock, const char *addr, const char
 void asc_socket_multicast_leave(asc_socket_t *sock);
 void asc_socket_multicast_renew(asc_socket_t *sock);
 
+/* extra memberships for sockets receiving several groups */
+bool asc_socket_multicast_add(asc_socket_t *sock, const char *addr
+                              , const char *localaddr) __asc_result;
+void asc_socket_multicast_drop(asc_socket_t *sock, const char *addr
+                               , const char *localaddr);
+bool asc_socket_set_multicast_all(asc_socket_t *sock, bool is_on) __asc_result;
+
 static inline __asc_result
 bool asc_socket_would_block(void)
 {
@@ -24,6 +24,7 @@
 #include <astra/core/mutex.h>
 #include <astra/core/list.h>
 #include <astra/core/mainloop.h>
+#include <astra/mpegts/block.h>
 
 #define MSG(_msg) "[thread %p] " _msg, (void *)thr
 
@@ -33,6 +34,8 @@ struct asc_thread_t
     thread_callback_t on_close;
     void *arg;
 
+    asc_main_loop_t *loop;
+
 #ifdef _WIN32
     HANDLE thread;
 #else
@@ -45,7 +48,7 @@ typedef struct
     asc_list_t *list;
 } asc_thread_mgr_t;
 
-static
+static __asc_thread
 asc_thread_mgr_t *thread_mgr = NULL;
 
 void asc_thread_core_init(void)
@@ -100,8 +103,13 @@ void *thread_proc(void *arg)
 {
     asc_thread_t *const thr = (asc_thread_t *)arg;
 
+    /* send jobs to the loop this thread was started from */
+    asc_main_loop_attach(thr->loop);
+
     thr->proc(thr->arg);
-    asc_job_queue(thr, on_thread_exit, thr);
+    ts_block_cache_flush();
+
+    asc_job_send(thr->loop, thr, on_thread_exit, thr);
 
     return 0;
 }
@@ -115,6 +123,7 @@ asc_thread_t *asc_thread_init(void *arg, thread_callback_t proc
     thr->proc = proc;
     thr->on_close = on_close;
     thr->arg = arg;
+    thr->loop = asc_main_loop_current();
 
 #ifdef _WIN32
     const intptr_t ret = _beginthreadex(NULL, 0, thread_proc, thr, 0, NULL);
@@ -153,6 +162,54 @@ void asc_thread_join(asc_thread_t *thr)
     free(thr);
 }
 
+/* pin calling thread to a single CPU */
+bool asc_thread_set_affinity(unsigned int cpu)
+{
+#if defined(_WIN32)
+    if (cpu >= sizeof(DWORD_PTR) * 8)
+        return false;
+
+    const DWORD_PTR mask = (DWORD_PTR)1 << cpu;
+    return (SetThreadAffinityMask(GetCurrentThread(), mask) != 0);
+#elif defined(HAVE_PTHREAD_SETAFFINITY_NP)
+    if (cpu >= CPU_SETSIZE)
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+#else
+    ASC_UNUSED(cpu);
+    return false;
+#endif
+}
+
+/* switch calling thread to real-time scheduling; needs privileges */
+bool asc_thread_set_realtime(int priority)
+{
+#ifdef _WIN32
+    ASC_UNUSED(priority);
+    return (SetThreadPriority(GetCurrentThread()
+                              , THREAD_PRIORITY_TIME_CRITICAL) != 0);
+#else
+    const int min = sched_get_priority_min(SCHED_FIFO);
+    const int max = sched_get_priority_max(SCHED_FIFO);
+
+    if (priority < min)
+        priority = min;
+    else if (priority > max)
+        priority = max;
+
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = priority;
+
+    return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0);
+#endif
+}
+
 /*
  * thread buffer (deprecated)
  */
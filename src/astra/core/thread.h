@@ -35,6 +35,8 @@ void asc_thread_core_destroy(void);
 asc_thread_t *asc_thread_init(void *arg, thread_callback_t proc
                               , thread_callback_t on_close) __asc_result;
 void asc_thread_join(asc_thread_t *thr);
+bool asc_thread_set_affinity(unsigned int cpu) __asc_result;
+bool asc_thread_set_realtime(int priority) __asc_result;
 
 /* thread buffer (deprecated) */
 typedef struct asc_thread_buffer_t asc_thread_buffer_t;
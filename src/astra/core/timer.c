@@ -21,7 +21,6 @@
 
 #include <astra/astra.h>
 #include <astra/core/timer.h>
-#include <astra/core/list.h>
 
 #ifdef _WIN32
 #   include <mmsystem.h>
@@ -30,6 +29,12 @@
 #define TIMER_DELAY_MIN 1000 /* 1ms */
 #define TIMER_DELAY_MAX 100000 /* 100ms */
 
+/* deadlines are rounded up to this granularity so that timers due
+ * within the same millisecond fire in a single pass */
+#define TIMER_COALESCE 1000 /* 1ms */
+
+#define TIMER_HEAP_SIZE 64
+
 struct asc_timer_t
 {
     timer_callback_t callback;
@@ -37,13 +42,134 @@ struct asc_timer_t
 
     uint64_t interval;
     uint64_t next_shot;
+
+    size_t idx; /* position in heap */
 };
 
-static asc_list_t *timer_list = NULL;
+/* binary min-heap ordered by next_shot */
+typedef struct
+{
+    asc_timer_t **items;
+    size_t count;
+    size_t size;
+
+    asc_timer_t *current; /* timer whose callback is running */
+} timer_heap_t;
+
+static __asc_thread timer_heap_t *timer_heap = NULL;
 #ifdef _WIN32
-static unsigned int timer_period = 0;
+static __asc_thread unsigned int timer_period = 0;
 #endif
 
+static inline
+uint64_t timer_deadline(uint64_t now, uint64_t interval)
+{
+    /* always strictly in the future */
+    return ((now + interval) / TIMER_COALESCE + 1) * TIMER_COALESCE;
+}
+
+/* next shot of a periodic timer, counted from the previous deadline
+ * so rounding and loop latency don't accumulate. A timer that overran
+ * its period gets a full interval of rest before the next shot, which
+ * is still picked from its original grid. */
+static inline
+uint64_t timer_next_shot(const asc_timer_t *timer, uint64_t now)
+{
+    const uint64_t interval = timer->interval;
+    const uint64_t next = timer->next_shot + interval;
+    if (next > now)
+        return next;
+
+    const uint64_t late = now - next + interval;
+    return next + ((late + interval - 1) / interval) * interval;
+}
+
+static inline
+void heap_set(timer_heap_t *heap, size_t idx, asc_timer_t *timer)
+{
+    heap->items[idx] = timer;
+    timer->idx = idx;
+}
+
+static
+void heap_sift_up(timer_heap_t *heap, size_t idx)
+{
+    asc_timer_t *const timer = heap->items[idx];
+
+    while (idx > 0)
+    {
+        const size_t parent = (idx - 1) / 2;
+        if (heap->items[parent]->next_shot <= timer->next_shot)
+            break;
+
+        heap_set(heap, idx, heap->items[parent]);
+        idx = parent;
+    }
+
+    heap_set(heap, idx, timer);
+}
+
+static
+void heap_sift_down(timer_heap_t *heap, size_t idx)
+{
+    asc_timer_t *const timer = heap->items[idx];
+
+    while (true)
+    {
+        size_t child = idx * 2 + 1;
+        if (child >= heap->count)
+            break;
+
+        asc_timer_t *const *const items = heap->items;
+        if (child + 1 < heap->count
+            && items[child + 1]->next_shot < items[child]->next_shot)
+        {
+            child++;
+        }
+
+        if (timer->next_shot <= heap->items[child]->next_shot)
+            break;
+
+        heap_set(heap, idx, heap->items[child]);
+        idx = child;
+    }
+
+    heap_set(heap, idx, timer);
+}
+
+static
+void heap_insert(timer_heap_t *heap, asc_timer_t *timer)
+{
+    if (heap->count >= heap->size)
+    {
+        heap->size *= 2;
+        const size_t len = heap->size * sizeof(*heap->items);
+        heap->items = (asc_timer_t **)realloc(heap->items, len);
+        ASC_ASSERT(heap->items != NULL, "[core/timer] realloc() failed");
+    }
+
+    heap_set(heap, heap->count, timer);
+    heap_sift_up(heap, heap->count++);
+}
+
+static
+void heap_remove(timer_heap_t *heap, asc_timer_t *timer)
+{
+    const size_t idx = timer->idx;
+    ASC_ASSERT(idx < heap->count && heap->items[idx] == timer
+               , "[core/timer] timer %p is not in the heap", (void *)timer);
+
+    asc_timer_t *const last = heap->items[--heap->count];
+    if (last == timer)
+        return;
+
+    heap_set(heap, idx, last);
+    if (idx > 0 && heap->items[(idx - 1) / 2]->next_shot > last->next_shot)
+        heap_sift_up(heap, idx);
+    else
+        heap_sift_down(heap, idx);
+}
+
 void asc_timer_core_init(void)
 {
 #ifdef _WIN32
@@ -55,20 +181,21 @@ void asc_timer_core_init(void)
     }
 #endif /* _WIN32 */
 
-    timer_list = asc_list_init();
+    timer_heap = ASC_ALLOC(1, timer_heap_t);
+    timer_heap->size = TIMER_HEAP_SIZE;
+    timer_heap->items = ASC_ALLOC(timer_heap->size, asc_timer_t *);
 }
 
 void asc_timer_core_destroy(void)
 {
-    if (timer_list == NULL)
+    if (timer_heap == NULL)
         return;
 
-    asc_list_for(timer_list)
-    {
-        free(asc_list_data(timer_list));
-    }
+    for (size_t i = 0; i < timer_heap->count; i++)
+        free(timer_heap->items[i]);
 
-    ASC_FREE(timer_list, asc_list_destroy);
+    free(timer_heap->items);
+    ASC_FREE(timer_heap, free);
 
 #ifdef _WIN32
     if (timer_period > 0)
@@ -81,41 +208,42 @@ void asc_timer_core_destroy(void)
 
 unsigned int asc_timer_core_loop(void)
 {
-    uint64_t nearest = UINT64_MAX;
-    uint64_t now = asc_utime();
+    timer_heap_t *const heap = timer_heap;
 
-    asc_list_first(timer_list);
-    while (!asc_list_eol(timer_list))
-    {
-        asc_timer_t *const timer = (asc_timer_t *)asc_list_data(timer_list);
+    const uint64_t start = asc_utime();
+    uint64_t now = start;
 
-        if (timer->callback != NULL && now >= timer->next_shot)
-        {
-            timer->callback(timer->arg);
+    /* fire everything that was due when this pass started */
+    while (heap->count > 0)
+    {
+        asc_timer_t *const timer = heap->items[0];
+        if (timer->next_shot > start)
+            break;
 
-            /* refresh timestamp */
-            now = asc_utime();
+        heap->current = timer;
+        timer->callback(timer->arg);
+        heap->current = NULL;
 
-            if (timer->interval > 0)
-                timer->next_shot = now + timer->interval; /* periodic timer */
-            else
-                timer->callback = NULL; /* one shot timer, so remove it */
-        }
+        /* refresh timestamp */
+        now = asc_utime();
 
-        if (timer->callback == NULL)
+        if (timer->callback != NULL && timer->interval > 0)
         {
-            asc_list_remove_current(timer_list);
-            free(timer);
+            /* periodic timer; position may have changed during callback */
+            timer->next_shot = timer_next_shot(timer, now);
+            heap_sift_down(heap, timer->idx);
         }
         else
         {
-            if (timer->next_shot < nearest)
-                nearest = timer->next_shot;
-
-            asc_list_next(timer_list);
+            /* one shot timer or destroyed from its own callback */
+            heap_remove(heap, timer);
+            free(timer);
         }
     }
 
+    const uint64_t nearest = (heap->count > 0)
+                             ? heap->items[0]->next_shot : UINT64_MAX;
+
     uint64_t diff;
     if (nearest < now + TIMER_DELAY_MIN)
         diff = TIMER_DELAY_MIN;
@@ -136,9 +264,8 @@ asc_timer_t *asc_timer_init(unsigned int ms, timer_callback_t callback
     timer->callback = callback;
     timer->arg = arg;
 
-    timer->next_shot = asc_utime() + timer->interval;
-
-    asc_list_insert_tail(timer_list, timer);
+    timer->next_shot = timer_deadline(asc_utime(), timer->interval);
+    heap_insert(timer_heap, timer);
 
     return timer;
 }
@@ -154,6 +281,13 @@ asc_timer_t *asc_timer_one_shot(unsigned int ms, timer_callback_t callback
 
 void asc_timer_destroy(asc_timer_t *timer)
 {
-    /* setting callback to NULL causes timer removal by loop function */
-    timer->callback = NULL;
+    if (timer == timer_heap->current)
+    {
+        /* called from timer's own callback; loop function will free it */
+        timer->callback = NULL;
+        return;
+    }
+
+    heap_remove(timer_heap, timer);
+    free(timer);
 }
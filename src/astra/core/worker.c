@@ -0,0 +1,226 @@
+/*
+ * Astra Core (Worker loops)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Worker loops are additional threads, each running its own copy of
+ * the event, timer and job queue cores. Module instances created on
+ * a worker's thread get their events and timers serviced by that
+ * worker, taking the load off the main thread.
+ *
+ * Worker IDs start at 1; ID 0 refers to the main thread.
+ */
+
+#include <astra/astra.h>
+#include <astra/core/worker.h>
+#include <astra/core/thread.h>
+#include <astra/core/timer.h>
+#include <astra/core/event.h>
+#include <astra/core/mutex.h>
+#include <astra/core/cond.h>
+
+#define MSG(_msg) "[worker] " _msg
+
+typedef struct
+{
+    unsigned int id;
+    asc_thread_t *thr;
+    asc_main_loop_t *loop;
+} asc_worker_t;
+
+typedef struct
+{
+    asc_worker_t *list;
+    unsigned int count;
+
+    asc_mutex_t mutex;
+    asc_cond_t cond;
+} asc_worker_mgr_t;
+
+static
+asc_worker_mgr_t *worker_mgr = NULL;
+
+static __asc_thread
+unsigned int worker_id = 0;
+
+void asc_worker_core_init(void)
+{
+    worker_mgr = ASC_ALLOC(1, asc_worker_mgr_t);
+
+    asc_mutex_init(&worker_mgr->mutex);
+    asc_cond_init(&worker_mgr->cond);
+}
+
+static
+void worker_close(void *arg);
+
+void asc_worker_core_destroy(void)
+{
+    if (worker_mgr == NULL)
+        return;
+
+    for (unsigned int i = 0; i < worker_mgr->count; i++)
+    {
+        asc_worker_t *const wrk = &worker_mgr->list[i];
+
+        if (wrk->thr != NULL)
+            worker_close(wrk);
+    }
+
+    if (worker_mgr->count > 0)
+        asc_wake_close();
+
+    asc_cond_destroy(&worker_mgr->cond);
+    asc_mutex_destroy(&worker_mgr->mutex);
+
+    ASC_FREE(worker_mgr->list, free);
+    ASC_FREE(worker_mgr, free);
+}
+
+/*
+ * worker thread
+ */
+
+static
+void worker_proc(void *arg)
+{
+    asc_worker_t *const wrk = (asc_worker_t *)arg;
+    worker_id = wrk->id;
+
+    asc_thread_core_init();
+    asc_timer_core_init();
+    asc_event_core_init();
+    asc_main_loop_init();
+
+    /* other threads need to be able to interrupt our polling */
+    asc_wake_open();
+
+    asc_mutex_lock(&worker_mgr->mutex);
+    wrk->loop = asc_main_loop_current();
+    asc_cond_broadcast(&worker_mgr->cond);
+    asc_mutex_unlock(&worker_mgr->mutex);
+
+    asc_log_debug(MSG("worker %u started"), wrk->id);
+
+    while (asc_main_loop_run())
+        asc_log_error(MSG("worker %u: event polling failed"), wrk->id);
+
+    asc_log_debug(MSG("worker %u stopped"), wrk->id);
+
+    asc_wake_close();
+
+    asc_thread_core_destroy();
+    asc_main_loop_destroy();
+    asc_event_core_destroy();
+    asc_timer_core_destroy();
+}
+
+static
+void on_worker_stop(void *arg)
+{
+    ASC_UNUSED(arg);
+    asc_main_loop_stop();
+}
+
+static
+void worker_close(void *arg)
+{
+    asc_worker_t *const wrk = (asc_worker_t *)arg;
+
+    asc_job_send(wrk->loop, NULL, on_worker_stop, NULL);
+    ASC_FREE(wrk->thr, asc_thread_join);
+}
+
+/*
+ * public API
+ */
+
+/* start worker threads; can only be called once per instance */
+bool asc_worker_start(unsigned int count)
+{
+#ifndef HAVE_THREAD_LOCAL
+    ASC_UNUSED(count);
+    asc_log_error(MSG("worker loops are not supported on this platform"));
+
+    return false;
+#else /* !HAVE_THREAD_LOCAL */
+    if (worker_mgr->count > 0)
+    {
+        asc_log_error(MSG("workers are already running"));
+        return false;
+    }
+
+    if (count == 0 || count > ASC_WORKER_MAX)
+    {
+        asc_log_error(MSG("worker count must be between 1 and %u")
+                      , ASC_WORKER_MAX);
+
+        return false;
+    }
+
+    /* wake up main thread for jobs sent from workers */
+    asc_wake_open();
+
+    worker_mgr->list = ASC_ALLOC(count, asc_worker_t);
+    worker_mgr->count = count;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        asc_worker_t *const wrk = &worker_mgr->list[i];
+
+        wrk->id = i + 1;
+        wrk->thr = asc_thread_init(wrk, worker_proc, worker_close);
+    }
+
+    /* wait until all loops are up */
+    asc_mutex_lock(&worker_mgr->mutex);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        while (worker_mgr->list[i].loop == NULL)
+            asc_cond_wait(&worker_mgr->cond, &worker_mgr->mutex);
+    }
+    asc_mutex_unlock(&worker_mgr->mutex);
+
+    asc_log_info(MSG("started %u worker loop%s")
+                 , count, (count > 1 ? "s" : ""));
+
+    return true;
+#endif /* HAVE_THREAD_LOCAL */
+}
+
+/* get number of running worker threads */
+unsigned int asc_worker_count(void)
+{
+    return worker_mgr->count;
+}
+
+/* get calling thread's worker ID, 0 for the main thread */
+unsigned int asc_worker_id(void)
+{
+    return worker_id;
+}
+
+/* get loop of a given worker, NULL if there's no such worker */
+asc_main_loop_t *asc_worker_loop(unsigned int id)
+{
+    if (id == 0 || id > worker_mgr->count)
+        return NULL;
+
+    return worker_mgr->list[id - 1].loop;
+}
@@ -0,0 +1,41 @@
+/*
+ * Astra Core (Worker loops)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ASC_WORKER_H_
+#define _ASC_WORKER_H_ 1
+
+#ifndef _ASTRA_H_
+#   error "Please include <astra/astra.h> first"
+#endif /* !_ASTRA_H_ */
+
+#include <astra/core/mainloop.h>
+
+/* maximum number of worker threads */
+#define ASC_WORKER_MAX 64
+
+void asc_worker_core_init(void);
+void asc_worker_core_destroy(void);
+
+bool asc_worker_start(unsigned int count) __asc_result;
+unsigned int asc_worker_count(void) __asc_result;
+unsigned int asc_worker_id(void) __asc_result;
+asc_main_loop_t *asc_worker_loop(unsigned int id) __asc_result;
+
+#endif /* _ASC_WORKER_H_ */
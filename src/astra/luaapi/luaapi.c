@@ -21,6 +21,7 @@
 
 #include <astra/astra.h>
 #include <astra/luaapi/luaapi.h>
+#include <astra/luaapi/state.h>
 
 #define MSG(_msg) "[lua] " _msg
 
@@ -95,3 +96,54 @@ void lua_err_log(lua_State *L)
     if (lua_gettop(L) > 0)
         lua_pop(L, 1);
 }
+
+/*
+ * calls across worker loops
+ */
+
+typedef struct
+{
+    lua_State *L;
+    int nargs;
+    int status;
+} remote_call_t;
+
+static
+void on_remote_call(void *arg)
+{
+    remote_call_t *const rc = (remote_call_t *)arg;
+
+    lua_api_lock();
+    rc->status = lua_pcall(rc->L, rc->nargs, LUA_MULTRET, 0);
+    lua_api_unlock();
+}
+
+/*
+ * Call function on another loop's thread, return number of results.
+ * Errors are caught on the remote side and rethrown in caller's context.
+ *
+ * The call runs on a new Lua thread rather than on the caller's stack:
+ * the caller's loop may enter Lua again from its own jobs while it is
+ * waiting, and the two sets of frames must not end up interleaved.
+ */
+int lua_remote_call(lua_State *L, asc_main_loop_t *loop, int nargs)
+{
+    lua_State *const co = lua_newthread(L);
+    lua_insert(L, -(nargs + 2));
+    lua_xmove(L, co, nargs + 1);
+
+    remote_call_t rc = { co, nargs, LUA_OK };
+
+    asc_job_call(loop, on_remote_call, &rc);
+    if (rc.status != LUA_OK)
+    {
+        lua_xmove(co, L, 1);
+        return lua_error(L);
+    }
+
+    const int nres = lua_gettop(co);
+    luaL_checkstack(L, nres, "too many results");
+    lua_xmove(co, L, nres);
+
+    return nres;
+}
@@ -30,8 +30,11 @@
 #include <lualib.h>
 #include <lauxlib.h>
 
+#include <astra/core/mainloop.h>
+
 int lua_tr_call(lua_State *L, int nargs, int nresults) __asc_result;
 void lua_err_log(lua_State *L);
+int lua_remote_call(lua_State *L, asc_main_loop_t *loop, int nargs);
 
 #define lua_foreach(_lua, _idx) \
     for (lua_pushnil(_lua) \
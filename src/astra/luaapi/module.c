@@ -21,6 +21,7 @@
 
 #include <astra/astra.h>
 #include <astra/luaapi/module.h>
+#include <astra/luaapi/state.h>
 
 #define MSG(_msg) "[module %s] " _msg, \
     (mod->manifest != NULL ? mod->manifest->name : NULL)
@@ -34,6 +35,7 @@ struct module_data_t
      */
     const module_manifest_t *manifest;
     lua_State *lua;
+    asc_main_loop_t *loop;
 };
 
 /*
@@ -47,7 +49,7 @@ struct module_data_t
     ((module_data_t *)lua_touserdata(L, lua_upvalueindex(2)))
 
 static
-int callback_thunk(lua_State *L)
+int method_thunk(lua_State *L)
 {
     void *const mod = lua_touserdata(L, lua_upvalueindex(1));
     void *const method = lua_touserdata(L, lua_upvalueindex(2));
@@ -55,6 +57,26 @@ int callback_thunk(lua_State *L)
     return ((module_method_t *)method)->func(L, (module_data_t *)mod);
 }
 
+static
+int callback_thunk(lua_State *L)
+{
+    const module_data_t *const mod =
+        (module_data_t *)lua_touserdata(L, lua_upvalueindex(1));
+
+    if (mod->loop == asc_main_loop_current())
+        return method_thunk(L);
+
+    /* instance belongs to another worker; call method on its thread */
+    const int nargs = lua_gettop(L);
+
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_pushvalue(L, lua_upvalueindex(2));
+    lua_pushcclosure(L, method_thunk, 2);
+    lua_insert(L, 1);
+
+    return lua_remote_call(L, mod->loop, nargs);
+}
+
 void module_add_methods(lua_State *L, const module_data_t *mod
                         , const module_method_t *list)
 {
@@ -77,15 +99,25 @@ int method_tostring(lua_State *L)
 }
 
 static
-int method_gc(lua_State *L)
+void module_destroy(void *arg)
 {
-    const module_manifest_t *const manifest = GET_MANIFEST(L);
-    module_data_t *const mod = GET_MODULE_DATA(L);
+    module_data_t *const mod = (module_data_t *)arg;
 
-    if (manifest->reg->destroy != NULL)
-        manifest->reg->destroy(mod);
+    lua_api_lock();
+    if (mod->manifest->reg->destroy != NULL)
+        mod->manifest->reg->destroy(mod);
+    lua_api_unlock();
 
     free(mod);
+}
+
+static
+int method_gc(lua_State *L)
+{
+    module_data_t *const mod = GET_MODULE_DATA(L);
+
+    /* instances are always destroyed by the thread that created them */
+    asc_job_call(mod->loop, module_destroy, mod);
 
     return 0;
 }
@@ -105,9 +137,8 @@ int method_new(lua_State *L)
     module_data_t *const mod = (module_data_t *)asc_calloc(1, manifest->size);
     mod->manifest = manifest;
 
-    lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
-    mod->lua = lua_tothread(L, -1);
-    lua_pop(L, 1);
+    mod->lua = lua_api_thread(L);
+    mod->loop = asc_main_loop_current();
 
     /* NOTE: module instances appear as tables in Lua */
     lua_newtable(L);
@@ -186,6 +217,11 @@ lua_State *module_lua(const module_data_t *mod)
     return mod->lua;
 }
 
+asc_main_loop_t *module_loop(const module_data_t *mod)
+{
+    return mod->loop;
+}
+
 /*
  * module option getters
  */
@@ -64,6 +64,7 @@ void module_add_methods(lua_State *L, const module_data_t *mod
                         , const module_method_t *list);
 void module_register(lua_State *L, const module_manifest_t *manifest);
 lua_State *module_lua(const module_data_t *mod) __asc_result;
+asc_main_loop_t *module_loop(const module_data_t *mod) __asc_result;
 
 bool module_option_integer(lua_State *L, const char *name, int *integer);
 bool module_option_string(lua_State *L, const char *name, const char **string
@@ -21,14 +21,40 @@
 #include <astra/astra.h>
 #include <astra/luaapi/state.h>
 #include <astra/luaapi/module.h>
+#include <astra/core/mutex.h>
 
 #include "../lualib/list.h"
 
 #define MSG(_msg) "[lua] " _msg
 
+/* minimum interval between starting GC cycles, usecs */
+#define GC_CYCLE_INTERVAL (1 * 1000 * 1000)
+
 /* global Lua state */
 lua_State *lua = NULL;
 
+/* serializes access to Lua state once worker loops are started */
+static asc_mutex_t lua_mutex;
+static bool lock_enabled = false;
+static __asc_thread unsigned int lock_depth = 0;
+
+/* Lua thread used by the calling loop for callbacks into Lua */
+static __asc_thread lua_State *loop_lua = NULL;
+
+/* incremental GC scheduler state */
+static struct
+{
+    unsigned int budget;
+    bool in_cycle;
+    uint64_t cycle_start;
+
+    uint64_t steps;
+    uint64_t cycles;
+    uint64_t pause_last;
+    uint64_t pause_max;
+    uint64_t pause_total;
+} gc = { .budget = LUA_API_GC_BUDGET };
+
 static
 int panic_handler(lua_State *L)
 {
@@ -107,10 +133,176 @@ lua_State *lua_api_init(void)
     for (size_t i = 0; lua_lib_list[i] != NULL; i++)
         module_register(L, lua_lib_list[i]);
 
+    /* new instance starts with a fresh GC schedule */
+    memset(&gc, 0, sizeof(gc));
+    gc.budget = LUA_API_GC_BUDGET;
+    gc.cycle_start = asc_utime();
+
+    /* main loop runs callbacks on the main thread */
+    loop_lua = L;
+
     return L;
 }
 
 void lua_api_destroy(lua_State *L)
 {
     lua_close(L);
+    loop_lua = NULL;
+}
+
+/*
+ * Get Lua thread for the calling loop, creating it if needed. Every
+ * worker runs on a stack of its own: while one of them waits for
+ * another loop with the lock released, the rest may enter Lua and
+ * would otherwise push frames in between those of the waiting call.
+ * The thread is anchored in the registry for the life of the state.
+ */
+lua_State *lua_api_thread(lua_State *L)
+{
+    if (loop_lua == NULL)
+    {
+        loop_lua = lua_newthread(L);
+        luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    return loop_lua;
+}
+
+/*
+ * incremental garbage collection
+ */
+
+/*
+ * Advance the collector by a slice bounded by the configured budget.
+ * Called by the main thread's loop when it has nothing else to do.
+ * A new cycle is started at most once per GC_CYCLE_INTERVAL, and is
+ * then carried out in slices over as many loop iterations as it takes.
+ * Lua's own allocation-driven collector keeps running as usual.
+ *
+ * NOTE: a single collector step can't be interrupted, so traversing
+ *       a very large table or running the atomic phase may still
+ *       exceed the budget.
+ *
+ * Returns true if the cycle is still in progress.
+ */
+bool lua_api_gc_step(void)
+{
+    const uint64_t start = asc_utime();
+
+    if (!gc.in_cycle)
+    {
+        if (start - gc.cycle_start < GC_CYCLE_INTERVAL)
+            return false;
+
+        gc.in_cycle = true;
+        gc.cycle_start = start;
+    }
+
+    uint64_t now = start;
+    do
+    {
+        if (lua_gc(lua, LUA_GCSTEP, 0))
+        {
+            gc.in_cycle = false;
+            gc.cycles++;
+            now = asc_utime();
+            break;
+        }
+
+        now = asc_utime();
+    } while (now - start < gc.budget);
+
+    const uint64_t pause = now - start;
+
+    gc.steps++;
+    gc.pause_last = pause;
+    gc.pause_total += pause;
+    if (pause > gc.pause_max)
+        gc.pause_max = pause;
+
+    return gc.in_cycle;
+}
+
+void lua_api_gc_set_budget(unsigned int usecs)
+{
+    gc.budget = usecs;
+}
+
+void lua_api_gc_stats(lua_api_gc_stats_t *stats)
+{
+    stats->budget = gc.budget;
+    stats->heap = (size_t)lua_gc(lua, LUA_GCCOUNT, 0) * 1024
+                  + lua_gc(lua, LUA_GCCOUNTB, 0);
+    stats->steps = gc.steps;
+    stats->cycles = gc.cycles;
+    stats->pause_last = gc.pause_last;
+    stats->pause_max = gc.pause_max;
+    stats->pause_total = gc.pause_total;
+}
+
+/*
+ * Lua state lock
+ */
+
+/* start serializing Lua access; calling thread becomes the lock holder */
+void lua_api_lock_enable(void)
+{
+    if (lock_enabled)
+        return;
+
+    asc_mutex_init(&lua_mutex);
+    lock_enabled = true;
+
+    lua_api_lock();
+}
+
+/* called after all other threads are done with the Lua state */
+void lua_api_lock_disable(void)
+{
+    if (!lock_enabled)
+        return;
+
+    lua_api_suspend();
+    lock_enabled = false;
+
+    asc_mutex_destroy(&lua_mutex);
+}
+
+void lua_api_lock(void)
+{
+    if (lock_enabled && lock_depth++ == 0)
+        asc_mutex_lock(&lua_mutex);
+}
+
+void lua_api_unlock(void)
+{
+    if (!lock_enabled)
+        return;
+
+    ASC_ASSERT(lock_depth > 0, MSG("Lua lock is not held"));
+    if (--lock_depth == 0)
+        asc_mutex_unlock(&lua_mutex);
+}
+
+/* release lock regardless of nesting, return depth for lua_api_resume() */
+unsigned int lua_api_suspend(void)
+{
+    const unsigned int depth = lock_depth;
+
+    if (depth > 0)
+    {
+        lock_depth = 0;
+        asc_mutex_unlock(&lua_mutex);
+    }
+
+    return depth;
+}
+
+void lua_api_resume(unsigned int depth)
+{
+    if (depth > 0 && lock_enabled)
+    {
+        asc_mutex_lock(&lua_mutex);
+        lock_depth = depth;
+    }
 }
@@ -29,7 +29,33 @@
 
 extern lua_State *lua;
 
+/* default maximum time spent in GC per main loop iteration, usecs */
+#define LUA_API_GC_BUDGET 500
+
+typedef struct
+{
+    unsigned int budget; /* max pause per slice, usecs */
+    size_t heap; /* bytes in use by Lua */
+    uint64_t steps; /* slices run so far */
+    uint64_t cycles; /* completed collection cycles */
+    uint64_t pause_last; /* duration of last slice, usecs */
+    uint64_t pause_max;
+    uint64_t pause_total;
+} lua_api_gc_stats_t;
+
 lua_State *lua_api_init(void) __asc_result;
 void lua_api_destroy(lua_State *L);
+lua_State *lua_api_thread(lua_State *L) __asc_result;
+
+void lua_api_lock_enable(void);
+void lua_api_lock_disable(void);
+void lua_api_lock(void);
+void lua_api_unlock(void);
+unsigned int lua_api_suspend(void);
+void lua_api_resume(unsigned int depth);
+
+bool lua_api_gc_step(void);
+void lua_api_gc_set_budget(unsigned int usecs);
+void lua_api_gc_stats(lua_api_gc_stats_t *stats);
 
 #endif /* _LUA_STATE_H_ */
@@ -21,24 +21,64 @@
 
 #include <astra/astra.h>
 #include <astra/luaapi/stream.h>
+#include <astra/core/atomic.h>
+#include <astra/core/clock.h>
 #include <astra/core/list.h>
+#include <astra/core/mutex.h>
+#include <astra/core/worker.h>
 
 #define MSG(_msg) "[stream %s] " _msg, \
     (mod->manifest != NULL ? mod->manifest->name : NULL)
 
 typedef struct module_stream_t module_stream_t;
 
+/* filtering children subscribed to a pid */
+typedef struct
+{
+    module_stream_t **list;
+    unsigned int count;
+    unsigned int size;
+} demux_subs_t;
+
 struct module_stream_t
 {
     module_data_t *self;
     module_stream_t *parent;
 
     stream_callback_t on_ts;
+    stream_batch_callback_t on_ts_batch;
+    stream_block_callback_t on_ts_block;
     asc_list_t *children;
 
+    /* loop delivering TS to children, if other than module's own */
+    asc_main_loop_t *out_loop;
+
     demux_callback_t join_pid;
     demux_callback_t leave_pid;
     uint8_t pid_list[TS_MAX_PIDS];
+
+    /* receive only joined pids; see module_demux_set_filter() */
+    bool filter;
+    const uint8_t *run;
+    size_t run_cnt;
+
+    /* pid dispatch table, allocated for first filtering child */
+    demux_subs_t *subs;
+
+    /* graph registry; see module_stream_graph() */
+    module_stream_t *reg_prev;
+    module_stream_t *reg_next;
+    size_t id;
+    unsigned int worker;
+    char *name;
+
+    struct
+    {
+        size_t packets_in;
+        size_t packets_out;
+        size_t drops;
+        size_t time; /* usecs spent in callbacks */
+    } stats;
 };
 
 struct module_data_t
@@ -51,11 +91,102 @@ struct module_data_t
      */
     const module_manifest_t *manifest;
     lua_State *lua;
+    asc_main_loop_t *loop;
     module_stream_t *stream;
 };
 
 ASC_STATIC_ASSERT(sizeof(module_data_t) <= STREAM_MODULE_DATA_SIZE);
 
+/*
+ * Every stream node is linked into a registry so the module tree can be
+ * walked from any thread. Parent links and the registry itself are only
+ * changed with the mutex held; counters are written by the thread that
+ * owns the node and read without locking.
+ */
+static struct
+{
+    asc_mutex_t mutex;
+    module_stream_t *head;
+    module_stream_t *tail;
+    size_t next_id;
+    bool timing;
+} graph;
+
+void module_stream_core_init(void)
+{
+    memset(&graph, 0, sizeof(graph));
+    asc_mutex_init(&graph.mutex);
+}
+
+void module_stream_core_destroy(void)
+{
+    ASC_ASSERT(graph.head == NULL, "[stream] leaked stream modules");
+    asc_mutex_destroy(&graph.mutex);
+}
+
+static
+void graph_insert(module_stream_t *st)
+{
+    asc_mutex_lock(&graph.mutex);
+
+    st->id = ++graph.next_id;
+    st->reg_prev = graph.tail;
+
+    if (graph.tail != NULL)
+        graph.tail->reg_next = st;
+    else
+        graph.head = st;
+
+    graph.tail = st;
+
+    asc_mutex_unlock(&graph.mutex);
+}
+
+static
+void graph_remove(module_stream_t *st)
+{
+    asc_mutex_lock(&graph.mutex);
+
+    if (st->reg_prev != NULL)
+        st->reg_prev->reg_next = st->reg_next;
+    else
+        graph.head = st->reg_next;
+
+    if (st->reg_next != NULL)
+        st->reg_next->reg_prev = st->reg_prev;
+    else
+        graph.tail = st->reg_prev;
+
+    asc_mutex_unlock(&graph.mutex);
+}
+
+/* single writer per counter; relaxed store keeps readers tear-free */
+static inline
+void stat_add(size_t *counter, size_t value)
+{
+    asc_atomic_store_relaxed(counter
+                             , asc_atomic_load_relaxed(counter) + value);
+}
+
+/* account for packets handed to a node; returns timing start point */
+static inline
+uint64_t stat_enter(module_stream_t *st, size_t count)
+{
+    stat_add(&st->stats.packets_in, count);
+
+    if (asc_atomic_load_relaxed(&graph.timing))
+        return asc_utime();
+
+    return 0;
+}
+
+static inline
+void stat_leave(module_stream_t *st, uint64_t start)
+{
+    if (start != 0)
+        stat_add(&st->stats.time, asc_utime() - start);
+}
+
 /*
  * init and cleanup
  */
@@ -87,12 +218,14 @@ void module_stream_init(lua_State *L, module_data_t *mod
     st->self = mod;
     st->on_ts = on_ts;
     st->children = asc_list_init();
+    st->worker = asc_worker_id();
 
     /* demux default: forward downstream pid requests to parent */
     st->join_pid = module_demux_join;
     st->leave_pid = module_demux_leave;
 
     mod->stream = st;
+    graph_insert(st);
 
     if (L != NULL)
     {
@@ -100,6 +233,12 @@ void module_stream_init(lua_State *L, module_data_t *mod
 
         if (lua_istable(L, MODULE_OPTIONS_IDX))
         {
+            lua_getfield(L, MODULE_OPTIONS_IDX, "name");
+            if (lua_type(L, -1) == LUA_TSTRING)
+                st->name = strdup(lua_tostring(L, -1));
+
+            lua_pop(L, 1);
+
             lua_getfield(L, MODULE_OPTIONS_IDX, "upstream");
             if (!lua_isnil(L, -1))
                 method_set_upstream(L, mod);
@@ -126,6 +265,7 @@ void module_stream_destroy(module_data_t *mod)
     module_stream_attach(NULL, mod);
 
     /* detach children */
+    asc_mutex_lock(&graph.mutex);
     asc_list_for(mod->stream->children)
     {
         module_stream_t *const i =
@@ -133,7 +273,19 @@ void module_stream_destroy(module_data_t *mod)
 
         i->parent = NULL;
     }
+    asc_mutex_unlock(&graph.mutex);
+
+    graph_remove(mod->stream);
+
+    if (mod->stream->subs != NULL)
+    {
+        for (unsigned int i = 0; i < TS_MAX_PIDS; i++)
+            free(mod->stream->subs[i].list);
+
+        free(mod->stream->subs);
+    }
 
+    free(mod->stream->name);
     ASC_FREE(mod->stream->children, asc_list_destroy);
     ASC_FREE(mod->stream, free);
 }
@@ -158,6 +310,9 @@ int method_set_upstream(lua_State *L, module_data_t *mod)
                 luaL_error(L, MSG("this module cannot receive TS"));
 
             up = (module_data_t *)lua_touserdata(L, -1);
+            if (module_stream_loop(up) != mod->loop)
+                luaL_error(L, MSG("upstream module runs on another worker"));
+
             module_stream_attach(up, mod);
             break;
 
@@ -168,6 +323,19 @@ int method_set_upstream(lua_State *L, module_data_t *mod)
     return 0;
 }
 
+void module_stream_set_loop(module_data_t *mod, asc_main_loop_t *loop)
+{
+    mod->stream->out_loop = loop;
+}
+
+asc_main_loop_t *module_stream_loop(const module_data_t *mod)
+{
+    if (mod->stream != NULL && mod->stream->out_loop != NULL)
+        return mod->stream->out_loop;
+
+    return mod->loop;
+}
+
 void module_stream_attach(module_data_t *mod, module_data_t *child)
 {
     /* save pid membership data, leave all pids */
@@ -183,6 +351,7 @@ void module_stream_attach(module_data_t *mod, module_data_t *child)
 
     /* switch parents */
     module_stream_t *const cs = child->stream;
+    asc_mutex_lock(&graph.mutex);
 
     if (cs->parent != NULL)
     {
@@ -190,6 +359,9 @@ void module_stream_attach(module_data_t *mod, module_data_t *child)
         cs->parent = NULL;
     }
 
+    cs->run = NULL;
+    cs->run_cnt = 0;
+
     if (mod != NULL)
     {
         module_stream_t *const ps = mod->stream;
@@ -200,6 +372,8 @@ void module_stream_attach(module_data_t *mod, module_data_t *child)
         asc_list_insert_tail(ps->children, cs);
     }
 
+    asc_mutex_unlock(&graph.mutex);
+
     /* re-request pids from new parent */
     for (unsigned int i = 0; i < TS_MAX_PIDS; i++)
     {
@@ -208,17 +382,319 @@ void module_stream_attach(module_data_t *mod, module_data_t *child)
     }
 }
 
+/* return upstream module, NULL if detached */
+module_data_t *module_stream_parent(const module_data_t *mod)
+{
+    module_data_t *parent = NULL;
+
+    asc_mutex_lock(&graph.mutex);
+    if (mod->stream->parent != NULL)
+        parent = mod->stream->parent->self;
+    asc_mutex_unlock(&graph.mutex);
+
+    return parent;
+}
+
+/* child keeps references to packets instead of copying them */
+static inline
+bool wants_block(const module_stream_t *st)
+{
+    return (!st->filter && st->on_ts_block != NULL
+            && st->on_ts_batch == NULL);
+}
+
+/* deliver packets collected for a filtering child */
+static
+void filter_flush(module_stream_t *st, ts_block_t *block)
+{
+    const uint8_t *ts = st->run;
+    size_t count = st->run_cnt;
+
+    st->run = NULL;
+    st->run_cnt = 0;
+
+    const uint64_t start = stat_enter(st, count);
+
+    if (st->on_ts_block != NULL && block != NULL
+        && ts == block->ts[0] && count == block->count)
+    {
+        st->on_ts_block(st->self, block);
+    }
+    else if (st->on_ts_batch != NULL)
+    {
+        st->on_ts_batch(st->self, ts, count);
+    }
+    else if (st->on_ts_block != NULL)
+    {
+        while (count > 0)
+        {
+            const size_t n = (count > TS_BLOCK_PACKETS)
+                             ? TS_BLOCK_PACKETS : count;
+
+            ts_block_t *const copy = ts_block_copy(ts, n);
+            st->on_ts_block(st->self, copy);
+            ts_block_unref(copy);
+
+            ts += n * TS_PACKET_SIZE;
+            count -= n;
+        }
+    }
+    else
+    {
+        for (size_t j = 0; j < count; j++)
+            st->on_ts(st->self, &ts[j * TS_PACKET_SIZE]);
+    }
+
+    stat_leave(st, start);
+}
+
+/*
+ * Send packets to filtering children that joined their pids. Adjacent
+ * packets going to the same child are delivered as one batch.
+ */
+static
+void filter_send(module_stream_t *st, const uint8_t *ts, size_t count
+                 , ts_block_t *block)
+{
+    if (st->subs == NULL)
+        return;
+
+    for (size_t j = 0; j < count; j++)
+    {
+        const uint8_t *const pkt = &ts[j * TS_PACKET_SIZE];
+        const demux_subs_t *const subs = &st->subs[TS_GET_PID(pkt)];
+
+        /* walk backwards: child may leave this pid from its callback */
+        for (unsigned int k = subs->count; k > 0; k--)
+        {
+            module_stream_t *const i = subs->list[k - 1];
+
+            if (i->run != NULL)
+            {
+                if (&i->run[i->run_cnt * TS_PACKET_SIZE] == pkt)
+                {
+                    i->run_cnt++;
+                    continue;
+                }
+
+                filter_flush(i, NULL);
+            }
+
+            i->run = pkt;
+            i->run_cnt = 1;
+        }
+    }
+
+    asc_list_for(st->children)
+    {
+        module_stream_t *const i =
+            (module_stream_t *)asc_list_data(st->children);
+
+        if (i->run != NULL)
+            filter_flush(i, block);
+    }
+}
+
+static
+void subs_add(module_stream_t *st, uint16_t pid, module_stream_t *child)
+{
+    const module_data_t *const mod = st->self;
+
+    if (st->subs == NULL)
+        st->subs = ASC_ALLOC(TS_MAX_PIDS, demux_subs_t);
+
+    demux_subs_t *const subs = &st->subs[pid];
+    if (subs->count >= subs->size)
+    {
+        subs->size = (subs->size > 0) ? subs->size * 2 : 4;
+        subs->list = (module_stream_t **)realloc(subs->list
+                                                 , subs->size
+                                                   * sizeof(*subs->list));
+        ASC_ASSERT(subs->list != NULL, MSG("realloc() failed"));
+    }
+
+    subs->list[subs->count++] = child;
+}
+
+static
+void subs_remove(module_stream_t *st, uint16_t pid, module_stream_t *child)
+{
+    demux_subs_t *const subs = &st->subs[pid];
+
+    for (unsigned int k = 0; k < subs->count; k++)
+    {
+        if (subs->list[k] == child)
+        {
+            /* keep order for a dispatch that may be in progress */
+            memmove(&subs->list[k], &subs->list[k + 1]
+                    , (subs->count - k - 1) * sizeof(*subs->list));
+            subs->count--;
+
+            return;
+        }
+    }
+}
+
+/* copy packets into blocks once and hand them to block-only children */
+static
+void send_copy(module_data_t *mod, const uint8_t *ts, size_t count)
+{
+    while (count > 0)
+    {
+        const size_t n = (count > TS_BLOCK_PACKETS)
+                         ? TS_BLOCK_PACKETS : count;
+
+        ts_block_t *const block = ts_block_copy(ts, n);
+        asc_list_for(mod->stream->children)
+        {
+            module_stream_t *const i =
+                (module_stream_t *)asc_list_data(mod->stream->children);
+
+            if (wants_block(i))
+            {
+                const uint64_t start = stat_enter(i, n);
+                i->on_ts_block(i->self, block);
+                stat_leave(i, start);
+            }
+        }
+        ts_block_unref(block);
+
+        ts += n * TS_PACKET_SIZE;
+        count -= n;
+    }
+}
+
 void module_stream_send(void *arg, const uint8_t *ts)
 {
     module_data_t *const mod = (module_data_t *)arg;
+    bool has_block = false;
+
+    stat_add(&mod->stream->stats.packets_out, 1);
+
+    asc_list_for(mod->stream->children)
+    {
+        module_stream_t *const i =
+            (module_stream_t *)asc_list_data(mod->stream->children);
+
+        if (i->filter)
+        {
+            continue;
+        }
+        else if (wants_block(i))
+        {
+            has_block = true;
+        }
+        else
+        {
+            const uint64_t start = stat_enter(i, 1);
+            i->on_ts(i->self, ts);
+            stat_leave(i, start);
+        }
+    }
+
+    if (has_block)
+        send_copy(mod, ts, 1);
+
+    filter_send(mod->stream, ts, 1, NULL);
+}
+
+/* send contiguous block of packets; saves a call per packet per child */
+void module_stream_send_batch(void *arg, const uint8_t *ts, size_t count)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+    bool has_block = false;
+
+    stat_add(&mod->stream->stats.packets_out, count);
+
+    asc_list_for(mod->stream->children)
+    {
+        module_stream_t *const i =
+            (module_stream_t *)asc_list_data(mod->stream->children);
+
+        if (i->filter)
+            continue;
+
+        if (i->on_ts_batch == NULL && i->on_ts_block != NULL)
+        {
+            has_block = true;
+            continue;
+        }
+
+        const uint64_t start = stat_enter(i, count);
+
+        if (i->on_ts_batch != NULL)
+        {
+            i->on_ts_batch(i->self, ts, count);
+        }
+        else
+        {
+            for (size_t j = 0; j < count; j++)
+                i->on_ts(i->self, &ts[j * TS_PACKET_SIZE]);
+        }
+
+        stat_leave(i, start);
+    }
+
+    if (has_block)
+        send_copy(mod, ts, count);
+
+    filter_send(mod->stream, ts, count, NULL);
+}
+
+/* pass shared block down the tree; children see the same packets */
+void module_stream_send_block(void *arg, ts_block_t *block)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+    const uint8_t *const ts = block->ts[0];
+
+    stat_add(&mod->stream->stats.packets_out, block->count);
 
     asc_list_for(mod->stream->children)
     {
         module_stream_t *const i =
             (module_stream_t *)asc_list_data(mod->stream->children);
 
-        i->on_ts(i->self, ts);
+        if (i->filter)
+            continue;
+
+        const uint64_t start = stat_enter(i, block->count);
+
+        if (i->on_ts_block != NULL)
+        {
+            i->on_ts_block(i->self, block);
+        }
+        else if (i->on_ts_batch != NULL)
+        {
+            i->on_ts_batch(i->self, ts, block->count);
+        }
+        else
+        {
+            for (size_t j = 0; j < block->count; j++)
+                i->on_ts(i->self, &ts[j * TS_PACKET_SIZE]);
+        }
+
+        stat_leave(i, start);
     }
+
+    filter_send(mod->stream, ts, block->count, block);
+}
+
+void module_stream_set_batch(module_data_t *mod
+                             , stream_batch_callback_t on_ts_batch)
+{
+    ASC_ASSERT(mod->stream->on_ts != NULL
+               , MSG("batch callback requires per-packet callback"));
+
+    mod->stream->on_ts_batch = on_ts_batch;
+}
+
+void module_stream_set_block(module_data_t *mod
+                             , stream_block_callback_t on_ts_block)
+{
+    ASC_ASSERT(mod->stream->on_ts != NULL
+               , MSG("block callback requires per-packet callback"));
+
+    mod->stream->on_ts_block = on_ts_block;
 }
 
 /*
@@ -238,10 +714,13 @@ void module_demux_join(module_data_t *mod, uint16_t pid)
     module_stream_t *const st = mod->stream;
 
     ++st->pid_list[pid];
-    if (st->pid_list[pid] == 1 && st->parent != NULL
-        && st->parent->join_pid != NULL)
+    if (st->pid_list[pid] == 1 && st->parent != NULL)
     {
-        st->parent->join_pid(st->parent->self, pid);
+        if (st->filter)
+            subs_add(st->parent, pid, st);
+
+        if (st->parent->join_pid != NULL)
+            st->parent->join_pid(st->parent->self, pid);
     }
 }
 
@@ -253,10 +732,13 @@ void module_demux_leave(module_data_t *mod, uint16_t pid)
     if (st->pid_list[pid] > 0)
     {
         --st->pid_list[pid];
-        if (st->pid_list[pid] == 0 && st->parent != NULL
-            && st->parent->leave_pid != NULL)
+        if (st->pid_list[pid] == 0 && st->parent != NULL)
         {
-            st->parent->leave_pid(st->parent->self, pid);
+            if (st->filter)
+                subs_remove(st->parent, pid, st);
+
+            if (st->parent->leave_pid != NULL)
+                st->parent->leave_pid(st->parent->self, pid);
         }
     }
     else
@@ -265,8 +747,204 @@ void module_demux_leave(module_data_t *mod, uint16_t pid)
     }
 }
 
+void module_demux_set_filter(module_data_t *mod, bool filter)
+{
+    module_stream_t *const st = mod->stream;
+    if (st->filter == filter)
+        return;
+
+    /* update parent's dispatch table with pids joined so far */
+    if (st->parent != NULL)
+    {
+        for (unsigned int i = 0; i < TS_MAX_PIDS; i++)
+        {
+            if (st->pid_list[i] == 0)
+                continue;
+
+            if (filter)
+                subs_add(st->parent, i, st);
+            else
+                subs_remove(st->parent, i, st);
+        }
+    }
+
+    st->filter = filter;
+}
+
 bool module_demux_check(const module_data_t *mod, uint16_t pid)
 {
     ASC_ASSERT(ts_pid_valid(pid), MSG("check: pid %hu out of range"), pid);
     return (mod->stream->pid_list[pid] > 0);
 }
+
+/*
+ * graph introspection
+ */
+
+void module_stream_set_name(module_data_t *mod, const char *name)
+{
+    module_stream_t *const st = mod->stream;
+    char *const copy = (name != NULL) ? strdup(name) : NULL;
+
+    asc_mutex_lock(&graph.mutex);
+    char *const old = st->name;
+    st->name = copy;
+    asc_mutex_unlock(&graph.mutex);
+
+    free(old);
+}
+
+/* count packets discarded by the module itself, e.g. on overflow */
+void module_stream_drop(module_data_t *mod, size_t count)
+{
+    asc_atomic_fetch_add(&mod->stream->stats.drops, count);
+}
+
+/* measure time spent in TS callbacks; costs two clock reads per call */
+bool module_stream_set_timing(bool enable)
+{
+    return asc_atomic_exchange(&graph.timing, enable);
+}
+
+/* node copied out of the registry; see module_stream_graph() */
+typedef struct
+{
+    const void *self;
+    const void *parent;
+    const char *module;
+    char *name;
+    size_t id;
+    unsigned int worker;
+
+    size_t packets_in;
+    size_t packets_out;
+    size_t drops;
+    size_t time;
+} graph_node_t;
+
+static
+void graph_push_node(lua_State *L, const graph_node_t *node)
+{
+    lua_newtable(L);
+
+    lua_pushinteger(L, node->id);
+    lua_setfield(L, -2, "id");
+
+    if (node->module != NULL)
+    {
+        lua_pushstring(L, node->module);
+        lua_setfield(L, -2, "module");
+    }
+
+    if (node->name != NULL)
+    {
+        lua_pushstring(L, node->name);
+        lua_setfield(L, -2, "name");
+    }
+
+    lua_pushinteger(L, node->worker);
+    lua_setfield(L, -2, "worker");
+
+    lua_pushnumber(L, node->packets_in);
+    lua_setfield(L, -2, "packets_in");
+
+    lua_pushnumber(L, (double)node->packets_in * TS_PACKET_SIZE);
+    lua_setfield(L, -2, "bytes_in");
+
+    lua_pushnumber(L, node->packets_out);
+    lua_setfield(L, -2, "packets_out");
+
+    lua_pushnumber(L, (double)node->packets_out * TS_PACKET_SIZE);
+    lua_setfield(L, -2, "bytes_out");
+
+    lua_pushnumber(L, node->drops);
+    lua_setfield(L, -2, "drops");
+
+    lua_pushnumber(L, node->time);
+    lua_setfield(L, -2, "time");
+
+    lua_newtable(L);
+    lua_setfield(L, -2, "children");
+}
+
+/*
+ * Push a snapshot of the live module tree: a list of root nodes, each
+ * with its counters and a list of child nodes. Time is inclusive of
+ * the children running on the same thread.
+ *
+ * NOTE: Lua allocations may run finalizers which destroy modules, so
+ *       the registry is copied out before building any tables.
+ */
+void module_stream_graph(lua_State *L)
+{
+    asc_mutex_lock(&graph.mutex);
+
+    size_t count = 0;
+    for (const module_stream_t *st = graph.head; st != NULL
+         ; st = st->reg_next)
+    {
+        count++;
+    }
+
+    graph_node_t *const list = ASC_ALLOC(count + 1, graph_node_t);
+    graph_node_t *node = list;
+
+    for (const module_stream_t *st = graph.head; st != NULL
+         ; st = st->reg_next, node++)
+    {
+        const module_data_t *const mod = st->self;
+
+        node->self = st;
+        node->parent = st->parent;
+        node->module = (mod->manifest != NULL) ? mod->manifest->name : NULL;
+        node->name = (st->name != NULL) ? strdup(st->name) : NULL;
+        node->id = st->id;
+        node->worker = st->worker;
+
+        node->packets_in = asc_atomic_load_relaxed(&st->stats.packets_in);
+        node->packets_out = asc_atomic_load_relaxed(&st->stats.packets_out);
+        node->drops = asc_atomic_load_relaxed(&st->stats.drops);
+        node->time = asc_atomic_load_relaxed(&st->stats.time);
+    }
+
+    asc_mutex_unlock(&graph.mutex);
+
+    lua_newtable(L); /* result */
+    const int result = lua_gettop(L);
+
+    lua_newtable(L); /* node pointer -> table */
+    const int nodes = lua_gettop(L);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        lua_pushlightuserdata(L, (void *)list[i].self);
+        graph_push_node(L, &list[i]);
+        lua_rawset(L, nodes);
+    }
+
+    /* link children to parents, collect the roots */
+    for (size_t i = 0; i < count; i++)
+    {
+        lua_pushlightuserdata(L, (void *)list[i].self);
+        lua_rawget(L, nodes);
+
+        if (list[i].parent != NULL)
+        {
+            lua_pushlightuserdata(L, (void *)list[i].parent);
+            lua_rawget(L, nodes);
+            lua_getfield(L, -1, "children");
+            lua_pushvalue(L, -3);
+            lua_rawseti(L, -2, luaL_len(L, -2) + 1);
+            lua_pop(L, 3);
+        }
+        else
+        {
+            lua_rawseti(L, result, luaL_len(L, result) + 1);
+        }
+
+        free(list[i].name);
+    }
+
+    free(list);
+    lua_pop(L, 1); /* nodes */
+}
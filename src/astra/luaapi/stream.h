@@ -27,8 +27,12 @@
 #endif /* !_ASTRA_H_ */
 
 #include <astra/luaapi/module.h>
+#include <astra/mpegts/block.h>
 
 typedef void (*stream_callback_t)(module_data_t *, const uint8_t *);
+typedef void (*stream_batch_callback_t)(module_data_t *, const uint8_t *
+                                        , size_t);
+typedef void (*stream_block_callback_t)(module_data_t *, ts_block_t *);
 typedef void (*demux_callback_t)(module_data_t *, uint16_t);
 
 void module_stream_init(lua_State *L, module_data_t *mod
@@ -36,7 +40,26 @@ void module_stream_init(lua_State *L, module_data_t *mod
 void module_stream_destroy(module_data_t *mod);
 
 void module_stream_attach(module_data_t *mod, module_data_t *child);
+module_data_t *module_stream_parent(const module_data_t *mod) __asc_result;
+
+/* thread bridges deliver TS to their children on another loop */
+void module_stream_set_loop(module_data_t *mod, asc_main_loop_t *loop);
+asc_main_loop_t *module_stream_loop(const module_data_t *mod) __asc_result;
 void module_stream_send(void *arg, const uint8_t *ts);
+void module_stream_send_batch(void *arg, const uint8_t *ts, size_t count);
+void module_stream_set_batch(module_data_t *mod
+                             , stream_batch_callback_t on_ts_batch);
+
+/*
+ * Block callbacks receive a borrowed reference; call ts_block_ref() to
+ * keep the block past the callback. Children that set a block callback
+ * but no batch callback get raw packets from module_stream_send() and
+ * module_stream_send_batch() copied once into a block shared between
+ * all such children.
+ */
+void module_stream_send_block(void *arg, ts_block_t *block);
+void module_stream_set_block(module_data_t *mod
+                             , stream_block_callback_t on_ts_block);
 
 void module_demux_set(module_data_t *mod, demux_callback_t join_pid
                       , demux_callback_t leave_pid);
@@ -44,6 +67,26 @@ void module_demux_join(module_data_t *mod, uint16_t pid);
 void module_demux_leave(module_data_t *mod, uint16_t pid);
 bool module_demux_check(const module_data_t *mod, uint16_t pid) __asc_result;
 
+/*
+ * Filtering modules only receive packets on pids they joined, looked
+ * up in the parent's pid table instead of calling every child for every
+ * packet. Modules are unfiltered by default and get the whole stream.
+ */
+void module_demux_set_filter(module_data_t *mod, bool filter);
+
+/*
+ * Every stream node keeps packet and drop counters. module_stream_graph()
+ * pushes a snapshot of the whole module tree with these counters onto
+ * the Lua stack; see astra.graph().
+ */
+void module_stream_core_init(void);
+void module_stream_core_destroy(void);
+
+void module_stream_set_name(module_data_t *mod, const char *name);
+void module_stream_drop(module_data_t *mod, size_t count);
+bool module_stream_set_timing(bool enable);
+void module_stream_graph(lua_State *L);
+
 #define STREAM_MODULE_DATA_SIZE \
     MODULE_DATA_SIZE
 
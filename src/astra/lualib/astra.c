@@ -39,11 +39,24 @@
  *                  - restart without terminating the process
  *      astra.shutdown()
  *                  - schedule graceful shutdown
+ *      astra.gc_budget([usecs])
+ *                  - set maximum time spent in garbage collection per
+ *                    main loop iteration; return previous value
+ *      astra.gc_stats()
+ *                  - table, garbage collector pause times and heap size
+ *      astra.graph()
+ *                  - list, live stream module trees with per-node
+ *                    packet, byte and drop counters
+ *      astra.graph_timing(enable)
+ *                  - measure time spent in each node's TS callbacks;
+ *                    return previous setting
  */
 
 #include <astra/astra.h>
 #include <astra/core/mainloop.h>
 #include <astra/luaapi/module.h>
+#include <astra/luaapi/state.h>
+#include <astra/luaapi/stream.h>
 
 static int method_exit(lua_State *L)
 {
@@ -73,6 +86,73 @@ static int method_shutdown(lua_State *L)
     return 0;
 }
 
+static int method_gc_budget(lua_State *L)
+{
+    lua_api_gc_stats_t stats;
+    lua_api_gc_stats(&stats);
+
+    if (!lua_isnoneornil(L, 1))
+    {
+        const lua_Integer budget = luaL_checkinteger(L, 1);
+        if (budget <= 0)
+            luaL_error(L, "[astra] GC budget must be a positive number");
+
+        lua_api_gc_set_budget(budget);
+    }
+
+    lua_pushinteger(L, stats.budget);
+    return 1;
+}
+
+static int method_gc_stats(lua_State *L)
+{
+    lua_api_gc_stats_t stats;
+    lua_api_gc_stats(&stats);
+
+    lua_newtable(L);
+
+    lua_pushinteger(L, stats.budget);
+    lua_setfield(L, -2, "budget");
+
+    lua_pushnumber(L, stats.heap);
+    lua_setfield(L, -2, "heap");
+
+    lua_pushnumber(L, stats.steps);
+    lua_setfield(L, -2, "steps");
+
+    lua_pushnumber(L, stats.cycles);
+    lua_setfield(L, -2, "cycles");
+
+    lua_pushnumber(L, stats.pause_last);
+    lua_setfield(L, -2, "pause_last");
+
+    lua_pushnumber(L, stats.pause_max);
+    lua_setfield(L, -2, "pause_max");
+
+    const double pause_avg = (stats.steps > 0)
+        ? (double)stats.pause_total / stats.steps : 0.0;
+    lua_pushnumber(L, pause_avg);
+    lua_setfield(L, -2, "pause_avg");
+
+    return 1;
+}
+
+static int method_graph(lua_State *L)
+{
+    module_stream_graph(L);
+    return 1;
+}
+
+static int method_graph_timing(lua_State *L)
+{
+    luaL_checktype(L, 1, LUA_TBOOLEAN);
+
+    const bool prev = module_stream_set_timing(lua_toboolean(L, 1));
+    lua_pushboolean(L, prev);
+
+    return 1;
+}
+
 static void module_load(lua_State *L)
 {
     static const luaL_Reg api[] =
@@ -81,6 +161,10 @@ static void module_load(lua_State *L)
         { "abort", method_abort },
         { "reload", method_reload },
         { "shutdown", method_shutdown },
+        { "gc_budget", method_gc_budget },
+        { "gc_stats", method_gc_stats },
+        { "graph", method_graph },
+        { "graph_timing", method_graph_timing },
         { NULL, NULL },
     };
 
@@ -40,6 +40,7 @@ MODULE_MANIFEST_DECL(sha1);
 MODULE_MANIFEST_DECL(strhex);
 MODULE_MANIFEST_DECL(timer);
 MODULE_MANIFEST_DECL(utils);
+MODULE_MANIFEST_DECL(worker);
 #ifdef _WIN32
 MODULE_MANIFEST_DECL(winsvc);
 #endif
@@ -60,6 +61,7 @@ const module_manifest_t *const lua_lib_list[] =
     &MODULE_MANIFEST_SYMBOL(strhex),
     &MODULE_MANIFEST_SYMBOL(timer),
     &MODULE_MANIFEST_SYMBOL(utils),
+    &MODULE_MANIFEST_SYMBOL(worker),
 #ifdef _WIN32
     &MODULE_MANIFEST_SYMBOL(winsvc),
 #endif
@@ -32,6 +32,16 @@
  *                                  true by default
  *                    syslog    - string, send log to syslog;
  *                                  ignored on Windows
+ *                    async     - boolean, write log from a background
+ *                                  thread
+ *                    rate_limit
+ *                              - number, max. lines per second from
+ *                                  a single call site, 0 to disable
+ *                    dedup     - boolean, collapse consecutive identical
+ *                                  lines into a repeat count
+ *      log.stats()
+ *                  - table, counters of queued, dropped, rate limited
+ *                    and duplicate lines
  *      log.error(message)
  *                  - error message
  *      log.warning(message)
@@ -81,6 +91,24 @@ int method_set(lua_State *L)
             luaL_checktype(L, -1, LUA_TBOOLEAN);
             asc_log_set_color(lua_toboolean(L, -1));
         }
+        else if (!strcmp(key, "async"))
+        {
+            luaL_checktype(L, -1, LUA_TBOOLEAN);
+            asc_log_set_async(lua_toboolean(L, -1));
+        }
+        else if (!strcmp(key, "rate_limit"))
+        {
+            const lua_Integer val = luaL_checkinteger(L, -1);
+            if (val < 0)
+                luaL_error(L, "[log] rate_limit can't be negative");
+
+            asc_log_set_rate_limit(val);
+        }
+        else if (!strcmp(key, "dedup"))
+        {
+            luaL_checktype(L, -1, LUA_TBOOLEAN);
+            asc_log_set_dedup(lua_toboolean(L, -1));
+        }
         else
         {
             luaL_error(L, "[log] unknown option: %s", key);
@@ -118,6 +146,29 @@ int method_debug(lua_State *L)
     return 0;
 }
 
+static
+int method_stats(lua_State *L)
+{
+    asc_log_stats_t stats;
+    asc_log_stats(&stats);
+
+    lua_newtable(L);
+
+    lua_pushnumber(L, stats.queued);
+    lua_setfield(L, -2, "queued");
+
+    lua_pushnumber(L, stats.dropped);
+    lua_setfield(L, -2, "dropped");
+
+    lua_pushnumber(L, stats.suppressed);
+    lua_setfield(L, -2, "suppressed");
+
+    lua_pushnumber(L, stats.repeated);
+    lua_setfield(L, -2, "repeated");
+
+    return 1;
+}
+
 static
 void module_load(lua_State *L)
 {
@@ -128,6 +179,7 @@ void module_load(lua_State *L)
         { "warning", method_warning },
         { "info", method_info },
         { "debug", method_debug },
+        { "stats", method_stats },
         { NULL, NULL },
     };
 
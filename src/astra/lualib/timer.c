@@ -30,6 +30,7 @@
 #include <astra/astra.h>
 #include <astra/core/timer.h>
 #include <astra/luaapi/module.h>
+#include <astra/luaapi/state.h>
 
 #define MSG(_msg) "[timer] " _msg
 
@@ -49,10 +50,12 @@ void timer_callback(void *arg)
     module_data_t *const mod = (module_data_t *)arg;
     lua_State *const L = module_lua(mod);
 
+    lua_api_lock();
     lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_callback);
     lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_self);
     if (lua_tr_call(L, 1, 0) != 0)
         lua_err_log(L);
+    lua_api_unlock();
 }
 
 static
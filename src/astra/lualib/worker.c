@@ -0,0 +1,162 @@
+/*
+ * Astra Lua Library (Worker loops)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Set of Lua methods for running module trees on worker threads
+ *
+ * Methods:
+ *      worker.start(count)
+ *                  - start worker loops; repeated calls with the
+ *                    same count are ignored
+ *      worker.count()
+ *                  - number, how many workers are running
+ *      worker.id()
+ *                  - number, calling thread's worker ID (0 for main)
+ *      worker.run(id, func, ...)
+ *                  - call func(...) on a worker thread and return its
+ *                    results; module instances created by func are
+ *                    serviced by that worker
+ *      worker.stats([id])
+ *                  - table, job queue counters of a worker
+ *                    (main loop if id is 0 or omitted)
+ *
+ * Lua code runs on one thread at a time. Modules that don't invoke Lua
+ * callbacks while streaming (UDP, channel, file) scale across workers.
+ */
+
+#include <astra/astra.h>
+#include <astra/core/worker.h>
+#include <astra/luaapi/module.h>
+#include <astra/luaapi/state.h>
+
+#define MSG(_msg) "[worker] " _msg
+
+static
+int method_start(lua_State *L)
+{
+    const int count = luaL_checkinteger(L, 1);
+    if (count <= 0 || count > ASC_WORKER_MAX)
+    {
+        luaL_error(L, MSG("worker count must be between 1 and %d")
+                   , ASC_WORKER_MAX);
+    }
+
+    /* config is evaluated again on reload */
+    if ((unsigned int)count == asc_worker_count())
+        return 0;
+
+    lua_api_lock_enable();
+    if (!asc_worker_start(count))
+        luaL_error(L, MSG("couldn't start worker loops"));
+
+    return 0;
+}
+
+static
+int method_count(lua_State *L)
+{
+    lua_pushinteger(L, asc_worker_count());
+    return 1;
+}
+
+static
+int method_id(lua_State *L)
+{
+    lua_pushinteger(L, asc_worker_id());
+    return 1;
+}
+
+static
+int method_run(lua_State *L)
+{
+    const lua_Integer id = luaL_checkinteger(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    lua_remove(L, 1);
+
+    const int nargs = lua_gettop(L) - 1;
+    if (id == asc_worker_id())
+    {
+        /* already there */
+        lua_call(L, nargs, LUA_MULTRET);
+        return lua_gettop(L);
+    }
+
+    asc_main_loop_t *const loop = asc_worker_loop(id);
+    if (loop == NULL)
+        luaL_error(L, MSG("no worker with ID %d"), (int)id);
+
+    return lua_remote_call(L, loop, nargs);
+}
+
+static
+int method_stats(lua_State *L)
+{
+    const lua_Integer id = luaL_optinteger(L, 1, 0);
+
+    asc_main_loop_t *const loop = (id == 0)
+                                  ? asc_main_loop_primary()
+                                  : asc_worker_loop(id);
+    if (loop == NULL)
+        luaL_error(L, MSG("no worker with ID %d"), (int)id);
+
+    asc_job_stats_t stats;
+    asc_job_stats(loop, &stats);
+
+    lua_newtable(L);
+
+    lua_pushinteger(L, stats.depth);
+    lua_setfield(L, -2, "depth");
+
+    lua_pushinteger(L, stats.depth_max);
+    lua_setfield(L, -2, "depth_max");
+
+    lua_pushnumber(L, stats.total);
+    lua_setfield(L, -2, "total");
+
+    lua_pushnumber(L, stats.latency_avg);
+    lua_setfield(L, -2, "latency_avg");
+
+    lua_pushnumber(L, stats.latency_max);
+    lua_setfield(L, -2, "latency_max");
+
+    return 1;
+}
+
+static
+void module_load(lua_State *L)
+{
+    static const luaL_Reg api[] =
+    {
+        { "start", method_start },
+        { "count", method_count },
+        { "id", method_id },
+        { "run", method_run },
+        { "stats", method_stats },
+        { NULL, NULL },
+    };
+
+    luaL_newlib(L, api);
+    lua_setglobal(L, "worker");
+}
+
+BINDING_REGISTER(worker)
+{
+    .load = module_load,
+};
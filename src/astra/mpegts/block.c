@@ -0,0 +1,124 @@
+/*
+ * Astra TS Library (Shared packet blocks)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <astra/astra.h>
+#include <astra/core/atomic.h>
+#include <astra/mpegts/block.h>
+
+#define MSG(_msg) "[block] " _msg
+
+/*
+ * Freed blocks go to a per-thread list, so allocation doesn't need
+ * any locking. Without thread-local storage blocks aren't cached.
+ */
+#ifdef HAVE_THREAD_LOCAL
+static __asc_thread ts_block_t *cache_head = NULL;
+static __asc_thread unsigned int cache_size = 0;
+#endif
+
+ts_block_t *ts_block_alloc(void)
+{
+    ts_block_t *block = NULL;
+
+#ifdef HAVE_THREAD_LOCAL
+    if (cache_head != NULL)
+    {
+        block = cache_head;
+        cache_head = block->next;
+        cache_size--;
+    }
+#endif
+
+    if (block == NULL)
+        block = ASC_ALLOC(1, ts_block_t);
+
+    block->refcnt = 1;
+    block->count = 0;
+    block->next = NULL;
+
+    return block;
+}
+
+ts_block_t *ts_block_copy(const uint8_t *ts, size_t count)
+{
+    ASC_ASSERT(count <= TS_BLOCK_PACKETS
+               , MSG("%zu packets won't fit in a block"), count);
+
+    ts_block_t *const block = ts_block_alloc();
+    memcpy(block->ts, ts, count * TS_PACKET_SIZE);
+    block->count = count;
+
+    return block;
+}
+
+ts_block_t *ts_block_ref(ts_block_t *block)
+{
+    asc_atomic_fetch_add(&block->refcnt, 1);
+    return block;
+}
+
+void ts_block_unref(ts_block_t *block)
+{
+    const unsigned int refcnt = asc_atomic_fetch_sub(&block->refcnt, 1);
+    ASC_ASSERT(refcnt > 0, MSG("unref on a free block"));
+
+    if (refcnt > 1)
+        return;
+
+#ifdef HAVE_THREAD_LOCAL
+    if (cache_size < TS_BLOCK_CACHE)
+    {
+        block->next = cache_head;
+        cache_head = block;
+        cache_size++;
+
+        return;
+    }
+#endif
+
+    free(block);
+}
+
+/* copy on write: return block that's safe to modify */
+ts_block_t *ts_block_writable(ts_block_t *block)
+{
+    if (asc_atomic_load(&block->refcnt) == 1)
+        return block;
+
+    ts_block_t *const copy = ts_block_copy(block->ts[0], block->count);
+    ts_block_unref(block);
+
+    return copy;
+}
+
+/* free calling thread's cached blocks; call before thread exit */
+void ts_block_cache_flush(void)
+{
+#ifdef HAVE_THREAD_LOCAL
+    while (cache_head != NULL)
+    {
+        ts_block_t *const next = cache_head->next;
+        free(cache_head);
+        cache_head = next;
+    }
+
+    cache_size = 0;
+#endif
+}
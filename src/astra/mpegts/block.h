@@ -0,0 +1,67 @@
+/*
+ * Astra TS Library (Shared packet blocks)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TS_BLOCK_
+#define _TS_BLOCK_ 1
+
+#ifndef _ASTRA_H_
+#   error "Please include <astra/astra.h> first"
+#endif /* !_ASTRA_H_ */
+
+/*
+ * Reference counted block of TS packets. Blocks are passed down the
+ * module tree so that sinks can queue packets without copying them.
+ * A block is read-only once it has more than one reference; use
+ * ts_block_writable() before modifying packet contents.
+ */
+
+/* one UDP datagram worth of packets */
+#define TS_BLOCK_PACKETS 7
+
+/* free blocks kept by each thread for reuse */
+#define TS_BLOCK_CACHE 256
+
+typedef struct ts_block_t ts_block_t;
+
+struct ts_block_t
+{
+    unsigned int refcnt;
+    unsigned int count;
+    ts_block_t *next;
+
+    ts_packet_t ts[TS_BLOCK_PACKETS];
+};
+
+ts_block_t *ts_block_alloc(void) __asc_result;
+ts_block_t *ts_block_copy(const uint8_t *ts, size_t count) __asc_result;
+ts_block_t *ts_block_ref(ts_block_t *block);
+void ts_block_unref(ts_block_t *block);
+ts_block_t *ts_block_writable(ts_block_t *block) __asc_result;
+
+void ts_block_cache_flush(void);
+
+/* block size in bytes */
+static inline
+size_t ts_block_size(const ts_block_t *block)
+{
+    return block->count * TS_PACKET_SIZE;
+}
+
+#endif /* _TS_BLOCK_ */
@@ -19,6 +19,10 @@
  */
 
 #include <astra/astra.h>
+#include <astra/core/atomic.h>
+#include <astra/core/mainloop.h>
+#include <astra/core/mutex.h>
+#include <astra/core/thread.h>
 #include <astra/mpegts/sync.h>
 #include <astra/mpegts/pcr.h>
 
@@ -52,6 +56,22 @@
 /* marker for unknown PCR PID */
 #define PCR_PID_NONE ((unsigned int)-1)
 
+/* adaptive thresholds: measurement window and block count limits */
+#define ADAPT_WINDOW (10 * 1000 * 1000) /* 10s */
+#define ADAPT_MIN_BLOCKS 4
+#define ADAPT_MAX_BLOCKS 100
+
+/* steady windows before shrinking; aims for at most one underrun a minute */
+#define ADAPT_QUIET 6
+
+/* blocks between thresholds cover this much of measured jitter, percent */
+#define ADAPT_HEADROOM 150
+
+/* pacing thread: SCHED_FIFO priority, shortest and longest sleep */
+#define PACE_PRIORITY 10
+#define PACE_MIN_SLEEP 50 /* 50us */
+#define PACE_MAX_SLEEP (1 * 1000) /* 1ms */
+
 enum sync_reset
 {
     SYNC_RESET_ALL = 0,
@@ -79,6 +99,7 @@ struct ts_sync_t
 
     uint64_t last_run;
     uint64_t last_error;
+    uint64_t last_push;
     unsigned int pcr_pid;
     unsigned int num_blocks;
 
@@ -88,14 +109,70 @@ struct ts_sync_t
     double quantum;
     double pending;
 
+    /* launch time mode */
+    double lead; /* PCR ticks */
+    uint64_t due;
+
     void *arg;
     sync_callback_t on_ready;
     ts_callback_t on_ts;
     uint64_t last_compact;
 
     bool buffered;
+
+    /* input jitter and underrun history */
+    struct
+    {
+        bool on;
+
+        /* PCR arrival time vs. stream time */
+        uint64_t pcr;
+        uint64_t anchor;
+        double stream; /* usecs since anchor */
+        double block; /* average PCR interval, usecs */
+        int64_t transit_min;
+        int64_t transit_max;
+        unsigned int jitter; /* previous window */
+
+        uint64_t window;
+        unsigned int window_underruns;
+        unsigned int quiet;
+        bool refill; /* hold output until the raised level is reached */
+
+        unsigned int underruns;
+        unsigned int grown;
+        unsigned int shrunk;
+    } adapt;
+
+    /* send time error, written with the buffer locked */
+    uint64_t late_hist[SYNC_HIST_BUCKETS];
+    unsigned int late_max;
+
+    /* pacing thread */
+    struct
+    {
+        asc_thread_t *thr;
+        asc_mutex_t lock;
+        bool running;
+        int cpu;
+    } pace;
 };
 
+/* buffer is shared with the pacing thread only while it runs */
+static inline
+void sync_lock(const ts_sync_t *sx)
+{
+    if (sx->pace.thr != NULL)
+        asc_mutex_lock((asc_mutex_t *)&sx->pace.lock);
+}
+
+static inline
+void sync_unlock(const ts_sync_t *sx)
+{
+    if (sx->pace.thr != NULL)
+        asc_mutex_unlock((asc_mutex_t *)&sx->pace.lock);
+}
+
 /*
  * worker functions
  */
@@ -324,6 +401,16 @@ void buffer_reset(ts_sync_t *sx, enum sync_reset type)
             sx->pos.rcv = sx->pos.pcr = sx->pos.send = 0;
             sx->last_run = 0;
 
+            memset(sx->late_hist, 0, sizeof(sx->late_hist));
+            sx->late_max = 0;
+
+            /* input restarts; keep thresholds and underrun history */
+            sx->adapt.pcr = TS_TIME_NONE;
+            sx->adapt.transit_min = INT64_MAX;
+            sx->adapt.transit_max = INT64_MIN;
+            sx->adapt.block = 0.0;
+            sx->adapt.jitter = 0;
+
             buffer_resize(sx, MIN_BUFFER_SIZE);
 
             /* fallthrough */
@@ -331,6 +418,7 @@ void buffer_reset(ts_sync_t *sx, enum sync_reset type)
         case SYNC_RESET_BLOCKS:
             /* restart initial buffering */
             sx->last_error = sx->num_blocks = sx->buffered = 0;
+            sx->adapt.refill = false;
 
             /* fallthrough */
 
@@ -338,14 +426,190 @@ void buffer_reset(ts_sync_t *sx, enum sync_reset type)
             /* reset PCR lookahead routine */
             sx->pcr_last = sx->pcr_cur = TS_TIME_NONE;
             sx->pcr_pid = PCR_PID_NONE;
-            sx->quantum = sx->pending = 0.0;
+            sx->quantum = 0.0;
+            sx->pending = sx->lead;
 
             /* start searching from first packet in queue */
             sx->pos.pcr = sx->pos.send;
     }
 }
 
-/* return number of milliseconds elapsed since this function's last call */
+/* account send time error of one packet */
+static inline
+void late_record(ts_sync_t *sx, unsigned int usecs)
+{
+    static const unsigned int bounds[SYNC_HIST_BUCKETS - 1] =
+    {
+        50, 100, 250, 500, 1000, 2000, 5000,
+    };
+
+    unsigned int i = 0;
+    while (i < ASC_ARRAY_SIZE(bounds) && usecs >= bounds[i])
+        i++;
+
+    sx->late_hist[i]++;
+
+    if (usecs > sx->late_max)
+        sx->late_max = usecs;
+}
+
+/*
+ * adaptive thresholds
+ */
+
+/* arrival jitter over the current and previous window, usecs */
+static inline
+unsigned int adapt_jitter(const ts_sync_t *sx)
+{
+    unsigned int jitter = 0;
+
+    if (sx->adapt.transit_max >= sx->adapt.transit_min)
+        jitter = sx->adapt.transit_max - sx->adapt.transit_min;
+
+    return (jitter > sx->adapt.jitter) ? jitter : sx->adapt.jitter;
+}
+
+/* set fill thresholds, keeping the default 2:1 ratio */
+static
+void adapt_set(ts_sync_t *sx, unsigned int enough)
+{
+    if (enough > ADAPT_MAX_BLOCKS)
+        enough = ADAPT_MAX_BLOCKS;
+
+    if (sx->quantum > 0.0 && sx->adapt.block > 0.0)
+    {
+        /* normal level shouldn't take more than half the buffer */
+        const double packets = (sx->adapt.block * (TS_PCR_FREQ / 1000000))
+                               / sx->quantum;
+        const unsigned int fit = (sx->max_size / 2) / packets;
+
+        if (enough > fit)
+            enough = fit;
+    }
+
+    if (enough < ADAPT_MIN_BLOCKS)
+        enough = ADAPT_MIN_BLOCKS;
+
+    sx->enough_blocks = enough;
+    sx->low_blocks = enough / 2;
+
+    if (sx->low_blocks < MIN_BUFFER_BLOCKS)
+        sx->low_blocks = MIN_BUFFER_BLOCKS;
+}
+
+/* compare arrival time of an input PCR packet to its stream time */
+static
+void adapt_pcr(ts_sync_t *sx, const uint8_t *ts, uint64_t time_now)
+{
+    const uint64_t pcr = TS_GET_PCR(ts);
+    const uint64_t last = sx->adapt.pcr;
+    sx->adapt.pcr = pcr;
+
+    const uint64_t delta = TS_PCR_DELTA(last, pcr);
+    if (last == TS_TIME_NONE || !(delta > 0 && delta < MAX_PCR_DELTA))
+    {
+        /* start over on discontinuity */
+        sx->adapt.anchor = time_now;
+        sx->adapt.stream = 0.0;
+        sx->adapt.transit_min = INT64_MAX;
+        sx->adapt.transit_max = INT64_MIN;
+
+        return;
+    }
+
+    const double usecs = (double)delta / (TS_PCR_FREQ / 1000000);
+    sx->adapt.stream += usecs;
+
+    if (sx->adapt.block > 0.0)
+        sx->adapt.block += (usecs - sx->adapt.block) / 8;
+    else
+        sx->adapt.block = usecs;
+
+    const int64_t transit = (int64_t)(time_now - sx->adapt.anchor)
+                            - (int64_t)sx->adapt.stream;
+
+    if (transit < sx->adapt.transit_min)
+        sx->adapt.transit_min = transit;
+
+    if (transit > sx->adapt.transit_max)
+        sx->adapt.transit_max = transit;
+}
+
+/* end of measurement window: fit thresholds to observed jitter */
+static
+void adapt_window(ts_sync_t *sx, uint64_t time_now)
+{
+    if (time_now - sx->adapt.window < ADAPT_WINDOW)
+        return;
+
+    sx->adapt.window = time_now;
+
+    const unsigned int jitter = adapt_jitter(sx);
+    sx->adapt.jitter = (sx->adapt.transit_max >= sx->adapt.transit_min)
+                       ? (sx->adapt.transit_max - sx->adapt.transit_min) : 0;
+    sx->adapt.transit_min = INT64_MAX;
+    sx->adapt.transit_max = INT64_MIN;
+
+    if (sx->adapt.window_underruns == 0)
+        sx->adapt.quiet++;
+    else
+        sx->adapt.quiet = 0;
+
+    sx->adapt.window_underruns = 0;
+
+    if (!sx->adapt.on || sx->adapt.block <= 0.0)
+        return;
+
+    /* blocks between low and normal level must cover the jitter */
+    const double margin = (jitter * ADAPT_HEADROOM) / 100.0;
+    const unsigned int need = (margin / sx->adapt.block) + 1;
+    const unsigned int enough = need * 2;
+
+    if (enough > sx->enough_blocks)
+    {
+        adapt_set(sx, enough);
+        sx->adapt.grown++;
+    }
+    else if (enough < sx->enough_blocks && sx->adapt.quiet >= ADAPT_QUIET)
+    {
+        adapt_set(sx, sx->enough_blocks - 1);
+        sx->adapt.shrunk++;
+    }
+    else
+    {
+        return;
+    }
+
+    asc_log_debug(MSG("jitter %.2fms, fill thresholds: normal = %u, low = %u")
+                  , jitter / 1000.0, sx->enough_blocks, sx->low_blocks);
+}
+
+/* output stalled: count it and, if adaptive, buffer more next time */
+static
+void adapt_underrun(ts_sync_t *sx)
+{
+    sx->adapt.underruns++;
+    sx->adapt.window_underruns++;
+
+    if (!sx->adapt.on)
+        return;
+
+    unsigned int step = sx->enough_blocks / 4;
+    if (step == 0)
+        step = 1;
+
+    adapt_set(sx, sx->enough_blocks + step);
+    sx->adapt.grown++;
+    sx->adapt.quiet = 0;
+
+    /* refill up to the new level before resuming */
+    sx->adapt.refill = true;
+
+    asc_log_debug(MSG("underrun, fill thresholds: normal = %u, low = %u")
+                  , sx->enough_blocks, sx->low_blocks);
+}
+
+/* return number of microseconds elapsed since this function's last call */
 static
 unsigned int update_last_run(ts_sync_t *sx, uint64_t time_now)
 {
@@ -369,17 +633,19 @@ unsigned int update_last_run(ts_sync_t *sx, uint64_t time_now)
     return elapsed;
 }
 
-void ts_sync_loop(void *arg)
+/* release packets that are due by `time_now' */
+static
+void sync_step(ts_sync_t *sx, uint64_t time_now)
 {
-    ts_sync_t *const sx = (ts_sync_t *)arg;
-
     /* timekeeping */
-    const uint64_t time_now = asc_utime();
     const unsigned int elapsed = update_last_run(sx, time_now);
 
     /* request more packets if needed (pull mode) */
-    if (sx->on_ready != NULL && sx->num_blocks < sx->enough_blocks)
+    if (sx->on_ready != NULL && sx->num_blocks < sx->enough_blocks
+        && sx->pace.thr == NULL)
+    {
         sx->on_ready(sx->arg);
+    }
 
     if (elapsed == 0 || !sx->buffered)
         return; /* let's not divide by zero */
@@ -393,17 +659,27 @@ void ts_sync_loop(void *arg)
         downtime = time_now - sx->last_error;
     }
 
-    if (sx->num_blocks < sx->low_blocks)
+    /* after an adaptive underrun, resume at the raised level */
+    const unsigned int resume = sx->adapt.refill
+                                ? sx->enough_blocks : sx->low_blocks;
+
+    if (sx->num_blocks < sx->low_blocks
+        || (sx->last_error > 0 && sx->num_blocks < resume))
     {
+        /* refilling takes a while; only give up if input stops */
+        const uint64_t idle = sx->adapt.refill
+                              ? time_now - sx->last_push : downtime;
+
         if (sx->last_error == 0)
         {
             /* set error state */
             sx->last_error = time_now;
+            adapt_underrun(sx);
         }
-        else if (downtime >= MAX_IDLE_TIME)
+        else if (idle >= MAX_IDLE_TIME)
         {
             asc_log_debug(MSG("no input in %.2fms, resetting buffer")
-                          , downtime / 1000.0);
+                          , idle / 1000.0);
 
             buffer_reset(sx, SYNC_RESET_ALL);
         }
@@ -419,6 +695,7 @@ void ts_sync_loop(void *arg)
         }
 
         sx->last_error = 0;
+        sx->adapt.refill = false;
     }
 
     /* dequeue packets */
@@ -426,8 +703,13 @@ void ts_sync_loop(void *arg)
 
     while (sx->pending >= sx->quantum)
     {
+        /* what's left over is how long ago this packet was due */
         sx->pending -= sx->quantum;
 
+        const double ago = (sx->pending - sx->lead) / (TS_PCR_FREQ / 1000000);
+        late_record(sx, (ago > 0.0) ? ago : 0);
+        sx->due = time_now - (int64_t)ago;
+
         if (sx->pos.send == sx->pos.pcr)
         {
             /* look up next PCR value */
@@ -474,9 +756,99 @@ void ts_sync_loop(void *arg)
     }
 }
 
+void ts_sync_loop(void *arg)
+{
+    ts_sync_t *const sx = (ts_sync_t *)arg;
+
+    sync_step(sx, asc_utime());
+}
+
+/*
+ * pacing thread
+ */
+
+/* when the next packet is due, give or take sleep limits */
+static
+uint64_t pace_deadline(const ts_sync_t *sx, uint64_t time_now)
+{
+    uint64_t wait = PACE_MAX_SLEEP;
+
+    if (sx->buffered && sx->last_error == 0 && sx->quantum > 0.0)
+    {
+        const double ticks = sx->quantum - sx->pending;
+        wait = (ticks > 0.0) ? ticks / (TS_PCR_FREQ / 1000000) : 0;
+
+        if (wait < PACE_MIN_SLEEP)
+            wait = PACE_MIN_SLEEP;
+        else if (wait > PACE_MAX_SLEEP)
+            wait = PACE_MAX_SLEEP;
+    }
+
+    return time_now + wait;
+}
+
+static
+void pace_proc(void *arg)
+{
+    ts_sync_t *const sx = (ts_sync_t *)arg;
+
+    if (sx->pace.cpu >= 0 && !asc_thread_set_affinity(sx->pace.cpu))
+    {
+        asc_log_warning(MSG("couldn't pin pacing thread to cpu %d")
+                        , sx->pace.cpu);
+    }
+
+    if (!asc_thread_set_realtime(PACE_PRIORITY))
+    {
+        asc_log_warning(MSG("couldn't set real-time priority "
+                            "for pacing thread"));
+    }
+
+    uint64_t deadline = asc_utime();
+
+    while (asc_atomic_load(&sx->pace.running))
+    {
+        asc_usleep_until(deadline);
+        const uint64_t time_now = asc_utime();
+
+        asc_mutex_lock(&sx->pace.lock);
+        sync_step(sx, time_now);
+        deadline = pace_deadline(sx, time_now);
+        asc_mutex_unlock(&sx->pace.lock);
+    }
+}
+
+bool ts_sync_start(ts_sync_t *sx, int cpu)
+{
+    if (sx->pace.thr != NULL)
+        return true;
+
+    sx->pace.cpu = cpu;
+    sx->pace.running = true;
+
+    asc_wake_open();
+    sx->pace.thr = asc_thread_init(sx, pace_proc, NULL);
+
+    return (sx->pace.thr != NULL);
+}
+
+void ts_sync_stop(ts_sync_t *sx)
+{
+    if (sx->pace.thr == NULL)
+        return;
+
+    asc_atomic_store(&sx->pace.running, false);
+    ASC_FREE(sx->pace.thr, asc_thread_join);
+    asc_wake_close();
+}
+
 bool ts_sync_push(ts_sync_t *sx, const void *buf, size_t count)
 {
     const ts_packet_t *const ts = (const ts_packet_t *)buf;
+    const uint64_t time_now = asc_utime();
+
+    sync_lock(sx);
+    sx->last_push = time_now;
 
     while (buffer_space(sx) < count)
     {
@@ -491,6 +863,7 @@ bool ts_sync_push(ts_sync_t *sx, const void *buf, size_t count)
                                   "dropping %zu packets"), count);
             }
 
+            sync_unlock(sx);
             return false;
         }
     }
@@ -509,7 +882,10 @@ bool ts_sync_push(ts_sync_t *sx, const void *buf, size_t count)
             }
 
             if (pid == sx->pcr_pid)
+            {
                 sx->num_blocks++;
+                adapt_pcr(sx, ts[i], time_now);
+            }
         }
 
         memcpy(sx->buf[sx->pos.rcv], ts[i], TS_PACKET_SIZE);
@@ -523,6 +899,9 @@ bool ts_sync_push(ts_sync_t *sx, const void *buf, size_t count)
         sx->buffered = true;
     }
 
+    adapt_window(sx, time_now);
+
+    sync_unlock(sx);
     return true;
 }
 
@@ -546,16 +925,24 @@ ts_sync_t *ts_sync_init(ts_callback_t on_ts, void *arg)
     sx->pcr_cur = TS_TIME_NONE;
     sx->pcr_pid = PCR_PID_NONE;
 
+    sx->adapt.pcr = TS_TIME_NONE;
+    sx->adapt.transit_min = INT64_MAX;
+    sx->adapt.transit_max = INT64_MIN;
+
     sx->on_ts = on_ts;
     sx->arg = arg;
 
     sx->buf = ASC_ALLOC(sx->size, ts_packet_t);
+    asc_mutex_init(&sx->pace.lock);
 
     return sx;
 }
 
 void ts_sync_destroy(ts_sync_t *sx)
 {
+    ts_sync_stop(sx);
+    asc_mutex_destroy(&sx->pace.lock);
+
     free(sx->buf);
     free(sx);
 }
@@ -577,6 +964,23 @@ bool ts_sync_set_opts(ts_sync_t *sx, const char *opts)
 {
     unsigned int numopts[3] = { 0, 0, 0 };
 
+    /* empty string leaves everything as is, adaptive mode included */
+    const bool is_empty = (*opts == '\0');
+
+    /* adaptive mode prefix */
+    static const char prefix[] = "auto";
+    const bool adaptive = !strncmp(opts, prefix, sizeof(prefix) - 1);
+
+    if (adaptive)
+    {
+        opts += sizeof(prefix) - 1;
+
+        if (*opts == ',')
+            opts++;
+        else if (*opts != '\0')
+            return false;
+    }
+
     /* break up option string */
     const char *ch, *str;
     unsigned int idx = 0;
@@ -620,6 +1024,9 @@ bool ts_sync_set_opts(ts_sync_t *sx, const char *opts)
         return false;
     }
 
+    if (!is_empty)
+        ts_sync_set_adaptive(sx, adaptive);
+
     return true;
 }
 
@@ -634,7 +1041,10 @@ bool ts_sync_set_max_size(ts_sync_t *sx, unsigned int mbytes)
     }
 
     asc_log_debug(MSG("setting buffer size limit to %u MiB"), mbytes);
+
+    sync_lock(sx);
     sx->max_size = max_size;
+    sync_unlock(sx);
 
     return true;
 }
@@ -660,16 +1070,50 @@ bool ts_sync_set_blocks(ts_sync_t *sx, unsigned int enough, unsigned int low)
     asc_log_debug(MSG("setting buffer fill thresholds: normal = %u, low = %u")
                   , enough, low);
 
+    sync_lock(sx);
     sx->enough_blocks = enough;
     sx->low_blocks = low;
+    sync_unlock(sx);
 
     return true;
 }
 
+void ts_sync_set_lead(ts_sync_t *sx, unsigned int usecs)
+{
+    sync_lock(sx);
+    sx->lead = (double)usecs * (TS_PCR_FREQ / 1000000);
+    buffer_reset(sx, SYNC_RESET_PCR);
+    sync_unlock(sx);
+}
+
+uint64_t ts_sync_due(const ts_sync_t *sx)
+{
+    return sx->due;
+}
+
+void ts_sync_set_adaptive(ts_sync_t *sx, bool on)
+{
+    sync_lock(sx);
+    sx->adapt.on = on;
+    sync_unlock(sx);
+}
+
 void ts_sync_query(const ts_sync_t *sx, ts_sync_stat_t *out)
 {
     memset(out, 0, sizeof(*out));
 
+    sync_lock(sx);
+
+    out->adaptive = sx->adapt.on;
+    out->jitter = adapt_jitter(sx);
+    out->underruns = sx->adapt.underruns;
+    out->grown = sx->adapt.grown;
+    out->shrunk = sx->adapt.shrunk;
+
+    out->paced = (sx->pace.thr != NULL);
+    out->late_max = sx->late_max;
+    memcpy(out->late_hist, sx->late_hist, sizeof(out->late_hist));
+
     out->size = sx->size;
     out->filled = buffer_filled(sx);
     out->num_blocks = sx->num_blocks;
@@ -693,9 +1137,13 @@ void ts_sync_query(const ts_sync_t *sx, ts_sync_stat_t *out)
     {
         out->want = 0;
     }
+
+    sync_unlock(sx);
 }
 
 void ts_sync_reset(ts_sync_t *sx)
 {
+    sync_lock(sx);
     buffer_reset(sx, SYNC_RESET_ALL);
+    sync_unlock(sx);
 }
@@ -28,6 +28,13 @@
 /* default timer interval, milliseconds */
 #define SYNC_INTERVAL_MSEC 5 /* 5ms */
 
+/*
+ * Send time error histogram: how late each packet went out compared to
+ * its PCR-derived send time. Bucket upper bounds, microseconds:
+ *    50, 100, 250, 500, 1000, 2000, 5000, +inf
+ */
+#define SYNC_HIST_BUCKETS 8
+
 typedef struct ts_sync_t ts_sync_t;
 typedef void (*sync_callback_t)(void *);
 
@@ -44,6 +51,18 @@ typedef struct
     size_t filled;
     size_t want;
     unsigned int num_blocks;
+
+    /* input jitter and underrun history */
+    bool adaptive;
+    unsigned int jitter; /* usecs */
+    unsigned int underruns;
+    unsigned int grown;
+    unsigned int shrunk;
+
+    /* send time error */
+    bool paced;
+    uint64_t late_hist[SYNC_HIST_BUCKETS];
+    unsigned int late_max; /* usecs */
 } ts_sync_stat_t;
 
 ts_sync_t *ts_sync_init(ts_callback_t on_ts, void *arg) __asc_result;
@@ -65,10 +84,25 @@ void ts_sync_set_fname(ts_sync_t *sx, const char *format
  * Any part can be omitted, e.g. "80"/",,16"/etc. are considered valid.
  *
  * Default is "10,5,8".
+ *
+ * Prefixing the string with "auto" (e.g. "auto" or "auto,20,10,16") turns
+ * on adaptive mode, in which the given thresholds are only a starting
+ * point. The buffer then follows input jitter and underruns, raising both
+ * thresholds after an underrun and lowering them again once the input has
+ * been steady for a while.
  */
 bool ts_sync_set_opts(ts_sync_t *sx, const char *opts);
 bool ts_sync_set_max_size(ts_sync_t *sx, unsigned int mbytes);
 bool ts_sync_set_blocks(ts_sync_t *sx, unsigned int enough, unsigned int low);
+void ts_sync_set_adaptive(ts_sync_t *sx, bool on);
+
+/*
+ * Launch time mode: release packets up to `usecs' ahead of their send
+ * time, for the kernel to hold until then. Inside `on_ts', ts_sync_due()
+ * returns the asc_utime() at which the current packet is due.
+ */
+void ts_sync_set_lead(ts_sync_t *sx, unsigned int usecs);
+uint64_t ts_sync_due(const ts_sync_t *sx) __asc_result;
 
 void ts_sync_query(const ts_sync_t *sx, ts_sync_stat_t *out);
 void ts_sync_reset(ts_sync_t *sx);
@@ -77,4 +111,14 @@ void ts_sync_loop(void *arg);
 bool ts_sync_push(ts_sync_t *sx, const void *buf
                   , size_t count) __asc_result;
 
+/*
+ * Pacing thread: instead of calling ts_sync_loop() from a timer, run the
+ * dequeue on a dedicated real-time thread that sleeps until the next
+ * packet is due. `on_ts' is then called on that thread, with the buffer
+ * locked, and `on_ready' is not called at all. Pass -1 as `cpu' to
+ * leave the thread unpinned.
+ */
+bool ts_sync_start(ts_sync_t *sx, int cpu) __asc_result;
+void ts_sync_stop(ts_sync_t *sx);
+
 #endif /* _TS_SYNC_ */
@@ -1076,7 +1076,6 @@ void on_sample(void *arg, const uint8_t *buf, size_t len)
     {
         /* ask main thread to dequeue */
         asc_job_queue(mod, bda_buffer_pop, mod);
-        asc_wake();
 
         mod->buf.pending = 0;
     }
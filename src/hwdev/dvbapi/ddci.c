@@ -141,7 +141,6 @@ static void thread_loop(void *arg)
                 {
                     system_time_buffer = system_time;
                     asc_job_queue(mod->sec_thread_output, on_thread_read, mod);
-                    asc_wake();
                 }
             }
         }
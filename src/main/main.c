@@ -129,6 +129,10 @@ int main(int argc, const char *argv[])
         asc_lib_init();
         signal_enable(true);
 
+        /* keep log output off the streaming threads */
+        asc_log_set_rate_limit(ASC_LOG_RATE_DEFAULT);
+        asc_log_set_async(true);
+
         /* initialize and run astra instance */
         bootstrap(lua, argc, argv);
 
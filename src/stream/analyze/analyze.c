@@ -41,6 +41,7 @@
 #include <astra/astra.h>
 #include <astra/core/timer.h>
 #include <astra/luaapi/stream.h>
+#include <astra/luaapi/state.h>
 #include <astra/mpegts/descriptors.h>
 #include <astra/mpegts/pes.h>
 #include <astra/mpegts/psi.h>
@@ -553,6 +554,7 @@ static void append_rate(module_data_t *mod, int rate)
     ++mod->rate_count;
     if(mod->rate_count >= (int)(sizeof(mod->rate)/sizeof(*mod->rate)))
     {
+        lua_api_lock();
         lua_newtable(L);
         lua_newtable(L);
         for(int i = 0; i < mod->rate_count; ++i)
@@ -563,6 +565,7 @@ static void append_rate(module_data_t *mod, int rate)
         }
         lua_setfield(L, -2, "rate");
         callback(L, mod);
+        lua_api_unlock();
         mod->rate_count = 0;
     }
 }
@@ -611,6 +614,8 @@ static void on_ts(module_data_t *mod, const uint8_t *ts)
 
     if(item->type & (TS_TYPE_PSI | TS_TYPE_SI))
     {
+        /* table callbacks may call into Lua */
+        lua_api_lock();
         switch(item->type)
         {
             case TS_TYPE_PAT:
@@ -629,6 +634,7 @@ static void on_ts(module_data_t *mod, const uint8_t *ts)
             default:
                 break;
         }
+        lua_api_unlock();
     }
 
     // Analyze
@@ -672,6 +678,8 @@ static void on_check_stat(void *arg)
     module_data_t *const mod = (module_data_t *)arg;
     lua_State *const L = module_lua(mod);
 
+    lua_api_lock();
+
     int items_count = 1;
     lua_newtable(L);
 
@@ -767,6 +775,7 @@ static void on_check_stat(void *arg)
     lua_setfield(L, -2, "on_air");
 
     callback(L, mod);
+    lua_api_unlock();
 }
 
 /*
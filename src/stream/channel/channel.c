@@ -797,6 +797,85 @@ static void on_ts(module_data_t *mod, const uint8_t *ts)
     module_stream_send(mod, ts);
 }
 
+/* check if packet would be passed downstream unmodified */
+static inline bool is_pass_through(const module_data_t *mod, const uint8_t *ts)
+{
+    const uint16_t pid = TS_GET_PID(ts);
+    if(pid == TS_NULL_PID || !module_demux_check(mod, pid))
+        return false;
+
+    switch(mod->stream[pid])
+    {
+        case TS_TYPE_PES:
+            break;
+        case TS_TYPE_SDT:
+            if(!mod->config.pass_sdt)
+                return false;
+            break;
+        case TS_TYPE_EIT:
+            if(!mod->config.pass_eit)
+                return false;
+            break;
+        case TS_TYPE_PAT:
+        case TS_TYPE_CAT:
+        case TS_TYPE_PMT:
+        case TS_TYPE_UNKNOWN:
+            return false;
+        default:
+            break;
+    }
+
+    if(mod->pid_map[pid] == TS_MAX_PIDS)
+        return false;
+
+    return !(mod->map && mod->pid_map[pid]);
+}
+
+static void on_ts_batch(module_data_t *mod, const uint8_t *ts, size_t count)
+{
+    const uint8_t *run = ts;
+    size_t run_cnt = 0;
+
+    for(size_t i = 0; i < count; i++, ts += TS_PACKET_SIZE)
+    {
+        if(is_pass_through(mod, ts))
+        {
+            if(run_cnt == 0)
+                run = ts;
+
+            run_cnt++;
+            continue;
+        }
+
+        /* keep packet order: flush pending run before anything else */
+        if(run_cnt > 0)
+        {
+            module_stream_send_batch(mod, run, run_cnt);
+            run_cnt = 0;
+        }
+
+        on_ts(mod, ts);
+    }
+
+    if(run_cnt > 0)
+        module_stream_send_batch(mod, run, run_cnt);
+}
+
+static void on_ts_block(module_data_t *mod, ts_block_t *block)
+{
+    /* forward shared block as is unless some packets need processing */
+    for(size_t i = 0; i < block->count; i++)
+    {
+        if(!is_pass_through(mod, block->ts[i]))
+        {
+            on_ts_batch(mod, block->ts[0], block->count);
+            return;
+        }
+    }
+
+    module_stream_send_block(mod, block);
+}
+
 /*
  * oooo     oooo  ooooooo  ooooooooo  ooooo  oooo ooooo       ooooooooooo
  *  8888o   888 o888   888o 888    88o 888    88   888         888    88
@@ -809,7 +888,10 @@ static void on_ts(module_data_t *mod, const uint8_t *ts)
 static void module_init(lua_State *L, module_data_t *mod)
 {
     module_stream_init(L, mod, on_ts);
+    module_stream_set_batch(mod, on_ts_batch);
+    module_stream_set_block(mod, on_ts_block);
     module_demux_set(mod, NULL, NULL);
+    module_demux_set_filter(mod, true);
 
     module_option_string(L, "name", &mod->config.name, NULL);
     if(mod->config.name == NULL)
@@ -37,12 +37,14 @@
 #include <astra/core/thread.h>
 #include <astra/core/timer.h>
 #include <astra/luaapi/stream.h>
+#include <astra/luaapi/state.h>
 #include <astra/mpegts/pcr.h>
 
 #define MSG(_msg) "[file_input %s] " _msg, mod->filename
 
 #define INPUT_BUFFER_SIZE 2
 #define TS_PACKET_SIZE_BDAV 192
+#define FILE_READ_BATCH 32
 
 struct module_data_t
 {
@@ -304,7 +306,6 @@ static void thread_loop(void *arg)
             {
                 system_time_buffer = system_time;
                 asc_job_queue(mod->thread_output, on_thread_read, mod);
-                asc_wake();
             }
 
             system_time_check = system_time;
@@ -355,9 +356,11 @@ static void on_thread_close(void *arg)
     {
         lua_State *const L = module_lua(mod);
 
+        lua_api_lock();
         lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_callback);
         if (lua_tr_call(L, 0, 0) != 0)
             lua_err_log(L);
+        lua_api_unlock();
     }
 }
 
@@ -365,15 +368,16 @@ static void on_thread_read(void *arg)
 {
     module_data_t *mod = (module_data_t *)arg;
 
-    uint8_t ts[TS_PACKET_SIZE];
+    uint8_t ts[TS_PACKET_SIZE * FILE_READ_BATCH];
     while (true)
     {
+        /* writer always pushes whole packets */
         const ssize_t r = asc_thread_buffer_read(mod->thread_output, ts
-                                                 , TS_PACKET_SIZE);
-        if (r != TS_PACKET_SIZE)
+                                                 , sizeof(ts));
+        if (r < TS_PACKET_SIZE)
             return;
 
-        module_stream_send(mod, ts);
+        module_stream_send_batch(mod, ts, r / TS_PACKET_SIZE);
     }
 }
 
@@ -19,36 +19,119 @@
  */
 
 #include <astra/astra.h>
+#include <astra/core/list.h>
 #include <astra/luaapi/stream.h>
+#include <astra/mpegts/psi.h>
 
 #include "../http.h"
 
 #define DEFAULT_BUFFER_SIZE (1024 * 1024)
 #define DEFAULT_BUFFER_FILL (128 * 1024)
 
+/* stop waiting for keyframes if the stream hasn't flagged one lately */
+#define RAP_TIMEOUT (10 * 1000 * 1000)
+
+/*
+ * Clients of the same upstream share a single ring of refcounted blocks.
+ * Each client keeps a cursor into the ring and sends straight from it,
+ * so memory and per-packet work don't grow with the number of viewers.
+ *
+ * The ring also follows PAT/PMT and marks blocks holding a random access
+ * point (PUSI with random_access_indicator on a video PID). A client
+ * that falls behind skips whole GOPs: it resumes at the next random
+ * access point, preceded by the cached PAT and PMT.
+ */
+
+typedef struct http_ring_t http_ring_t;
+
 struct module_data_t
 {
     MODULE_DATA();
 
     int idx_callback;
+    asc_list_t *rings;
 };
 
-struct http_response_t
+typedef struct
+{
+    ts_block_t *block;
+    uint64_t offset; /* stream position of the block's first byte */
+    unsigned int rap; /* 1 + index of the first random access point */
+} ring_slot_t;
+
+typedef struct
+{
+    http_ring_t *ring;
+    ts_psi_t *psi; /* section being assembled; cc is the last one seen */
+    ts_psi_t *last; /* last complete section, re-sent on resync */
+} ring_psi_t;
+
+/* ring->pids flags */
+enum
+{
+    RING_PID_PAT = 0x01,
+    RING_PID_PMT = 0x02,
+    RING_PID_VIDEO = 0x04,
+};
+
+struct http_ring_t
 {
     STREAM_MODULE_DATA();
 
+    module_data_t *mod;
+    module_data_t *upstream;
+
+    ring_slot_t *slots;
+    size_t size; /* power of two */
+    size_t max_bytes; /* largest buffer_size among clients */
+
+    uint64_t head; /* sequence number of the next block */
+    uint64_t tail; /* oldest block still in the ring */
+    uint64_t bytes; /* stream position of the next byte */
+
+    asc_list_t *clients;
+    asc_list_t *idle; /* caught up, waiting for buffer_fill */
+    uint64_t wake_at; /* earliest position an idle client waits for */
+
+    uint8_t *pids;
+    ring_psi_t *pat;
+    asc_list_t *pmts;
+    uint64_t rap_time; /* when the last random access point came in */
+};
+
+/* what to do with clients that fall behind more than buffer_size */
+enum
+{
+    OVERFLOW_GOP = 0,
+    OVERFLOW_RESYNC,
+    OVERFLOW_CLOSE,
+};
+
+struct http_response_t
+{
     module_data_t *mod;
     http_client_t *client;
+    http_ring_t *ring;
 
-    uint8_t *buffer;
-    size_t buffer_count;
-    size_t buffer_read;
-    size_t buffer_write;
+    uint64_t cursor; /* block being sent */
+    uint64_t pos; /* stream position of the next byte to send */
+    size_t send_offset; /* part of the cursor block already sent */
+    ts_block_t *partial; /* cursor block while partially sent */
 
     size_t buffer_size;
     size_t buffer_fill;
+    int overflow;
 
     bool is_socket_busy;
+    bool wait_rap; /* skipping to the next random access point */
+
+    uint8_t *inject; /* PAT and PMT to send before resuming */
+    size_t inject_size;
+    size_t inject_skip;
+
+    uint64_t skipped; /* packets */
+    unsigned int overflows;
+    int idx_stat; /* lua table to report counters into */
 };
 
 /*
@@ -56,91 +139,651 @@ struct http_response_t
  * client->response->mod - http_upstream module
  */
 
-static void on_upstream_ready(void *arg)
+static void on_upstream_ready(void *arg);
+
+/*
+ * PAT/PMT tracking
+ */
+
+static ring_psi_t *ring_psi_init(http_ring_t *ring, ts_type_t type, uint16_t pid)
 {
-    http_client_t *const client = (http_client_t *)arg;
-    http_response_t *const response = client->response;
+    ring_psi_t *const entry = ASC_ALLOC(1, ring_psi_t);
+
+    entry->ring = ring;
+    entry->psi = ts_psi_init(type, pid);
+    entry->last = ts_psi_init(type, pid);
+
+    return entry;
+}
+
+static void ring_psi_destroy(ring_psi_t *entry)
+{
+    ts_psi_destroy(entry->psi);
+    ts_psi_destroy(entry->last);
+    free(entry);
+}
+
+/* keep a copy of a new section; false if it's unchanged or corrupt */
+static bool ring_psi_store(ring_psi_t *entry)
+{
+    ts_psi_t *const psi = entry->psi;
+
+    const uint32_t crc32 = PSI_GET_CRC32(psi);
+    if(crc32 == psi->crc32 || crc32 != PSI_CALC_CRC32(psi))
+        return false;
+
+    psi->crc32 = crc32;
+    memcpy(entry->last->buffer, psi->buffer, psi->buffer_size);
+    entry->last->buffer_size = psi->buffer_size;
+
+    return true;
+}
 
-    if(response->buffer_count > 0)
+static void on_ring_pat(void *arg, ts_psi_t *psi)
+{
+    ring_psi_t *const entry = (ring_psi_t *)arg;
+    http_ring_t *const ring = entry->ring;
+
+    if(psi->buffer[0] != 0x00 || !ring_psi_store(entry))
+        return;
+
+    /* program list changed, start over */
+    asc_list_clear(ring->pmts)
+        ring_psi_destroy((ring_psi_t *)asc_list_data(ring->pmts));
+
+    memset(ring->pids, 0, TS_MAX_PIDS);
+    ring->pids[0] = RING_PID_PAT;
+
+    const uint8_t *pointer;
+    PAT_ITEMS_FOREACH(psi, pointer)
     {
-        size_t block_size = (response->buffer_write > response->buffer_read)
-                          ? (response->buffer_write - response->buffer_read)
-                          : (response->buffer_size - response->buffer_read);
+        const uint16_t pnr = PAT_ITEM_GET_PNR(psi, pointer);
+        const uint16_t pid = PAT_ITEM_GET_PID(psi, pointer);
 
-        if(block_size > response->buffer_count)
-            block_size = response->buffer_count;
+        /* skip NIT and duplicates */
+        if(pnr == 0 || ring->pids[pid] != 0)
+            continue;
 
-        const ssize_t send_size = asc_socket_send(  client->sock
-                                                  , &response->buffer[response->buffer_read]
-                                                  , block_size);
+        ring->pids[pid] = RING_PID_PMT;
+        asc_list_insert_tail(ring->pmts, ring_psi_init(ring, TS_TYPE_PMT, pid));
+    }
+}
 
-        if(send_size > 0)
+static void on_ring_pmt(void *arg, ts_psi_t *psi)
+{
+    ring_psi_t *const entry = (ring_psi_t *)arg;
+    http_ring_t *const ring = entry->ring;
+
+    if(psi->buffer[0] != 0x02 || !ring_psi_store(entry))
+        return;
+
+    const uint8_t *pointer;
+    PMT_ITEMS_FOREACH(psi, pointer)
+    {
+        const uint8_t type = PMT_ITEM_GET_TYPE(psi, pointer);
+        const uint16_t pid = PMT_ITEM_GET_PID(psi, pointer);
+
+        if(ring->pids[pid] == 0
+           && ts_stream_type(type)->pkt_type == TS_TYPE_VIDEO)
+        {
+            ring->pids[pid] = RING_PID_VIDEO;
+        }
+    }
+}
+
+/* feed PSI parsers; return 1 + index of the first random access point */
+static unsigned int ring_scan(http_ring_t *ring, const ts_block_t *block)
+{
+    unsigned int rap = 0;
+
+    for(unsigned int i = 0; i < block->count; i++)
+    {
+        const uint8_t *const ts = block->ts[i];
+        const uint16_t pid = TS_GET_PID(ts);
+        const uint8_t flags = ring->pids[pid];
+
+        if(flags & RING_PID_VIDEO)
         {
-            response->buffer_count -= send_size;
-            response->buffer_read += send_size;
-            if(response->buffer_read >= response->buffer_size)
-                response->buffer_read = 0;
+            if(rap == 0 && TS_IS_PUSI(ts) && TS_IS_RANDOM(ts))
+                rap = i + 1;
         }
-        else if(send_size == -1)
+        else if(flags & RING_PID_PAT)
         {
-            http_client_error(client, "failed to send ts (%zu bytes): %s"
-                              , block_size, asc_error_msg());
-            http_client_close(client);
-            return;
+            ts_psi_mux(ring->pat->psi, ts, on_ring_pat, ring->pat);
+        }
+        else if(flags & RING_PID_PMT)
+        {
+            asc_list_for(ring->pmts)
+            {
+                ring_psi_t *const entry =
+                    (ring_psi_t *)asc_list_data(ring->pmts);
+
+                if(entry->psi->pid == pid)
+                {
+                    ts_psi_mux(entry->psi, ts, on_ring_pmt, entry);
+                    break;
+                }
+            }
         }
     }
 
-    if(response->buffer_count == 0)
+    return rap;
+}
+
+/*
+ * ring buffer
+ */
+
+static inline ring_slot_t *ring_slot(const http_ring_t *ring, uint64_t seq)
+{
+    return &ring->slots[seq & (ring->size - 1)];
+}
+
+static void ring_resize(http_ring_t *ring, size_t max_bytes)
+{
+    /* worst case is one packet per block */
+    size_t size = 1;
+    while(size < max_bytes / TS_PACKET_SIZE + 1)
+        size *= 2;
+
+    if(size > ring->size)
     {
-        asc_socket_set_on_ready(client->sock, NULL);
+        ring_slot_t *const slots = ASC_ALLOC(size, ring_slot_t);
+        for(uint64_t seq = ring->tail; seq < ring->head; seq++)
+            slots[seq & (size - 1)] = *ring_slot(ring, seq);
+
+        free(ring->slots);
+        ring->slots = slots;
+        ring->size = size;
+    }
+
+    ring->max_bytes = max_bytes;
+}
+
+/* arm idle clients that have buffer_fill worth of data to send */
+static void ring_wake(http_ring_t *ring)
+{
+    ring->wake_at = UINT64_MAX;
+
+    asc_list_first(ring->idle);
+    while(!asc_list_eol(ring->idle))
+    {
+        http_response_t *const response =
+            (http_response_t *)asc_list_data(ring->idle);
+
+        const uint64_t wake = response->pos + response->buffer_fill;
+        if(ring->bytes >= wake)
+        {
+            asc_list_remove_current(ring->idle);
+            asc_socket_set_on_ready(response->client->sock, on_upstream_ready);
+            response->is_socket_busy = true;
+        }
+        else
+        {
+            if(wake < ring->wake_at)
+                ring->wake_at = wake;
+
+            asc_list_next(ring->idle);
+        }
+    }
+}
+
+static void ring_push(http_ring_t *ring, ts_block_t *block)
+{
+    const size_t size = ts_block_size(block);
+    const unsigned int rap = ring_scan(ring, block);
+
+    /* slow clients notice their data is gone when they next send */
+    while(ring->head > ring->tail
+          && (ring->head - ring->tail >= ring->size
+              || ring->bytes + size - ring_slot(ring, ring->tail)->offset
+                 > ring->max_bytes))
+    {
+        ring_slot_t *const slot = ring_slot(ring, ring->tail++);
+        ASC_FREE(slot->block, ts_block_unref);
+    }
+
+    ring_slot_t *const slot = ring_slot(ring, ring->head++);
+    slot->block = ts_block_ref(block);
+    slot->offset = ring->bytes;
+    slot->rap = rap;
+    ring->bytes += size;
+
+    if(rap != 0)
+        ring->rap_time = asc_utime();
+
+    if(ring->bytes >= ring->wake_at)
+        ring_wake(ring);
+}
+
+/* return first block at or after stream position `offset' */
+static uint64_t ring_seek(const http_ring_t *ring, uint64_t offset)
+{
+    uint64_t lo = ring->tail;
+    uint64_t hi = ring->head;
+
+    while(lo < hi)
+    {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if(ring_slot(ring, mid)->offset < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void on_ring_block(void *arg, ts_block_t *block)
+{
+    ring_push((http_ring_t *)arg, block);
+}
+
+static void on_ring_ts(void *arg, const uint8_t *ts)
+{
+    ts_block_t *const block = ts_block_copy(ts, 1);
+    ring_push((http_ring_t *)arg, block);
+    ts_block_unref(block);
+}
+
+static http_ring_t *ring_open(module_data_t *mod, module_data_t *upstream)
+{
+    asc_list_for(mod->rings)
+    {
+        http_ring_t *const ring = (http_ring_t *)asc_list_data(mod->rings);
+
+        /* upstream may have been destroyed and its address reused */
+        if(ring->upstream == upstream
+           && module_stream_parent((module_data_t *)ring) == upstream)
+        {
+            return ring;
+        }
+    }
+
+    http_ring_t *const ring = ASC_ALLOC(1, http_ring_t);
+    ring->mod = mod;
+    ring->upstream = upstream;
+    ring->clients = asc_list_init();
+    ring->idle = asc_list_init();
+    ring->wake_at = UINT64_MAX;
+
+    ring->pids = ASC_ALLOC(TS_MAX_PIDS, uint8_t);
+    ring->pids[0] = RING_PID_PAT;
+    ring->pat = ring_psi_init(ring, TS_TYPE_PAT, 0);
+    ring->pmts = asc_list_init();
+
+    module_data_t *const rmod = (module_data_t *)ring;
+    module_stream_init(NULL, rmod, (stream_callback_t)on_ring_ts);
+    module_stream_set_block(rmod, (stream_block_callback_t)on_ring_block);
+    module_stream_set_name(rmod, "http clients");
+    module_demux_set(rmod, NULL, NULL);
+    module_stream_attach(upstream, rmod);
+
+    asc_list_insert_tail(mod->rings, ring);
+
+    return ring;
+}
+
+static void ring_close(http_ring_t *ring)
+{
+    module_stream_destroy((module_data_t *)ring);
+
+    for(uint64_t seq = ring->tail; seq < ring->head; seq++)
+        ts_block_unref(ring_slot(ring, seq)->block);
+
+    asc_list_clear(ring->pmts)
+        ring_psi_destroy((ring_psi_t *)asc_list_data(ring->pmts));
+
+    asc_list_remove_item(ring->mod->rings, ring);
+    asc_list_destroy(ring->clients);
+    asc_list_destroy(ring->idle);
+    asc_list_destroy(ring->pmts);
+    ring_psi_destroy(ring->pat);
+    free(ring->pids);
+    free(ring->slots);
+    free(ring);
+}
+
+/*
+ * clients
+ */
+
+/* nothing left to send; wait for buffer_fill more bytes */
+static void client_idle(http_response_t *response)
+{
+    http_ring_t *const ring = response->ring;
+
+    if(response->is_socket_busy)
+    {
+        asc_socket_set_on_ready(response->client->sock, NULL);
         response->is_socket_busy = false;
     }
+
+    asc_list_insert_tail(ring->idle, response);
+
+    const uint64_t wake = response->pos + response->buffer_fill;
+    if(wake < ring->wake_at)
+        ring->wake_at = wake;
+}
+
+/* report counters into the table passed as the `stat' option */
+static void client_stat(http_response_t *response)
+{
+    if(response->idx_stat == 0)
+        return;
+
+    lua_State *const L = module_lua(response->mod);
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, response->idx_stat);
+    lua_pushnumber(L, response->skipped);
+    lua_setfield(L, -2, "skipped");
+    lua_pushinteger(L, response->overflows);
+    lua_setfield(L, -2, "overflows");
+    lua_pop(L, 1);
 }
 
-static void on_ts(void *arg, const uint8_t *ts)
+/* jump forward to stream position `pos', counting what's left out */
+static void client_skip(http_response_t *response, uint64_t pos)
+{
+    const uint64_t skipped = (pos - response->pos) / TS_PACKET_SIZE;
+
+    module_stream_drop((module_data_t *)response->ring, skipped);
+    response->skipped += skipped;
+    response->pos = pos;
+
+    client_stat(response);
+}
+
+static void on_inject_ts(void *arg, const uint8_t *ts)
 {
     http_response_t *const response = (http_response_t *)arg;
-    http_client_t *const client = response->client;
 
-    if(response->buffer_count + TS_PACKET_SIZE >= response->buffer_size)
+    memcpy(&response->inject[response->inject_size], ts, TS_PACKET_SIZE);
+    response->inject_size += TS_PACKET_SIZE;
+}
+
+/* CC of the next packet on this PID the client is going to get */
+static uint8_t client_next_cc(const http_response_t *response
+                              , const ring_psi_t *entry)
+{
+    const http_ring_t *const ring = response->ring;
+    const uint16_t pid = entry->psi->pid;
+
+    unsigned int i = (response->partial != NULL)
+                   ? response->send_offset / TS_PACKET_SIZE : 0;
+
+    for(uint64_t seq = response->cursor; seq < ring->head; seq++, i = 0)
     {
-        // overflow
-        response->buffer_count = 0;
-        response->buffer_read = 0;
-        response->buffer_write = 0;
-        if(response->is_socket_busy)
+        const ts_block_t *const block = ring_slot(ring, seq)->block;
+        for(; i < block->count; i++)
         {
-            asc_socket_set_on_ready(client->sock, NULL);
-            response->is_socket_busy = false;
+            const uint8_t *const ts = block->ts[i];
+            if(TS_GET_PID(ts) == pid && TS_IS_PAYLOAD(ts))
+                return TS_GET_CC(ts);
         }
+    }
+
+    /* nothing buffered after the resume point yet */
+    return (entry->psi->cc + 1) & 0x0F;
+}
+
+/*
+ * Queue one cached section. Its packets take the CCs right before the
+ * stream's own next packet on that PID, so the client sees no
+ * discontinuity and other clients' counters are left alone.
+ */
+static void client_inject_psi(http_response_t *response
+                              , const ring_psi_t *entry)
+{
+    const size_t first = response->inject_size;
+    ts_psi_demux(entry->last, on_inject_ts, response);
+
+    const size_t count = (response->inject_size - first) / TS_PACKET_SIZE;
+    const size_t next = client_next_cc(response, entry);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        uint8_t *const ts = &response->inject[first + i * TS_PACKET_SIZE];
+        TS_SET_CC(ts, next - count + i);
+    }
+}
+
+/* queue cached PAT and PMT ahead of the resumed stream */
+static void client_inject(http_response_t *response)
+{
+    http_ring_t *const ring = response->ring;
+
+    if(ring->pat->last->buffer_size == 0)
         return;
+
+    size_t count = ring->pat->last->buffer_size / TS_BODY_SIZE + 1;
+    asc_list_for(ring->pmts)
+    {
+        const ring_psi_t *const entry =
+            (ring_psi_t *)asc_list_data(ring->pmts);
+
+        if(entry->last->buffer_size > 0)
+            count += entry->last->buffer_size / TS_BODY_SIZE + 1;
     }
 
-    const size_t buffer_write = response->buffer_write + TS_PACKET_SIZE;
-    if(buffer_write < response->buffer_size)
+    free(response->inject);
+    response->inject = ASC_ALLOC(count * TS_PACKET_SIZE, uint8_t);
+    response->inject_size = 0;
+    response->inject_skip = 0;
+
+    client_inject_psi(response, ring->pat);
+    asc_list_for(ring->pmts)
     {
-        memcpy(&response->buffer[response->buffer_write], ts, TS_PACKET_SIZE);
-        response->buffer_write = buffer_write;
+        const ring_psi_t *const entry =
+            (ring_psi_t *)asc_list_data(ring->pmts);
+
+        client_inject_psi(response, entry);
     }
-    else if(buffer_write > response->buffer_size)
+}
+
+/* skip to the next random access point; false if there's none yet */
+static bool client_seek_rap(http_response_t *response)
+{
+    http_ring_t *const ring = response->ring;
+
+    /* don't wait for keyframes the stream doesn't flag */
+    const bool has_rap = (ring->rap_time != 0
+                          && asc_utime() - ring->rap_time < RAP_TIMEOUT);
+
+    uint64_t seq = response->cursor;
+    if(has_rap)
     {
-        const size_t ts_head = response->buffer_size - response->buffer_write;
-        memcpy(&response->buffer[response->buffer_write], ts, ts_head);
-        response->buffer_write = TS_PACKET_SIZE - ts_head;
-        memcpy(response->buffer, &ts[ts_head], response->buffer_write);
+        while(seq < ring->head && ring_slot(ring, seq)->rap == 0)
+            seq++;
+    }
+
+    response->cursor = seq;
+    if(seq == ring->head)
+    {
+        client_skip(response, ring->bytes);
+        return false;
+    }
+
+    const ring_slot_t *const slot = ring_slot(ring, seq);
+    const size_t offset = has_rap ? (slot->rap - 1) * TS_PACKET_SIZE : 0;
+
+    client_skip(response, slot->offset + offset);
+    if(offset > 0)
+    {
+        /* start mid-block, right at the keyframe */
+        response->partial = ts_block_ref(slot->block);
+        response->send_offset = offset;
+    }
+
+    response->wait_rap = false;
+    client_inject(response);
+
+    return true;
+}
+
+/* client fell behind; returns false if it was closed */
+static bool client_overflow(http_response_t *response)
+{
+    http_ring_t *const ring = response->ring;
+    http_client_t *const client = response->client;
+
+    if(response->overflow == OVERFLOW_CLOSE)
+    {
+        const size_t dropped = (ring->bytes - response->pos) / TS_PACKET_SIZE;
+        module_stream_drop((module_data_t *)ring, dropped);
+
+        http_client_error(client, "client is too slow, dropped %zu packets"
+                          , dropped);
+        http_client_close(client);
+        return false;
+    }
+
+    response->overflows++;
+
+    if(response->overflow == OVERFLOW_GOP)
+    {
+        /* drop whole GOPs: look for a keyframe in the newest half buffer */
+        uint64_t start = 0;
+        if(ring->bytes > response->buffer_size / 2)
+            start = ring->bytes - response->buffer_size / 2;
+
+        response->cursor = ring_seek(ring, start);
+        response->wait_rap = true;
     }
     else
     {
-        memcpy(&response->buffer[response->buffer_write], ts, TS_PACKET_SIZE);
-        response->buffer_write = 0;
+        response->cursor = ring->head;
+        client_inject(response);
+    }
+
+    client_skip(response, (response->cursor < ring->head)
+                          ? ring_slot(ring, response->cursor)->offset
+                          : ring->bytes);
+
+    return true;
+}
+
+static void on_upstream_ready(void *arg)
+{
+    http_client_t *const client = (http_client_t *)arg;
+    http_response_t *const response = client->response;
+    http_ring_t *const ring = response->ring;
+
+    /* upstream module is gone */
+    if(ring == NULL)
+    {
+        asc_socket_set_on_ready(client->sock, NULL);
+        return;
+    }
+
+    if(response->partial == NULL
+       && (response->cursor < ring->tail
+           || ring->bytes - response->pos > response->buffer_size))
+    {
+        if(!client_overflow(response))
+            return;
+    }
+
+    if(response->wait_rap && !client_seek_rap(response))
+    {
+        client_idle(response);
+        return;
+    }
+
+    const void *buffers[ASC_SOCKET_BATCH_MAX];
+    size_t sizes[ASC_SOCKET_BATCH_MAX];
+    size_t count = 0;
+    size_t total = 0;
+
+    if(response->inject != NULL)
+    {
+        buffers[0] = &response->inject[response->inject_skip];
+        sizes[0] = response->inject_size - response->inject_skip;
+        total += sizes[0];
+        count++;
+    }
+
+    uint64_t seq = response->cursor;
+    if(response->partial != NULL)
+    {
+        /* finish this block to stay packet aligned */
+        const ts_block_t *const block = response->partial;
+        buffers[count] = &block->ts[0][response->send_offset];
+        sizes[count] = ts_block_size(block) - response->send_offset;
+        total += sizes[count];
+        count++;
+        seq++;
+    }
+
+    while(count < ASC_SOCKET_BATCH_MAX && seq < ring->head
+          && seq >= ring->tail)
+    {
+        const ts_block_t *const block = ring_slot(ring, seq++)->block;
+        buffers[count] = block->ts[0];
+        sizes[count] = ts_block_size(block);
+        total += sizes[count];
+        count++;
+    }
+
+    if(count == 0)
+    {
+        client_idle(response);
+        return;
+    }
+
+    ssize_t send_size = asc_socket_sendv(client->sock, buffers, sizes, count);
+    if(send_size == -1)
+    {
+        http_client_error(client, "failed to send ts (%zu bytes): %s"
+                          , total, asc_error_msg());
+        http_client_close(client);
+        return;
+    }
+
+    size_t i = 0;
+    if(response->inject != NULL)
+    {
+        if((size_t)send_size < sizes[0])
+        {
+            response->inject_skip += send_size;
+            send_size = 0;
+        }
+        else
+        {
+            send_size -= sizes[0];
+            ASC_FREE(response->inject, free);
+        }
+
+        i++;
     }
-    response->buffer_count += TS_PACKET_SIZE;
 
-    if(   response->is_socket_busy == false
-       && response->buffer_count >= response->buffer_fill)
+    for(; i < count && send_size > 0; i++)
     {
-        asc_socket_set_on_ready(client->sock, on_upstream_ready);
-        response->is_socket_busy = true;
+        if((size_t)send_size < sizes[i])
+        {
+            if(response->partial == NULL)
+            {
+                ts_block_t *const block =
+                    ring_slot(ring, response->cursor)->block;
+                response->partial = ts_block_ref(block);
+            }
+
+            response->send_offset += send_size;
+            response->pos += send_size;
+            break;
+        }
+
+        send_size -= sizes[i];
+        response->pos += sizes[i];
+        response->send_offset = 0;
+        response->cursor++;
+        ASC_FREE(response->partial, ts_block_unref);
+    }
+
+    if(response->inject == NULL && response->partial == NULL
+       && response->cursor == ring->head)
+    {
+        client_idle(response);
     }
 }
 
@@ -188,6 +831,27 @@ static void on_upstream_send(void *arg)
         }
         lua_pop(L, 1);
 
+        lua_getfield(L, 3, "overflow");
+        if(lua_isstring(L, -1))
+        {
+            const char *const value = lua_tostring(L, -1);
+            if(!strcmp(value, "close"))
+                client->response->overflow = OVERFLOW_CLOSE;
+            else if(!strcmp(value, "gop"))
+                client->response->overflow = OVERFLOW_GOP;
+            else if(!strcmp(value, "resync"))
+                client->response->overflow = OVERFLOW_RESYNC;
+            else
+                http_client_warning(client, "unknown overflow mode '%s'", value);
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, 3, "stat");
+        if(lua_istable(L, -1))
+            client->response->idx_stat = luaL_ref(L, LUA_REGISTRYINDEX);
+        else
+            lua_pop(L, 1);
+
         if(client->response->buffer_size <= client->response->buffer_fill)
         {
             http_client_error(client, "buffer_size must be greater than buffer_fill");
@@ -206,15 +870,30 @@ static void on_upstream_send(void *arg)
         return;
     }
 
-    client->response->buffer = ASC_ALLOC(client->response->buffer_size, uint8_t);
+    http_response_t *const response = client->response;
+    http_ring_t *const ring = ring_open(response->mod, upstream);
+    if(response->buffer_size > ring->max_bytes)
+        ring_resize(ring, response->buffer_size);
+
+    asc_list_insert_tail(ring->clients, response);
+    response->ring = ring;
+
+    /* start with up to buffer_fill of what's already in the ring */
+    uint64_t start = 0;
+    if(ring->bytes > response->buffer_fill)
+        start = ring->bytes - response->buffer_fill;
 
-    module_data_t *const mod = (module_data_t *)client->response;
-    module_stream_init(NULL, mod, (stream_callback_t)on_ts);
-    module_demux_set(mod, NULL, NULL);
-    module_stream_attach(upstream, mod);
+    response->cursor = ring_seek(ring, start);
+    response->pos = (response->cursor < ring->head)
+                  ? ring_slot(ring, response->cursor)->offset
+                  : ring->bytes;
 
+    client_stat(response);
+
+    /* server switches to on_ready once headers are out */
     client->on_read = on_upstream_read;
-    client->on_ready = NULL;
+    client->on_ready = on_upstream_ready;
+    response->is_socket_busy = true;
 
     const char *content_type = lua_isstring(L, 4)
                              ? lua_tostring(L, 4)
@@ -243,10 +922,23 @@ static int module_call(lua_State *L, module_data_t *mod)
             if (lua_tr_call(L, 3, 0) != 0)
                 lua_err_log(L);
 
-            module_stream_destroy((module_data_t *)client->response);
+            http_response_t *const response = client->response;
+            http_ring_t *const ring = response->ring;
+            if(ring != NULL)
+            {
+                asc_list_remove_item(ring->idle, response);
+                asc_list_remove_item(ring->clients, response);
+
+                if(asc_list_count(ring->clients) == 0)
+                    ring_close(ring);
+            }
 
-            free(client->response->buffer);
-            free(client->response);
+            if(response->idx_stat)
+                luaL_unref(L, LUA_REGISTRYINDEX, response->idx_stat);
+
+            ASC_FREE(response->partial, ts_block_unref);
+            free(response->inject);
+            free(response);
             client->response = NULL;
         }
         return 0;
@@ -281,6 +973,7 @@ static void module_init(lua_State *L, module_data_t *mod)
     lua_getfield(L, MODULE_OPTIONS_IDX, "callback");
     ASC_ASSERT(lua_isfunction(L, -1), "[http_upstream] option 'callback' is required");
     mod->idx_callback = luaL_ref(L, LUA_REGISTRYINDEX);
+    mod->rings = asc_list_init();
 
     // Deprecated
     bool is_deprecated = false;
@@ -314,6 +1007,32 @@ static void module_destroy(module_data_t *mod)
         luaL_unref(module_lua(mod), LUA_REGISTRYINDEX, mod->idx_callback);
         mod->idx_callback = 0;
     }
+
+    asc_list_till_empty(mod->rings)
+    {
+        http_ring_t *const ring = (http_ring_t *)asc_list_data(mod->rings);
+
+        /* orphan remaining clients; they stop getting data */
+        asc_list_for(ring->clients)
+        {
+            http_response_t *const response =
+                (http_response_t *)asc_list_data(ring->clients);
+
+            if(response->is_socket_busy)
+                asc_socket_set_on_ready(response->client->sock, NULL);
+
+            /* server re-arms on_ready once headers are out */
+            response->client->on_ready = NULL;
+
+            response->is_socket_busy = false;
+            response->ring = NULL;
+            ASC_FREE(response->partial, ts_block_unref);
+        }
+
+        ring_close(ring);
+    }
+
+    ASC_FREE(mod->rings, asc_list_destroy);
 }
 
 MODULE_REGISTER(http_upstream)
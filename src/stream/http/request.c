@@ -365,9 +365,19 @@ static void on_ts_read(void *arg)
             return;
         }
 
+        /* collect a run of aligned packets */
+        const uint8_t *const ts = &mod->ts.buf[mod->ts.buf_read];
+        size_t count = 1;
+        const size_t avail = mod->ts.buf_write - mod->ts.buf_read;
+        while((count + 1) * TS_PACKET_SIZE <= avail
+              && ts[count * TS_PACKET_SIZE] == 0x47)
+        {
+            ++count;
+        }
+
         if(mod->ts.sync != NULL)
         {
-            if (!ts_sync_push(mod->ts.sync, &mod->ts.buf[mod->ts.buf_read], 1))
+            if(!ts_sync_push(mod->ts.sync, ts, count))
             {
                 asc_log_error(MSG("sync push failed, resetting buffer"));
                 ts_sync_reset(mod->ts.sync);
@@ -375,18 +385,22 @@ static void on_ts_read(void *arg)
                 return;
             }
 
-            if (mod->ts.sync_feed > 0 && --mod->ts.sync_feed <= 0)
+            if(mod->ts.sync_feed > 0)
             {
-                asc_socket_set_on_read(mod->sock, NULL);
-                ts_sync_set_on_ready(mod->ts.sync, on_sync_ready);
+                mod->ts.sync_feed -= count;
+                if(mod->ts.sync_feed <= 0)
+                {
+                    asc_socket_set_on_read(mod->sock, NULL);
+                    ts_sync_set_on_ready(mod->ts.sync, on_sync_ready);
+                }
             }
         }
         else
         {
-            module_stream_send(mod, &mod->ts.buf[mod->ts.buf_read]);
+            module_stream_send_batch(mod, ts, count);
         }
 
-        mod->ts.buf_read += TS_PACKET_SIZE;
+        mod->ts.buf_read += count * TS_PACKET_SIZE;
     }
 }
 
@@ -612,7 +626,7 @@ static void on_read(void *arg)
             asc_socket_set_on_read(mod->sock, on_ts_read);
             asc_socket_set_on_ready(mod->sock, NULL);
 
-            if (mod->config.sync)
+            if(mod->config.sync)
             {
                 mod->ts.sync = ts_sync_init(module_stream_send, mod);
 
@@ -620,7 +634,7 @@ static void on_read(void *arg)
                                   , mod->config.host, mod->config.port
                                   , mod->config.path);
 
-                if (mod->config.sync_opts != NULL
+                if(mod->config.sync_opts != NULL
                     && !ts_sync_set_opts(mod->ts.sync, mod->config.sync_opts))
                 {
                     asc_log_error(MSG("invalid value for option 'sync_opts'"));
@@ -44,6 +44,7 @@
 #include <astra/core/child.h>
 #include <astra/core/timer.h>
 #include <astra/luaapi/stream.h>
+#include <astra/luaapi/state.h>
 #include <astra/mpegts/sync.h>
 
 #define MSG(_msg) "[%s] " _msg, mod->config.name
@@ -79,6 +80,8 @@ void callback_started(module_data_t *mod, pid_t pid)
     if (mod->idx_callback != LUA_REFNIL)
     {
         lua_State *const L = module_lua(mod);
+
+        lua_api_lock();
         lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_callback);
 
         /* data.started.pid */
@@ -90,6 +93,7 @@ void callback_started(module_data_t *mod, pid_t pid)
 
         if (lua_tr_call(L, 1, 0) != 0)
             lua_err_log(L);
+        lua_api_unlock();
     }
 }
 
@@ -99,6 +103,8 @@ void callback_text(module_data_t *mod, const char *src, const char *text)
     if (mod->idx_callback != LUA_REFNIL)
     {
         lua_State *const L = module_lua(mod);
+
+        lua_api_lock();
         lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_callback);
 
         /* data.<src> */
@@ -108,6 +114,7 @@ void callback_text(module_data_t *mod, const char *src, const char *text)
 
         if (lua_tr_call(L, 1, 0) != 0)
             lua_err_log(L);
+        lua_api_unlock();
     }
     else
     {
@@ -131,6 +138,8 @@ void callback_error(module_data_t *mod, const char *fmt, ...)
     if (mod->idx_callback != LUA_REFNIL)
     {
         lua_State *const L = module_lua(mod);
+
+        lua_api_lock();
         lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_callback);
 
         /* data.error */
@@ -140,6 +149,7 @@ void callback_error(module_data_t *mod, const char *fmt, ...)
 
         if (lua_tr_call(L, 1, 0) != 0)
             lua_err_log(L);
+        lua_api_unlock();
     }
 }
 
@@ -149,6 +159,8 @@ void callback_exited(module_data_t *mod, int status)
     if (mod->idx_callback != LUA_REFNIL)
     {
         lua_State *const L = module_lua(mod);
+
+        lua_api_lock();
         lua_rawgeti(L, LUA_REGISTRYINDEX, mod->idx_callback);
 
         /* data.exited.status */
@@ -160,6 +172,7 @@ void callback_exited(module_data_t *mod, int status)
 
         if (lua_tr_call(L, 1, 0) != 0)
             lua_err_log(L);
+        lua_api_unlock();
     }
 }
 
@@ -290,8 +303,7 @@ void on_child_ts(void *arg, const void *buf, size_t packets)
     module_data_t *const mod = (module_data_t *)arg;
     const uint8_t *const ts = (uint8_t *)buf;
 
-    for (size_t i = 0; i < packets; i++)
-        module_stream_send(mod, &ts[i * TS_PACKET_SIZE]);
+    module_stream_send_batch(mod, ts, packets);
 }
 
 static
@@ -330,18 +342,20 @@ void on_child_ready(void *arg)
 }
 
 static
-void on_upstream_ts(module_data_t *mod, const uint8_t *ts)
+void on_upstream_batch(module_data_t *mod, const uint8_t *ts, size_t count)
 {
     if (!mod->can_send)
     {
-        mod->dropped++;
+        mod->dropped += count;
         if (mod->bypass)
-            module_stream_send(mod, ts);
+            module_stream_send_batch(mod, ts, count);
+        else
+            module_stream_drop(mod, count);
 
         return;
     }
 
-    const ssize_t ret = asc_child_send(mod->child, ts, 1);
+    const ssize_t ret = asc_child_send(mod->child, ts, count);
     if (ret == -1)
     {
         mod->can_send = false;
@@ -358,6 +372,12 @@ void on_upstream_ts(module_data_t *mod, const uint8_t *ts)
     }
 }
 
+static
+void on_upstream_ts(module_data_t *mod, const uint8_t *ts)
+{
+    on_upstream_batch(mod, ts, 1);
+}
+
 /*
  * lua methods
  */
@@ -502,6 +522,9 @@ void module_init(lua_State *L, module_data_t *mod)
         lua_pop(L, 1);
 
     module_stream_init(L, mod, on_ts);
+    if (on_ts != NULL)
+        module_stream_set_batch(mod, on_upstream_batch);
+
     on_child_restart(mod);
 }
 
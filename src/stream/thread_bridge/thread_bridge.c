@@ -0,0 +1,366 @@
+/*
+ * Astra Module: Thread bridge
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Module Name:
+ *      thread_bridge
+ *
+ * Module Role:
+ *      Input or output stage, forwards pid requests
+ *
+ * Module Options:
+ *      upstream    - object, stream instance returned by mod:stream()
+ *      name        - string, instance identifier for logging
+ *      worker      - number, worker delivering TS to children,
+ *                    0 for the main thread (default)
+ *      size        - number, ring depth in packet blocks, default is 1024
+ *      overflow    - string, what to drop when the ring is full:
+ *                    "drop_oldest" (default) or "drop_newest"
+ *
+ * Module Methods:
+ *      stats()     - return table, ring occupancy and packet counters
+ *
+ * Create the bridge on upstream's thread, then create its children on
+ * the target worker. Downstream modules must be destroyed before the
+ * bridge.
+ */
+
+#include <astra/astra.h>
+#include <astra/core/atomic.h>
+#include <astra/core/mainloop.h>
+#include <astra/core/ring.h>
+#include <astra/core/worker.h>
+#include <astra/luaapi/stream.h>
+
+#define MSG(_msg) "[thread_bridge %s] " _msg, mod->config.name
+
+/* default ring depth, blocks */
+#define DEFAULT_RING_SIZE 1024
+
+/* maximum blocks delivered per job before yielding to other events */
+#define DRAIN_LIMIT 256
+
+struct module_data_t
+{
+    STREAM_MODULE_DATA();
+
+    struct
+    {
+        const char *name;
+        int worker;
+        int size;
+        bool drop_oldest;
+    } config;
+
+    asc_main_loop_t *in_loop;
+    asc_main_loop_t *out_loop;
+
+    asc_ring_t *ring;
+    bool drain_pending;
+
+    /* pid requests from children, counted on the output side */
+    uint8_t down_pids[TS_MAX_PIDS];
+    bool want_pids[TS_MAX_PIDS];
+    bool sync_pending;
+
+    struct
+    {
+        size_t pushed;
+        size_t delivered;
+        size_t dropped;
+        size_t depth_max;
+    } stats;
+};
+
+/*
+ * output side
+ */
+
+static
+void on_drain(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    asc_atomic_store(&mod->drain_pending, false);
+
+    for (unsigned int i = 0; i < DRAIN_LIMIT; i++)
+    {
+        ts_block_t *const block = (ts_block_t *)asc_ring_pop(mod->ring);
+        if (block == NULL)
+            return;
+
+        asc_atomic_fetch_add(&mod->stats.delivered, block->count);
+        module_stream_send_block(mod, block);
+        ts_block_unref(block);
+    }
+
+    /* more to come; let other events on this loop run first */
+    if (!asc_atomic_exchange(&mod->drain_pending, true))
+        asc_job_send(mod->out_loop, mod, on_drain, mod);
+}
+
+static
+void on_sync(void *arg);
+
+static
+void request_sync(module_data_t *mod, uint16_t pid, bool want)
+{
+    asc_atomic_store(&mod->want_pids[pid], want);
+
+    if (!asc_atomic_exchange(&mod->sync_pending, true))
+        asc_job_send(mod->in_loop, mod, on_sync, mod);
+}
+
+static
+void on_join_pid(module_data_t *mod, uint16_t pid)
+{
+    if (++mod->down_pids[pid] == 1)
+        request_sync(mod, pid, true);
+}
+
+static
+void on_leave_pid(module_data_t *mod, uint16_t pid)
+{
+    if (mod->down_pids[pid] == 0)
+    {
+        asc_log_error(MSG("double leave on pid %hu"), pid);
+        return;
+    }
+
+    if (--mod->down_pids[pid] == 0)
+        request_sync(mod, pid, false);
+}
+
+/*
+ * input side
+ */
+
+/* bring our own pid membership in line with children's requests */
+static
+void on_sync(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    asc_atomic_store(&mod->sync_pending, false);
+
+    for (unsigned int pid = 0; pid < TS_MAX_PIDS; pid++)
+    {
+        const bool want = asc_atomic_load(&mod->want_pids[pid]);
+        const bool joined = module_demux_check(mod, pid);
+
+        if (want && !joined)
+            module_demux_join(mod, pid);
+        else if (!want && joined)
+            module_demux_leave(mod, pid);
+    }
+}
+
+/* takes ownership of the block */
+static
+void push_block(module_data_t *mod, ts_block_t *block)
+{
+    /* consumer may release the block as soon as it's in the ring */
+    const size_t count = block->count;
+
+    if (!asc_ring_push(mod->ring, block))
+    {
+        if (!mod->config.drop_oldest)
+        {
+            asc_atomic_fetch_add(&mod->stats.dropped, count);
+            module_stream_drop(mod, count);
+            ts_block_unref(block);
+
+            return;
+        }
+
+        /* NULL means consumer emptied the ring in the meantime */
+        ts_block_t *const old = (ts_block_t *)asc_ring_pop(mod->ring);
+        if (old != NULL)
+        {
+            asc_atomic_fetch_add(&mod->stats.dropped, old->count);
+            module_stream_drop(mod, old->count);
+            ts_block_unref(old);
+        }
+
+        /* we're the only producer, so there's room now */
+        const bool pushed = asc_ring_push(mod->ring, block);
+        ASC_ASSERT(pushed, MSG("ring is still full after drop"));
+    }
+
+    asc_atomic_fetch_add(&mod->stats.pushed, count);
+
+    const size_t depth = asc_ring_count(mod->ring);
+    if (depth > mod->stats.depth_max)
+        asc_atomic_store_relaxed(&mod->stats.depth_max, depth);
+
+    if (!asc_atomic_exchange(&mod->drain_pending, true))
+        asc_job_send(mod->out_loop, mod, on_drain, mod);
+}
+
+static
+void on_ts(module_data_t *mod, const uint8_t *ts)
+{
+    push_block(mod, ts_block_copy(ts, 1));
+}
+
+static
+void on_ts_batch(module_data_t *mod, const uint8_t *ts, size_t count)
+{
+    while (count > 0)
+    {
+        const size_t n = (count > TS_BLOCK_PACKETS)
+                         ? TS_BLOCK_PACKETS : count;
+
+        push_block(mod, ts_block_copy(ts, n));
+
+        ts += n * TS_PACKET_SIZE;
+        count -= n;
+    }
+}
+
+static
+void on_ts_block(module_data_t *mod, ts_block_t *block)
+{
+    push_block(mod, ts_block_ref(block));
+}
+
+/*
+ * module methods
+ */
+
+static
+int method_stats(lua_State *L, module_data_t *mod)
+{
+    lua_newtable(L);
+
+    lua_pushinteger(L, asc_ring_count(mod->ring));
+    lua_setfield(L, -2, "depth");
+
+    lua_pushinteger(L, asc_atomic_load_relaxed(&mod->stats.depth_max));
+    lua_setfield(L, -2, "depth_max");
+
+    lua_pushinteger(L, asc_ring_size(mod->ring));
+    lua_setfield(L, -2, "size");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->stats.pushed));
+    lua_setfield(L, -2, "pushed");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->stats.delivered));
+    lua_setfield(L, -2, "delivered");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->stats.dropped));
+    lua_setfield(L, -2, "dropped");
+
+    return 1;
+}
+
+/*
+ * module init
+ */
+
+static
+void module_init(lua_State *L, module_data_t *mod)
+{
+    mod->config.name = "bridge";
+    module_option_string(L, "name", &mod->config.name, NULL);
+
+    module_option_integer(L, "worker", &mod->config.worker);
+    if (mod->config.worker == 0)
+    {
+        mod->out_loop = asc_main_loop_primary();
+    }
+    else
+    {
+        if (mod->config.worker < 0)
+            luaL_error(L, MSG("invalid worker id %d"), mod->config.worker);
+
+        mod->out_loop = asc_worker_loop(mod->config.worker);
+        if (mod->out_loop == NULL)
+        {
+            luaL_error(L, MSG("worker #%d is not running")
+                       , mod->config.worker);
+        }
+    }
+
+    mod->config.size = DEFAULT_RING_SIZE;
+    module_option_integer(L, "size", &mod->config.size);
+    if (mod->config.size < 2)
+        luaL_error(L, MSG("ring size must be at least 2 blocks"));
+
+    mod->config.drop_oldest = true;
+    const char *overflow = NULL;
+    if (module_option_string(L, "overflow", &overflow, NULL))
+    {
+        if (!strcmp(overflow, "drop_newest"))
+            mod->config.drop_oldest = false;
+        else if (strcmp(overflow, "drop_oldest") != 0)
+            luaL_error(L, MSG("unknown overflow policy: %s"), overflow);
+    }
+
+    mod->in_loop = module_loop(mod);
+    mod->ring = asc_ring_init(mod->config.size);
+
+    module_stream_init(L, mod, on_ts);
+    module_stream_set_batch(mod, on_ts_batch);
+    module_stream_set_block(mod, on_ts_block);
+    module_stream_set_loop(mod, mod->out_loop);
+    module_demux_set(mod, on_join_pid, on_leave_pid);
+}
+
+static
+void on_prune(void *arg)
+{
+    asc_job_prune(arg);
+}
+
+static
+void module_destroy(module_data_t *mod)
+{
+    if (mod->ring == NULL)
+        return;
+
+    /* stop input, then wait out any delivery in progress */
+    module_stream_attach(NULL, mod);
+
+    asc_job_call(mod->out_loop, on_prune, mod);
+    asc_job_prune(mod);
+
+    module_stream_destroy(mod);
+
+    ts_block_t *block;
+    while ((block = (ts_block_t *)asc_ring_pop(mod->ring)) != NULL)
+        ts_block_unref(block);
+
+    ASC_FREE(mod->ring, asc_ring_destroy);
+}
+
+static
+const module_method_t module_methods[] =
+{
+    { "stats", method_stats },
+    { NULL, NULL },
+};
+
+STREAM_MODULE_REGISTER(thread_bridge)
+{
+    .init = module_init,
+    .destroy = module_destroy,
+    .methods = module_methods,
+};
@@ -0,0 +1,294 @@
+/*
+ * Astra Module: UDP (SMPTE 2022-1 FEC)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fec.h"
+#include "rtp.h"
+
+/*
+ * FEC packet layout: RTP header, whose P, X, CC and M bits carry their
+ * recovery values as in RFC 2733, then the FEC header:
+ *
+ *  0: SN base low bits (16)     | length recovery (16)
+ *  4: E (1) | PT recovery (7)   | mask (24)
+ *  8: TS recovery (32)
+ * 12: X (1) | D (1) | type (3) | index (3) | offset (8) | NA (8)
+ *     | SN base ext bits (8)
+ *
+ * followed by the XOR of the protected payloads, zero padded to the
+ * longest one. D is 0 for columns and 1 for rows.
+ */
+
+#define FEC_PAYLOAD(_pkt) (&(_pkt)[RTP_HEADER_SIZE + FEC_HEADER_SIZE])
+
+bool fec_parse(const uint8_t *pkt, size_t len, fec_header_t *hdr)
+{
+    if (len < RTP_HEADER_SIZE + FEC_HEADER_SIZE || (pkt[0] & 0xC0) != 0x80)
+        return false;
+
+    const uint8_t *const fec = &pkt[RTP_HEADER_SIZE];
+
+    /* E bit must be set: 2022-1 always uses the extended header */
+    if (!(fec[4] & 0x80))
+        return false;
+
+    hdr->is_row = (fec[12] & 0x40) != 0;
+    hdr->snbase = (fec[0] << 8) | fec[1];
+    hdr->offset = fec[13];
+    hdr->na = fec[14];
+
+    hdr->b0_rec = pkt[0] & 0x3F;
+    hdr->m_rec = pkt[1] & 0x80;
+    hdr->pt_rec = fec[4] & 0x7F;
+    hdr->len_rec = (fec[2] << 8) | fec[3];
+    hdr->ts_rec = ((uint32_t)fec[8] << 24) | (fec[9] << 16)
+                  | (fec[10] << 8) | fec[11];
+
+    hdr->payload = FEC_PAYLOAD(pkt);
+    hdr->payload_len = len - RTP_HEADER_SIZE - FEC_HEADER_SIZE;
+
+    /* protected datagrams must fit in the receiver's history */
+    if (hdr->offset == 0 || hdr->na == 0
+        || (size_t)(hdr->na - 1) * hdr->offset >= FEC_MAX_SPAN)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * XOR kernel. GCC vector extensions compile to SSE2/AVX2 or NEON
+ * depending on target flags; unaligned access goes through memcpy().
+ */
+#if defined(__GNUC__)
+#   ifdef __AVX2__
+#       define FEC_VEC_SIZE 32
+#   else
+#       define FEC_VEC_SIZE 16
+#   endif
+typedef uint8_t fec_vec_t __attribute__((vector_size(FEC_VEC_SIZE)));
+#endif /* __GNUC__ */
+
+void fec_xor(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    size_t i = 0;
+
+#ifdef FEC_VEC_SIZE
+    for (; i + FEC_VEC_SIZE <= len; i += FEC_VEC_SIZE)
+    {
+        fec_vec_t a, b;
+        memcpy(&a, &dst[i], sizeof(a));
+        memcpy(&b, &src[i], sizeof(b));
+        a ^= b;
+        memcpy(&dst[i], &a, sizeof(a));
+    }
+#endif /* FEC_VEC_SIZE */
+
+    for (; i < len; i++)
+        dst[i] ^= src[i];
+}
+
+/*
+ * encoder
+ */
+
+typedef struct
+{
+    uint8_t *pkt;
+    size_t plen; /* longest payload so far */
+    unsigned int count;
+    bool broken; /* has a datagram that couldn't be protected */
+
+    uint16_t snbase;
+    uint16_t len_rec;
+    uint8_t b0_rec;
+    uint8_t b1_rec;
+    uint32_t ts_rec;
+} fec_acc_t;
+
+struct fec_encoder_t
+{
+    unsigned int cols;
+    unsigned int rows;
+    size_t mtu;
+
+    fec_send_t cb;
+    void *arg;
+
+    unsigned int pos; /* position in the current matrix */
+    fec_acc_t *col;
+    fec_acc_t row;
+    bool row_fec;
+
+    uint16_t seq[2]; /* FEC stream sequence numbers, column and row */
+};
+
+static
+void acc_init(fec_acc_t *acc, size_t mtu)
+{
+    acc->pkt = ASC_ALLOC(RTP_HEADER_SIZE + FEC_HEADER_SIZE + mtu, uint8_t);
+}
+
+/*
+ * A datagram that doesn't fit still takes up its place in the matrix,
+ * but the groups it belongs to can't be rebuilt and aren't sent.
+ */
+static
+void acc_add(fec_acc_t *acc, const uint8_t *pkt, size_t len, size_t mtu)
+{
+    const bool fits = (len > RTP_HEADER_SIZE
+                       && len - RTP_HEADER_SIZE <= mtu);
+
+    if (acc->count == 0)
+    {
+        memset(FEC_PAYLOAD(acc->pkt), 0, acc->plen);
+
+        acc->plen = 0;
+        acc->broken = false;
+        acc->snbase = (len >= 4) ? ((pkt[2] << 8) | pkt[3]) : 0;
+        acc->len_rec = 0;
+        acc->b0_rec = 0;
+        acc->b1_rec = 0;
+        acc->ts_rec = 0;
+    }
+
+    acc->count++;
+
+    if (!fits)
+    {
+        acc->broken = true;
+        return;
+    }
+
+    const uint8_t *const payload = &pkt[RTP_HEADER_SIZE];
+    const size_t plen = len - RTP_HEADER_SIZE;
+
+    if (plen > acc->plen)
+        acc->plen = plen;
+
+    fec_xor(FEC_PAYLOAD(acc->pkt), payload, plen);
+
+    acc->len_rec ^= plen;
+    acc->b0_rec ^= pkt[0];
+    acc->b1_rec ^= pkt[1];
+    acc->ts_rec ^= ((uint32_t)pkt[4] << 24) | (pkt[5] << 16)
+                   | (pkt[6] << 8) | pkt[7];
+}
+
+static
+void acc_send(fec_encoder_t *enc, fec_acc_t *acc, bool is_row
+              , unsigned int offset)
+{
+    if (acc->broken)
+    {
+        acc->count = 0;
+        return;
+    }
+
+    uint8_t *const pkt = acc->pkt;
+    const uint16_t seq = enc->seq[is_row]++;
+
+    /* RTP header */
+    pkt[0] = 0x80 | (acc->b0_rec & 0x3F);
+    pkt[1] = (acc->b1_rec & 0x80) | RTP_PT_FEC;
+    pkt[2] = seq >> 8;
+    pkt[3] = seq;
+    memset(&pkt[4], 0, 8);
+
+    /* FEC header */
+    uint8_t *const fec = &pkt[RTP_HEADER_SIZE];
+    fec[0] = acc->snbase >> 8;
+    fec[1] = acc->snbase;
+    fec[2] = acc->len_rec >> 8;
+    fec[3] = acc->len_rec;
+    fec[4] = 0x80 | (acc->b1_rec & 0x7F);
+    fec[5] = fec[6] = fec[7] = 0;
+    fec[8] = acc->ts_rec >> 24;
+    fec[9] = acc->ts_rec >> 16;
+    fec[10] = acc->ts_rec >> 8;
+    fec[11] = acc->ts_rec;
+    fec[12] = is_row ? 0x40 : 0x00;
+    fec[13] = offset;
+    fec[14] = acc->count;
+    fec[15] = 0;
+
+    enc->cb(enc->arg, is_row, pkt
+            , RTP_HEADER_SIZE + FEC_HEADER_SIZE + acc->plen);
+
+    acc->count = 0;
+}
+
+fec_encoder_t *fec_encoder_init(unsigned int cols, unsigned int rows
+                                , bool row_fec, size_t mtu
+                                , fec_send_t cb, void *arg)
+{
+    fec_encoder_t *const enc = ASC_ALLOC(1, fec_encoder_t);
+
+    enc->cols = cols;
+    enc->rows = rows;
+    enc->mtu = mtu;
+    enc->cb = cb;
+    enc->arg = arg;
+    enc->row_fec = row_fec;
+
+    enc->col = ASC_ALLOC(cols, fec_acc_t);
+    for (unsigned int i = 0; i < cols; i++)
+        acc_init(&enc->col[i], mtu);
+
+    acc_init(&enc->row, mtu);
+
+    return enc;
+}
+
+void fec_encoder_destroy(fec_encoder_t *enc)
+{
+    for (unsigned int i = 0; i < enc->cols; i++)
+        free(enc->col[i].pkt);
+
+    free(enc->col);
+    free(enc->row.pkt);
+    free(enc);
+}
+
+/* feed an outgoing media datagram, RTP header included */
+void fec_encoder_push(fec_encoder_t *enc, const uint8_t *pkt, size_t len)
+{
+    const unsigned int col = enc->pos % enc->cols;
+
+    if (enc->rows > 1)
+    {
+        fec_acc_t *const acc = &enc->col[col];
+        acc_add(acc, pkt, len, enc->mtu);
+
+        if (acc->count == enc->rows)
+            acc_send(enc, acc, false, enc->cols);
+    }
+
+    if (enc->row_fec)
+    {
+        acc_add(&enc->row, pkt, len, enc->mtu);
+
+        if (col == enc->cols - 1)
+            acc_send(enc, &enc->row, true, 1);
+    }
+
+    if (++enc->pos == enc->cols * enc->rows)
+        enc->pos = 0;
+}
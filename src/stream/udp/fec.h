@@ -0,0 +1,74 @@
+/*
+ * Astra Module: UDP (SMPTE 2022-1 FEC)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _UDP_FEC_H_
+#define _UDP_FEC_H_ 1
+
+#include <astra/astra.h>
+
+/*
+ * Row/column XOR parity over a matrix of L columns by D rows of RTP
+ * datagrams. Column FEC goes to media port + 2, row FEC to port + 4.
+ */
+
+#define FEC_HEADER_SIZE 16
+#define FEC_PORT_COL 2
+#define FEC_PORT_ROW 4
+
+/* matrix limits from the standard */
+#define FEC_MAX_L 20
+#define FEC_MAX_D 20
+#define FEC_MAX_SPAN 100
+
+#define RTP_PT_FEC 96
+
+typedef struct
+{
+    bool is_row;
+    uint16_t snbase;
+    uint8_t offset;
+    uint8_t na;
+
+    /* recovery fields, XOR of the protected datagrams */
+    uint8_t b0_rec; /* P, X and CC bits */
+    uint8_t m_rec;
+    uint8_t pt_rec;
+    uint16_t len_rec;
+    uint32_t ts_rec;
+
+    const uint8_t *payload;
+    size_t payload_len;
+} fec_header_t;
+
+bool fec_parse(const uint8_t *pkt, size_t len, fec_header_t *hdr) __asc_result;
+void fec_xor(uint8_t *dst, const uint8_t *src, size_t len);
+
+/* encoder */
+typedef struct fec_encoder_t fec_encoder_t;
+
+typedef void (*fec_send_t)(void *, bool, const uint8_t *, size_t);
+
+fec_encoder_t *fec_encoder_init(unsigned int cols, unsigned int rows
+                                , bool row_fec, size_t mtu
+                                , fec_send_t cb, void *arg) __asc_result;
+void fec_encoder_destroy(fec_encoder_t *enc);
+void fec_encoder_push(fec_encoder_t *enc, const uint8_t *pkt, size_t len);
+
+#endif /* _UDP_FEC_H_ */
@@ -32,18 +32,72 @@
  *      socket_size - number, socket buffer size
  *      renew       - number, renewing multicast subscription interval in seconds
  *      rtp         - boolean, use RTP instead of RAW UDP
+ *      reorder     - number, RTP reorder window in datagrams; 0 (default)
+ *                    passes datagrams as they come and only counts
+ *                    sequence errors
+ *      reorder_ms  - number, longest time to wait for a missing RTP
+ *                    datagram, milliseconds; window defaults to 64
+ *      fec         - boolean, receive SMPTE 2022-1 column and row FEC on
+ *                    port + 2 and port + 4 and rebuild lost datagrams;
+ *                    requires rtp, window defaults to 256
+ *      batch       - number, maximum datagrams to receive per call
+ *      rx_thread   - boolean, receive on a dedicated thread and pass
+ *                    packets to the main loop through a lock-free ring
+ *      rx_ring     - number, ring depth in packet blocks, default 1024
+ *      busy_poll   - number, SO_BUSY_POLL time in microseconds for the
+ *                    receive thread; keeps a CPU core busy
+ *      cpu         - number, pin receive thread to this CPU core
+ *      timestamps  - boolean, measure inter-arrival time and jitter with
+ *                    kernel receive timestamps (SO_TIMESTAMPNS)
+ *      shared      - boolean, receive through a socket shared by all
+ *                    inputs on the same port; see shared.c
  *
  * Module Methods:
  *      port()      - return number, random port number
+ *      stats()     - return table, receive statistics
+ *
+ * Kernel queue drops (SO_RXQ_OVFL), queue occupancy and, with timestamps
+ * on, inter-arrival jitter are reported by stats(); a growing kernel_drops
+ * counter or queue_max close to rcvbuf means socket_size is too small.
  */
 
 #include <astra/astra.h>
+#include <astra/core/atomic.h>
+#include <astra/core/mainloop.h>
+#include <astra/core/ring.h>
 #include <astra/core/socket.h>
+#include <astra/core/thread.h>
 #include <astra/core/timer.h>
 #include <astra/luaapi/stream.h>
 
+#include "fec.h"
+#include "rtp.h"
+#include "shared.h"
+
 #define UDP_BUFFER_SIZE 1460
-#define RTP_HEADER_SIZE 12
+
+#define UDP_BATCH_DEFAULT 16
+#define UDP_DRAIN_ROUNDS 4
+
+/* receive thread: ring depth in blocks, stop flag check interval */
+#define RX_RING_DEFAULT 1024
+#define RX_TIMEOUT_MS 100
+
+/* maximum blocks delivered per job before yielding to other events */
+#define RX_DRAIN_LIMIT 256
+
+/* RTP reorder window when only reorder_ms is set; upper limit */
+#define RTP_REORDER_DEFAULT 64
+#define RTP_REORDER_MAX 4096
+
+/* default window with FEC: largest matrix plus column FEC delay */
+#define RTP_REORDER_FEC 256
+
+/* minimum interval between receive queue samples, usecs */
+#define NET_SAMPLE_INTERVAL 10000
+
+/* EWMA weight for inter-arrival time and jitter, 1/16 like RFC 3550 */
+#define NET_EWMA_SHIFT 4
 
 #define RTP_IS_EXT(_data) ((_data[0] & 0x10))
 #define RTP_EXT_SIZE(_data) \
@@ -61,14 +115,72 @@ struct module_data_t
         int port;
         const char *localaddr;
         bool rtp;
+        int reorder;
+        int reorder_ms;
+        int batch;
+
+        bool rx_thread;
+        int rx_ring;
+        int busy_poll;
+        int cpu;
+        bool timestamps;
+        bool shared;
+        bool fec;
     } config;
 
     bool is_error_message;
 
     asc_socket_t *sock;
+    asc_socket_t *fec_sock[2]; /* column, row */
+    udp_member_t *member;
+    rtp_reorder_t *rtp;
+    asc_timer_t *timer_rtp;
     asc_timer_t *timer_renew;
 
-    uint8_t buffer[UDP_BUFFER_SIZE];
+    struct
+    {
+        uint64_t wakeups;
+        uint64_t datagrams;
+        unsigned burst_max;
+    } stats;
+
+    uint8_t *buffer;
+    size_t lengths[ASC_SOCKET_BATCH_MAX];
+    asc_socket_rxinfo_t info[ASC_SOCKET_BATCH_MAX];
+
+    /* kernel queue and arrival timing, written by the receiving thread */
+    struct
+    {
+        uint64_t last_sample; /* usecs */
+        uint64_t last_arrival; /* nsecs */
+
+        size_t kernel_drops;
+        size_t queue_bytes;
+        size_t queue_max;
+        size_t rcvbuf;
+
+        size_t iat_avg; /* nsecs */
+        size_t iat_max;
+        size_t jitter;
+    } net;
+
+    /* dedicated receive thread */
+    struct
+    {
+        asc_thread_t *thr;
+        asc_main_loop_t *loop;
+        bool running;
+
+        asc_ring_t *ring;
+        bool drain_pending;
+
+        size_t wakeups;
+        size_t datagrams;
+        size_t pushed;
+        size_t delivered;
+        size_t dropped;
+        size_t depth_max;
+    } rx;
 };
 
 static void on_close(void *arg)
@@ -82,80 +194,632 @@ static void on_close(void *arg)
         mod->sock = NULL;
     }
 
+    for(size_t i = 0; i < ASC_ARRAY_SIZE(mod->fec_sock); i++)
+    {
+        if(mod->fec_sock[i])
+        {
+            asc_socket_multicast_leave(mod->fec_sock[i]);
+            asc_socket_close(mod->fec_sock[i]);
+            mod->fec_sock[i] = NULL;
+        }
+    }
+
+    ASC_FREE(mod->member, udp_shared_leave);
+
+    ASC_FREE(mod->timer_rtp, asc_timer_destroy);
     ASC_FREE(mod->timer_renew, asc_timer_destroy);
 }
 
+/* find TS payload in a datagram; returns packet count */
+static size_t datagram_payload(module_data_t *mod, const uint8_t *buffer
+                               , size_t len, size_t *offset)
+{
+    size_t i = 0;
+
+    if(mod->config.rtp)
+    {
+        i = RTP_HEADER_SIZE;
+        if(RTP_IS_EXT(buffer))
+        {
+            if(len < RTP_HEADER_SIZE + 4)
+                return 0;
+
+            i += RTP_EXT_SIZE(buffer);
+        }
+    }
+
+    const size_t count = (len > i) ? (len - i) / TS_PACKET_SIZE : 0;
+
+    if(i + count * TS_PACKET_SIZE != len && !mod->is_error_message)
+    {
+        const size_t skip = (len > i) ? len - i - count * TS_PACKET_SIZE
+                                      : len;
+
+        asc_log_error(MSG("wrong stream format. drop %zu bytes"), skip);
+        mod->is_error_message = true;
+    }
+
+    *offset = i;
+    return count;
+}
+
+/* sample kernel receive queue, at most once per interval */
+static void net_sample(module_data_t *mod, uint64_t now)
+{
+    if(now - mod->net.last_sample < NET_SAMPLE_INTERVAL)
+        return;
+
+    mod->net.last_sample = now;
+
+    /* shared socket figures cover every group received through it */
+    asc_socket_t *const sock = (mod->member != NULL)
+                               ? udp_shared_socket(mod->member) : mod->sock;
+
+    asc_socket_rxq_t rxq;
+    if(sock == NULL || !asc_socket_rxq(sock, &rxq))
+        return;
+
+    asc_atomic_store_relaxed(&mod->net.queue_bytes, rxq.queued);
+    asc_atomic_store_relaxed(&mod->net.rcvbuf, rxq.rcvbuf);
+
+    if(rxq.queued > mod->net.queue_max)
+        asc_atomic_store_relaxed(&mod->net.queue_max, rxq.queued);
+
+    if(rxq.drops > mod->net.kernel_drops)
+        asc_atomic_store_relaxed(&mod->net.kernel_drops, rxq.drops);
+}
+
+/*
+ * account one datagram. Arrival timing needs kernel timestamps: a batch
+ * of datagrams is picked up in one wakeup, so reading the clock here
+ * would measure batching rather than the network.
+ */
+static void net_arrival(module_data_t *mod, const asc_socket_rxinfo_t *info)
+{
+    if(info->drops > mod->net.kernel_drops)
+        asc_atomic_store_relaxed(&mod->net.kernel_drops, info->drops);
+
+    const uint64_t arrival = info->tstamp;
+    if(!mod->config.timestamps || arrival == 0)
+        return;
+
+    const uint64_t last = mod->net.last_arrival;
+    mod->net.last_arrival = arrival;
+
+    if(last == 0 || arrival < last)
+        return;
+
+    const int64_t iat = arrival - last;
+    const int64_t avg = mod->net.iat_avg;
+    const int64_t jitter = mod->net.jitter;
+    const int64_t dev = (iat > avg) ? iat - avg : avg - iat;
+
+    asc_atomic_store_relaxed(&mod->net.iat_avg
+                             , avg + ((iat - avg) >> NET_EWMA_SHIFT));
+    asc_atomic_store_relaxed(&mod->net.jitter
+                             , jitter + ((dev - jitter) >> NET_EWMA_SHIFT));
+
+    if((uint64_t)iat > mod->net.iat_max)
+        asc_atomic_store_relaxed(&mod->net.iat_max, iat);
+}
+
+static void on_payload(void *arg, const uint8_t *buffer, size_t len)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    size_t offset = 0;
+    const size_t count = datagram_payload(mod, buffer, len, &offset);
+
+    if(count > 0)
+        module_stream_send_batch(mod, &buffer[offset], count);
+}
+
+static void on_datagram(module_data_t *mod, const uint8_t *buffer, size_t len
+                        , uint64_t now)
+{
+    if(mod->rtp != NULL)
+        rtp_reorder_push(mod->rtp, buffer, len, now);
+    else
+        on_payload(mod, buffer, len);
+}
+
 static void on_read(void *arg)
 {
     module_data_t *const mod = (module_data_t *)arg;
 
-    /* TODO: read until it fails with EAGAIN */
-    const ssize_t ret = asc_socket_recv(mod->sock, mod->buffer, UDP_BUFFER_SIZE);
-    if(ret <= 0)
+    const size_t batch = mod->config.batch;
+    unsigned burst = 0;
+
+    const uint64_t now = asc_utime();
+    net_sample(mod, now);
+
+    /* drain socket queue, but give other events a chance on flood */
+    for(unsigned round = 0; round < UDP_DRAIN_ROUNDS; round++)
     {
-        if(ret == 0 || asc_socket_would_block())
+        const ssize_t ret = asc_socket_recv_batch(mod->sock, mod->buffer
+                                                  , UDP_BUFFER_SIZE
+                                                  , mod->lengths, mod->info
+                                                  , batch);
+        if(ret <= 0)
+        {
+            if(ret == 0 || asc_socket_would_block())
+                break;
+
+            asc_log_error(MSG("recv(): %s"), asc_error_msg());
+            on_close(mod);
+
             return;
+        }
 
-        asc_log_error(MSG("recv(): %s"), asc_error_msg());
-        on_close(mod);
+        for(ssize_t i = 0; i < ret; i++)
+        {
+            net_arrival(mod, &mod->info[i]);
+            on_datagram(mod, &mod->buffer[i * UDP_BUFFER_SIZE]
+                        , mod->lengths[i], now);
+        }
 
-        return;
+        burst += ret;
+        if((size_t)ret < batch)
+            break;
     }
 
-    const size_t len = ret;
-    size_t i = 0;
+    mod->stats.wakeups++;
+    mod->stats.datagrams += burst;
+    if(burst > mod->stats.burst_max)
+        mod->stats.burst_max = burst;
+}
 
-    if(mod->config.rtp)
+static void on_recv(void *arg, const void *data, size_t len)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    /* datagram delivered by the event backend, no wakeup accounting */
+    const uint64_t now = asc_utime();
+    net_sample(mod, now);
+
+    mod->stats.datagrams++;
+    on_datagram(mod, (const uint8_t *)data, len, now);
+}
+
+/* FEC packets; same thread as media, so straight to the window */
+static void fec_read(module_data_t *mod, asc_socket_t *sock)
+{
+    uint8_t buffer[UDP_BUFFER_SIZE + FEC_HEADER_SIZE];
+    const uint64_t now = asc_utime();
+
+    for(int i = 0; i < UDP_BATCH_DEFAULT; i++)
     {
-        i = RTP_HEADER_SIZE;
-        if(RTP_IS_EXT(mod->buffer))
+        const ssize_t ret = asc_socket_recv(sock, buffer, sizeof(buffer));
+        if(ret <= 0)
         {
-            if(len < RTP_HEADER_SIZE + 4)
-                return;
+            if(ret < 0 && !asc_socket_would_block())
+                asc_log_error(MSG("FEC recv(): %s"), asc_error_msg());
+
+            break;
+        }
+
+        rtp_reorder_fec(mod->rtp, buffer, ret, now);
+    }
+}
+
+static void on_fec_col_read(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+    fec_read(mod, mod->fec_sock[0]);
+}
+
+static void on_fec_row_read(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+    fec_read(mod, mod->fec_sock[1]);
+}
+
+/* datagram routed to us by the shared receiver */
+static void on_shared(void *arg, const uint8_t *data, size_t len
+                      , const asc_socket_rxinfo_t *info)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    const uint64_t now = asc_utime();
+    net_sample(mod, now);
+    net_arrival(mod, info);
+
+    mod->stats.datagrams++;
+    on_datagram(mod, data, len, now);
+}
+
+/*
+ * dedicated receive thread
+ */
+
+static void rx_on_drain(void *arg);
+
+/* schedule a drain pass on the main loop unless one is pending */
+static void rx_kick(module_data_t *mod)
+{
+    if(!asc_atomic_exchange(&mod->rx.drain_pending, true))
+        asc_job_send(mod->rx.loop, mod, rx_on_drain, mod);
+}
 
-            i += RTP_EXT_SIZE(mod->buffer);
+static void rx_on_drain(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    asc_atomic_store(&mod->rx.drain_pending, false);
+
+    for(unsigned int i = 0; i < RX_DRAIN_LIMIT; i++)
+    {
+        ts_block_t *const block = (ts_block_t *)asc_ring_pop(mod->rx.ring);
+        if(block == NULL)
+            return;
+
+        asc_atomic_fetch_add(&mod->rx.delivered, block->count);
+        module_stream_send_block(mod, block);
+        ts_block_unref(block);
+    }
+
+    /* more to come; let other events on this loop run first */
+    rx_kick(mod);
+}
+
+/* called on the receive thread */
+static void rx_payload(void *arg, const uint8_t *buffer, size_t len)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    size_t offset = 0;
+    size_t count = datagram_payload(mod, buffer, len, &offset);
+    const uint8_t *ts = &buffer[offset];
+
+    while(count > 0)
+    {
+        const size_t n = (count > TS_BLOCK_PACKETS)
+                         ? TS_BLOCK_PACKETS : count;
+
+        ts_block_t *const block = ts_block_copy(ts, n);
+        if(asc_ring_push(mod->rx.ring, block))
+        {
+            asc_atomic_fetch_add(&mod->rx.pushed, n);
+        }
+        else
+        {
+            /* never stall the socket; main loop is behind */
+            asc_atomic_fetch_add(&mod->rx.dropped, n);
+            module_stream_drop(mod, n);
+            ts_block_unref(block);
         }
+
+        ts += n * TS_PACKET_SIZE;
+        count -= n;
     }
+}
 
-    for(; i + TS_PACKET_SIZE <= len; i += TS_PACKET_SIZE)
-        module_stream_send(mod, &mod->buffer[i]);
+static void rx_datagram(module_data_t *mod, const uint8_t *buffer, size_t len
+                        , uint64_t now)
+{
+    if(mod->rtp != NULL)
+        rtp_reorder_push(mod->rtp, buffer, len, now);
+    else
+        rx_payload(mod, buffer, len);
+}
+
+static bool rx_timed_out(void)
+{
+#ifdef _WIN32
+    if(WSAGetLastError() == WSAETIMEDOUT)
+        return true;
+#else
+    if(errno == EINTR)
+        return true;
+#endif
+
+    return asc_socket_would_block();
+}
+
+static void rx_thread_proc(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
 
-    if(i != len && !mod->is_error_message)
+    if(mod->config.cpu >= 0 && !asc_thread_set_affinity(mod->config.cpu))
     {
-        asc_log_error(MSG("wrong stream format. drop %zu bytes"), len - i);
-        mod->is_error_message = true;
+        asc_log_warning(MSG("couldn't pin receive thread to cpu %d")
+                        , mod->config.cpu);
+    }
+
+    const size_t batch = mod->config.batch;
+
+    while(asc_atomic_load(&mod->rx.running))
+    {
+        /*
+         * wait for the first datagram, then take whatever else is queued;
+         * socket timeout lets us check the stop flag
+         */
+        const ssize_t ret = asc_socket_recv_batch(mod->sock, mod->buffer
+                                                  , UDP_BUFFER_SIZE
+                                                  , mod->lengths, mod->info
+                                                  , batch);
+        if(ret <= 0)
+        {
+            if(ret == 0 || rx_timed_out())
+            {
+                /* input stopped; don't sit on held datagrams */
+                if(mod->rtp != NULL)
+                {
+                    rtp_reorder_poll(mod->rtp, asc_utime());
+                    if(asc_ring_count(mod->rx.ring) > 0)
+                        rx_kick(mod);
+                }
+
+                continue;
+            }
+
+            asc_log_error(MSG("recv(): %s"), asc_error_msg());
+            break;
+        }
+
+        const uint64_t now = asc_utime();
+        net_sample(mod, now);
+
+        for(ssize_t i = 0; i < ret; i++)
+        {
+            net_arrival(mod, &mod->info[i]);
+            rx_datagram(mod, &mod->buffer[i * UDP_BUFFER_SIZE]
+                        , mod->lengths[i], now);
+        }
+
+        const size_t burst = ret;
+
+        asc_atomic_store_relaxed(&mod->rx.wakeups, mod->rx.wakeups + 1);
+        asc_atomic_store_relaxed(&mod->rx.datagrams
+                                 , mod->rx.datagrams + burst);
+
+        if(burst > mod->stats.burst_max)
+            asc_atomic_store_relaxed(&mod->stats.burst_max, burst);
+
+        const size_t depth = asc_ring_count(mod->rx.ring);
+        if(depth > mod->rx.depth_max)
+            asc_atomic_store_relaxed(&mod->rx.depth_max, depth);
+
+        rx_kick(mod);
+    }
+}
+
+static void rx_stop(module_data_t *mod)
+{
+    if(mod->rx.thr == NULL)
+        return;
+
+    asc_atomic_store(&mod->rx.running, false);
+    ASC_FREE(mod->rx.thr, asc_thread_join);
+    asc_wake_close();
+}
+
+/* receive thread quit on its own, i.e. on socket error */
+static void rx_on_close(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    rx_stop(mod);
+    on_close(mod);
+}
+
+static void rx_start(lua_State *L, module_data_t *mod)
+{
+    mod->config.rx_ring = RX_RING_DEFAULT;
+    module_option_integer(L, "rx_ring", &mod->config.rx_ring);
+    if(mod->config.rx_ring < 2)
+        luaL_error(L, MSG("option 'rx_ring' must be at least 2 blocks"));
+
+    /* thread blocks in recv() instead of polling the event loop */
+    int timeout = RX_TIMEOUT_MS;
+    if(mod->config.reorder_ms > 0 && mod->config.reorder_ms < timeout)
+        timeout = mod->config.reorder_ms;
+
+    asc_socket_set_nonblock(mod->sock, false);
+    asc_socket_set_timeout(mod->sock, timeout, 0);
+
+    if(mod->config.busy_poll > 0
+       && !asc_socket_set_busy_poll(mod->sock, mod->config.busy_poll))
+    {
+        asc_log_warning(MSG("busy polling is not available"));
     }
+
+    mod->rx.ring = asc_ring_init(mod->config.rx_ring);
+    mod->rx.loop = module_loop(mod);
+    mod->rx.running = true;
+
+    asc_wake_open();
+    mod->rx.thr = asc_thread_init(mod, rx_thread_proc, rx_on_close);
 }
 
 static void timer_renew_callback(void *arg)
 {
     module_data_t *const mod = (module_data_t *)arg;
-    asc_socket_multicast_renew(mod->sock);
+
+    if(mod->member != NULL)
+        udp_shared_renew(mod->member);
+    else if(mod->sock != NULL)
+        asc_socket_multicast_renew(mod->sock);
+}
+
+/* release held RTP datagrams when input stops; main loop receive only */
+static void timer_rtp_callback(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+    rtp_reorder_poll(mod->rtp, asc_utime());
 }
 
 static int method_port(lua_State *L, module_data_t *mod)
 {
-    const int port = asc_socket_port(mod->sock);
+    const int port = (mod->sock != NULL)
+                     ? asc_socket_port(mod->sock) : mod->config.port;
     lua_pushinteger(L, port);
 
     return 1;
 }
 
-static void module_init(lua_State *L, module_data_t *mod)
+static void push_ring_stats(lua_State *L, module_data_t *mod)
 {
-    module_stream_init(L, mod, NULL);
-    module_demux_set(mod, NULL, NULL);
+    lua_pushinteger(L, asc_ring_count(mod->rx.ring));
+    lua_setfield(L, -2, "ring_depth");
 
-    module_option_string(L, "addr", &mod->config.addr, NULL);
-    if(mod->config.addr == NULL)
-        luaL_error(L, "[udp_input] option 'addr' is required");
+    lua_pushinteger(L, asc_atomic_load_relaxed(&mod->rx.depth_max));
+    lua_setfield(L, -2, "ring_depth_max");
 
-    module_option_integer(L, "port", &mod->config.port);
+    lua_pushinteger(L, asc_ring_size(mod->rx.ring));
+    lua_setfield(L, -2, "ring_size");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->rx.pushed));
+    lua_setfield(L, -2, "ring_pushed");
 
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->rx.delivered));
+    lua_setfield(L, -2, "ring_delivered");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->rx.dropped));
+    lua_setfield(L, -2, "ring_dropped");
+}
+
+static void push_rtp_stats(lua_State *L, module_data_t *mod)
+{
+    rtp_stats_t st;
+    rtp_reorder_stats(mod->rtp, &st);
+
+    lua_pushinteger(L, mod->config.reorder);
+    lua_setfield(L, -2, "rtp_reorder");
+
+    lua_pushnumber(L, st.received);
+    lua_setfield(L, -2, "rtp_received");
+
+    lua_pushnumber(L, st.lost);
+    lua_setfield(L, -2, "rtp_lost");
+
+    lua_pushnumber(L, st.reordered);
+    lua_setfield(L, -2, "rtp_reordered");
+
+    lua_pushnumber(L, st.duplicate);
+    lua_setfield(L, -2, "rtp_duplicate");
+
+    lua_pushnumber(L, st.late);
+    lua_setfield(L, -2, "rtp_late");
+
+    lua_pushnumber(L, st.resync);
+    lua_setfield(L, -2, "rtp_resync");
+
+    lua_pushnumber(L, st.stray);
+    lua_setfield(L, -2, "rtp_stray");
+
+    lua_pushinteger(L, st.pending);
+    lua_setfield(L, -2, "rtp_pending");
+
+    if(mod->config.fec)
+    {
+        lua_pushnumber(L, st.fec);
+        lua_setfield(L, -2, "fec_received");
+
+        lua_pushnumber(L, st.recovered);
+        lua_setfield(L, -2, "fec_recovered");
+
+        lua_pushnumber(L, st.unrecoverable);
+        lua_setfield(L, -2, "fec_unrecoverable");
+    }
+}
+
+static int method_stats(lua_State *L, module_data_t *mod)
+{
+    lua_newtable(L);
+
+    if(mod->rtp != NULL)
+        push_rtp_stats(L, mod);
+
+    uint64_t wakeups = mod->stats.wakeups;
+    uint64_t datagrams = mod->stats.datagrams;
+
+    if(mod->rx.ring != NULL)
+    {
+        wakeups = asc_atomic_load_relaxed(&mod->rx.wakeups);
+        datagrams = asc_atomic_load_relaxed(&mod->rx.datagrams);
+        push_ring_stats(L, mod);
+    }
+
+    lua_pushboolean(L, (mod->rx.ring != NULL));
+    lua_setfield(L, -2, "rx_thread");
+
+    lua_pushboolean(L, mod->config.shared);
+    lua_setfield(L, -2, "shared");
+
+    lua_pushnumber(L, wakeups);
+    lua_setfield(L, -2, "wakeups");
+
+    lua_pushnumber(L, datagrams);
+    lua_setfield(L, -2, "datagrams");
+
+    const double per_wakeup = (wakeups > 0)
+        ? (double)datagrams / wakeups : 0.0;
+    lua_pushnumber(L, per_wakeup);
+    lua_setfield(L, -2, "per_wakeup");
+
+    lua_pushinteger(L, asc_atomic_load_relaxed(&mod->stats.burst_max));
+    lua_setfield(L, -2, "burst_max");
+
+    lua_pushinteger(L, mod->config.batch);
+    lua_setfield(L, -2, "batch");
+
+    /* kernel side */
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->net.kernel_drops));
+    lua_setfield(L, -2, "kernel_drops");
+
+    lua_pushinteger(L, asc_atomic_load_relaxed(&mod->net.queue_bytes));
+    lua_setfield(L, -2, "queue_bytes");
+
+    lua_pushinteger(L, asc_atomic_load_relaxed(&mod->net.queue_max));
+    lua_setfield(L, -2, "queue_max");
+
+    lua_pushinteger(L, asc_atomic_load_relaxed(&mod->net.rcvbuf));
+    lua_setfield(L, -2, "rcvbuf");
+
+    /* arrival timing, microseconds; only with kernel timestamps */
+    lua_pushboolean(L, mod->config.timestamps);
+    lua_setfield(L, -2, "timestamps");
+
+    if(!mod->config.timestamps)
+        return 1;
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->net.iat_avg) / 1000.0);
+    lua_setfield(L, -2, "iat_avg");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->net.iat_max) / 1000.0);
+    lua_setfield(L, -2, "iat_max");
+
+    lua_pushnumber(L, asc_atomic_load_relaxed(&mod->net.jitter) / 1000.0);
+    lua_setfield(L, -2, "jitter");
+
+    return 1;
+}
+
+static void shared_start(lua_State *L, module_data_t *mod)
+{
+    if(mod->config.rx_thread)
+        luaL_error(L, MSG("options 'shared' and 'rx_thread' are mutually exclusive"));
+
+    if(mod->config.timestamps)
+    {
+        asc_log_warning(MSG("kernel timestamps are not available on shared sockets"));
+        mod->config.timestamps = false;
+    }
+
+    int socket_size = 0;
+    module_option_integer(L, "socket_size", &socket_size);
+
+    mod->member = udp_shared_join(mod->config.addr, mod->config.port
+                                  , mod->config.localaddr, socket_size
+                                  , on_shared, mod);
+}
+
+static void socket_start(lua_State *L, module_data_t *mod)
+{
     mod->sock = asc_socket_open_udp4(mod);
     asc_socket_set_reuseaddr(mod->sock, 1);
 
-    module_option_string(L, "localaddr", &mod->config.localaddr, NULL);
 #if defined(_WIN32) || defined(__CYGWIN__)
     if(!asc_socket_bind(mod->sock, mod->config.localaddr, mod->config.port))
 #else
@@ -167,25 +831,189 @@ static void module_init(lua_State *L, module_data_t *mod)
     if(module_option_integer(L, "socket_size", &value))
         asc_socket_set_buffer(mod->sock, value, 0);
 
-    module_option_boolean(L, "rtp", &mod->config.rtp);
+    mod->buffer = ASC_ALLOC(mod->config.batch * UDP_BUFFER_SIZE, uint8_t);
+
+    /* drop counter is cheap; timestamps are opt-in */
+    if(!asc_socket_set_rxq_ovfl(mod->sock))
+        asc_log_debug(MSG("kernel drop counter is not available"));
 
-    asc_socket_set_on_read(mod->sock, on_read);
-    asc_socket_set_on_close(mod->sock, on_close);
+    if(mod->config.timestamps && !asc_socket_set_timestamps(mod->sock))
+    {
+        asc_log_warning(MSG("kernel timestamps are not available"));
+        mod->config.timestamps = false;
+    }
 
     asc_socket_multicast_join(mod->sock, mod->config.addr, mod->config.localaddr);
+
+    if(mod->config.rx_thread)
+    {
+        rx_start(L, mod);
+    }
+    else
+    {
+        /* prefer completion based receive when event backend has it */
+        if(!asc_socket_set_on_recv(mod->sock, on_recv))
+            asc_socket_set_on_read(mod->sock, on_read);
+
+        asc_socket_set_on_close(mod->sock, on_close);
+    }
+}
+
+static void fec_start(lua_State *L, module_data_t *mod)
+{
+    static const int offset[] = { FEC_PORT_COL, FEC_PORT_ROW };
+    static const event_callback_t on_read[] = { on_fec_col_read
+                                              , on_fec_row_read };
+
+    int socket_size = 0;
+    module_option_integer(L, "socket_size", &socket_size);
+
+    for(size_t i = 0; i < ASC_ARRAY_SIZE(mod->fec_sock); i++)
+    {
+        const int port = mod->config.port + offset[i];
+        asc_socket_t *const sock = asc_socket_open_udp4(mod);
+        asc_socket_set_reuseaddr(sock, 1);
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+        if(!asc_socket_bind(sock, mod->config.localaddr, port))
+#else
+        if(!asc_socket_bind(sock, mod->config.addr, port))
+#endif
+        {
+            asc_socket_close(sock);
+            continue;
+        }
+
+        if(socket_size > 0)
+            asc_socket_set_buffer(sock, socket_size, 0);
+
+        asc_socket_multicast_join(sock, mod->config.addr, mod->config.localaddr);
+        asc_socket_set_on_read(sock, on_read[i]);
+
+        mod->fec_sock[i] = sock;
+    }
+}
+
+static void module_init(lua_State *L, module_data_t *mod)
+{
+    module_stream_init(L, mod, NULL);
+    module_demux_set(mod, NULL, NULL);
+
+    module_option_string(L, "addr", &mod->config.addr, NULL);
+    if(mod->config.addr == NULL)
+        luaL_error(L, "[udp_input] option 'addr' is required");
+
+    module_option_integer(L, "port", &mod->config.port);
+    module_option_string(L, "localaddr", &mod->config.localaddr, NULL);
+    module_option_boolean(L, "rtp", &mod->config.rtp);
+    module_option_integer(L, "reorder", &mod->config.reorder);
+    module_option_integer(L, "reorder_ms", &mod->config.reorder_ms);
+
+    if(!mod->config.rtp
+       && (mod->config.reorder > 0 || mod->config.reorder_ms > 0))
+    {
+        luaL_error(L, MSG("options 'reorder' and 'reorder_ms' require 'rtp'"));
+    }
+
+    module_option_boolean(L, "fec", &mod->config.fec);
+    if(mod->config.fec && !mod->config.rtp)
+        luaL_error(L, MSG("option 'fec' requires 'rtp'"));
+
+    if(mod->config.fec && mod->config.reorder == 0)
+        mod->config.reorder = RTP_REORDER_FEC;
+    else if(mod->config.reorder_ms > 0 && mod->config.reorder == 0)
+        mod->config.reorder = RTP_REORDER_DEFAULT;
+
+    if(mod->config.reorder < 0 || mod->config.reorder > RTP_REORDER_MAX)
+    {
+        luaL_error(L, MSG("option 'reorder' must be between 0 and %d")
+                   , RTP_REORDER_MAX);
+    }
+
+    mod->config.batch = UDP_BATCH_DEFAULT;
+    module_option_integer(L, "batch", &mod->config.batch);
+    if(mod->config.batch < 1 || mod->config.batch > ASC_SOCKET_BATCH_MAX)
+    {
+        luaL_error(L, MSG("option 'batch' must be between 1 and %d")
+                   , ASC_SOCKET_BATCH_MAX);
+    }
+
+    module_option_boolean(L, "rx_thread", &mod->config.rx_thread);
+    module_option_integer(L, "busy_poll", &mod->config.busy_poll);
+
+    mod->config.cpu = -1;
+    module_option_integer(L, "cpu", &mod->config.cpu);
+
+    if(!mod->config.rx_thread
+       && (mod->config.busy_poll > 0 || mod->config.cpu >= 0))
+    {
+        luaL_error(L, MSG("options 'busy_poll' and 'cpu' require 'rx_thread'"));
+    }
+
+    module_option_boolean(L, "timestamps", &mod->config.timestamps);
+    module_option_boolean(L, "shared", &mod->config.shared);
+
+    /* FEC sockets are served by the main loop only */
+    if(mod->config.fec && (mod->config.rx_thread || mod->config.shared))
+        luaL_error(L, MSG("option 'fec' can't be used with 'rx_thread' or 'shared'"));
+
+    if(mod->config.rtp)
+    {
+        /* runs on whichever thread receives */
+        const rtp_deliver_t cb = mod->config.rx_thread ? rx_payload : on_payload;
+        mod->rtp = rtp_reorder_init(mod->config.reorder
+                                    , mod->config.reorder_ms * 1000ULL
+                                    , UDP_BUFFER_SIZE, mod->config.fec
+                                    , cb, mod);
+    }
+
+    if(mod->config.shared)
+        shared_start(L, mod);
+    else
+        socket_start(L, mod);
+
+    if(mod->config.fec && mod->sock != NULL)
+        fec_start(L, mod);
+
+    /* receive thread checks held datagrams on its own */
+    if(mod->rtp != NULL && mod->config.reorder_ms > 0 && mod->rx.thr == NULL)
+    {
+        const unsigned int interval = (mod->config.reorder_ms > 1)
+                                      ? mod->config.reorder_ms / 2 : 1;
+        mod->timer_rtp = asc_timer_init(interval, timer_rtp_callback, mod);
+    }
+
+    int value;
     if(module_option_integer(L, "renew", &value))
         mod->timer_renew = asc_timer_init(value * 1000, timer_renew_callback, mod);
 }
 
 static void module_destroy(module_data_t *mod)
 {
+    /* no new blocks after this; discard pending deliveries */
+    rx_stop(mod);
+    asc_job_prune(mod);
+
     module_stream_destroy(mod);
     on_close(mod);
+
+    if(mod->rx.ring != NULL)
+    {
+        ts_block_t *block;
+        while((block = (ts_block_t *)asc_ring_pop(mod->rx.ring)) != NULL)
+            ts_block_unref(block);
+
+        ASC_FREE(mod->rx.ring, asc_ring_destroy);
+    }
+
+    ASC_FREE(mod->rtp, rtp_reorder_destroy);
+    ASC_FREE(mod->buffer, free);
 }
 
 static const module_method_t module_methods[] =
 {
     { "port", method_port },
+    { "stats", method_stats },
     { NULL, NULL },
 };
 
@@ -34,20 +34,66 @@
  *      socket_size - number, socket buffer size
  *      rtp         - boolean, use RTP instead of RAW UDP
  *      sync        - boolean, use MPEG-TS syncing
- *      sync_opts   - string, sync buffer options
+ *      sync_opts   - string, sync buffer options; "auto" prefix for
+ *                    adaptive fill thresholds
+ *      sync_thread - boolean, pace synced output on a dedicated real-time
+ *                    thread instead of the main loop timer
+ *      sync_cpu    - number, pin pacing thread to this CPU core
+ *      txtime      - boolean, stamp datagrams with their PCR-derived send
+ *                    time (SO_TXTIME) and let the etf/fq qdisc pace them;
+ *                    requires sync
+ *      txtime_lead - number, milliseconds to hand datagrams to the kernel
+ *                    ahead of their send time
+ *      txtime_tai  - boolean, launch times in CLOCK_TAI, as etf expects;
+ *                    default is CLOCK_MONOTONIC for fq
+ *      pacing      - boolean, cap socket rate at the measured bitrate
+ *                    (SO_MAX_PACING_RATE, needs fq); used as a fallback
+ *                    when txtime is unavailable
+ *      batch       - number, datagrams to accumulate before sending
+ *      batch_ms    - number, maximum time to hold accumulated datagrams
+ *      gso         - boolean, use UDP segmentation offload if available
+ *      fec         - string, "LxD": send SMPTE 2022-1 column FEC for a
+ *                    matrix of L columns by D rows to port + 2; requires rtp.
+ *                    With txtime, FEC leaves with the last datagram it covers
+ *      fec_row     - boolean, also send row FEC to port + 4; always on
+ *                    when D is 1
+ *
+ * Module Methods:
+ *      stats()     - return table, sync buffer, pacing and launch time
+ *                    statistics
  */
 
 #include <astra/astra.h>
+#include <astra/core/atomic.h>
 #include <astra/core/socket.h>
 #include <astra/core/timer.h>
 #include <astra/luaapi/stream.h>
 #include <astra/mpegts/sync.h>
 
+#include "fec.h"
+
 #define MSG(_msg) "[udp_output %s:%d] " _msg, mod->addr, mod->port
 
-#define UDP_BUFFER_SIZE 1460
+#define UDP_TS_COUNT 7 /* 1316 bytes, fits into ethernet MTU */
+#define RTP_HEADER_SIZE 12
 #define RTP_PT_MP2T 33 /* RFC2250 */
 
+#define UDP_BATCH_MS_DEFAULT 5
+
+/* pacing thread: minimum interval between drop reports, usecs */
+#define PACE_REPORT_INTERVAL (1 * 1000 * 1000)
+
+/* launch time mode: default lead; pacing rate: timer and update interval */
+#define TXTIME_LEAD_DEFAULT 20
+#define PACING_TIMER_MS 100
+#define PACING_INTERVAL (1 * 1000 * 1000)
+
+/* IPv4 and UDP headers, counted towards the pacing rate */
+#define UDP_OVERHEAD 28
+
+/* pacing rate headroom over the measured bitrate, percent */
+#define PACING_HEADROOM 105
+
 struct module_data_t
 {
     STREAM_MODULE_DATA();
@@ -57,6 +103,7 @@ struct module_data_t
 
     bool is_rtp;
     uint16_t rtpseq;
+    uint8_t rtp_header[RTP_HEADER_SIZE];
 
     asc_socket_t *sock;
     bool can_send;
@@ -64,12 +111,35 @@ struct module_data_t
 
     struct
     {
-        uint32_t skip;
-        uint8_t buffer[UDP_BUFFER_SIZE];
+        uint8_t *buffer;
+        size_t size; /* datagram size */
+        size_t skip; /* write position in current datagram */
+        size_t pending; /* complete datagrams waiting to be sent */
+        size_t batch;
     } packet;
 
+    asc_timer_t *flush_timer;
+
+    fec_encoder_t *fec;
+    asc_socket_t *fec_sock[2]; /* column, row */
+    uint64_t fec_launch; /* launch time of the last protected datagram */
+
     ts_sync_t *sync;
     asc_timer_t *sync_loop;
+    bool is_paced;
+    uint64_t last_report;
+
+    /* kernel pacing */
+    bool is_txtime;
+    uint64_t *txtime; /* launch time of each pending datagram */
+    asc_socket_txerr_t txerr;
+
+    bool is_pacing;
+    uint64_t pacing_rate;
+    size_t tx_bytes;
+    uint64_t last_pacing;
+
+    asc_timer_t *tx_timer;
 };
 
 static void on_ready(void *arg)
@@ -97,55 +167,342 @@ static void on_sync_ts(module_data_t *mod, const uint8_t *ts)
     }
 }
 
+static void on_sync_batch(module_data_t *mod, const uint8_t *ts, size_t count)
+{
+    const bool ret = ts_sync_push(mod->sync, ts, count);
+
+    if (!ret)
+    {
+        asc_log_error(MSG("sync push failed, resetting buffer"));
+        ts_sync_reset(mod->sync);
+    }
+}
+
+static void flush_batch(module_data_t *mod)
+{
+    const size_t pending = mod->packet.pending;
+    if(pending == 0)
+        return;
+
+    mod->packet.pending = 0;
+
+    ssize_t ret;
+    if(mod->is_txtime)
+    {
+        ret = asc_socket_sendto_txtime(mod->sock, mod->packet.buffer
+                                       , mod->packet.size, pending
+                                       , mod->txtime);
+    }
+    else
+    {
+        ret = asc_socket_sendto_batch(mod->sock, mod->packet.buffer
+                                      , mod->packet.size, pending);
+    }
+
+    /*
+     * FEC goes out after the media it protects. Datagrams the socket
+     * didn't take still used up their sequence numbers, so they're fed
+     * to the encoder as well.
+     */
+    if(mod->fec != NULL)
+    {
+        for(size_t i = 0; i < pending; i++)
+        {
+            if(mod->is_txtime)
+                mod->fec_launch = mod->txtime[i];
+
+            fec_encoder_push(mod->fec
+                             , &mod->packet.buffer[i * mod->packet.size]
+                             , mod->packet.size);
+        }
+    }
+
+    if(ret == -1 && !asc_socket_would_block())
+    {
+        asc_log_warning(MSG("sendto(): %s"), asc_error_msg());
+        return;
+    }
+
+    const size_t sent = (ret > 0) ? ret : 0;
+    if(mod->is_pacing)
+    {
+        const size_t bytes = sent * (mod->packet.size + UDP_OVERHEAD);
+        asc_atomic_fetch_add(&mod->tx_bytes, bytes);
+    }
+
+    if(sent < pending && mod->is_paced)
+    {
+        /* pacing thread: never wait for the socket, just count */
+        const size_t dropped = (pending - sent) * UDP_TS_COUNT;
+        asc_atomic_fetch_add(&mod->dropped, dropped);
+
+        const uint64_t now = asc_utime();
+        if(now - mod->last_report >= PACE_REPORT_INTERVAL)
+        {
+            asc_log_error(MSG("socket buffer full, dropped %zu packets")
+                          , asc_atomic_exchange(&mod->dropped, 0));
+            mod->last_report = now;
+        }
+    }
+    else if(sent < pending)
+    {
+        mod->dropped += (pending - sent) * UDP_TS_COUNT;
+        module_stream_drop(mod, (pending - sent) * UDP_TS_COUNT);
+        mod->can_send = false;
+        asc_socket_set_on_ready(mod->sock, on_ready);
+    }
+}
+
+static void on_fec(void *arg, bool is_row, const uint8_t *pkt, size_t len)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    /* don't let FEC leave before the media it protects */
+    asc_socket_t *const sock = mod->fec_sock[is_row];
+    ssize_t ret;
+    if(mod->is_txtime)
+        ret = asc_socket_sendto_txtime(sock, pkt, len, 1, &mod->fec_launch);
+    else
+        ret = asc_socket_sendto(sock, pkt, len);
+
+    /* FEC is best effort; media keeps priority on a full socket */
+    if(ret == -1 && !asc_socket_would_block())
+        asc_log_warning(MSG("FEC sendto(): %s"), asc_error_msg());
+}
+
+/* SO_TXTIME reports missed deadlines on the error queue */
+static void on_error(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    /* socket stays signalled until the queue is drained */
+    asc_socket_txtime_errors(mod->sock, &mod->txerr);
+}
+
+/* FEC sockets count their missed deadlines along with media */
+static void on_fec_error(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    for(size_t i = 0; i < ASC_ARRAY_SIZE(mod->fec_sock); i++)
+        asc_socket_txtime_errors(mod->fec_sock[i], &mod->txerr);
+}
+
+/* follow the stream bitrate with the pacing rate */
+static void on_tx_timer(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    const uint64_t now = asc_utime();
+    const uint64_t elapsed = now - mod->last_pacing;
+    if(elapsed < PACING_INTERVAL)
+        return;
+
+    const size_t bytes = asc_atomic_exchange(&mod->tx_bytes, 0);
+    mod->last_pacing = now;
+
+    if(bytes == 0)
+        return;
+
+    const uint64_t rate = ((bytes * 1000000ULL) / elapsed)
+                          * PACING_HEADROOM / 100;
+
+    if(asc_socket_set_pacing_rate(mod->sock, rate))
+        mod->pacing_rate = rate;
+}
+
+static void on_flush_timer(void *arg)
+{
+    module_data_t *const mod = (module_data_t *)arg;
+
+    if(mod->can_send)
+        flush_batch(mod);
+}
+
 static void on_output_ts(module_data_t *mod, const uint8_t *ts)
 {
     if(!mod->can_send)
     {
         mod->dropped++;
+        module_stream_drop(mod, 1);
         return;
     }
 
+    uint8_t *const dgram =
+        &mod->packet.buffer[mod->packet.pending * mod->packet.size];
+
+    if(mod->is_txtime && mod->packet.skip == 0)
+        mod->txtime[mod->packet.pending] = ts_sync_due(mod->sync);
+
     if(mod->is_rtp && mod->packet.skip == 0)
     {
         struct timeval tv;
         gettimeofday(&tv, NULL);
         const uint64_t msec = ((tv.tv_sec % 1000000) * 1000) + (tv.tv_usec / 1000);
 
-        mod->packet.buffer[2] = (mod->rtpseq >> 8) & 0xFF;
-        mod->packet.buffer[3] = (mod->rtpseq     ) & 0xFF;
+        memcpy(dgram, mod->rtp_header, RTP_HEADER_SIZE);
+
+        dgram[2] = (mod->rtpseq >> 8) & 0xFF;
+        dgram[3] = (mod->rtpseq     ) & 0xFF;
 
-        mod->packet.buffer[4] = (msec >> 24) & 0xFF;
-        mod->packet.buffer[5] = (msec >> 16) & 0xFF;
-        mod->packet.buffer[6] = (msec >>  8) & 0xFF;
-        mod->packet.buffer[7] = (msec      ) & 0xFF;
+        dgram[4] = (msec >> 24) & 0xFF;
+        dgram[5] = (msec >> 16) & 0xFF;
+        dgram[6] = (msec >>  8) & 0xFF;
+        dgram[7] = (msec      ) & 0xFF;
 
         ++mod->rtpseq;
 
-        mod->packet.skip += 12;
+        mod->packet.skip += RTP_HEADER_SIZE;
     }
 
-    memcpy(&mod->packet.buffer[mod->packet.skip], ts, TS_PACKET_SIZE);
+    memcpy(&dgram[mod->packet.skip], ts, TS_PACKET_SIZE);
     mod->packet.skip += TS_PACKET_SIZE;
 
-    if(mod->packet.skip > UDP_BUFFER_SIZE - TS_PACKET_SIZE)
+    if(mod->packet.skip >= mod->packet.size)
     {
-        const ssize_t ret = asc_socket_sendto(mod->sock
-                                              , mod->packet.buffer
-                                              , mod->packet.skip);
+        mod->packet.skip = 0;
+        if(++mod->packet.pending >= mod->packet.batch)
+            flush_batch(mod);
+    }
+}
 
-        if(ret == -1)
-        {
-            if(asc_socket_would_block())
-            {
-                mod->can_send = false;
-                asc_socket_set_on_ready(mod->sock, on_ready);
-            }
-            else
-                asc_log_warning(MSG("sendto(): %s"), asc_error_msg());
-        }
+static void on_output_batch(module_data_t *mod, const uint8_t *ts, size_t count)
+{
+    if(!mod->can_send)
+    {
+        mod->dropped += count;
+        module_stream_drop(mod, count);
+        return;
+    }
 
-        mod->packet.skip = 0;
+    for(size_t i = 0; i < count; i++)
+        on_output_ts(mod, &ts[i * TS_PACKET_SIZE]);
+}
+
+static void fec_init(lua_State *L, module_data_t *mod, const char *localaddr
+                     , int ttl)
+{
+    const char *optstr = NULL;
+    module_option_string(L, "fec", &optstr, NULL);
+    if(optstr == NULL)
+        return;
+
+    if(!mod->is_rtp)
+        luaL_error(L, MSG("option 'fec' requires 'rtp'"));
+
+    unsigned int cols = 0, rows = 0;
+    if(sscanf(optstr, "%ux%u", &cols, &rows) != 2
+       || cols < 1 || cols > FEC_MAX_L || rows < 1 || rows > FEC_MAX_D
+       || cols * rows > FEC_MAX_SPAN)
+    {
+        luaL_error(L, MSG("option 'fec' must be LxD, L and D up to %d"
+                          " and L*D up to %d")
+                   , FEC_MAX_L, FEC_MAX_SPAN);
+    }
+
+    bool row_fec = (rows == 1);
+    module_option_boolean(L, "fec_row", &row_fec);
+    if(rows == 1 && !row_fec)
+        luaL_error(L, MSG("option 'fec' with one row needs 'fec_row'"));
+
+    static const int offset[] = { FEC_PORT_COL, FEC_PORT_ROW };
+    for(size_t i = 0; i < ASC_ARRAY_SIZE(mod->fec_sock); i++)
+    {
+        asc_socket_t *const sock = asc_socket_open_udp4(mod);
+        mod->fec_sock[i] = sock;
+
+        asc_socket_set_reuseaddr(sock, 1);
+        if(!asc_socket_bind(sock, NULL, 0))
+            luaL_error(L, MSG("couldn't bind FEC socket"));
+
+        if(localaddr)
+            asc_socket_set_multicast_if(sock, localaddr);
+
+        asc_socket_set_multicast_ttl(sock, ttl);
+        asc_socket_set_sockaddr(sock, mod->addr, mod->port + offset[i]);
+    }
+
+    mod->fec = fec_encoder_init(cols, rows, row_fec
+                                , mod->packet.size - RTP_HEADER_SIZE
+                                , on_fec, mod);
+}
+
+static int method_stats(lua_State *L, module_data_t *mod)
+{
+    lua_newtable(L);
+
+    lua_pushboolean(L, (mod->sync != NULL));
+    lua_setfield(L, -2, "sync");
+
+    /* bits per second, 0 until the first update */
+    lua_pushnumber(L, mod->pacing_rate * 8);
+    lua_setfield(L, -2, "pacing_rate");
+
+    if(mod->sync == NULL)
+        return 1;
+
+    ts_sync_stat_t st;
+    ts_sync_query(mod->sync, &st);
+
+    lua_pushboolean(L, st.paced);
+    lua_setfield(L, -2, "sync_thread");
+
+    lua_pushnumber(L, st.bitrate);
+    lua_setfield(L, -2, "bitrate");
+
+    lua_pushinteger(L, st.filled);
+    lua_setfield(L, -2, "filled");
+
+    lua_pushinteger(L, st.num_blocks);
+    lua_setfield(L, -2, "blocks");
+
+    /* fill thresholds and what drives them in adaptive mode */
+    lua_pushboolean(L, st.adaptive);
+    lua_setfield(L, -2, "adaptive");
+
+    lua_pushinteger(L, st.enough_blocks);
+    lua_setfield(L, -2, "enough_blocks");
+
+    lua_pushinteger(L, st.low_blocks);
+    lua_setfield(L, -2, "low_blocks");
+
+    lua_pushinteger(L, st.jitter);
+    lua_setfield(L, -2, "jitter");
+
+    lua_pushinteger(L, st.underruns);
+    lua_setfield(L, -2, "underruns");
+
+    lua_pushinteger(L, st.grown);
+    lua_setfield(L, -2, "grown");
+
+    lua_pushinteger(L, st.shrunk);
+    lua_setfield(L, -2, "shrunk");
+
+    /* send time error histogram, see sync.h for bucket limits */
+    lua_newtable(L);
+    for(size_t i = 0; i < SYNC_HIST_BUCKETS; i++)
+    {
+        lua_pushnumber(L, st.late_hist[i]);
+        lua_rawseti(L, -2, i + 1);
     }
+    lua_setfield(L, -2, "late_hist");
+
+    lua_pushinteger(L, st.late_max);
+    lua_setfield(L, -2, "late_max");
+
+    lua_pushboolean(L, mod->is_txtime);
+    lua_setfield(L, -2, "txtime");
+
+    if(mod->is_txtime)
+    {
+        lua_pushnumber(L, mod->txerr.late);
+        lua_setfield(L, -2, "txtime_late");
+
+        lua_pushnumber(L, mod->txerr.rejected);
+        lua_setfield(L, -2, "txtime_rejected");
+    }
+
+    return 1;
 }
 
 static void module_init(lua_State *L, module_data_t *mod)
@@ -157,19 +514,34 @@ static void module_init(lua_State *L, module_data_t *mod)
     mod->port = 1234;
     module_option_integer(L, "port", &mod->port);
 
+    mod->packet.size = UDP_TS_COUNT * TS_PACKET_SIZE;
+
     module_option_boolean(L, "rtp", &mod->is_rtp);
     if(mod->is_rtp)
     {
         const uint32_t rtpssrc = (uint32_t)rand();
 
-        mod->packet.buffer[0 ] = 0x80; // RTP version
-        mod->packet.buffer[1 ] = RTP_PT_MP2T;
-        mod->packet.buffer[8 ] = (rtpssrc >> 24) & 0xFF;
-        mod->packet.buffer[9 ] = (rtpssrc >> 16) & 0xFF;
-        mod->packet.buffer[10] = (rtpssrc >>  8) & 0xFF;
-        mod->packet.buffer[11] = (rtpssrc      ) & 0xFF;
+        mod->rtp_header[0 ] = 0x80; // RTP version
+        mod->rtp_header[1 ] = RTP_PT_MP2T;
+        mod->rtp_header[8 ] = (rtpssrc >> 24) & 0xFF;
+        mod->rtp_header[9 ] = (rtpssrc >> 16) & 0xFF;
+        mod->rtp_header[10] = (rtpssrc >>  8) & 0xFF;
+        mod->rtp_header[11] = (rtpssrc      ) & 0xFF;
+
+        mod->packet.size += RTP_HEADER_SIZE;
     }
 
+    int batch = 1;
+    module_option_integer(L, "batch", &batch);
+    if(batch < 1 || batch > ASC_SOCKET_BATCH_MAX)
+    {
+        luaL_error(L, MSG("option 'batch' must be between 1 and %d")
+                   , ASC_SOCKET_BATCH_MAX);
+    }
+
+    mod->packet.batch = batch;
+    mod->packet.buffer = ASC_ALLOC(batch * mod->packet.size, uint8_t);
+
     mod->sock = asc_socket_open_udp4(mod);
     asc_socket_set_reuseaddr(mod->sock, 1);
     if(!asc_socket_bind(mod->sock, NULL, 0))
@@ -191,13 +563,51 @@ static void module_init(lua_State *L, module_data_t *mod)
     asc_socket_multicast_join(mod->sock, mod->addr, NULL);
     asc_socket_set_sockaddr(mod->sock, mod->addr, mod->port);
 
-    mod->can_send = false;
-    asc_socket_set_on_ready(mod->sock, on_ready);
+    fec_init(L, mod, localaddr, value);
+
+    if(mod->packet.batch > 1)
+    {
+        bool gso_on = false;
+        module_option_boolean(L, "gso", &gso_on);
+
+        /* segments of one send share a launch time */
+        bool txtime_on = false;
+        module_option_boolean(L, "txtime", &txtime_on);
+        if(gso_on && txtime_on)
+            luaL_error(L, MSG("option 'gso' can't be used with 'txtime'"));
+
+        if(gso_on && !asc_socket_set_gso(mod->sock, mod->packet.size))
+            asc_log_warning(MSG("UDP GSO is not available, using sendmmsg()"));
+
+        /* upper bound on latency added by batching */
+        int batch_ms = UDP_BATCH_MS_DEFAULT;
+        module_option_integer(L, "batch_ms", &batch_ms);
+        if(batch_ms < 1)
+            luaL_error(L, MSG("option 'batch_ms' must be positive"));
+
+        mod->flush_timer = asc_timer_init(batch_ms, on_flush_timer, mod);
+    }
 
     stream_callback_t on_ts = on_output_ts;
+    stream_batch_callback_t on_ts_batch = on_output_batch;
     bool sync_on = false;
     module_option_boolean(L, "sync", &sync_on);
 
+    module_option_boolean(L, "sync_thread", &mod->is_paced);
+    if(mod->is_paced && (!sync_on || mod->packet.batch > 1))
+        luaL_error(L, MSG("option 'sync_thread' requires 'sync' and no 'batch'"));
+
+    if(mod->is_paced)
+    {
+        /* socket belongs to the pacing thread; drops are counted there */
+        mod->can_send = true;
+    }
+    else
+    {
+        mod->can_send = false;
+        asc_socket_set_on_ready(mod->sock, on_ready);
+    }
+
     if(sync_on)
     {
         mod->sync = ts_sync_init((ts_callback_t)on_ts, mod);
@@ -209,27 +619,108 @@ static void module_init(lua_State *L, module_data_t *mod)
         if (optstr != NULL && !ts_sync_set_opts(mod->sync, optstr))
             luaL_error(L, MSG("invalid value for option 'sync_opts'"));
 
-        mod->sync_loop = asc_timer_init(SYNC_INTERVAL_MSEC, ts_sync_loop
-                                        , mod->sync);
+        if(mod->is_paced)
+        {
+            int cpu = -1;
+            module_option_integer(L, "sync_cpu", &cpu);
+
+            if(!ts_sync_start(mod->sync, cpu))
+                luaL_error(L, MSG("couldn't start pacing thread"));
+        }
+        else
+        {
+            mod->sync_loop = asc_timer_init(SYNC_INTERVAL_MSEC, ts_sync_loop
+                                            , mod->sync);
+        }
 
         on_ts = on_sync_ts;
+        on_ts_batch = on_sync_batch;
+    }
+
+    module_option_boolean(L, "pacing", &mod->is_pacing);
+    module_option_boolean(L, "txtime", &mod->is_txtime);
+    if(mod->is_txtime && (!sync_on || mod->is_paced))
+        luaL_error(L, MSG("option 'txtime' requires 'sync' and no 'sync_thread'"));
+
+    if(mod->is_txtime)
+    {
+        /* should cover sync timer interval and batching delay */
+        int lead = TXTIME_LEAD_DEFAULT;
+        module_option_integer(L, "txtime_lead", &lead);
+        if(lead < 1)
+            luaL_error(L, MSG("option 'txtime_lead' must be positive"));
+
+        bool tai = false;
+        module_option_boolean(L, "txtime_tai", &tai);
+
+        if(asc_socket_set_txtime(mod->sock, tai))
+        {
+            mod->txtime = ASC_ALLOC(mod->packet.batch, uint64_t);
+            ts_sync_set_lead(mod->sync, lead * 1000);
+
+            asc_socket_set_on_close(mod->sock, on_error);
+
+            for(size_t i = 0; i < ASC_ARRAY_SIZE(mod->fec_sock); i++)
+            {
+                asc_socket_t *const sock = mod->fec_sock[i];
+                if(sock == NULL)
+                    continue;
+
+                /* without it, FEC just goes out ahead of its media */
+                if(asc_socket_set_txtime(sock, tai))
+                    asc_socket_set_on_close(sock, on_fec_error);
+            }
+        }
+        else
+        {
+            asc_log_warning(MSG("SO_TXTIME is not available, "
+                                "using pacing rate instead"));
+
+            mod->is_txtime = false;
+            mod->is_pacing = true;
+        }
+    }
+
+    if(mod->is_pacing)
+    {
+        mod->last_pacing = asc_utime();
+        mod->tx_timer = asc_timer_init(PACING_TIMER_MS, on_tx_timer, mod);
     }
 
     module_stream_init(L, mod, on_ts);
+    module_stream_set_batch(mod, on_ts_batch);
     module_demux_set(mod, NULL, NULL);
 }
 
 static void module_destroy(module_data_t *mod)
 {
+    /* pacing thread uses the socket; stop it first */
+    if(mod->sync != NULL)
+        ts_sync_stop(mod->sync);
+
     module_stream_destroy(mod);
 
     ASC_FREE(mod->sync_loop, asc_timer_destroy);
     ASC_FREE(mod->sync, ts_sync_destroy);
+    ASC_FREE(mod->flush_timer, asc_timer_destroy);
+    ASC_FREE(mod->tx_timer, asc_timer_destroy);
+    ASC_FREE(mod->txtime, free);
+    ASC_FREE(mod->fec, fec_encoder_destroy);
+    ASC_FREE(mod->fec_sock[0], asc_socket_close);
+    ASC_FREE(mod->fec_sock[1], asc_socket_close);
     ASC_FREE(mod->sock, asc_socket_close);
+    ASC_FREE(mod->packet.buffer, free);
 }
 
+static const module_method_t module_methods[] =
+{
+    { "stats", method_stats },
+    { NULL, NULL },
+};
+
 STREAM_MODULE_REGISTER(udp_output)
 {
     .init = module_init,
     .destroy = module_destroy,
+    .methods = module_methods,
 };
@@ -0,0 +1,575 @@
+/*
+ * Astra Module: UDP Input (RTP reordering)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rtp.h"
+#include "fec.h"
+#include <astra/core/atomic.h>
+
+#define RTP_SEQ(_data) ((uint16_t)(((_data)[2] << 8) | (_data)[3]))
+
+/* delivered sequence numbers remembered for duplicate detection */
+#define HISTORY_BITS 64
+
+/* larger jumps mean the sender restarted (RFC 3550, appendix A.1) */
+#define MAX_DROPOUT 3000
+#define MAX_MISORDER 100
+
+/* no jump waiting for confirmation; outside uint16_t range */
+#define RTP_SEQ_NONE 0x10000
+
+/* FEC packets kept around for recovery */
+#define FEC_SLOTS 128
+
+typedef struct
+{
+    bool used; /* waiting in the window */
+    bool kept; /* data still valid, possibly already delivered */
+    uint16_t seq;
+    size_t len;
+} rtp_slot_t;
+
+typedef struct
+{
+    bool used;
+    fec_header_t hdr;
+} fec_slot_t;
+
+struct rtp_reorder_t
+{
+    size_t depth;
+    size_t size; /* slot count: window plus history kept for FEC */
+    uint64_t latency;
+    size_t mtu;
+
+    rtp_deliver_t cb;
+    void *arg;
+
+    bool started;
+    uint16_t expected; /* next sequence number to deliver */
+    uint16_t highest; /* highest sequence number seen */
+    uint32_t bad_seq; /* restart is confirmed by this one; RTP_SEQ_NONE */
+    uint64_t history; /* bit n set: expected - 1 - n was delivered */
+
+    rtp_slot_t *slots;
+    uint8_t *buffer;
+    uint64_t hold_since;
+
+    bool fec;
+    fec_slot_t *fec_slots;
+    uint8_t *fec_buffer;
+    size_t fec_next;
+
+    rtp_stats_t stats;
+};
+
+#define STAT_SET(_r, _field, _n) \
+    asc_atomic_store_relaxed(&(_r)->stats._field, (_n))
+
+#define STAT_ADD(_r, _field, _n) \
+    STAT_SET(_r, _field, (_r)->stats._field + (_n))
+
+/* must divide 2^16 for slots to stay put when sequence wraps */
+static
+size_t pow2(size_t n)
+{
+    size_t cap = 1;
+    while (cap < n)
+        cap <<= 1;
+
+    return cap;
+}
+
+rtp_reorder_t *rtp_reorder_init(size_t depth, uint64_t latency, size_t mtu
+                                , bool fec, rtp_deliver_t cb, void *arg)
+{
+    rtp_reorder_t *const r = ASC_ALLOC(1, rtp_reorder_t);
+
+    if (depth > 0)
+        depth = pow2(depth);
+
+    r->depth = depth;
+    r->latency = latency;
+    r->mtu = mtu;
+    r->cb = cb;
+    r->arg = arg;
+    r->bad_seq = RTP_SEQ_NONE;
+
+    /* FEC needs delivered datagrams too, as far back as one matrix */
+    r->fec = (fec && depth > 0);
+    r->size = r->fec ? pow2(depth + FEC_MAX_SPAN) : depth;
+
+    if (r->size > 0)
+    {
+        r->slots = ASC_ALLOC(r->size, rtp_slot_t);
+        r->buffer = ASC_ALLOC(r->size * mtu, uint8_t);
+    }
+
+    if (r->fec)
+    {
+        r->fec_slots = ASC_ALLOC(FEC_SLOTS, fec_slot_t);
+        r->fec_buffer = ASC_ALLOC(FEC_SLOTS * (mtu + FEC_HEADER_SIZE)
+                                  , uint8_t);
+    }
+
+    return r;
+}
+
+void rtp_reorder_destroy(rtp_reorder_t *r)
+{
+    free(r->fec_buffer);
+    free(r->fec_slots);
+    free(r->buffer);
+    free(r->slots);
+    free(r);
+}
+
+static inline
+size_t slot_idx(const rtp_reorder_t *r, uint16_t seq)
+{
+    return seq & (r->size - 1);
+}
+
+static inline
+uint8_t *slot_data(const rtp_reorder_t *r, uint16_t seq)
+{
+    return &r->buffer[slot_idx(r, seq) * r->mtu];
+}
+
+static inline
+bool is_kept(const rtp_reorder_t *r, uint16_t seq)
+{
+    const rtp_slot_t *const slot = &r->slots[slot_idx(r, seq)];
+    return (slot->kept && slot->seq == seq);
+}
+
+/*
+ * Rebuild the one datagram missing from a FEC group. Done in place, in
+ * the slot it would have been stored in; fails if more than one is
+ * missing or the missing one is no longer deliverable. Unless `force'
+ * is set, waits until something past the missing datagram shows up.
+ */
+static
+bool fec_recover(rtp_reorder_t *r, const fec_header_t *f, bool force
+                 , uint64_t now)
+{
+    uint16_t missing = 0;
+    unsigned int count = 0;
+
+    for (unsigned int i = 0; i < f->na; i++)
+    {
+        const uint16_t seq = f->snbase + i * f->offset;
+        if (!is_kept(r, seq))
+        {
+            missing = seq;
+            if (++count > 1)
+                return false;
+        }
+    }
+
+    const int16_t ahead = (int16_t)(missing - r->expected);
+    if (count == 0 || ahead < 0 || (size_t)ahead >= r->depth)
+        return false;
+
+    /* nothing after it has arrived yet; it's probably on its way */
+    if (!force && (int16_t)(r->highest - missing) <= 0)
+        return false;
+
+    const size_t plen = f->payload_len;
+    if (plen > r->mtu - RTP_HEADER_SIZE)
+        return false;
+
+    rtp_slot_t *const slot = &r->slots[slot_idx(r, missing)];
+    uint8_t *const out = slot_data(r, missing);
+    slot->kept = false;
+
+    memcpy(&out[RTP_HEADER_SIZE], f->payload, plen);
+
+    uint8_t b0 = f->b0_rec;
+    uint8_t b1 = f->m_rec | f->pt_rec;
+    uint16_t len = f->len_rec;
+    uint32_t ts = f->ts_rec;
+    const uint8_t *ssrc = NULL;
+
+    for (unsigned int i = 0; i < f->na; i++)
+    {
+        const uint16_t seq = f->snbase + i * f->offset;
+        if (seq == missing)
+            continue;
+
+        const uint8_t *const pkt = slot_data(r, seq);
+        const size_t pkt_len = r->slots[slot_idx(r, seq)].len;
+        if (pkt_len - RTP_HEADER_SIZE > plen)
+            return false;
+
+        fec_xor(&out[RTP_HEADER_SIZE], &pkt[RTP_HEADER_SIZE]
+                , pkt_len - RTP_HEADER_SIZE);
+
+        b0 ^= pkt[0];
+        b1 ^= pkt[1];
+        len ^= pkt_len - RTP_HEADER_SIZE;
+        ts ^= ((uint32_t)pkt[4] << 24) | (pkt[5] << 16)
+              | (pkt[6] << 8) | pkt[7];
+        ssrc = &pkt[8];
+    }
+
+    if (len > plen || ssrc == NULL)
+        return false;
+
+    out[0] = 0x80 | (b0 & 0x3F);
+    out[1] = b1;
+    out[2] = missing >> 8;
+    out[3] = missing;
+    out[4] = ts >> 24;
+    out[5] = ts >> 16;
+    out[6] = ts >> 8;
+    out[7] = ts;
+    memcpy(&out[8], ssrc, 4);
+
+    slot->used = true;
+    slot->kept = true;
+    slot->seq = missing;
+    slot->len = RTP_HEADER_SIZE + len;
+
+    if (r->stats.pending == 0)
+        r->hold_since = now;
+
+    STAT_ADD(r, pending, 1);
+    STAT_ADD(r, recovered, 1);
+
+    return true;
+}
+
+/* try every FEC group covering a datagram missing at the head */
+static
+bool fec_lookup(rtp_reorder_t *r, uint16_t seq, uint64_t now)
+{
+    for (size_t i = 0; i < FEC_SLOTS; i++)
+    {
+        const fec_slot_t *const fs = &r->fec_slots[i];
+        if (!fs->used)
+            continue;
+
+        const uint16_t diff = seq - fs->hdr.snbase;
+        if (diff % fs->hdr.offset != 0 || diff / fs->hdr.offset >= fs->hdr.na)
+            continue;
+
+        if (fec_recover(r, &fs->hdr, true, now))
+            return true;
+    }
+
+    return false;
+}
+
+static
+void deliver(rtp_reorder_t *r, const uint8_t *data, size_t len)
+{
+    r->history = (r->history << 1) | 1;
+    r->expected++;
+
+    r->cb(r->arg, data, len);
+}
+
+/* deliver or skip the datagram at the head of the window */
+static
+void advance(rtp_reorder_t *r, uint64_t now)
+{
+    rtp_slot_t *const slot = &r->slots[slot_idx(r, r->expected)];
+
+    if (!(slot->used && slot->seq == r->expected)
+        && r->fec && !fec_lookup(r, r->expected, now))
+    {
+        STAT_ADD(r, unrecoverable, 1);
+    }
+
+    if (slot->used && slot->seq == r->expected)
+    {
+        slot->used = false;
+        STAT_SET(r, pending, r->stats.pending - 1);
+        deliver(r, slot_data(r, r->expected), slot->len);
+    }
+    else
+    {
+        r->history <<= 1;
+        r->expected++;
+        STAT_ADD(r, lost, 1);
+    }
+}
+
+/* release whatever is in order at the head of the window */
+static
+void flush(rtp_reorder_t *r, uint64_t now)
+{
+    while (r->stats.pending > 0)
+    {
+        const rtp_slot_t *const slot = &r->slots[slot_idx(r, r->expected)];
+        if (!slot->used || slot->seq != r->expected)
+            break;
+
+        advance(r, now);
+    }
+
+    /* new gap at the head; restart its clock */
+    if (r->stats.pending > 0)
+        r->hold_since = now;
+}
+
+/* give up on the gap at the head of the window */
+static
+void skip_gap(rtp_reorder_t *r, uint64_t now)
+{
+    while (r->stats.pending > 0)
+    {
+        const rtp_slot_t *const slot = &r->slots[slot_idx(r, r->expected)];
+        if (slot->used && slot->seq == r->expected)
+            break;
+
+        advance(r, now);
+    }
+
+    flush(r, now);
+}
+
+/* sender restarted; drain the window in order, gaps and all */
+static
+void resync(rtp_reorder_t *r, uint16_t seq)
+{
+    for (size_t i = 0; i < r->depth && r->stats.pending > 0; i++)
+    {
+        rtp_slot_t *const slot = &r->slots[slot_idx(r, r->expected)];
+        if (slot->used && slot->seq == r->expected)
+        {
+            slot->used = false;
+            STAT_SET(r, pending, r->stats.pending - 1);
+            r->cb(r->arg, slot_data(r, r->expected), slot->len);
+        }
+
+        r->expected++;
+    }
+
+    /* old datagrams and FEC are of no use for the new sequence */
+    for (size_t i = 0; i < r->size; i++)
+        r->slots[i].kept = false;
+
+    for (size_t i = 0; r->fec && i < FEC_SLOTS; i++)
+        r->fec_slots[i].used = false;
+
+    r->expected = seq;
+    r->highest = seq;
+    r->history = 0;
+
+    STAT_ADD(r, resync, 1);
+}
+
+void rtp_reorder_push(rtp_reorder_t *r, const uint8_t *data, size_t len
+                      , uint64_t now)
+{
+    if (len < RTP_HEADER_SIZE || len > r->mtu)
+    {
+        /* not ours to judge; payload parser reports bad format */
+        r->cb(r->arg, data, len);
+        return;
+    }
+
+    const uint16_t seq = RTP_SEQ(data);
+    STAT_ADD(r, received, 1);
+
+    if (!r->started)
+    {
+        r->started = true;
+        r->expected = seq;
+        r->highest = seq;
+    }
+    else
+    {
+        const int16_t jump = (int16_t)(seq - r->expected);
+        const int misorder = (r->depth > MAX_MISORDER)
+                             ? (int)r->depth : MAX_MISORDER;
+
+        if (jump >= MAX_DROPOUT || jump < -misorder)
+        {
+            /*
+             * Only believe a restart once the next datagram follows the
+             * one that jumped; a single stray is dropped.
+             */
+            if (seq != r->bad_seq)
+            {
+                r->bad_seq = (uint16_t)(seq + 1);
+                STAT_ADD(r, stray, 1);
+                return;
+            }
+
+            resync(r, seq);
+        }
+
+        r->bad_seq = RTP_SEQ_NONE;
+    }
+
+    int16_t ahead = (int16_t)(seq - r->expected);
+    if (ahead < 0)
+    {
+        const int back = -ahead;
+        if (back <= HISTORY_BITS && (r->history & (1ULL << (back - 1))))
+            STAT_ADD(r, duplicate, 1);
+        else
+            STAT_ADD(r, late, 1);
+
+        /* no window: keep old behavior and pass it on */
+        if (r->depth == 0)
+            r->cb(r->arg, data, len);
+
+        return;
+    }
+
+    if (r->depth > 0 && (size_t)ahead < r->depth)
+    {
+        const rtp_slot_t *const slot = &r->slots[slot_idx(r, seq)];
+        if (slot->used && slot->seq == seq)
+        {
+            STAT_ADD(r, duplicate, 1);
+            return;
+        }
+    }
+
+    /* in time, but behind something we've already seen */
+    if ((int16_t)(r->highest - seq) > 0)
+        STAT_ADD(r, reordered, 1);
+    else
+        r->highest = seq;
+
+    if (r->depth == 0)
+    {
+        /* count the gap, then move on */
+        if (ahead > 0)
+        {
+            STAT_ADD(r, lost, ahead);
+            r->history = (ahead < HISTORY_BITS)
+                         ? r->history << ahead : 0;
+            r->expected = seq;
+        }
+
+        deliver(r, data, len);
+        return;
+    }
+
+    /* make room: window always covers [expected, expected + depth) */
+    if ((size_t)ahead >= r->depth)
+    {
+        while ((size_t)ahead >= r->depth)
+        {
+            advance(r, now);
+            ahead = (int16_t)(seq - r->expected);
+        }
+
+        flush(r, now);
+        ahead = (int16_t)(seq - r->expected);
+    }
+
+    if (ahead == 0 && !r->fec)
+    {
+        deliver(r, data, len);
+        flush(r, now);
+
+        return;
+    }
+
+    rtp_slot_t *const slot = &r->slots[slot_idx(r, seq)];
+    memcpy(slot_data(r, seq), data, len);
+    slot->used = true;
+    slot->kept = true;
+    slot->seq = seq;
+    slot->len = len;
+
+    if (r->stats.pending == 0)
+        r->hold_since = now;
+
+    STAT_ADD(r, pending, 1);
+
+    /* with FEC, in order datagrams go through the slots as well */
+    if (ahead == 0)
+    {
+        flush(r, now);
+        return;
+    }
+
+    /* gap at the head; FEC might have enough to fill it already */
+    if (r->fec && fec_lookup(r, r->expected, now))
+    {
+        flush(r, now);
+        return;
+    }
+
+    if (r->latency > 0 && now - r->hold_since >= r->latency)
+        skip_gap(r, now);
+}
+
+void rtp_reorder_fec(rtp_reorder_t *r, const uint8_t *data, size_t len
+                     , uint64_t now)
+{
+    fec_header_t hdr;
+
+    if (!r->fec || len > r->mtu + FEC_HEADER_SIZE
+        || !fec_parse(data, len, &hdr))
+    {
+        return;
+    }
+
+    STAT_ADD(r, fec, 1);
+
+    /* keep a copy for datagrams that aren't due yet */
+    const size_t idx = r->fec_next++ % FEC_SLOTS;
+    uint8_t *const copy = &r->fec_buffer[idx * (r->mtu + FEC_HEADER_SIZE)];
+    memcpy(copy, data, len);
+
+    fec_slot_t *const fs = &r->fec_slots[idx];
+    fs->used = true;
+    fs->hdr = hdr;
+    fs->hdr.payload = &copy[RTP_HEADER_SIZE + FEC_HEADER_SIZE];
+
+    if (r->started && fec_recover(r, &fs->hdr, false, now))
+    {
+        const rtp_slot_t *const slot = &r->slots[slot_idx(r, r->expected)];
+        if (slot->used && slot->seq == r->expected)
+            flush(r, now);
+    }
+}
+
+void rtp_reorder_poll(rtp_reorder_t *r, uint64_t now)
+{
+    if (r->latency > 0 && r->stats.pending > 0
+        && now - r->hold_since >= r->latency)
+    {
+        skip_gap(r, now);
+    }
+}
+
+void rtp_reorder_stats(const rtp_reorder_t *r, rtp_stats_t *stats)
+{
+    stats->received = asc_atomic_load_relaxed(&r->stats.received);
+    stats->lost = asc_atomic_load_relaxed(&r->stats.lost);
+    stats->reordered = asc_atomic_load_relaxed(&r->stats.reordered);
+    stats->duplicate = asc_atomic_load_relaxed(&r->stats.duplicate);
+    stats->late = asc_atomic_load_relaxed(&r->stats.late);
+    stats->resync = asc_atomic_load_relaxed(&r->stats.resync);
+    stats->stray = asc_atomic_load_relaxed(&r->stats.stray);
+    stats->pending = asc_atomic_load_relaxed(&r->stats.pending);
+    stats->fec = asc_atomic_load_relaxed(&r->stats.fec);
+    stats->recovered = asc_atomic_load_relaxed(&r->stats.recovered);
+    stats->unrecoverable = asc_atomic_load_relaxed(&r->stats.unrecoverable);
+}
@@ -0,0 +1,80 @@
+/*
+ * Astra Module: UDP Input (RTP reordering)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _UDP_RTP_H_
+#define _UDP_RTP_H_ 1
+
+#include <astra/astra.h>
+
+#define RTP_HEADER_SIZE 12
+
+/*
+ * Puts RTP datagrams back in sequence order. Out of order datagrams are
+ * held in a window of `depth' slots (rounded up to a power of two)
+ * until the gap before them is filled, the window overflows or, if
+ * `latency' is set, the gap is older than that many microseconds. Zero
+ * depth only counts sequence errors and passes everything through
+ * unchanged. A large sequence jump is taken as a sender restart only
+ * when the datagram after it follows on (RFC 3550, appendix A.1).
+ *
+ * rtp_reorder_poll() releases held datagrams once `latency' expires
+ * while nothing else arrives; call it periodically.
+ *
+ * With `fec' set, the window also remembers recently delivered
+ * datagrams and rebuilds lost ones from SMPTE 2022-1 packets passed to
+ * rtp_reorder_fec(), as long as the gap hasn't been skipped yet.
+ *
+ * Counters may be read from any thread; everything else belongs to the
+ * thread that pushes datagrams.
+ */
+
+typedef struct rtp_reorder_t rtp_reorder_t;
+
+typedef void (*rtp_deliver_t)(void *, const uint8_t *, size_t);
+
+typedef struct
+{
+    size_t received;
+    size_t lost; /* skipped over, never arrived in time */
+    size_t reordered; /* arrived after a higher sequence number */
+    size_t duplicate;
+    size_t late; /* arrived after its gap was skipped */
+    size_t resync; /* sequence jumps, e.g. sender restarts */
+    size_t stray; /* jumps not followed by the next datagram, dropped */
+    size_t pending; /* held in the window right now */
+
+    size_t fec; /* FEC packets received */
+    size_t recovered; /* rebuilt from FEC */
+    size_t unrecoverable; /* lost despite FEC */
+} rtp_stats_t;
+
+rtp_reorder_t *rtp_reorder_init(size_t depth, uint64_t latency, size_t mtu
+                                , bool fec, rtp_deliver_t cb
+                                , void *arg) __asc_result;
+void rtp_reorder_destroy(rtp_reorder_t *r);
+
+void rtp_reorder_push(rtp_reorder_t *r, const uint8_t *data, size_t len
+                      , uint64_t now);
+void rtp_reorder_fec(rtp_reorder_t *r, const uint8_t *data, size_t len
+                     , uint64_t now);
+void rtp_reorder_poll(rtp_reorder_t *r, uint64_t now);
+void rtp_reorder_stats(const rtp_reorder_t *r, rtp_stats_t *stats);
+
+#endif /* _UDP_RTP_H_ */
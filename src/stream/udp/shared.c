@@ -0,0 +1,479 @@
+/*
+ * Astra Module: UDP Input (shared receiver)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Every socket bound to a port gets its own copy of each datagram sent
+ * to that port, so a thousand inputs on one port means a thousand socket
+ * lookups per packet. Here all inputs on a port share a socket bound to
+ * the wildcard address; groups are joined on it and datagrams are routed
+ * by destination address. Once the kernel refuses more memberships on a
+ * socket (net.ipv4.igmp_max_memberships), another one is opened on the
+ * same port. IP_MULTICAST_ALL is turned off so that sockets in the set
+ * don't receive each other's groups.
+ */
+
+#include "shared.h"
+#include <astra/core/list.h>
+#include <astra/core/mainloop.h>
+
+#ifndef _WIN32
+#   include <arpa/inet.h>
+#   include <netinet/in.h>
+#endif
+
+#define MSG(_msg) "[udp_input *:%d] " _msg, rx->port
+
+#define SHARED_BUFFER_SIZE 1460
+#define SHARED_DRAIN_ROUNDS 4
+
+/* member lookup table size, power of two */
+#define SHARED_BUCKETS 1024
+
+typedef struct shared_rx_t shared_rx_t;
+
+typedef struct
+{
+    shared_rx_t *rx;
+    asc_socket_t *sock;
+
+    size_t groups;
+    bool is_full;
+} shared_sock_t;
+
+struct udp_member_t
+{
+    shared_rx_t *rx;
+    shared_sock_t *ss; /* socket holding the membership, NULL for unicast */
+
+    char *addr;
+    char *localaddr;
+    uint32_t dst;
+
+    udp_member_cb_t cb;
+    void *arg;
+
+    udp_member_t *next;
+};
+
+struct shared_rx_t
+{
+    asc_main_loop_t *loop;
+    int port;
+    int socket_size;
+
+    asc_list_t *socks;
+    shared_sock_t *ucast; /* first socket opened; carries unicast */
+    udp_member_t *buckets[SHARED_BUCKETS];
+    size_t members;
+
+    uint8_t *buffer;
+    size_t lengths[ASC_SOCKET_BATCH_MAX];
+    asc_socket_rxinfo_t info[ASC_SOCKET_BATCH_MAX];
+
+    /* last member left from inside a callback; free after dispatch */
+    bool in_dispatch;
+    bool is_dead;
+};
+
+/* all receivers; only touched with the Lua lock held */
+static asc_list_t *receivers = NULL;
+
+static inline
+size_t bucket_idx(uint32_t dst)
+{
+    return ((ntohl(dst) * 2654435761U) >> 16) & (SHARED_BUCKETS - 1);
+}
+
+static
+udp_member_t *member_find(const shared_rx_t *rx, uint32_t dst)
+{
+    udp_member_t *m = rx->buckets[bucket_idx(dst)];
+    while (m != NULL && m->dst != dst)
+        m = m->next;
+
+    return m;
+}
+
+static
+void member_unlink(udp_member_t *member)
+{
+    udp_member_t **ptr = &member->rx->buckets[bucket_idx(member->dst)];
+    while (*ptr != member)
+        ptr = &(*ptr)->next;
+
+    *ptr = member->next;
+}
+
+/*
+ * receiving
+ */
+
+static
+void sock_close(shared_sock_t *ss)
+{
+    ASC_FREE(ss->sock, asc_socket_close);
+}
+
+static
+void rx_destroy(shared_rx_t *rx)
+{
+    asc_list_for(rx->socks)
+    {
+        shared_sock_t *const ss = (shared_sock_t *)asc_list_data(rx->socks);
+        sock_close(ss);
+        free(ss);
+    }
+
+    ASC_FREE(rx->socks, asc_list_destroy);
+    free(rx->buffer);
+    free(rx);
+}
+
+static
+void on_close(void *arg)
+{
+    shared_sock_t *const ss = (shared_sock_t *)arg;
+    shared_rx_t *const rx = ss->rx;
+
+    asc_log_error(MSG("receive error: %s"), asc_error_msg());
+
+    /* members on this socket go silent; others keep receiving */
+    sock_close(ss);
+    ss->is_full = true;
+}
+
+static
+void on_read(void *arg)
+{
+    shared_sock_t *const ss = (shared_sock_t *)arg;
+    shared_rx_t *const rx = ss->rx;
+
+    rx->in_dispatch = true;
+
+    for (unsigned int round = 0; round < SHARED_DRAIN_ROUNDS; round++)
+    {
+        const ssize_t ret = asc_socket_recv_batch(ss->sock, rx->buffer
+                                                  , SHARED_BUFFER_SIZE
+                                                  , rx->lengths, rx->info
+                                                  , ASC_SOCKET_BATCH_MAX);
+        if (ret <= 0)
+        {
+            if (ret < 0 && !asc_socket_would_block())
+                on_close(ss);
+
+            break;
+        }
+
+        for (ssize_t i = 0; i < ret && !rx->is_dead; i++)
+        {
+            /* member on 0.0.0.0 takes unicast no one else claimed */
+            udp_member_t *m = member_find(rx, rx->info[i].dst);
+            if (m == NULL)
+                m = member_find(rx, INADDR_ANY);
+
+            if (m != NULL)
+            {
+                m->cb(m->arg, &rx->buffer[i * SHARED_BUFFER_SIZE]
+                      , rx->lengths[i], &rx->info[i]);
+            }
+        }
+
+        if (rx->is_dead || ret < ASC_SOCKET_BATCH_MAX)
+            break;
+    }
+
+    rx->in_dispatch = false;
+
+    if (rx->is_dead)
+        rx_destroy(rx);
+}
+
+/*
+ * receiver setup
+ */
+
+static
+shared_sock_t *sock_open(shared_rx_t *rx)
+{
+    shared_sock_t *const ss = ASC_ALLOC(1, shared_sock_t);
+    ss->rx = rx;
+    ss->sock = asc_socket_open_udp4(ss);
+    asc_socket_set_reuseaddr(ss->sock, 1);
+
+    if (!asc_socket_set_pktinfo(ss->sock))
+    {
+        asc_log_error(MSG("shared receive requires IP_PKTINFO and recvmmsg()"));
+        goto fail;
+    }
+
+    if (!asc_socket_bind(ss->sock, "0.0.0.0", rx->port))
+        goto fail;
+
+    if (!asc_socket_set_multicast_all(ss->sock, false))
+        asc_log_debug(MSG("couldn't disable IP_MULTICAST_ALL"));
+
+    if (!asc_socket_set_rxq_ovfl(ss->sock))
+        asc_log_debug(MSG("kernel drop counter is not available"));
+
+    if (rx->socket_size > 0)
+        asc_socket_set_buffer(ss->sock, rx->socket_size, 0);
+
+    asc_socket_set_on_read(ss->sock, on_read);
+    asc_socket_set_on_close(ss->sock, on_close);
+
+    asc_list_insert_tail(rx->socks, ss);
+    if (rx->ucast == NULL)
+        rx->ucast = ss;
+
+    asc_log_debug(MSG("opened socket #%zu"), asc_list_count(rx->socks));
+
+    return ss;
+
+fail:
+    sock_close(ss);
+    free(ss);
+
+    return NULL;
+}
+
+/*
+ * Sockets are bound to the wildcard address regardless of the interface
+ * groups are joined on, and SO_REUSEPORT spreads unicast between them,
+ * so there must be only one set of sockets per port.
+ */
+static
+shared_rx_t *rx_find(int port)
+{
+    if (receivers == NULL)
+        return NULL;
+
+    asc_main_loop_t *const loop = asc_main_loop_current();
+
+    asc_list_for(receivers)
+    {
+        shared_rx_t *const rx = (shared_rx_t *)asc_list_data(receivers);
+
+        if (rx->loop == loop && rx->port == port)
+            return rx;
+    }
+
+    return NULL;
+}
+
+static
+shared_rx_t *rx_init(int port)
+{
+    shared_rx_t *const rx = ASC_ALLOC(1, shared_rx_t);
+
+    rx->loop = asc_main_loop_current();
+    rx->port = port;
+
+    rx->socks = asc_list_init();
+    rx->buffer = ASC_ALLOC(ASC_SOCKET_BATCH_MAX * SHARED_BUFFER_SIZE
+                           , uint8_t);
+
+    if (receivers == NULL)
+        receivers = asc_list_init();
+
+    asc_list_insert_tail(receivers, rx);
+
+    return rx;
+}
+
+static
+void rx_release(shared_rx_t *rx)
+{
+    asc_list_remove_item(receivers, rx);
+    if (asc_list_count(receivers) == 0)
+        ASC_FREE(receivers, asc_list_destroy);
+
+    /* called from a member callback; on_read() will clean up */
+    rx->is_dead = true;
+    if (!rx->in_dispatch)
+        rx_destroy(rx);
+}
+
+/* find a socket with room for another group, opening one if needed */
+static
+shared_sock_t *rx_subscribe(shared_rx_t *rx, const char *addr
+                            , const char *localaddr)
+{
+    asc_list_for(rx->socks)
+    {
+        shared_sock_t *const ss = (shared_sock_t *)asc_list_data(rx->socks);
+        if (ss->is_full)
+            continue;
+
+        if (asc_socket_multicast_add(ss->sock, addr, localaddr))
+            return ss;
+
+        /* most likely out of memberships */
+        asc_log_debug(MSG("socket is full at %zu groups: %s")
+                      , ss->groups, asc_error_msg());
+
+        ss->is_full = true;
+    }
+
+    shared_sock_t *const ss = sock_open(rx);
+    if (ss == NULL)
+        return NULL;
+
+    if (!asc_socket_multicast_add(ss->sock, addr, localaddr))
+    {
+        asc_log_error(MSG("failed to join multicast group `%s': %s")
+                      , addr, asc_error_msg());
+
+        ss->is_full = true;
+        return NULL;
+    }
+
+    return ss;
+}
+
+/*
+ * public API
+ */
+
+udp_member_t *udp_shared_join(const char *addr, int port
+                              , const char *localaddr, int socket_size
+                              , udp_member_cb_t cb, void *arg)
+{
+    const uint32_t dst = inet_addr(addr);
+    if (dst == INADDR_NONE)
+    {
+        asc_log_error("[udp_input %s:%d] invalid address", addr, port);
+        return NULL;
+    }
+
+    bool is_new = false;
+    shared_rx_t *rx = rx_find(port);
+    if (rx == NULL)
+    {
+        rx = rx_init(port);
+        is_new = true;
+    }
+    else if (member_find(rx, dst) != NULL)
+    {
+        asc_log_error(MSG("group %s is already being received"), addr);
+        return NULL;
+    }
+
+    /* largest buffer requested by any member wins */
+    if (socket_size > rx->socket_size)
+    {
+        rx->socket_size = socket_size;
+
+        asc_list_for(rx->socks)
+        {
+            shared_sock_t *const ss = (shared_sock_t *)asc_list_data(rx->socks);
+            if (ss->sock != NULL)
+                asc_socket_set_buffer(ss->sock, socket_size, 0);
+        }
+    }
+
+    shared_sock_t *ss = NULL;
+    if (IN_MULTICAST(ntohl(dst)))
+        ss = rx_subscribe(rx, addr, localaddr);
+    else if (rx->ucast == NULL)
+        ss = sock_open(rx);
+    else
+        ss = rx->ucast;
+
+    if (ss == NULL)
+    {
+        if (is_new)
+            rx_release(rx);
+
+        return NULL;
+    }
+
+    udp_member_t *const member = ASC_ALLOC(1, udp_member_t);
+    member->rx = rx;
+    member->addr = strdup(addr);
+    if (localaddr != NULL)
+        member->localaddr = strdup(localaddr);
+    member->dst = dst;
+    member->cb = cb;
+    member->arg = arg;
+
+    if (IN_MULTICAST(ntohl(dst)))
+    {
+        member->ss = ss;
+        ss->groups++;
+    }
+
+    const size_t idx = bucket_idx(dst);
+    member->next = rx->buckets[idx];
+    rx->buckets[idx] = member;
+    rx->members++;
+
+    return member;
+}
+
+void udp_shared_leave(udp_member_t *member)
+{
+    shared_rx_t *const rx = member->rx;
+
+    member_unlink(member);
+
+    shared_sock_t *const ss = member->ss;
+    if (ss != NULL && ss->sock != NULL)
+    {
+        asc_socket_multicast_drop(ss->sock, member->addr, member->localaddr);
+        ss->groups--;
+        ss->is_full = false;
+    }
+
+    free(member->localaddr);
+    free(member->addr);
+    free(member);
+
+    if (--rx->members == 0)
+        rx_release(rx);
+}
+
+void udp_shared_renew(udp_member_t *member)
+{
+    shared_sock_t *const ss = member->ss;
+    if (ss == NULL || ss->sock == NULL)
+        return;
+
+    shared_rx_t *const rx = member->rx;
+    asc_socket_multicast_drop(ss->sock, member->addr, member->localaddr);
+
+    if (!asc_socket_multicast_add(ss->sock, member->addr, member->localaddr))
+    {
+        asc_log_error(MSG("failed to renew multicast group `%s': %s")
+                      , member->addr, asc_error_msg());
+    }
+}
+
+/* socket carrying member's traffic, for queue statistics */
+asc_socket_t *udp_shared_socket(const udp_member_t *member)
+{
+    if (member->ss != NULL)
+        return member->ss->sock;
+
+    const shared_rx_t *const rx = member->rx;
+    if (rx->ucast == NULL)
+        return NULL;
+
+    return rx->ucast->sock;
+}
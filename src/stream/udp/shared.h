@@ -0,0 +1,46 @@
+/*
+ * Astra Module: UDP Input (shared receiver)
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _UDP_SHARED_H_
+#define _UDP_SHARED_H_ 1
+
+#include <astra/astra.h>
+#include <astra/core/socket.h>
+
+/*
+ * One set of sockets per local port receives any number of groups.
+ * Datagrams are handed to members by destination address (IP_PKTINFO);
+ * a member on 0.0.0.0 gets whatever no other member claims. Members must be added and removed on the thread that runs their loop.
+ */
+
+typedef struct udp_member_t udp_member_t;
+
+typedef void (*udp_member_cb_t)(void *, const uint8_t *, size_t
+                                , const asc_socket_rxinfo_t *);
+
+udp_member_t *udp_shared_join(const char *addr, int port
+                              , const char *localaddr, int socket_size
+                              , udp_member_cb_t cb, void *arg) __asc_result;
+void udp_shared_leave(udp_member_t *member);
+void udp_shared_renew(udp_member_t *member);
+
+asc_socket_t *udp_shared_socket(const udp_member_t *member) __asc_result;
+
+#endif /* _UDP_SHARED_H_ */
@@ -59,6 +59,31 @@ START_TEST(u_sleep)
 }
 END_TEST
 
+START_TEST(u_sleep_until)
+{
+    const unsigned res = get_timer_res();
+    uint64_t deadline = asc_utime();
+
+    for (size_t i = 1; i <= 5; i++)
+    {
+        deadline += i * res;
+        asc_usleep_until(deadline);
+
+        /* relative sleep fallback may come back a bit early */
+        const uint64_t now = asc_utime();
+        ck_assert_msg(now + (res / 10) >= deadline, "Woke up %lluus early"
+                      , (unsigned long long)(deadline - now));
+        ck_assert_msg(now <= deadline + res, "Woke up %lluus late"
+                      , (unsigned long long)(now - deadline));
+    }
+
+    /* deadline in the past returns right away */
+    const uint64_t time_a = asc_utime();
+    asc_usleep_until(time_a - 1000000);
+    ck_assert(asc_utime() - time_a < res);
+}
+END_TEST
+
 #ifndef _WIN32
 START_TEST(rtc_time)
 {
@@ -89,6 +114,7 @@ Suite *core_clock(void)
     TCase *const tc = tcase_create("default");
     tcase_add_test(tc, u_time);
     tcase_add_test(tc, u_sleep);
+    tcase_add_test(tc, u_sleep_until);
 #ifndef _WIN32
     tcase_add_test(tc, rtc_time);
 #endif
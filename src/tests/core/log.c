@@ -183,6 +183,253 @@ START_TEST(threaded)
 }
 END_TEST
 
+/* same as above, through the writer thread */
+#define ASYNC_THREADS 8
+
+START_TEST(async)
+{
+    ck_assert(lseek(extra_fd, 0, SEEK_END) == 0);
+
+    /* init might have logged something already */
+    asc_log_stats_t before;
+    asc_log_stats(&before);
+
+    asc_log_set_async(true);
+
+    asc_thread_t *thr[ASYNC_THREADS] = { NULL };
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(thr); i++)
+    {
+        thr[i] = asc_thread_init((void *)i, log_proc, NULL);
+        ck_assert(thr[i] != NULL);
+    }
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(thr); i++)
+    {
+        asc_thread_join(thr[i]);
+    }
+
+    asc_log_flush();
+
+    asc_log_stats_t stats;
+    asc_log_stats(&stats);
+    ck_assert(stats.dropped == before.dropped);
+    ck_assert(stats.queued - before.queued
+              == ASYNC_THREADS * MESSAGES_PER_THREAD);
+
+    /* per-thread ordering must be preserved */
+    FILE *const f = fdopen(extra_fd, "rb");
+    ck_assert(f != NULL);
+
+    unsigned int msg[ASYNC_THREADS] = { 0 };
+    char buf[512];
+
+    while (fgets(buf, sizeof(buf), f) != NULL)
+    {
+        char *const p = strstr(buf, ": INFO: ");
+        ck_assert(p != NULL);
+
+        unsigned int thread_id = 0;
+        unsigned int msg_id = 0;
+
+        const int ret = sscanf(p + 8, "%u: message %u", &thread_id, &msg_id);
+        ck_assert(ret == 2);
+        ck_assert(thread_id < ASYNC_THREADS);
+        ck_assert(msg[thread_id] == msg_id);
+
+        msg[thread_id]++;
+    }
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(msg); i++)
+        ck_assert(msg[i] == MESSAGES_PER_THREAD);
+
+    asc_log_set_async(false);
+    ck_assert(fclose(f) == 0);
+}
+END_TEST
+
+/* switching async mode off and on while other threads are logging */
+#define TOGGLE_THREADS 4
+#define TOGGLE_MESSAGES 4000
+#define TOGGLE_ROUNDS 50
+
+static
+void toggle_proc(void *arg)
+{
+    const unsigned int thread_id = (unsigned)((intptr_t)arg);
+
+    for (unsigned int i = 0; i < TOGGLE_MESSAGES; i++)
+        asc_log_info("%u: toggle %u", thread_id, i);
+}
+
+START_TEST(async_toggle)
+{
+    ck_assert(lseek(extra_fd, 0, SEEK_END) == 0);
+
+    asc_log_stats_t before;
+    asc_log_stats(&before);
+
+    asc_thread_t *thr[TOGGLE_THREADS] = { NULL };
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(thr); i++)
+    {
+        thr[i] = asc_thread_init((void *)i, toggle_proc, NULL);
+        ck_assert(thr[i] != NULL);
+    }
+
+    for (unsigned int i = 0; i < TOGGLE_ROUNDS; i++)
+    {
+        asc_log_set_async(true);
+        asc_usleep(200);
+        asc_log_set_async(false);
+    }
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(thr); i++)
+        asc_thread_join(thr[i]);
+
+    /* every line is either written out or counted as dropped */
+    asc_log_stats_t stats;
+    asc_log_stats(&stats);
+
+    const size_t queued = stats.queued - before.queued;
+    const size_t dropped = stats.dropped - before.dropped;
+    ck_assert(queued + dropped == TOGGLE_THREADS * TOGGLE_MESSAGES);
+
+    FILE *const f = fdopen(extra_fd, "rb");
+    ck_assert(f != NULL);
+
+    size_t lines = 0;
+    char buf[512];
+
+    while (fgets(buf, sizeof(buf), f) != NULL)
+    {
+        if (strstr(buf, ": toggle ") != NULL)
+            lines++;
+    }
+
+    ck_assert_msg(lines == queued, "wrote %zu lines, queued %zu"
+                  , lines, queued);
+
+    ck_assert(fclose(f) == 0);
+}
+END_TEST
+
+/* per call site rate limiting and duplicate suppression */
+#define RATE_LIMIT 5
+#define RATE_COUNT 100
+
+START_TEST(rate_limit)
+{
+    FILE *const f = fdopen(extra_fd, "rb");
+    ck_assert(f != NULL);
+
+    /* make sure all lines fall into the same one second window */
+    const time_t start = time(NULL);
+    while (time(NULL) == start)
+        asc_usleep(1000);
+
+    asc_log_set_rate_limit(RATE_LIMIT);
+
+    /* same format string, different text */
+    for (unsigned int i = 0; i < RATE_COUNT; i++)
+        asc_log_info("flood %u", i);
+
+    /* pass-through messages are told apart by their text */
+    for (unsigned int i = 0; i < RATE_COUNT; i++)
+        asc_log_info("%s", (i % 2) ? "odd line" : "even line");
+
+    asc_log_stats_t stats;
+    asc_log_stats(&stats);
+    ck_assert(stats.suppressed == (RATE_COUNT - RATE_LIMIT)
+                                 + (RATE_COUNT - RATE_LIMIT * 2));
+
+    char buf[512];
+    for (unsigned int i = 0; i < RATE_LIMIT; i++)
+    {
+        ck_assert(fgets(buf, sizeof(buf), f) != NULL);
+
+        unsigned int n = RATE_COUNT;
+        char *const p = strstr(buf, "INFO: flood ");
+        ck_assert(p != NULL && sscanf(p, "INFO: flood %u", &n) == 1);
+        ck_assert(n == i);
+    }
+
+    for (unsigned int i = 0; i < RATE_LIMIT * 2; i++)
+    {
+        ck_assert(fgets(buf, sizeof(buf), f) != NULL);
+        ck_assert(strstr(buf, (i % 2) ? "odd line" : "even line") != NULL);
+    }
+
+    ck_assert(fgets(buf, sizeof(buf), f) == NULL);
+    ck_assert(fclose(f) == 0);
+}
+END_TEST
+
+/* summary of a flood is written once the next window begins */
+START_TEST(rate_rollover)
+{
+    FILE *const f = fdopen(extra_fd, "rb");
+    ck_assert(f != NULL);
+
+    const time_t start = time(NULL);
+    while (time(NULL) == start)
+        asc_usleep(1000);
+
+    asc_log_set_rate_limit(RATE_LIMIT);
+
+    const time_t window = time(NULL);
+    for (unsigned int i = 0; i < RATE_LIMIT * 2; i++)
+        asc_log_info("flood %u", i);
+
+    while (time(NULL) == window)
+        asc_usleep(1000);
+
+    asc_log_info("flood %u", RATE_LIMIT * 2);
+
+    char buf[512];
+    for (unsigned int i = 0; i < RATE_LIMIT; i++)
+        ck_assert(fgets(buf, sizeof(buf), f) != NULL);
+
+    ck_assert(fgets(buf, sizeof(buf), f) != NULL);
+    ck_assert(strstr(buf, "suppressed 5 messages: flood %u") != NULL);
+
+    ck_assert(fgets(buf, sizeof(buf), f) != NULL);
+    ck_assert(strstr(buf, "flood 10") != NULL);
+
+    ck_assert(fgets(buf, sizeof(buf), f) == NULL);
+    ck_assert(fclose(f) == 0);
+}
+END_TEST
+
+START_TEST(repeated)
+{
+    FILE *const f = fdopen(extra_fd, "rb");
+    ck_assert(f != NULL);
+
+    /* duplicates are written out as is by default */
+    for (unsigned int i = 0; i < 2; i++)
+        asc_log_warning("same thing again");
+
+    file_check(f, "WARNING: same thing again\n");
+    file_check(f, "WARNING: same thing again\n");
+
+    asc_log_set_dedup(true);
+
+    for (unsigned int i = 0; i < 10; i++)
+        asc_log_warning("same thing again");
+
+    asc_log_warning("something else");
+
+    file_check(f, "WARNING: same thing again\n");
+    file_check(f, "WARNING: last message repeated 9 times\n");
+    file_check(f, "WARNING: something else\n");
+
+    asc_log_stats_t stats;
+    asc_log_stats(&stats);
+    ck_assert(stats.repeated == 9);
+
+    ck_assert(fclose(f) == 0);
+}
+END_TEST
+
 Suite *core_log(void)
 {
     Suite *const s = suite_create("core/log");
@@ -193,6 +440,11 @@ Suite *core_log(void)
     tcase_add_test(tc, debug_flag);
     tcase_add_test(tc, log_file);
     tcase_add_test(tc, threaded);
+    tcase_add_test(tc, async);
+    tcase_add_test(tc, async_toggle);
+    tcase_add_test(tc, rate_limit);
+    tcase_add_test(tc, rate_rollover);
+    tcase_add_test(tc, repeated);
 
     suite_add_tcase(s, tc);
 
@@ -20,6 +20,7 @@
 
 #include "../libastra.h"
 #include <astra/core/mainloop.h>
+#include <astra/core/thread.h>
 #include <astra/core/timer.h>
 
 /* basic shutdown and reload commands */
@@ -224,6 +225,62 @@ START_TEST(callback_cancel)
 }
 END_TEST
 
+/* many threads posting jobs at once */
+#define MP_THREADS 8
+#define MP_JOBS 20000
+
+static asc_thread_t *mp_thr[MP_THREADS];
+static unsigned int mp_done;
+static unsigned int mp_closed;
+
+static void on_mp_job(void *arg)
+{
+    ASC_UNUSED(arg);
+    mp_done++;
+}
+
+static void mp_proc(void *arg)
+{
+    ASC_UNUSED(arg);
+
+    for (size_t i = 0; i < MP_JOBS; i++)
+        asc_job_queue(NULL, on_mp_job, NULL);
+}
+
+static void mp_close(void *arg)
+{
+    asc_thread_join(*(asc_thread_t **)arg);
+
+    /* exit job is queued after the thread's last job */
+    if (++mp_closed >= MP_THREADS)
+        asc_main_loop_shutdown();
+}
+
+START_TEST(multi_producer)
+{
+    mp_done = mp_closed = 0;
+    asc_wake_open();
+
+    for (size_t i = 0; i < MP_THREADS; i++)
+    {
+        mp_thr[i] = asc_thread_init(&mp_thr[i], mp_proc, mp_close);
+        ck_assert(mp_thr[i] != NULL);
+    }
+
+    ck_assert(asc_main_loop_run() == false);
+    ck_assert(mp_done == MP_THREADS * MP_JOBS);
+
+    asc_job_stats_t stats;
+    asc_job_stats(asc_main_loop_current(), &stats);
+    ck_assert(stats.depth == 0);
+    ck_assert(stats.total == MP_THREADS * MP_JOBS + MP_THREADS);
+    ck_assert(stats.depth_max > 0);
+    ck_assert(stats.latency_max >= stats.latency_avg);
+
+    asc_wake_close();
+}
+END_TEST
+
 /* shutting down while wake up pipe is still open */
 START_TEST(abandoned_pipe)
 {
@@ -246,6 +303,7 @@ Suite *core_mainloop(void)
     tcase_add_test(tc, callback_simple);
     tcase_add_test(tc, callback_prune);
     tcase_add_test(tc, callback_cancel);
+    tcase_add_test(tc, multi_producer);
     tcase_add_test(tc, abandoned_pipe);
 
     if (can_fork != CK_NOFORK)
@@ -0,0 +1,158 @@
+/*
+ * Astra Unit Tests
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../libastra.h"
+#include <astra/core/atomic.h>
+#include <astra/core/mainloop.h>
+#include <astra/core/ring.h>
+#include <astra/core/thread.h>
+
+#define ITEM(_n) ((void *)(uintptr_t)(_n))
+
+/* single thread push and pop */
+START_TEST(basic)
+{
+    asc_ring_t *const ring = asc_ring_init(5);
+    ck_assert(asc_ring_size(ring) == 8);
+    ck_assert(asc_ring_count(ring) == 0);
+    ck_assert(asc_ring_pop(ring) == NULL);
+
+    for (uintptr_t i = 1; i <= 8; i++)
+        ck_assert(asc_ring_push(ring, ITEM(i)));
+
+    ck_assert(asc_ring_count(ring) == 8);
+    ck_assert(!asc_ring_push(ring, ITEM(9)));
+
+    /* drop oldest, then there's room for one more */
+    ck_assert(asc_ring_pop(ring) == ITEM(1));
+    ck_assert(asc_ring_push(ring, ITEM(9)));
+
+    for (uintptr_t i = 2; i <= 9; i++)
+        ck_assert(asc_ring_pop(ring) == ITEM(i));
+
+    ck_assert(asc_ring_pop(ring) == NULL);
+    ck_assert(asc_ring_count(ring) == 0);
+
+    /* wrap around many times */
+    for (uintptr_t i = 1; i <= 1000; i++)
+    {
+        ck_assert(asc_ring_push(ring, ITEM(i)));
+        ck_assert(asc_ring_push(ring, ITEM(i)));
+        ck_assert(asc_ring_pop(ring) == ITEM(i));
+        ck_assert(asc_ring_pop(ring) == ITEM(i));
+    }
+
+    asc_ring_destroy(ring);
+}
+END_TEST
+
+/* producer dropping old items while consumer is popping */
+#define STRESS_ITEMS 1000000
+#define STRESS_SIZE 64
+
+static asc_ring_t *stress_ring;
+static asc_thread_t *stress_thr;
+static bool stress_done;
+static uintptr_t stress_received;
+
+static
+void stress_proc(void *arg)
+{
+    ASC_UNUSED(arg);
+
+    uintptr_t last = 0;
+    while (true)
+    {
+        const bool done = asc_atomic_load(&stress_done);
+        void *const item = asc_ring_pop(stress_ring);
+
+        if (item == NULL)
+        {
+            if (done)
+                break;
+
+            continue;
+        }
+
+        /* items may be dropped but never reordered or duplicated */
+        const uintptr_t value = (uintptr_t)item;
+        ck_assert(value > last);
+        last = value;
+
+        stress_received++;
+    }
+}
+
+static
+void stress_close(void *arg)
+{
+    ASC_UNUSED(arg);
+
+    asc_main_loop_shutdown();
+    asc_thread_join(stress_thr);
+}
+
+START_TEST(stress)
+{
+    stress_ring = asc_ring_init(STRESS_SIZE);
+    stress_done = false;
+    stress_received = 0;
+
+    stress_thr = asc_thread_init(NULL, stress_proc, stress_close);
+
+    uintptr_t dropped = 0;
+    for (uintptr_t i = 1; i <= STRESS_ITEMS; i++)
+    {
+        if (!asc_ring_push(stress_ring, ITEM(i)))
+        {
+            if (asc_ring_pop(stress_ring) != NULL)
+                dropped++;
+
+            ck_assert(asc_ring_push(stress_ring, ITEM(i)));
+        }
+    }
+
+    asc_atomic_store(&stress_done, true);
+    ck_assert(asc_main_loop_run() == false);
+
+    ck_assert(stress_received + dropped == STRESS_ITEMS);
+    ck_assert(asc_ring_count(stress_ring) == 0);
+
+    asc_ring_destroy(stress_ring);
+}
+END_TEST
+
+Suite *core_ring(void)
+{
+    Suite *const s = suite_create("core/ring");
+
+    TCase *const tc = tcase_create("default");
+    tcase_add_checked_fixture(tc, lib_setup, lib_teardown);
+
+    if (can_fork != CK_NOFORK)
+        tcase_set_timeout(tc, 30);
+
+    tcase_add_test(tc, basic);
+    tcase_add_test(tc, stress);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
@@ -80,8 +80,10 @@ static void on_hundred(void *arg)
     const uint64_t now = asc_utime();
     if (timer->last_run)
     {
+        /* deadlines keep a fixed period, so a call that ran late is
+         * followed by a slightly shorter gap */
         const unsigned diff = (now - timer->last_run) / 1000;
-        ck_assert_msg(diff >= timer->interval
+        ck_assert_msg(diff + 1 >= timer->interval
                       , "timer interval too short: %ums", diff);
     }
 
@@ -144,6 +146,71 @@ START_TEST(single_timer)
 }
 END_TEST
 
+/* short period shouldn't drift */
+#define DRIFT_INTERVAL 5 /* ms */
+#define DRIFT_MAX 128
+
+typedef struct
+{
+    uint64_t calls[DRIFT_MAX];
+    unsigned count;
+} drift_test_t;
+
+static void on_drift(void *arg)
+{
+    drift_test_t *const data = (drift_test_t *)arg;
+
+    if (data->count < DRIFT_MAX)
+        data->calls[data->count++] = asc_utime();
+}
+
+static int cmp_gap(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+START_TEST(period_drift)
+{
+    drift_test_t data;
+    memset(&data, 0, sizeof(data));
+
+    asc_timer_t *const timer =
+        asc_timer_init(DRIFT_INTERVAL, on_drift, &data);
+    ck_assert(timer != NULL);
+
+    /* 5ms * 100 events, fewer if the host is busy */
+    run_loop(500);
+    ck_assert(timed_out == true);
+    fail_unless(data.count >= 25 && data.count <= 101
+                , "wanted about 100 events, got %u", data.count);
+
+    /*
+     * Late calls skip whole periods and are followed by a short gap,
+     * but the typical gap must stay at the interval. Rounding each
+     * deadline up instead would make it a millisecond longer.
+     */
+    uint64_t gaps[DRIFT_MAX];
+    const unsigned cnt = data.count - 1;
+    for (unsigned i = 0; i < cnt; i++)
+        gaps[i] = data.calls[i + 1] - data.calls[i];
+
+    qsort(gaps, cnt, sizeof(*gaps), cmp_gap);
+    const uint64_t median = gaps[cnt / 2];
+    fail_unless(median >= (DRIFT_INTERVAL - 1) * 1000
+                && median <= DRIFT_INTERVAL * 1000 + 500
+                , "median period is %uus", (unsigned)median);
+
+    /* overall schedule: no more calls than there are grid points */
+    const uint64_t span = data.calls[cnt] - data.calls[0];
+    const uint64_t points = span / (DRIFT_INTERVAL * 1000) + 2;
+    fail_unless(data.count <= points
+                , "%u calls over %uus", data.count, (unsigned)span);
+}
+END_TEST
+
 /* single one shot timer */
 static void on_single_one_shot(void *arg)
 {
@@ -219,6 +286,115 @@ START_TEST(blocked_thread)
 }
 END_TEST
 
+/* timer core scaling benchmark */
+static void on_bench_timer(void *arg)
+{
+    unsigned *const triggered = (unsigned *)arg;
+    (*triggered)++;
+}
+
+/* average time of an idle loop pass with `count' pending timers, usec */
+static double bench_idle(size_t count)
+{
+    asc_timer_t **const list = ASC_ALLOC(count, asc_timer_t *);
+    unsigned triggered = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const unsigned ms = 10000 + (i % 1000) * 10;
+        list[i] = asc_timer_init(ms, on_bench_timer, &triggered);
+    }
+
+    const unsigned passes = 1000;
+    const uint64_t start = asc_utime();
+    for (unsigned i = 0; i < passes; i++)
+        ck_assert(asc_timer_core_loop() > 0);
+
+    const double bench = (double)(asc_utime() - start) / passes;
+    ck_assert(triggered == 0);
+
+    /* destroy in non-sequential order */
+    for (size_t i = 0; i < count; i += 2)
+        asc_timer_destroy(list[i]);
+
+    for (size_t i = 1; i < count; i += 2)
+        asc_timer_destroy(list[i]);
+
+    free(list);
+    return bench;
+}
+
+/* time needed to fire `count' timers due at the same moment, usec */
+static double bench_fire(size_t count)
+{
+    unsigned triggered = 0;
+
+    for (size_t i = 0; i < count; i++)
+        ck_assert(asc_timer_one_shot(0, on_bench_timer, &triggered) != NULL);
+
+    asc_usleep(2000);
+
+    const uint64_t start = asc_utime();
+    asc_timer_core_loop();
+    const double bench = (double)(asc_utime() - start);
+
+    ck_assert(triggered == count);
+    return bench;
+}
+
+START_TEST(scaling)
+{
+    static const size_t counts[] = { 100, 1000, 10000, 100000 };
+    double idle[ASC_ARRAY_SIZE(counts)];
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(counts); i++)
+    {
+        idle[i] = bench_idle(counts[i]);
+        const double fire = bench_fire(counts[i]);
+
+        asc_log_info("%zu timers: idle pass %.3fus, fire all %.0fus "
+                     "(%.3fus per timer)"
+                     , counts[i], idle[i], fire, fire / counts[i]);
+    }
+
+    /* idle pass must not depend on number of pending timers */
+    const double first = (idle[0] > 1.0) ? idle[0] : 1.0;
+    fail_unless(idle[ASC_ARRAY_SIZE(idle) - 1] < first * 10
+                , "idle pass scales with timer count (%.3fus vs %.3fus)"
+                , idle[ASC_ARRAY_SIZE(idle) - 1], idle[0]);
+}
+END_TEST
+
+/* destroy self and pending timers from callback */
+static asc_timer_t *chain[10];
+static unsigned chain_cnt;
+
+static void on_chain(void *arg)
+{
+    const size_t idx = (size_t)arg;
+    chain_cnt++;
+
+    /* destroy self and the next timer in chain */
+    asc_timer_destroy(chain[idx]);
+    if (idx + 1 < ASC_ARRAY_SIZE(chain))
+    {
+        asc_timer_destroy(chain[idx + 1]);
+        chain[idx + 1] = NULL;
+    }
+}
+
+START_TEST(destroy_chain)
+{
+    chain_cnt = 0;
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(chain); i++)
+        chain[i] = asc_timer_init(10 + (i % 2) * 5, on_chain, (void *)i);
+
+    run_loop(100);
+    ck_assert(timed_out == true);
+    ck_assert(chain_cnt == ASC_ARRAY_SIZE(chain) / 2);
+}
+END_TEST
+
 Suite *core_timer(void)
 {
     Suite *const s = suite_create("core/timer");
@@ -232,9 +408,12 @@ Suite *core_timer(void)
     tcase_add_test(tc, empty_loop);
     tcase_add_test(tc, hundred_timers);
     tcase_add_test(tc, single_timer);
+    tcase_add_test(tc, period_drift);
     tcase_add_test(tc, single_one_shot);
     tcase_add_test(tc, cancel_one_shot);
     tcase_add_test(tc, blocked_thread);
+    tcase_add_test(tc, scaling);
+    tcase_add_test(tc, destroy_chain);
 
     suite_add_tcase(s, tc);
 
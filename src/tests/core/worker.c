@@ -0,0 +1,195 @@
+/*
+ * Astra Unit Tests
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../libastra.h"
+#include <astra/core/mainloop.h>
+#include <astra/core/timer.h>
+#include <astra/core/worker.h>
+
+#define WORKER_COUNT 4
+
+/* start workers and look them up */
+START_TEST(start_stop)
+{
+    ck_assert(asc_worker_count() == 0);
+    ck_assert(asc_worker_id() == 0);
+
+    ck_assert(asc_worker_start(0) == false);
+    ck_assert(asc_worker_start(ASC_WORKER_MAX + 1) == false);
+
+    ck_assert(asc_worker_start(WORKER_COUNT) == true);
+    ck_assert(asc_worker_count() == WORKER_COUNT);
+    ck_assert(asc_worker_start(1) == false);
+
+    ck_assert(asc_worker_loop(0) == NULL);
+    ck_assert(asc_worker_loop(WORKER_COUNT + 1) == NULL);
+
+    for (unsigned int i = 1; i <= WORKER_COUNT; i++)
+    {
+        asc_main_loop_t *const loop = asc_worker_loop(i);
+
+        ck_assert(loop != NULL);
+        ck_assert(loop != asc_main_loop_current());
+        ck_assert(i == 1 || loop != asc_worker_loop(i - 1));
+    }
+}
+END_TEST
+
+/* synchronous calls to each worker */
+typedef struct
+{
+    unsigned int id;
+    asc_main_loop_t *loop;
+} call_test_t;
+
+static void on_call(void *arg)
+{
+    call_test_t *const ct = (call_test_t *)arg;
+
+    ct->id = asc_worker_id();
+    ct->loop = asc_main_loop_current();
+}
+
+START_TEST(job_call)
+{
+    ck_assert(asc_worker_start(WORKER_COUNT) == true);
+
+    for (unsigned int i = 1; i <= WORKER_COUNT; i++)
+    {
+        call_test_t ct = { 0, NULL };
+
+        asc_job_call(asc_worker_loop(i), on_call, &ct);
+        ck_assert(ct.id == i);
+        ck_assert(ct.loop == asc_worker_loop(i));
+    }
+
+    /* calling own loop runs procedure in place */
+    call_test_t ct = { ~0U, NULL };
+    asc_job_call(asc_main_loop_current(), on_call, &ct);
+    ck_assert(ct.id == 0);
+    ck_assert(ct.loop == asc_main_loop_current());
+}
+END_TEST
+
+/* timers created on a worker run on that worker */
+#define TIMER_SHOTS 10
+
+static unsigned int timer_shots;
+static unsigned int timer_bad_id;
+
+static void on_worker_done(void *arg)
+{
+    ASC_UNUSED(arg);
+    asc_main_loop_shutdown();
+}
+
+static void on_worker_timer(void *arg)
+{
+    asc_timer_t **const timer = (asc_timer_t **)arg;
+
+    if (asc_worker_id() != 2)
+        timer_bad_id++;
+
+    if (++timer_shots >= TIMER_SHOTS)
+    {
+        ASC_FREE(*timer, asc_timer_destroy);
+        asc_main_loop_shutdown();
+    }
+}
+
+static void on_timer_create(void *arg)
+{
+    asc_timer_t **const timer = (asc_timer_t **)arg;
+    *timer = asc_timer_init(5, on_worker_timer, timer);
+}
+
+START_TEST(worker_timer)
+{
+    ck_assert(asc_worker_start(WORKER_COUNT) == true);
+
+    asc_timer_t *timer = NULL;
+    timer_shots = timer_bad_id = 0;
+
+    asc_job_call(asc_worker_loop(2), on_timer_create, &timer);
+    ck_assert(timer != NULL);
+
+    ck_assert(asc_main_loop_run() == false);
+    ck_assert(timer_shots == TIMER_SHOTS);
+    ck_assert(timer_bad_id == 0);
+}
+END_TEST
+
+/* worker calling back into a waiting thread */
+typedef struct
+{
+    asc_main_loop_t *main;
+    unsigned int id[3];
+} nested_test_t;
+
+static void on_nested_inner(void *arg)
+{
+    unsigned int *const id = (unsigned int *)arg;
+    *id = asc_worker_id() + 100;
+}
+
+static void on_nested_outer(void *arg)
+{
+    nested_test_t *const nt = (nested_test_t *)arg;
+
+    asc_job_call(nt->main, on_nested_inner, &nt->id[0]);
+    asc_job_call(asc_worker_loop(3), on_nested_inner, &nt->id[1]);
+    nt->id[2] = asc_worker_id();
+}
+
+START_TEST(nested_call)
+{
+    ck_assert(asc_worker_start(WORKER_COUNT) == true);
+
+    nested_test_t nt = { asc_main_loop_current(), { 0, 0, 0 } };
+    asc_job_call(asc_worker_loop(1), on_nested_outer, &nt);
+
+    ck_assert(nt.id[0] == 100);
+    ck_assert(nt.id[1] == 103);
+    ck_assert(nt.id[2] == 1);
+
+    asc_job_queue(NULL, on_worker_done, NULL);
+    ck_assert(asc_main_loop_run() == false);
+}
+END_TEST
+
+Suite *core_worker(void)
+{
+    Suite *const s = suite_create("core/worker");
+
+    TCase *const tc = tcase_create("default");
+    tcase_add_checked_fixture(tc, lib_setup, lib_teardown);
+
+    if (can_fork != CK_NOFORK)
+        tcase_set_timeout(tc, 5);
+
+    tcase_add_test(tc, start_stop);
+    tcase_add_test(tc, job_call);
+    tcase_add_test(tc, worker_timer);
+    tcase_add_test(tc, nested_call);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
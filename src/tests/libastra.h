@@ -41,10 +41,12 @@ Suite *core_event(void);
 Suite *core_list(void);
 Suite *core_log(void);
 Suite *core_mainloop(void);
+Suite *core_ring(void);
 Suite *core_spawn(void);
 Suite *core_child(void);
 Suite *core_thread(void);
 Suite *core_timer(void);
+Suite *core_worker(void);
 
 /* luaapi */
 Suite *luaapi_luaapi(void);
@@ -62,12 +64,18 @@ Suite *lualib_rc4(void);
 Suite *lualib_sha1(void);
 Suite *lualib_strhex(void);
 Suite *lualib_utils(void);
+Suite *lualib_worker(void);
 
 /* mpegts */
+Suite *mpegts_block(void);
 Suite *mpegts_mpegts(void);
 Suite *mpegts_pcr(void);
 Suite *mpegts_sync(void);
 
+/* stream */
+Suite *stream_fec(void);
+Suite *stream_rtp(void);
+
 /* utils */
 Suite *utils_base64(void);
 Suite *utils_crc32b(void);
@@ -91,10 +99,12 @@ static suite_func_t suite_list[] = {
     core_list,
     core_log,
     core_mainloop,
+    core_ring,
     core_spawn,
     core_child,
     core_thread,
     core_timer,
+    core_worker,
 
     /* luaapi */
     luaapi_luaapi,
@@ -112,12 +122,18 @@ static suite_func_t suite_list[] = {
     lualib_sha1,
     lualib_strhex,
     lualib_utils,
+    lualib_worker,
 
     /* mpegts */
+    mpegts_block,
     mpegts_mpegts,
     mpegts_pcr,
     mpegts_sync,
 
+    /* stream */
+    stream_fec,
+    stream_rtp,
+
     /* utils */
     utils_base64,
     utils_crc32b,
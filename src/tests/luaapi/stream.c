@@ -19,6 +19,7 @@
  */
 
 #include "../libastra.h"
+#include <astra/luaapi/state.h>
 #include <astra/luaapi/stream.h>
 
 /*
@@ -535,6 +536,338 @@ START_TEST(demux_destroy)
 }
 END_TEST
 
+/* batched delivery, with and without batch callback */
+#define BATCH_SIZE 7
+
+static unsigned int batch_calls;
+static unsigned int batch_packets;
+static unsigned int single_packets;
+
+static void batch_on_ts(module_data_t *mod, const uint8_t *ts)
+{
+    single_packets++;
+    module_stream_send(mod, ts);
+}
+
+static void batch_on_batch(module_data_t *mod, const uint8_t *ts
+                           , size_t count)
+{
+    batch_calls++;
+    batch_packets += count;
+    module_stream_send_batch(mod, ts, count);
+}
+
+START_TEST(batch_send)
+{
+    uint8_t ts[TS_PACKET_SIZE * BATCH_SIZE];
+    memset(ts, 0, sizeof(ts));
+
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        ts[i * TS_PACKET_SIZE] = 0x47;
+        TS_SET_PID(&ts[i * TS_PACKET_SIZE], i);
+    }
+
+    batch_calls = batch_packets = single_packets = 0;
+    st_foobar.on_ts = batch_on_ts;
+    st_sink_a.on_ts = batch_on_ts;
+    st_sink_b.on_ts = batch_on_ts;
+
+    /* no batch callbacks: falls back to per-packet delivery */
+    module_stream_send_batch(mod_selector, ts, BATCH_SIZE);
+    ck_assert(batch_calls == 0);
+    ck_assert(single_packets == BATCH_SIZE * 3);
+
+    /* foobar takes whole batch, sinks still get single packets */
+    batch_calls = batch_packets = single_packets = 0;
+    module_stream_set_batch(mod_foobar, batch_on_batch);
+    module_stream_send_batch(mod_selector, ts, BATCH_SIZE);
+    ck_assert(batch_calls == 1);
+    ck_assert(batch_packets == BATCH_SIZE);
+    ck_assert(single_packets == BATCH_SIZE * 2);
+
+    /* whole tree is batch-aware */
+    batch_calls = batch_packets = single_packets = 0;
+    module_stream_set_batch(mod_sink_a, batch_on_batch);
+    module_stream_set_batch(mod_sink_b, batch_on_batch);
+    module_stream_send_batch(mod_selector, ts, BATCH_SIZE);
+    ck_assert(batch_calls == 3);
+    ck_assert(batch_packets == BATCH_SIZE * 3);
+    ck_assert(single_packets == 0);
+
+    /* per-packet send still uses on_ts */
+    batch_calls = batch_packets = single_packets = 0;
+    module_stream_send(mod_selector, ts);
+    ck_assert(batch_calls == 0);
+    ck_assert(single_packets == 3);
+}
+END_TEST
+
+/* shared block delivery */
+#define BLOCK_HELD 8
+
+static ts_block_t *block_held[2][BLOCK_HELD];
+static unsigned int block_held_cnt[2];
+
+static void block_on_block(module_data_t *mod, ts_block_t *block)
+{
+    const unsigned int id = (mod == mod_sink_a) ? 0 : 1;
+
+    ck_assert(block_held_cnt[id] < BLOCK_HELD);
+    block_held[id][block_held_cnt[id]++] = ts_block_ref(block);
+}
+
+static void block_forward(module_data_t *mod, ts_block_t *block)
+{
+    module_stream_send_block(mod, block);
+}
+
+static void block_release(void)
+{
+    for (size_t i = 0; i < 2; i++)
+    {
+        for (size_t j = 0; j < block_held_cnt[i]; j++)
+            ts_block_unref(block_held[i][j]);
+
+        block_held_cnt[i] = 0;
+    }
+}
+
+START_TEST(block_send)
+{
+    uint8_t ts[TS_PACKET_SIZE * (TS_BLOCK_PACKETS + 3)];
+    memset(ts, 0, sizeof(ts));
+
+    for (size_t i = 0; i < TS_BLOCK_PACKETS + 3; i++)
+    {
+        ts[i * TS_PACKET_SIZE] = 0x47;
+        TS_SET_PID(&ts[i * TS_PACKET_SIZE], i);
+    }
+
+    batch_calls = batch_packets = single_packets = 0;
+    st_foobar.on_ts = batch_on_ts;
+    module_stream_set_batch(mod_foobar, batch_on_batch);
+    module_stream_set_block(mod_foobar, block_forward);
+    module_stream_set_block(mod_sink_a, block_on_block);
+    module_stream_set_block(mod_sink_b, block_on_block);
+
+    /* raw batch is copied once; both sinks share the same blocks */
+    module_stream_send_batch(mod_selector, ts, TS_BLOCK_PACKETS + 3);
+    ck_assert(batch_calls == 1);
+    ck_assert(block_held_cnt[0] == 2 && block_held_cnt[1] == 2);
+    for (size_t i = 0; i < 2; i++)
+    {
+        ck_assert(block_held[0][i] == block_held[1][i]);
+        ck_assert(block_held[0][i]->refcnt == 2);
+    }
+    ck_assert(block_held[0][0]->count == TS_BLOCK_PACKETS);
+    ck_assert(block_held[0][1]->count == 3);
+    ck_assert(!memcmp(block_held[0][0]->ts, ts
+                      , TS_BLOCK_PACKETS * TS_PACKET_SIZE));
+    ck_assert(!memcmp(block_held[0][1]->ts
+                      , &ts[TS_BLOCK_PACKETS * TS_PACKET_SIZE]
+                      , 3 * TS_PACKET_SIZE));
+    block_release();
+
+    /* single packet takes the same path */
+    module_stream_send(mod_selector, ts);
+    ck_assert(single_packets == 1);
+    ck_assert(block_held_cnt[0] == 1 && block_held_cnt[1] == 1);
+    ck_assert(block_held[0][0] == block_held[1][0]);
+    ck_assert(block_held[0][0]->count == 1);
+    block_release();
+
+    /* block passes through without copying */
+    ts_block_t *const block = ts_block_copy(ts, TS_BLOCK_PACKETS);
+    module_stream_send_block(mod_selector, block);
+    ck_assert(block_held_cnt[0] == 1 && block_held_cnt[1] == 1);
+    ck_assert(block_held[0][0] == block && block_held[1][0] == block);
+    ck_assert(block->refcnt == 3);
+    block_release();
+    ck_assert(block->refcnt == 1);
+
+    /* block to batch-only child: unpacked into a batch */
+    batch_calls = batch_packets = 0;
+    module_stream_set_block(mod_foobar, NULL);
+    module_stream_send_block(mod_selector, block);
+    ck_assert(batch_calls == 1);
+    ck_assert(batch_packets == TS_BLOCK_PACKETS);
+    ck_assert(block_held_cnt[0] == 1 && block_held[0][0] != block);
+    block_release();
+
+    ts_block_unref(block);
+}
+END_TEST
+
+/* pid dispatch to filtering children */
+static unsigned int filter_calls[2];
+static unsigned int filter_packets[2][TS_MAX_PIDS];
+
+static void filter_on_ts(module_data_t *mod, const uint8_t *ts)
+{
+    const unsigned int id = (mod == mod_sink_a) ? 0 : 1;
+    filter_packets[id][TS_GET_PID(ts)]++;
+}
+
+static void filter_on_batch(module_data_t *mod, const uint8_t *ts
+                            , size_t count)
+{
+    const unsigned int id = (mod == mod_sink_a) ? 0 : 1;
+    filter_calls[id]++;
+
+    for (size_t i = 0; i < count; i++)
+        filter_packets[id][TS_GET_PID(&ts[i * TS_PACKET_SIZE])]++;
+}
+
+static void filter_send(module_data_t *mod, const uint16_t *pids
+                        , size_t count)
+{
+    uint8_t ts[TS_PACKET_SIZE * 16] = { 0 };
+    ck_assert(count <= 16);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ts[i * TS_PACKET_SIZE] = 0x47;
+        TS_SET_PID(&ts[i * TS_PACKET_SIZE], pids[i]);
+    }
+
+    memset(filter_calls, 0, sizeof(filter_calls));
+    memset(filter_packets, 0, sizeof(filter_packets));
+    module_stream_send_batch(mod, ts, count);
+}
+
+START_TEST(demux_filter)
+{
+    static const uint16_t pids[] = { 1, 1, 2, 2, 3, 4, 1 };
+
+    st_sink_a.on_ts = filter_on_ts;
+    st_sink_b.on_ts = filter_on_ts;
+    module_stream_set_batch(mod_sink_a, filter_on_batch);
+    module_stream_set_batch(mod_sink_b, filter_on_batch);
+
+    /* set filter before and after joining */
+    module_demux_set_filter(mod_sink_a, true);
+    module_demux_join(mod_sink_a, 1);
+    module_demux_join(mod_sink_a, 2);
+    module_demux_join(mod_sink_b, 2);
+    module_demux_join(mod_sink_b, 3);
+    module_demux_set_filter(mod_sink_b, true);
+
+    /* adjacent packets are batched per child */
+    filter_send(mod_foobar, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_calls[0] == 2);
+    ck_assert(filter_packets[0][1] == 3 && filter_packets[0][2] == 2);
+    ck_assert(filter_packets[0][3] == 0 && filter_packets[0][4] == 0);
+    ck_assert(filter_calls[1] == 1);
+    ck_assert(filter_packets[1][2] == 2 && filter_packets[1][3] == 1);
+    ck_assert(filter_packets[1][1] == 0 && filter_packets[1][4] == 0);
+
+    /* per-packet delivery */
+    module_stream_set_batch(mod_sink_b, NULL);
+    filter_send(mod_foobar, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_calls[1] == 0);
+    ck_assert(filter_packets[1][2] == 2 && filter_packets[1][3] == 1);
+    ck_assert(filter_packets[1][1] == 0 && filter_packets[1][4] == 0);
+
+    /* leaving a pid stops delivery */
+    module_demux_leave(mod_sink_a, 2);
+    filter_send(mod_foobar, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_calls[0] == 2);
+    ck_assert(filter_packets[0][1] == 3 && filter_packets[0][2] == 0);
+
+    /* memberships follow the child to its new parent */
+    module_stream_attach(mod_selector, mod_sink_a);
+    filter_send(mod_foobar, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_calls[0] == 0 && filter_packets[0][1] == 0);
+    filter_send(mod_selector, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_calls[0] == 2 && filter_packets[0][1] == 3);
+
+    /* unfiltered child gets everything */
+    module_demux_set_filter(mod_sink_b, false);
+    filter_send(mod_foobar, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_packets[1][1] == 3 && filter_packets[1][4] == 1);
+
+    /* single packets */
+    uint8_t ts[TS_PACKET_SIZE] = { 0x47 };
+    module_demux_set_filter(mod_sink_b, true);
+    memset(filter_packets, 0, sizeof(filter_packets));
+    TS_SET_PID(ts, 3);
+    module_stream_send(mod_foobar, ts);
+    TS_SET_PID(ts, 4);
+    module_stream_send(mod_foobar, ts);
+    ck_assert(filter_packets[1][3] == 1 && filter_packets[1][4] == 0);
+
+    /* destroyed child is removed from parent's table */
+    module_stream_destroy(mod_sink_b);
+    filter_send(mod_foobar, pids, ASC_ARRAY_SIZE(pids));
+    ck_assert(filter_packets[1][2] == 0 && filter_packets[1][3] == 0);
+}
+END_TEST
+
+/* per-node counters and tree snapshot */
+static void graph_on_ts(module_data_t *mod, const uint8_t *ts)
+{
+    module_stream_send(mod, ts);
+}
+
+static void graph_on_batch(module_data_t *mod, const uint8_t *ts
+                           , size_t count)
+{
+    module_stream_send_batch(mod, ts, count);
+}
+
+START_TEST(graph_stats)
+{
+    uint8_t ts[TS_PACKET_SIZE * 3] = { 0x47 };
+
+    module_stream_attach(mod_source_a, mod_selector);
+    st_selector.on_ts = graph_on_ts;
+    st_foobar.on_ts = graph_on_ts;
+    module_stream_set_batch(mod_foobar, graph_on_batch);
+    module_stream_set_name(mod_foobar, "foo");
+    module_stream_set_name(mod_foobar, "foobar");
+
+    module_stream_send(mod_source_a, ts);
+    module_stream_send_batch(mod_source_a, ts, 3);
+    module_stream_drop(mod_sink_b, 2);
+    ck_assert(module_stream_set_timing(true) == false);
+    ck_assert(module_stream_set_timing(false) == true);
+
+    /*
+     * roots are source_a and source_b; check the chain
+     * source_a -> selector -> foobar -> { sink_a, sink_b }
+     */
+    static const char script[] =
+        "local g = ...\n"
+        "assert(#g == 2)\n"
+        "local a = g[1]\n"
+        "assert(a.packets_in == 0 and a.packets_out == 4)\n"
+        "assert(a.bytes_out == 4 * 188 and #a.children == 1)\n"
+        "assert(#g[2].children == 0 and g[2].packets_out == 0)\n"
+        "local sel = a.children[1]\n"
+        "assert(sel.packets_in == 4 and sel.packets_out == 4)\n"
+        "local foo = sel.children[1]\n"
+        "assert(foo.name == 'foobar' and foo.worker == 0)\n"
+        "assert(foo.packets_in == 4 and foo.bytes_in == 4 * 188)\n"
+        "assert(#foo.children == 2)\n"
+        "local sa, sb = foo.children[1], foo.children[2]\n"
+        "assert(sa.id < sb.id and sa.name == nil)\n"
+        "assert(sa.packets_in == 4 and sa.drops == 0)\n"
+        "assert(sb.packets_in == 4 and sb.drops == 2)\n"
+        "assert(sb.packets_out == 0 and #sb.children == 0)\n";
+
+    ck_assert(luaL_loadstring(lua, script) == 0);
+    module_stream_graph(lua);
+    ck_assert(lua_pcall(lua, 1, 0, 0) == 0);
+
+    /* destroyed nodes disappear; their children become roots */
+    module_stream_destroy(mod_foobar);
+    module_stream_graph(lua);
+    ck_assert(luaL_len(lua, -1) == 4);
+    lua_pop(lua, 1);
+}
+END_TEST
+
 /* make sure double leave doesn't cause refcount underflow */
 #define DOUBLE_PID 0x1000
 
@@ -642,6 +975,10 @@ Suite *luaapi_stream(void)
     tcase_add_test(tc, demux_flood);
     tcase_add_test(tc, demux_stack);
     tcase_add_test(tc, demux_destroy);
+    tcase_add_test(tc, batch_send);
+    tcase_add_test(tc, block_send);
+    tcase_add_test(tc, demux_filter);
+    tcase_add_test(tc, graph_stats);
     tcase_add_test(tc, double_leave);
     suite_add_tcase(s, tc);
 
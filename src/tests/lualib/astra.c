@@ -20,6 +20,7 @@
 
 #include "../libastra.h"
 #include <astra/core/mainloop.h>
+#include <astra/core/timer.h>
 #include <astra/luaapi/state.h>
 
 #define L lua
@@ -69,6 +70,40 @@ START_TEST(astra_loopctl)
 }
 END_TEST
 
+/* test incremental garbage collection */
+#define GC_RUN_TIME 1500 /* msecs */
+
+static void gc_stop(void *arg)
+{
+    ASC_UNUSED(arg);
+    asc_main_loop_shutdown();
+}
+
+START_TEST(astra_gc)
+{
+    static const char *const script =
+        "assert(astra.gc_budget(200) > 0)\n"
+        "assert(astra.gc_budget() == 200)\n"
+        "assert(pcall(astra.gc_budget, 0) == false)\n"
+        "for i = 1, 100000 do local t = { i, tostring(i) } end\n";
+
+    ck_assert_msg(luaL_dostring(L, script) == 0, lua_tostring(L, -1));
+
+    asc_timer_t *const timer = asc_timer_one_shot(GC_RUN_TIME, gc_stop, NULL);
+    ck_assert(timer != NULL);
+    ck_assert(asc_main_loop_run() == false);
+
+    static const char *const check =
+        "local s = astra.gc_stats()\n"
+        "assert(s.budget == 200)\n"
+        "assert(s.heap > 0)\n"
+        "assert(s.steps > 0 and s.cycles > 0)\n"
+        "assert(s.pause_max >= s.pause_avg)\n";
+
+    ck_assert_msg(luaL_dostring(L, check) == 0, lua_tostring(L, -1));
+}
+END_TEST
+
 /* test abort */
 START_TEST(astra_abort)
 {
@@ -100,6 +135,7 @@ Suite *lualib_astra(void)
     tcase_add_checked_fixture(tc, lib_setup, lib_teardown);
     tcase_add_test(tc, version_data);
     tcase_add_test(tc, astra_loopctl);
+    tcase_add_test(tc, astra_gc);
 
     if (can_fork != CK_NOFORK)
     {
@@ -0,0 +1,140 @@
+/*
+ * Astra Unit Tests
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../libastra.h"
+#include <astra/core/mainloop.h>
+#include <astra/luaapi/state.h>
+
+#define L lua
+
+/* call functions on workers */
+START_TEST(run_func)
+{
+    static const char *const script =
+        "assert(worker.count() == 0)\n"
+        "assert(worker.id() == 0)\n"
+        "worker.start(2)\n"
+        "assert(worker.count() == 2)\n"
+        "local a, b = worker.run(2, function(x, y)\n"
+        "    return worker.id() + x, y .. '!'\n"
+        "end, 10, 'test')\n"
+        "assert(a == 12 and b == 'test!')\n"
+        "assert(worker.run(0, worker.id) == 0)\n"
+        "local ok, err = pcall(worker.run, 1, function()\n"
+        "    error('oops')\n"
+        "end)\n"
+        "assert(ok == false and err:find('oops'))\n"
+        "assert(pcall(worker.run, 3, function() end) == false)\n";
+
+    ck_assert_msg(luaL_dostring(L, script) == 0, lua_tostring(L, -1));
+}
+END_TEST
+
+/* module instance living on a worker */
+START_TEST(run_module)
+{
+    static const char *const script =
+        "worker.start(2)\n"
+        "ticks = 0\n"
+        "tmr = worker.run(1, function()\n"
+        "    return timer({\n"
+        "        interval = 1,\n"
+        "        callback = function(self)\n"
+        "            assert(worker.id() == 1)\n"
+        "            ticks = ticks + 1\n"
+        "            astra.shutdown()\n"
+        "        end,\n"
+        "    })\n"
+        "end)\n";
+
+    ck_assert_msg(luaL_dostring(L, script) == 0, lua_tostring(L, -1));
+    ck_assert(asc_main_loop_run() == false);
+
+    /* method call gets routed to worker */
+    static const char *const check =
+        "assert(ticks == 1)\n"
+        "tmr:close()\n"
+        "tmr = nil\n"
+        "collectgarbage()\n";
+
+    ck_assert_msg(luaL_dostring(L, check) == 0, lua_tostring(L, -1));
+}
+END_TEST
+
+/* workers calling each other from their own callbacks */
+START_TEST(cross_calls)
+{
+    static const char *const script =
+        "worker.start(2)\n"
+        "done = 0\n"
+        "tmr = {}\n"
+        "for id = 1, 2 do\n"
+        "    tmr[id] = worker.run(id, function()\n"
+        "        return timer({\n"
+        "            interval = 1,\n"
+        "            callback = function(self)\n"
+        "                self:close()\n"
+        "                local peer = 3 - id\n"
+        "                for i = 1, 200 do\n"
+        "                    local a, b, c = worker.run(peer, function(x)\n"
+        "                        local y = worker.run(id, function(z)\n"
+        "                            return z + 1\n"
+        "                        end, x)\n"
+        "                        return worker.id(), y, x\n"
+        "                    end, i)\n"
+        "                    assert(a == peer and b == i + 1 and c == i)\n"
+        "                end\n"
+        "                done = done + 1\n"
+        "                if done == 2 then astra.shutdown() end\n"
+        "            end,\n"
+        "        })\n"
+        "    end)\n"
+        "end\n";
+
+    ck_assert_msg(luaL_dostring(L, script) == 0, lua_tostring(L, -1));
+    ck_assert(asc_main_loop_run() == false);
+
+    static const char *const check =
+        "assert(done == 2)\n"
+        "tmr = nil\n"
+        "collectgarbage()\n";
+
+    ck_assert_msg(luaL_dostring(L, check) == 0, lua_tostring(L, -1));
+}
+END_TEST
+
+Suite *lualib_worker(void)
+{
+    Suite *const s = suite_create("lualib/worker");
+
+    TCase *const tc = tcase_create("default");
+    tcase_add_checked_fixture(tc, lib_setup, lib_teardown);
+
+    if (can_fork != CK_NOFORK)
+        tcase_set_timeout(tc, 5);
+
+    tcase_add_test(tc, run_func);
+    tcase_add_test(tc, run_module);
+    tcase_add_test(tc, cross_calls);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
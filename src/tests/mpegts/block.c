@@ -0,0 +1,184 @@
+/*
+ * Astra Unit Tests
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../libastra.h"
+#include <astra/core/thread.h>
+#include <astra/core/mainloop.h>
+#include <astra/mpegts/block.h>
+
+static
+void fill_packets(uint8_t *ts, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t *const pkt = &ts[i * TS_PACKET_SIZE];
+
+        memset(pkt, i, TS_PACKET_SIZE);
+        TS_INIT(pkt);
+        TS_SET_PID(pkt, i);
+    }
+}
+
+/* basic reference counting */
+START_TEST(refcount)
+{
+    uint8_t ts[TS_PACKET_SIZE * TS_BLOCK_PACKETS];
+    fill_packets(ts, TS_BLOCK_PACKETS);
+
+    ts_block_t *const block = ts_block_copy(ts, TS_BLOCK_PACKETS);
+    ck_assert(block->refcnt == 1);
+    ck_assert(block->count == TS_BLOCK_PACKETS);
+    ck_assert(ts_block_size(block) == sizeof(ts));
+    ck_assert(!memcmp(block->ts, ts, sizeof(ts)));
+
+    ck_assert(ts_block_ref(block) == block);
+    ck_assert(ts_block_ref(block) == block);
+    ck_assert(block->refcnt == 3);
+
+    ts_block_unref(block);
+    ts_block_unref(block);
+    ck_assert(block->refcnt == 1);
+    ts_block_unref(block);
+}
+END_TEST
+
+/* freed blocks are reused by the same thread */
+START_TEST(cache)
+{
+    ts_block_t *list[TS_BLOCK_CACHE];
+    ts_block_cache_flush();
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(list); i++)
+    {
+        list[i] = ts_block_alloc();
+        ck_assert(list[i]->refcnt == 1);
+        ck_assert(list[i]->count == 0);
+    }
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(list); i++)
+        ts_block_unref(list[i]);
+
+#ifdef HAVE_THREAD_LOCAL
+    /* LIFO order */
+    for (size_t i = ASC_ARRAY_SIZE(list); i > 0; i--)
+    {
+        ts_block_t *const block = ts_block_alloc();
+        ck_assert(block == list[i - 1]);
+        ts_block_unref(block);
+        ck_assert(ts_block_alloc() == block);
+        list[i - 1] = block;
+    }
+
+    for (size_t i = 0; i < ASC_ARRAY_SIZE(list); i++)
+        ts_block_unref(list[i]);
+#endif /* HAVE_THREAD_LOCAL */
+
+    ts_block_cache_flush();
+}
+END_TEST
+
+/* copy on write */
+START_TEST(writable)
+{
+    uint8_t ts[TS_PACKET_SIZE * 3];
+    fill_packets(ts, 3);
+
+    /* sole owner modifies in place */
+    ts_block_t *block = ts_block_copy(ts, 3);
+    ts_block_t *const orig = block;
+    block = ts_block_writable(block);
+    ck_assert(block == orig);
+
+    /* shared block gets copied */
+    ts_block_t *const shared = ts_block_ref(block);
+    block = ts_block_writable(block);
+    ck_assert(block != shared);
+    ck_assert(block->refcnt == 1);
+    ck_assert(shared->refcnt == 1);
+    ck_assert(block->count == 3);
+    ck_assert(!memcmp(block->ts, shared->ts, sizeof(ts)));
+
+    TS_SET_PID(block->ts[0], 0x100);
+    ck_assert(TS_GET_PID(block->ts[0]) == 0x100);
+    ck_assert(TS_GET_PID(shared->ts[0]) == 0);
+
+    ts_block_unref(block);
+    ts_block_unref(shared);
+}
+END_TEST
+
+/* block allocated on one thread, released on another */
+#define XTHREAD_BLOCKS 1000
+
+static ts_block_t *xthread_list[XTHREAD_BLOCKS];
+static asc_thread_t *xthread_thr;
+
+static
+void xthread_proc(void *arg)
+{
+    ASC_UNUSED(arg);
+
+    for (size_t i = 0; i < XTHREAD_BLOCKS; i++)
+        ts_block_unref(xthread_list[i]);
+}
+
+static
+void xthread_close(void *arg)
+{
+    ASC_UNUSED(arg);
+
+    asc_main_loop_shutdown();
+    asc_thread_join(xthread_thr);
+}
+
+START_TEST(cross_thread)
+{
+    for (size_t i = 0; i < XTHREAD_BLOCKS; i++)
+    {
+        xthread_list[i] = ts_block_alloc();
+        ts_block_ref(xthread_list[i]);
+    }
+
+    /* both threads drop their reference */
+    xthread_thr = asc_thread_init(NULL, xthread_proc, xthread_close);
+
+    for (size_t i = 0; i < XTHREAD_BLOCKS; i++)
+        ts_block_unref(xthread_list[i]);
+
+    ck_assert(asc_main_loop_run() == false);
+}
+END_TEST
+
+Suite *mpegts_block(void)
+{
+    Suite *const s = suite_create("mpegts/block");
+
+    TCase *const tc = tcase_create("default");
+    tcase_add_checked_fixture(tc, lib_setup, lib_teardown);
+
+    tcase_add_test(tc, refcount);
+    tcase_add_test(tc, cache);
+    tcase_add_test(tc, writable);
+    tcase_add_test(tc, cross_thread);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
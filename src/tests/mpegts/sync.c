@@ -124,6 +124,7 @@ START_TEST(setters)
         unsigned int enough;
         unsigned int low;
         unsigned int mbytes;
+        bool adaptive;
     } opt_test_t;
 
     ts_sync_t *const sx = ts_sync_init(fail_on_ts, NULL);
@@ -174,31 +175,49 @@ START_TEST(setters)
     {
         /* NOTE: passing empty string leaves configuration unchanged */
         { "", true,
-          def.enough, def.low, def.mbytes },
+          def.enough, def.low, def.mbytes, false },
 
         { "20,10,32", true,
-          20, 10, 32 },
+          20, 10, 32, false },
 
         { "", true,
-          20, 10, 32 },
+          20, 10, 32, false },
 
         { ",,", true,
-          20, 10, 32 },
+          20, 10, 32, false },
 
         { ",,,", false,
-          20, 10, 32 },
+          20, 10, 32, false },
 
         { "1,1001,", false,
-          20, 10, 32 },
+          20, 10, 32, false },
 
         { ",,16", true,
-          20, 10, 16 },
+          20, 10, 16, false },
 
         { "40,10", true,
-          40, 10, 16 },
+          40, 10, 16, false },
 
         { ",", true,
-          40, 10, 16},
+          40, 10, 16, false },
+
+        { "auto", true,
+          40, 10, 16, true },
+
+        { "auto,20,10", true,
+          20, 10, 16, true },
+
+        { "", true,
+          20, 10, 16, true },
+
+        { "automatic", false,
+          20, 10, 16, true },
+
+        { "auto20", false,
+          20, 10, 16, true },
+
+        { "20", true,
+          20, 10, 16, false },
     };
 
     for (size_t i = 0; i < ASC_ARRAY_SIZE(tests); i++)
@@ -210,6 +229,7 @@ START_TEST(setters)
         ck_assert(st.enough_blocks == t->enough);
         ck_assert(st.low_blocks == t->low);
         ck_assert(st.max_size == (t->mbytes * 1048576) / TS_PACKET_SIZE);
+        ck_assert(st.adaptive == t->adaptive);
 
         /* reset doesn't affect buffer configuration */
         ts_sync_reset(sx);
@@ -1742,6 +1762,343 @@ START_TEST(ts_bench)
 }
 END_TEST
 
+/* dequeue on the pacing thread */
+#define PACE_BITRATE 2000000 /* 2 Mbps */
+#define PACE_PCR_INTERVAL 20 /* 20ms */
+#define PACE_DURATION 400 /* 400ms */
+#define PACE_LOW_THRESH 2
+
+typedef struct
+{
+    size_t rx_packets;
+    uint64_t first;
+    uint64_t last;
+} pace_test_t;
+
+static
+void pace_on_ts(void *arg, const uint8_t ts[TS_PACKET_SIZE])
+{
+    pace_test_t *const t = (pace_test_t *)arg;
+    ASC_UNUSED(ts);
+
+    /* runs on the pacing thread; checked after join */
+    const uint64_t now = asc_utime();
+    if (t->first == 0)
+        t->first = now;
+
+    t->last = now;
+    t->rx_packets++;
+}
+
+START_TEST(pace_thread)
+{
+    pace_test_t t;
+    memset(&t, 0, sizeof(t));
+
+    ts_sync_t *sx = ts_sync_init(pace_on_ts, &t);
+    ck_assert(ts_sync_set_blocks(sx, PACE_LOW_THRESH, PACE_LOW_THRESH));
+
+    ts_generator_t gen;
+    memset(&gen, 0, sizeof(gen));
+
+    const size_t blocks = (PACE_DURATION / PACE_PCR_INTERVAL) + 1;
+    size_t tx_blocks = 0;
+
+    while (tx_blocks < blocks)
+    {
+        uint8_t ts[TS_PACKET_SIZE];
+
+        if (ts_generator(&gen, ts))
+        {
+            ck_assert(ts_sync_push(sx, ts, 1) == true);
+        }
+        else
+        {
+            gen.bitrate = PACE_BITRATE;
+            gen.duration = PACE_PCR_INTERVAL;
+            tx_blocks++;
+        }
+    }
+
+    ts_sync_stat_t st;
+    ts_sync_query(sx, &st);
+    ck_assert(!st.paced);
+
+    ck_assert(ts_sync_start(sx, -1));
+    ts_sync_query(sx, &st);
+    ck_assert(st.paced);
+
+    /* push from this thread while the other one dequeues */
+    asc_usleep((PACE_DURATION / 2) * 1000);
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        uint8_t ts[TS_PACKET_SIZE];
+
+        gen.bitrate = PACE_BITRATE;
+        gen.duration = PACE_PCR_INTERVAL;
+
+        while (ts_generator(&gen, ts))
+            ck_assert(ts_sync_push(sx, ts, 1) == true);
+    }
+
+    asc_usleep(PACE_DURATION * 1000);
+    ts_sync_query(sx, &st);
+    ts_sync_stop(sx);
+
+    /* every packet sent is in the histogram */
+    uint64_t total = 0;
+    for (size_t i = 0; i < SYNC_HIST_BUCKETS; i++)
+        total += st.late_hist[i];
+
+    asc_log_debug("pace_thread: sent %zu packets, max error %uus"
+                  , t.rx_packets, st.late_max);
+    asc_log_debug("pace_thread: histogram %llu %llu %llu %llu"
+                  " %llu %llu %llu %llu"
+                  , (unsigned long long)st.late_hist[0]
+                  , (unsigned long long)st.late_hist[1]
+                  , (unsigned long long)st.late_hist[2]
+                  , (unsigned long long)st.late_hist[3]
+                  , (unsigned long long)st.late_hist[4]
+                  , (unsigned long long)st.late_hist[5]
+                  , (unsigned long long)st.late_hist[6]
+                  , (unsigned long long)st.late_hist[7]);
+
+    ck_assert(t.rx_packets > 0);
+    ck_assert(total == t.rx_packets);
+
+    /* check average bitrate */
+    ck_assert(t.last > t.first);
+    const double bitrate = (t.rx_packets * TS_PACKET_BITS * 1000000.0)
+                           / (t.last - t.first);
+
+    asc_log_debug("pace_thread: bitrate %.2f", bitrate);
+    ck_assert(bitrate > PACE_BITRATE * 0.9 && bitrate < PACE_BITRATE * 1.1);
+
+    ASC_FREE(sx, ts_sync_destroy);
+}
+END_TEST
+
+/* launch time mode: packets leave early, stamped with their send time */
+#define LEAD_BITRATE 2000000 /* 2 Mbps */
+#define LEAD_PCR_INTERVAL 20 /* 20 ms */
+#define LEAD_BLOCKS 30
+#define LEAD_DURATION 300 /* 300 ms */
+#define LEAD_TIME 50000 /* 50 ms */
+#define LEAD_LOW_THRESH 2
+#define LEAD_STARTUP 2 /* packets sent before the bitrate is known */
+
+typedef struct
+{
+    ts_sync_t *sx;
+
+    size_t rx_packets;
+    uint64_t first_due;
+    uint64_t last_due;
+    int64_t min_early;
+    int64_t max_early;
+} lead_test_t;
+
+static
+void lead_on_ts(void *arg, const uint8_t *ts)
+{
+    lead_test_t *const t = (lead_test_t *)arg;
+    ck_assert(TS_IS_SYNC(ts));
+
+    const uint64_t due = ts_sync_due(t->sx);
+    const int64_t early = (int64_t)(due - asc_utime());
+
+    if (t->rx_packets++ == 0)
+    {
+        t->first_due = due;
+        t->min_early = t->max_early = early;
+    }
+    else
+    {
+        ck_assert(due >= t->last_due);
+
+        if (early < t->min_early)
+            t->min_early = early;
+
+        if (early > t->max_early)
+            t->max_early = early;
+    }
+
+    t->last_due = due;
+}
+
+START_TEST(lead_time)
+{
+    lead_test_t t;
+    memset(&t, 0, sizeof(t));
+
+    ts_sync_t *sx = ts_sync_init(lead_on_ts, &t);
+    ck_assert(ts_sync_set_blocks(sx, LEAD_LOW_THRESH, LEAD_LOW_THRESH));
+    ts_sync_set_lead(sx, LEAD_TIME);
+    t.sx = sx;
+
+    ts_generator_t gen;
+    memset(&gen, 0, sizeof(gen));
+
+    for (size_t i = 0; i < LEAD_BLOCKS; i++)
+    {
+        uint8_t ts[TS_PACKET_SIZE];
+
+        gen.bitrate = LEAD_BITRATE;
+        gen.duration = LEAD_PCR_INTERVAL;
+
+        while (ts_generator(&gen, ts))
+            ck_assert(ts_sync_push(sx, ts, 1) == true);
+    }
+
+    const uint64_t start = asc_utime();
+    while (asc_utime() - start < LEAD_DURATION * 1000)
+    {
+        ts_sync_loop(sx);
+        asc_usleep(1000);
+    }
+
+    ts_sync_stat_t st;
+    ts_sync_query(sx, &st);
+
+    asc_log_debug("lead_time: sent %zu packets, %lld to %lldus early"
+                  , t.rx_packets, (long long)t.min_early
+                  , (long long)t.max_early);
+
+    /* nothing but the first packets was released past its send time */
+    ck_assert(t.rx_packets > 0);
+    ck_assert(st.late_hist[0] + LEAD_STARTUP >= t.rx_packets);
+
+    /* never more than the lead time and a timer tick ahead */
+    ck_assert(t.max_early <= LEAD_TIME + 1000);
+    ck_assert(t.min_early > -5000);
+
+    /* send times follow the stream bitrate */
+    ck_assert(t.last_due > t.first_due);
+    const double bitrate = ((t.rx_packets - 1) * TS_PACKET_BITS * 1000000.0)
+                           / (t.last_due - t.first_due);
+
+    asc_log_debug("lead_time: bitrate %.2f", bitrate);
+    ck_assert(bitrate > LEAD_BITRATE * 0.95 && bitrate < LEAD_BITRATE * 1.05);
+
+    ASC_FREE(sx, ts_sync_destroy);
+}
+END_TEST
+
+/* adaptive thresholds: input jitter and growth on underrun */
+#define ADAPT_BITRATE 2000000 /* 2 Mbps */
+#define ADAPT_PCR_INTERVAL 20 /* 20 ms */
+#define ADAPT_BLOCKS 6
+#define ADAPT_ENOUGH 4
+#define ADAPT_LOW 2
+
+static
+void adapt_on_ts(void *arg, const uint8_t *ts)
+{
+    size_t *const rx_packets = (size_t *)arg;
+
+    ck_assert(TS_IS_SYNC(ts));
+    (*rx_packets)++;
+}
+
+static
+void adapt_push(ts_sync_t *sx, ts_generator_t *gen, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; i++)
+    {
+        uint8_t ts[TS_PACKET_SIZE];
+
+        gen->bitrate = ADAPT_BITRATE;
+        gen->duration = ADAPT_PCR_INTERVAL;
+
+        while (ts_generator(gen, ts))
+            ck_assert(ts_sync_push(sx, ts, 1) == true);
+    }
+}
+
+START_TEST(adaptive)
+{
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        const bool on = (pass > 0);
+        size_t rx_packets = 0;
+
+        ts_sync_t *sx = ts_sync_init(adapt_on_ts, &rx_packets);
+        ck_assert(ts_sync_set_blocks(sx, ADAPT_ENOUGH, ADAPT_LOW));
+        ts_sync_set_adaptive(sx, on);
+
+        /* stream arrives at once: jitter is the part seen before output */
+        ts_generator_t gen;
+        memset(&gen, 0, sizeof(gen));
+        adapt_push(sx, &gen, ADAPT_BLOCKS);
+
+        ts_sync_stat_t st;
+        ts_sync_query(sx, &st);
+        ck_assert(st.adaptive == on);
+        ck_assert(st.underruns == 0);
+        ck_assert(st.jitter > ADAPT_PCR_INTERVAL * 1000);
+        ck_assert(st.jitter < (ADAPT_BLOCKS + 1) * ADAPT_PCR_INTERVAL * 1000);
+
+        /* play it out until the buffer runs low */
+        const uint64_t start = asc_utime();
+        while (st.underruns == 0)
+        {
+            ck_assert(asc_utime() - start < 1000000);
+
+            ts_sync_loop(sx);
+            asc_usleep(SYNC_INTERVAL_MSEC * 1000);
+            ts_sync_query(sx, &st);
+        }
+
+        ck_assert(rx_packets > 0);
+        ck_assert(st.grown == (on ? 1 : 0));
+        ck_assert(st.shrunk == 0);
+
+        if (on)
+        {
+            ck_assert(st.enough_blocks == ADAPT_ENOUGH + 1);
+            ck_assert(st.low_blocks == ADAPT_LOW);
+        }
+        else
+        {
+            ck_assert(st.enough_blocks == ADAPT_ENOUGH);
+            ck_assert(st.low_blocks == ADAPT_LOW);
+        }
+
+        /* adaptive mode waits for the raised level, not just low */
+        const size_t stalled = rx_packets;
+        adapt_push(sx, &gen, ADAPT_LOW + 1);
+
+        for (size_t i = 0; i < 10; i++)
+        {
+            ts_sync_loop(sx);
+            asc_usleep(SYNC_INTERVAL_MSEC * 1000);
+        }
+
+        if (on)
+            ck_assert(rx_packets == stalled);
+        else
+            ck_assert(rx_packets > stalled);
+
+        /* output resumes once there's enough data again */
+        adapt_push(sx, &gen, ADAPT_BLOCKS);
+
+        for (size_t i = 0; i < 10; i++)
+        {
+            ts_sync_loop(sx);
+            asc_usleep(SYNC_INTERVAL_MSEC * 1000);
+        }
+
+        ck_assert(rx_packets > stalled);
+
+        ts_sync_query(sx, &st);
+        ck_assert(st.underruns == 1);
+
+        ASC_FREE(sx, ts_sync_destroy);
+    }
+}
+END_TEST
+
 Suite *mpegts_sync(void)
 {
     Suite *const s = suite_create("mpegts/sync");
@@ -1762,6 +2119,9 @@ Suite *mpegts_sync(void)
     tcase_add_test(tc, time_travel);
     tcase_add_test(tc, ts_pull);
     tcase_add_test(tc, ts_bench);
+    tcase_add_test(tc, pace_thread);
+    tcase_add_test(tc, lead_time);
+    tcase_add_test(tc, adaptive);
 
     suite_add_tcase(s, tc);
 
@@ -0,0 +1,393 @@
+/*
+ * Astra Unit Tests
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../libastra.h"
+#include <stream/udp/fec.h>
+#include <stream/udp/rtp.h>
+
+#define MTU 256
+#define MAX_MEDIA 128
+#define MAX_FEC 64
+
+/*
+ * Encodes a run of media datagrams, then feeds them to the decoder in
+ * the order a receiver would see them, leaving out the lost ones.
+ */
+typedef struct
+{
+    uint8_t media[MAX_MEDIA][MTU];
+    size_t media_len[MAX_MEDIA];
+    size_t media_cnt;
+
+    uint8_t fec[MAX_FEC][MTU + FEC_HEADER_SIZE];
+    size_t fec_len[MAX_FEC];
+    size_t fec_after[MAX_FEC]; /* index of the media that triggered it */
+    size_t fec_cnt;
+
+    uint8_t out[MAX_MEDIA][MTU];
+    size_t out_len[MAX_MEDIA];
+    size_t out_cnt;
+} fec_test_t;
+
+static fec_test_t *t;
+
+static void on_fec(void *arg, bool is_row, const uint8_t *pkt, size_t len)
+{
+    ASC_UNUSED(arg);
+    ASC_UNUSED(is_row);
+
+    ck_assert(t->fec_cnt < MAX_FEC);
+    ck_assert(len <= sizeof(t->fec[0]));
+
+    memcpy(t->fec[t->fec_cnt], pkt, len);
+    t->fec_len[t->fec_cnt] = len;
+    t->fec_after[t->fec_cnt] = t->media_cnt - 1;
+    t->fec_cnt++;
+}
+
+static void on_deliver(void *arg, const uint8_t *data, size_t len)
+{
+    ASC_UNUSED(arg);
+
+    ck_assert(t->out_cnt < MAX_MEDIA);
+    ck_assert(len <= MTU);
+
+    memcpy(t->out[t->out_cnt], data, len);
+    t->out_len[t->out_cnt] = len;
+    t->out_cnt++;
+}
+
+/* RTP datagram with a payload whose size and contents depend on `seq' */
+static size_t make_media(uint8_t *pkt, uint16_t seq)
+{
+    const size_t plen = 100 + (seq * 7) % 100;
+
+    pkt[0] = 0x80;
+    pkt[1] = 33 | ((seq % 5 == 0) ? 0x80 : 0);
+    pkt[2] = seq >> 8;
+    pkt[3] = seq;
+
+    const uint32_t ts = seq * 3003;
+    pkt[4] = ts >> 24;
+    pkt[5] = ts >> 16;
+    pkt[6] = ts >> 8;
+    pkt[7] = ts;
+
+    pkt[8] = 0xDE;
+    pkt[9] = 0xAD;
+    pkt[10] = 0xBE;
+    pkt[11] = 0xEF;
+
+    for (size_t i = 0; i < plen; i++)
+        pkt[RTP_HEADER_SIZE + i] = (uint8_t)(seq ^ (i * 13));
+
+    return RTP_HEADER_SIZE + plen;
+}
+
+static void encode(unsigned cols, unsigned rows, bool row_fec
+                   , uint16_t first, size_t count)
+{
+    fec_encoder_t *const enc =
+        fec_encoder_init(cols, rows, row_fec, MTU - RTP_HEADER_SIZE
+                         , on_fec, NULL);
+
+    ck_assert(count <= MAX_MEDIA);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t *const pkt = t->media[i];
+        t->media_len[i] = make_media(pkt, first + i);
+        t->media_cnt++;
+
+        fec_encoder_push(enc, pkt, t->media_len[i]);
+    }
+
+    fec_encoder_destroy(enc);
+}
+
+/* deliver everything except `lost', then let the window time out */
+static void decode(const size_t *lost, size_t lost_cnt, rtp_stats_t *st)
+{
+    rtp_reorder_t *const r =
+        rtp_reorder_init(128, 1000, MTU, true, on_deliver, NULL);
+
+    size_t f = 0;
+    for (size_t i = 0; i < t->media_cnt; i++)
+    {
+        bool skip = false;
+        for (size_t j = 0; j < lost_cnt; j++)
+        {
+            if (lost[j] == i)
+                skip = true;
+        }
+
+        if (!skip)
+            rtp_reorder_push(r, t->media[i], t->media_len[i], 0);
+
+        for (; f < t->fec_cnt && t->fec_after[f] == i; f++)
+            rtp_reorder_fec(r, t->fec[f], t->fec_len[f], 0);
+    }
+
+    /* each poll gives up on one gap */
+    uint64_t now = 0;
+    do
+    {
+        now += 1000;
+        rtp_reorder_poll(r, now);
+        rtp_reorder_stats(r, st);
+    } while (st->pending > 0 && now < 1000000);
+
+    rtp_reorder_destroy(r);
+}
+
+/* check that output is the media in order, except `missing' */
+static void check_output(const size_t *missing, size_t missing_cnt)
+{
+    size_t o = 0;
+    for (size_t i = 0; i < t->media_cnt; i++)
+    {
+        bool gone = false;
+        for (size_t j = 0; j < missing_cnt; j++)
+        {
+            if (missing[j] == i)
+                gone = true;
+        }
+
+        if (gone)
+            continue;
+
+        ck_assert_msg(o < t->out_cnt, "datagram %zu not delivered", i);
+        ck_assert_msg(t->out_len[o] == t->media_len[i]
+                      && !memcmp(t->out[o], t->media[i], t->media_len[i])
+                      , "datagram %zu doesn't match", i);
+        o++;
+    }
+
+    ck_assert_msg(o == t->out_cnt, "%zu extra datagrams", t->out_cnt - o);
+}
+
+static void fec_setup(void)
+{
+    lib_setup();
+    t = ASC_ALLOC(1, fec_test_t);
+}
+
+static void fec_teardown(void)
+{
+    ASC_FREE(t, free);
+    lib_teardown();
+}
+
+/* header round trip */
+START_TEST(parse)
+{
+    encode(4, 3, true, 1000, 12);
+    ck_assert(t->fec_cnt == 3 + 4);
+
+    size_t rows = 0, cols = 0;
+    for (size_t i = 0; i < t->fec_cnt; i++)
+    {
+        fec_header_t hdr;
+        ck_assert(fec_parse(t->fec[i], t->fec_len[i], &hdr));
+
+        if (hdr.is_row)
+        {
+            ck_assert(hdr.snbase == 1000 + rows * 4);
+            ck_assert(hdr.offset == 1 && hdr.na == 4);
+            rows++;
+        }
+        else
+        {
+            ck_assert(hdr.snbase == 1000 + cols);
+            ck_assert(hdr.offset == 4 && hdr.na == 3);
+            cols++;
+        }
+    }
+
+    ck_assert(rows == 3 && cols == 4);
+
+    /* no E bit */
+    t->fec[0][RTP_HEADER_SIZE + 4] &= ~0x80;
+    fec_header_t hdr;
+    ck_assert(!fec_parse(t->fec[0], t->fec_len[0], &hdr));
+}
+END_TEST
+
+/* one loss in a row, row FEC only */
+START_TEST(row_loss)
+{
+    encode(5, 1, true, 200, 20);
+
+    static const size_t lost[] = { 2, 6, 14 };
+    rtp_stats_t st;
+    decode(lost, ASC_ARRAY_SIZE(lost), &st);
+
+    check_output(NULL, 0);
+    ck_assert(st.recovered == 3);
+    ck_assert(st.lost == 0 && st.unrecoverable == 0);
+}
+END_TEST
+
+/* one loss per column; rows lose two each */
+START_TEST(column_loss)
+{
+    encode(4, 3, false, 300, 24);
+
+    /* first matrix: row 1 loses columns 0 and 3 */
+    static const size_t lost[] = { 4, 7, 13, 22 };
+    rtp_stats_t st;
+    decode(lost, ASC_ARRAY_SIZE(lost), &st);
+
+    check_output(NULL, 0);
+    ck_assert(st.recovered == 4);
+    ck_assert(st.lost == 0 && st.unrecoverable == 0);
+}
+END_TEST
+
+/* needs rows and columns together */
+START_TEST(cross_loss)
+{
+    encode(4, 4, true, 400, 32);
+
+    /*
+     * Second matrix: row 0 has one loss, row 1 two. Column 0 has two as
+     * well, so it takes the row to free up the column and the other
+     * column to free up the row.
+     */
+    static const size_t lost[] = { 16, 20, 21 };
+    rtp_stats_t st;
+    decode(lost, ASC_ARRAY_SIZE(lost), &st);
+
+    check_output(NULL, 0);
+    ck_assert(st.recovered == 3);
+    ck_assert(st.lost == 0 && st.unrecoverable == 0);
+}
+END_TEST
+
+/* matrix that crosses the sequence wrap, followed by the next one */
+START_TEST(matrix_wrap)
+{
+    encode(4, 2, true, 65530, 24);
+
+    static const size_t lost[] = { 5, 6, 9, 19 };
+    rtp_stats_t st;
+    decode(lost, ASC_ARRAY_SIZE(lost), &st);
+
+    check_output(NULL, 0);
+    ck_assert(st.recovered == 4);
+    ck_assert(st.lost == 0 && st.unrecoverable == 0);
+
+    /* every matrix starts over in the first column */
+    size_t cols = 0;
+    for (size_t i = 0; i < t->fec_cnt; i++)
+    {
+        fec_header_t hdr;
+        ck_assert(fec_parse(t->fec[i], t->fec_len[i], &hdr));
+        if (hdr.is_row)
+            continue;
+
+        const uint16_t want = 65530 + (cols / 4) * 8 + (cols % 4);
+        ck_assert_msg(hdr.snbase == want, "snbase %u, wanted %u"
+                      , hdr.snbase, want);
+        cols++;
+    }
+
+    ck_assert(cols == 12);
+}
+END_TEST
+
+/* two losses in one group with nothing else to help */
+START_TEST(double_loss)
+{
+    encode(5, 1, true, 500, 10);
+
+    static const size_t lost[] = { 1, 3 };
+    rtp_stats_t st;
+    decode(lost, ASC_ARRAY_SIZE(lost), &st);
+
+    check_output(lost, ASC_ARRAY_SIZE(lost));
+    ck_assert(st.recovered == 0);
+    ck_assert(st.lost == 2 && st.unrecoverable == 2);
+}
+END_TEST
+
+/* datagram too big to protect keeps its place in the matrix */
+START_TEST(oversized)
+{
+    fec_encoder_t *const enc =
+        fec_encoder_init(4, 2, true, MTU - RTP_HEADER_SIZE - 16
+                         , on_fec, NULL);
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        uint8_t *const pkt = t->media[i];
+        t->media_len[i] = make_media(pkt, 600 + i);
+        t->media_cnt++;
+
+        /* second column of the first row is over the limit */
+        if (i == 1)
+            t->media_len[i] = MTU;
+
+        fec_encoder_push(enc, pkt, t->media_len[i]);
+    }
+
+    fec_encoder_destroy(enc);
+
+    /* its row and column are dropped; the rest keep their positions */
+    ck_assert(t->fec_cnt == (4 + 2) * 2 - 2);
+    for (size_t i = 0; i < t->fec_cnt; i++)
+    {
+        fec_header_t hdr;
+        ck_assert(fec_parse(t->fec[i], t->fec_len[i], &hdr));
+
+        if (hdr.is_row)
+            ck_assert(hdr.snbase % 4 == 0 && hdr.snbase != 600);
+        else
+            ck_assert((hdr.snbase - 600) % 8 < 4 && hdr.snbase != 601);
+    }
+
+    /* losses elsewhere are still recovered */
+    static const size_t lost[] = { 6, 10 };
+    rtp_stats_t st;
+    decode(lost, ASC_ARRAY_SIZE(lost), &st);
+
+    check_output(NULL, 0);
+    ck_assert(st.recovered == 2);
+}
+END_TEST
+
+Suite *stream_fec(void)
+{
+    Suite *const s = suite_create("stream/fec");
+
+    TCase *const tc = tcase_create("default");
+    tcase_add_checked_fixture(tc, fec_setup, fec_teardown);
+
+    tcase_add_test(tc, parse);
+    tcase_add_test(tc, row_loss);
+    tcase_add_test(tc, column_loss);
+    tcase_add_test(tc, cross_loss);
+    tcase_add_test(tc, matrix_wrap);
+    tcase_add_test(tc, double_loss);
+    tcase_add_test(tc, oversized);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}
@@ -0,0 +1,281 @@
+/*
+ * Astra Unit Tests
+ * http://cesbo.com/astra
+ *
+ * Copyright (C) 2017, Artem Kharitonov <artem@3phase.pw>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../libastra.h"
+#include <stream/udp/rtp.h>
+
+#define MTU 64
+#define MAX_OUT 64
+
+static uint16_t out[MAX_OUT];
+static size_t out_cnt;
+
+static void on_deliver(void *arg, const uint8_t *data, size_t len)
+{
+    ASC_UNUSED(arg);
+
+    ck_assert(len == MTU);
+    ck_assert(out_cnt < MAX_OUT);
+
+    /* payload repeats the sequence number */
+    const uint16_t seq = (data[2] << 8) | data[3];
+    ck_assert(data[RTP_HEADER_SIZE] == (uint8_t)(seq >> 8));
+    ck_assert(data[RTP_HEADER_SIZE + 1] == (uint8_t)seq);
+
+    out[out_cnt++] = seq;
+}
+
+static void push(rtp_reorder_t *r, uint16_t seq, uint64_t now)
+{
+    uint8_t pkt[MTU];
+    memset(pkt, 0, sizeof(pkt));
+
+    pkt[0] = 0x80;
+    pkt[1] = 33;
+    pkt[2] = seq >> 8;
+    pkt[3] = seq;
+    pkt[RTP_HEADER_SIZE] = seq >> 8;
+    pkt[RTP_HEADER_SIZE + 1] = seq;
+
+    rtp_reorder_push(r, pkt, sizeof(pkt), now);
+}
+
+static void push_list(rtp_reorder_t *r, const uint16_t *list, size_t cnt)
+{
+    for (size_t i = 0; i < cnt; i++)
+        push(r, list[i], 0);
+}
+
+static void check_out(const uint16_t *list, size_t cnt)
+{
+    ck_assert_msg(out_cnt == cnt, "delivered %zu, wanted %zu"
+                  , out_cnt, cnt);
+
+    for (size_t i = 0; i < cnt; i++)
+    {
+        ck_assert_msg(out[i] == list[i], "position %zu: got %u, wanted %u"
+                      , i, out[i], list[i]);
+    }
+}
+
+static void rtp_setup(void)
+{
+    lib_setup();
+    out_cnt = 0;
+}
+
+/* late arrivals are put back in place */
+START_TEST(out_of_order)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(8, 0, MTU, false
+                                              , on_deliver, NULL);
+
+    static const uint16_t in[] = { 10, 12, 13, 11, 15, 14, 16 };
+    push_list(r, in, ASC_ARRAY_SIZE(in));
+
+    static const uint16_t want[] = { 10, 11, 12, 13, 14, 15, 16 };
+    check_out(want, ASC_ARRAY_SIZE(want));
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.received == 7);
+    ck_assert(st.reordered == 2);
+    ck_assert(st.lost == 0 && st.pending == 0);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+/* window overflow skips the gap */
+START_TEST(overflow)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(4, 0, MTU, false
+                                              , on_deliver, NULL);
+
+    static const uint16_t in[] = { 10, 12, 13, 14, 15, 11 };
+    push_list(r, in, ASC_ARRAY_SIZE(in));
+
+    /* 15 doesn't fit while 11 is missing; 11 is late after that */
+    static const uint16_t want[] = { 10, 12, 13, 14, 15 };
+    check_out(want, ASC_ARRAY_SIZE(want));
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.lost == 1 && st.late == 1);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+/* repeats are dropped, whether delivered already or still held */
+START_TEST(duplicates)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(8, 0, MTU, false
+                                              , on_deliver, NULL);
+
+    static const uint16_t in[] = { 10, 11, 11, 13, 13, 12, 10 };
+    push_list(r, in, ASC_ARRAY_SIZE(in));
+
+    static const uint16_t want[] = { 10, 11, 12, 13 };
+    check_out(want, ASC_ARRAY_SIZE(want));
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.duplicate == 3);
+    ck_assert(st.late == 0 && st.lost == 0);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+/* window keeps working across 65535 -> 0 */
+START_TEST(seq_wrap)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(8, 0, MTU, false
+                                              , on_deliver, NULL);
+
+    static const uint16_t in[] = { 65532, 65533, 65535, 1, 0, 65534, 2 };
+    push_list(r, in, ASC_ARRAY_SIZE(in));
+
+    static const uint16_t want[] = { 65532, 65533, 65534, 65535, 0, 1, 2 };
+    check_out(want, ASC_ARRAY_SIZE(want));
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.reordered == 2);
+    ck_assert(st.lost == 0 && st.resync == 0 && st.pending == 0);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+/* big jumps need the next datagram to confirm them */
+START_TEST(restart)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(8, 0, MTU, false
+                                              , on_deliver, NULL);
+
+    /* a lone stray is dropped and the old sequence carries on */
+    static const uint16_t in1[] = { 100, 101, 30000, 102 };
+    push_list(r, in1, ASC_ARRAY_SIZE(in1));
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.stray == 1 && st.resync == 0);
+
+    /* a restart is taken from its second datagram on */
+    static const uint16_t in2[] = { 40000, 40001, 40002 };
+    push_list(r, in2, ASC_ARRAY_SIZE(in2));
+
+    static const uint16_t want[] = { 100, 101, 102, 40001, 40002 };
+    check_out(want, ASC_ARRAY_SIZE(want));
+
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.stray == 2 && st.resync == 1);
+    ck_assert(st.lost == 0 && st.late == 0);
+
+    /* backwards restarts work the same way */
+    static const uint16_t in3[] = { 500, 501 };
+    push_list(r, in3, ASC_ARRAY_SIZE(in3));
+
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.stray == 3 && st.resync == 2);
+    ck_assert(out_cnt == ASC_ARRAY_SIZE(want) + 1);
+    ck_assert(out[out_cnt - 1] == 501);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+/* held datagrams go out after the latency even if input stops */
+START_TEST(poll_timeout)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(8, 1000, MTU, false
+                                              , on_deliver, NULL);
+
+    push(r, 10, 0);
+    push(r, 12, 100);
+    push(r, 13, 200);
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(out_cnt == 1 && st.pending == 2);
+
+    /* not yet */
+    rtp_reorder_poll(r, 1000);
+    ck_assert(out_cnt == 1);
+
+    /* gap opened at 100us */
+    rtp_reorder_poll(r, 1100);
+
+    static const uint16_t want[] = { 10, 12, 13 };
+    check_out(want, ASC_ARRAY_SIZE(want));
+
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.lost == 1 && st.pending == 0);
+
+    /* gap's clock restarts with the next one */
+    push(r, 15, 2000);
+    rtp_reorder_poll(r, 2999);
+    ck_assert(out_cnt == 3);
+    rtp_reorder_poll(r, 3000);
+    ck_assert(out_cnt == 4 && out[3] == 15);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+/* no window: everything passes through, errors are only counted */
+START_TEST(no_window)
+{
+    rtp_reorder_t *const r = rtp_reorder_init(0, 0, MTU, false
+                                              , on_deliver, NULL);
+
+    static const uint16_t in[] = { 10, 12, 11, 12, 13 };
+    push_list(r, in, ASC_ARRAY_SIZE(in));
+    check_out(in, ASC_ARRAY_SIZE(in));
+
+    rtp_stats_t st;
+    rtp_reorder_stats(r, &st);
+    ck_assert(st.lost == 1 && st.late == 1 && st.duplicate == 1);
+
+    rtp_reorder_destroy(r);
+}
+END_TEST
+
+Suite *stream_rtp(void)
+{
+    Suite *const s = suite_create("stream/rtp");
+
+    TCase *const tc = tcase_create("default");
+    tcase_add_checked_fixture(tc, rtp_setup, lib_teardown);
+
+    tcase_add_test(tc, out_of_order);
+    tcase_add_test(tc, overflow);
+    tcase_add_test(tc, duplicates);
+    tcase_add_test(tc, seq_wrap);
+    tcase_add_test(tc, restart);
+    tcase_add_test(tc, poll_timeout);
+    tcase_add_test(tc, no_window);
+
+    suite_add_tcase(s, tc);
+
+    return s;
+}